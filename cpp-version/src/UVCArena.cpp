@@ -0,0 +1,83 @@
+//
+// UVCArena.cpp
+//
+// Monotonic memory arena for per-device metadata.
+//
+// Translated from Objective-C to C++
+// Copyright © 2016
+// Dr. Jeffrey Frey, IT-NSS
+// University of Delaware
+//
+// $Id$
+//
+
+#include "UVCArena.hpp"
+
+#include <algorithm>
+
+std::shared_ptr<UVCArena> UVCArena::create(size_t blockSize) {
+  return std::make_shared<UVCArena>(blockSize);
+}
+
+UVCArena::UVCArena(size_t blockSize)
+    : _blocks(nullptr),
+      _cursor(nullptr),
+      _limit(nullptr),
+      _blockSize(std::max<size_t>(blockSize, 256)),
+      _bytesAllocated(0),
+      _bytesReserved(0),
+      _blockCount(0) {}
+
+UVCArena::~UVCArena() {
+  while (_blocks) {
+    Block* next = _blocks->next;
+    ::operator delete(_blocks);
+    _blocks = next;
+  }
+}
+
+void* UVCArena::allocate(size_t size, size_t alignment) {
+  uintptr_t aligned =
+      (reinterpret_cast<uintptr_t>(_cursor) + alignment - 1) & ~(alignment - 1);
+
+  if (!_cursor || aligned + size > reinterpret_cast<uintptr_t>(_limit)) {
+    // Start a new block; the header is padded so that the first allocation is
+    // suitably aligned:
+    size_t headerSize = (sizeof(Block) + alignment - 1) & ~(alignment - 1);
+    size_t blockSize = std::max(_blockSize, headerSize + size);
+    Block* block = static_cast<Block*>(::operator new(blockSize));
+
+    block->next = _blocks;
+    block->size = blockSize;
+    _blocks = block;
+    _bytesReserved += blockSize;
+    _blockCount++;
+
+    // Oversized requests do not displace the current block:
+    uint8_t* base = reinterpret_cast<uint8_t*>(block);
+    if (blockSize > _blockSize) {
+      _bytesAllocated += size;
+      return base + headerSize;
+    }
+    _cursor = base + sizeof(Block);
+    _limit = base + blockSize;
+    aligned = (reinterpret_cast<uintptr_t>(_cursor) + alignment - 1) &
+              ~(alignment - 1);
+  }
+
+  _cursor = reinterpret_cast<uint8_t*>(aligned + size);
+  _bytesAllocated += size;
+  return reinterpret_cast<void*>(aligned);
+}
+
+size_t UVCArena::bytesAllocated() const {
+  return _bytesAllocated;
+}
+
+size_t UVCArena::bytesReserved() const {
+  return _bytesReserved;
+}
+
+size_t UVCArena::blockCount() const {
+  return _blockCount;
+}
@@ -0,0 +1,153 @@
+//
+// UVCArena.hpp
+//
+// Monotonic memory arena for per-device metadata.
+//
+// Translated from Objective-C to C++
+// Copyright © 2016
+// Dr. Jeffrey Frey, IT-NSS
+// University of Delaware
+//
+// $Id$
+//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <string>
+
+/*!
+  @class UVCArena
+  @abstract Monotonic allocator backing metadata that lives as long as a
+            device.
+
+  Memory is carved sequentially out of a short chain of fixed-size blocks;
+  individual allocations are never freed.  Every block is released at once
+  when the arena is destroyed.  A request too large for a regular block gets
+  a block of its own.
+
+  An arena is not thread-safe:  it is meant to be used by whatever serializes
+  access to its owner.
+*/
+class UVCArena {
+ private:
+  struct Block {
+    Block* next;
+    size_t size;
+  };
+
+  Block* _blocks;
+  uint8_t* _cursor;
+  uint8_t* _limit;
+  size_t _blockSize;
+  size_t _bytesAllocated;
+  size_t _bytesReserved;
+  size_t _blockCount;
+
+ public:
+  /*!
+    @method create
+
+    Returns a shared_ptr to an empty arena which obtains memory from the heap
+    blockSize bytes at a time.  No memory is reserved until the first
+    allocation.
+  */
+  static std::shared_ptr<UVCArena> create(size_t blockSize = 4096);
+
+  explicit UVCArena(size_t blockSize);
+  ~UVCArena();
+
+  // Delete copy constructor and assignment operator
+  UVCArena(const UVCArena&) = delete;
+  UVCArena& operator=(const UVCArena&) = delete;
+
+  /*!
+    @method allocate
+
+    Returns size bytes aligned to alignment (a power of two).  Throws
+    std::bad_alloc if a new block cannot be obtained.
+  */
+  void* allocate(size_t size, size_t alignment = alignof(std::max_align_t));
+
+  /*!
+    @method bytesAllocated
+
+    Returns the number of bytes handed out, excluding alignment padding.
+  */
+  size_t bytesAllocated() const;
+
+  /*!
+    @method bytesReserved
+
+    Returns the number of bytes obtained from the heap for blocks.
+  */
+  size_t bytesReserved() const;
+
+  /*!
+    @method blockCount
+
+    Returns the number of blocks obtained from the heap.
+  */
+  size_t blockCount() const;
+};
+
+/*!
+  @class UVCArenaAllocator
+  @abstract Standard allocator drawing from a UVCArena.
+
+  Containers and std::allocate_shared use this to place their storage in an
+  arena.  Each allocator holds a reference to its arena, so the arena outlives
+  every object placed in it even if its owner goes away first.  An allocator
+  without an arena falls back to the heap, which lets arena-aware types be
+  used standalone.
+*/
+template <typename T>
+class UVCArenaAllocator {
+ private:
+  std::shared_ptr<UVCArena> _arena;
+
+  template <typename U>
+  friend class UVCArenaAllocator;
+
+ public:
+  using value_type = T;
+
+  UVCArenaAllocator() noexcept = default;
+  explicit UVCArenaAllocator(std::shared_ptr<UVCArena> arena) noexcept
+      : _arena(std::move(arena)) {}
+  template <typename U>
+  UVCArenaAllocator(const UVCArenaAllocator<U>& other) noexcept
+      : _arena(other._arena) {}
+
+  T* allocate(size_t n) {
+    if (_arena) {
+      return static_cast<T*>(_arena->allocate(n * sizeof(T), alignof(T)));
+    }
+    return static_cast<T*>(::operator new(n * sizeof(T)));
+  }
+
+  // Arena memory is reclaimed only when the arena itself goes away:
+  void deallocate(T* p, size_t) noexcept {
+    if (!_arena) {
+      ::operator delete(p);
+    }
+  }
+
+  const std::shared_ptr<UVCArena>& arena() const { return _arena; }
+
+  template <typename U>
+  bool operator==(const UVCArenaAllocator<U>& other) const {
+    return _arena == other._arena;
+  }
+  template <typename U>
+  bool operator!=(const UVCArenaAllocator<U>& other) const {
+    return _arena != other._arena;
+  }
+};
+
+// String whose storage is drawn from a UVCArena:
+using UVCArenaString =
+    std::basic_string<char, std::char_traits<char>, UVCArenaAllocator<char>>;
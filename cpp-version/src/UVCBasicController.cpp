@@ -0,0 +1,133 @@
+//
+// UVCBasicController.cpp
+//
+// Control request path of a UVC device, with the transport as a compile-time
+// policy.
+//
+// Translated from Objective-C to C++
+// Copyright © 2016
+// Dr. Jeffrey Frey, IT-NSS
+// University of Delaware
+//
+// $Id$
+//
+
+#include "UVCBasicController.hpp"
+
+#include <algorithm>
+
+#include "UVCDiagnostics.hpp"
+
+UVCVideoControlTopology UVCParseVideoControlDescriptors(
+    const std::vector<uint8_t>& descriptors) {
+  UVCVideoControlTopology topology;
+
+  if (descriptors.size() < sizeof(UVC_Descriptor_Header)) {
+    UVC_DIAGNOSTIC(Info, Descriptor,
+                   "no VideoControl descriptors, using default unit ids");
+    return topology;
+  }
+
+  const UVC_Descriptor_Header* descriptor =
+      reinterpret_cast<const UVC_Descriptor_Header*>(descriptors.data());
+
+  if (descriptor->bDescriptorSubType == VC_HEADER) {
+    // Parse UVC header to get version
+    struct UVC_VC_Header {
+      uint8_t bLength;
+      uint8_t bDescriptorType;
+      uint8_t bDescriptorSubType;
+      uint16_t bcdUVC;
+      uint16_t wTotalLength;
+      uint32_t dwClockFrequency;
+      uint8_t bInCollection;
+      uint8_t baInterfaceNr1;
+      // ... more fields
+    } __attribute__((packed));
+
+    if (descriptors.size() < sizeof(UVC_VC_Header))
+      return topology;
+
+    const UVC_VC_Header* header =
+        reinterpret_cast<const UVC_VC_Header*>(descriptor);
+    const uint8_t* headerBytes = descriptors.data();
+    topology.uvcVersion =
+        headerBytes[3] | (headerBytes[4] << 8);  // little endian
+    UVC_DIAGNOSTIC(Debug, Descriptor, "VideoControl header, UVC %x.%02x",
+                   topology.uvcVersion >> 8, topology.uvcVersion & 0xff);
+
+    // Walk through embedded Unit/Terminal descriptors
+    const uint8_t* basePtr = descriptors.data();
+    const uint8_t* endPtr =
+        basePtr + std::min<size_t>(headerBytes[5] | (headerBytes[6] << 8),
+                                   descriptors.size());
+    basePtr += header->bLength;
+
+    while (basePtr + sizeof(UVC_Descriptor_Header) <= endPtr) {
+      const UVC_Descriptor_Header* subDesc =
+          reinterpret_cast<const UVC_Descriptor_Header*>(basePtr);
+
+      // A zero-length or truncated descriptor ends the walk:
+      if (subDesc->bLength < sizeof(UVC_Descriptor_Header) ||
+          basePtr + subDesc->bLength > endPtr) {
+        UVC_DIAGNOSTIC(Info, Descriptor,
+                       "truncated descriptor at offset %td ends the walk",
+                       basePtr - descriptors.data());
+        break;
+      }
+
+      if (subDesc->bDescriptorType == CS_INTERFACE) {
+        if (subDesc->bDescriptorSubType == VC_PROCESSING_UNIT) {
+          // Processing Unit descriptor - extract unit ID
+          struct UVC_PU_Header {
+            uint8_t bLength;
+            uint8_t bDescriptorType;
+            uint8_t bDescriptorSubType;
+            uint8_t bUnitId;  // This is what we need!
+            uint8_t bSourceId;
+            uint16_t wMaxMultiplier;
+            uint8_t bControlSize;
+            // uint8_t bmControls[]; // variable length
+          } __attribute__((packed));
+
+          const UVC_PU_Header* puHeader =
+              reinterpret_cast<const UVC_PU_Header*>(basePtr);
+          topology.unitIds[0] = puHeader->bUnitId;
+          UVC_DIAGNOSTIC(Debug, Descriptor, "processing unit %u",
+                         puHeader->bUnitId);
+
+          // Store control capabilities if needed
+          if (subDesc->bLength >= sizeof(UVC_PU_Header) &&
+              puHeader->bControlSize > 0 &&
+              sizeof(UVC_PU_Header) + puHeader->bControlSize <=
+                  subDesc->bLength) {
+            const uint8_t* controls = basePtr + sizeof(UVC_PU_Header);
+            topology.processingUnitControlsAvailable.assign(
+                controls, controls + puHeader->bControlSize);
+          }
+        } else if (subDesc->bDescriptorSubType == VC_INPUT_TERMINAL) {
+          // Input Terminal descriptor
+          struct UVC_IT_Header {
+            uint8_t bLength;
+            uint8_t bDescriptorType;
+            uint8_t bDescriptorSubType;
+            uint8_t bTerminalId;  // This is what we need!
+            uint16_t wTerminalType;
+            uint8_t bAssocTerminal;
+            uint8_t iTerminal;
+            // Camera terminal has more fields...
+          } __attribute__((packed));
+
+          const UVC_IT_Header* itHeader =
+              reinterpret_cast<const UVC_IT_Header*>(basePtr);
+          topology.unitIds[1] = itHeader->bTerminalId;
+          UVC_DIAGNOSTIC(Debug, Descriptor, "input terminal %u",
+                         itHeader->bTerminalId);
+        }
+      }
+
+      basePtr += subDesc->bLength;
+    }
+  }
+  return topology;
+}
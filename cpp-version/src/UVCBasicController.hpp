@@ -0,0 +1,447 @@
+//
+// UVCBasicController.hpp
+//
+// Control request path of a UVC device, with the transport as a compile-time
+// policy.
+//
+// Translated from Objective-C to C++
+// Copyright © 2016
+// Dr. Jeffrey Frey, IT-NSS
+// University of Delaware
+//
+// $Id$
+//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <vector>
+
+#include "UVCDiagnostics.hpp"
+#include "UVCProtocol.hpp"
+#include "UVCTransport.hpp"
+#include "UVCValue.hpp"
+
+using uvc_capabilities_t = uint32_t;
+
+// UVC Control Capability Flags
+enum {
+  // Bits 0-7 from UVC standard
+  kUVCControlSupportsGet = 1 << 0,
+  kUVCControlSupportsSet = 1 << 1,
+  kUVCControlDisabledDueToAutomaticMode = 1 << 2,
+  kUVCControlAutoUpdateControl = 1 << 3,
+  kUVCControlAsynchronousControl = 1 << 4,
+  // Bits 8+ are custom
+  kUVCControlHasRange = 1 << 8,
+  kUVCControlHasStepSize = 1 << 9,
+  kUVCControlHasDefaultValue = 1 << 10
+};
+
+// Control structure for tracking UVC controls
+struct UVCControlDef {
+  const char* name;
+  const char* typeSignature;
+  int controlSelector;
+  int unitType;  // 0 = processing unit, 1 = camera terminal
+
+  constexpr UVCControlDef(const char* n, const char* ts, int cs, int ut)
+      : name(n), typeSignature(ts), controlSelector(cs), unitType(ut) {}
+};
+
+// Global control definitions, indexed by control id; constant-initialized, so
+// no static constructor runs for the table:
+inline constexpr UVCControlDef uvcControlDefinitions[] = {
+    // Processing Unit Controls
+    UVCControlDef("brightness", "{S2}", UVC_PU_BRIGHTNESS_CONTROL, 0),
+    UVCControlDef("contrast", "{U2}", UVC_PU_CONTRAST_CONTROL, 0),
+    UVCControlDef("hue", "{S2}", UVC_PU_HUE_CONTROL, 0),
+    UVCControlDef("saturation", "{U2}", UVC_PU_SATURATION_CONTROL, 0),
+    UVCControlDef("sharpness", "{U2}", UVC_PU_SHARPNESS_CONTROL, 0),
+    UVCControlDef("gamma", "{U2}", UVC_PU_GAMMA_CONTROL, 0),
+    UVCControlDef("backlight-compensation",
+                  "{U2}",
+                  UVC_PU_BACKLIGHT_COMPENSATION_CONTROL,
+                  0),
+    UVCControlDef("gain", "{U2}", UVC_PU_GAIN_CONTROL, 0),
+    UVCControlDef("power-line-frequency",
+                  "{U1}",
+                  UVC_PU_POWER_LINE_FREQUENCY_CONTROL,
+                  0),
+    UVCControlDef("white-balance-temp",
+                  "{U2}",
+                  UVC_PU_WHITE_BALANCE_TEMPERATURE_CONTROL,
+                  0),
+    UVCControlDef("auto-white-balance-temp",
+                  "{B}",
+                  UVC_PU_WHITE_BALANCE_TEMPERATURE_AUTO_CONTROL,
+                  0),
+
+    // Camera Terminal Controls
+    UVCControlDef("auto-exposure-mode", "{U1}", UVC_CT_AE_MODE_CONTROL, 1),
+    UVCControlDef("auto-exposure-priority",
+                  "{B}",
+                  UVC_CT_AE_PRIORITY_CONTROL,
+                  1),
+    UVCControlDef("exposure-time-abs",
+                  "{U4}",
+                  UVC_CT_EXPOSURE_TIME_ABSOLUTE_CONTROL,
+                  1),
+    UVCControlDef("focus-abs", "{U2}", UVC_CT_FOCUS_ABSOLUTE_CONTROL, 1),
+    UVCControlDef("focus-rel", "{S1}", UVC_CT_FOCUS_RELATIVE_CONTROL, 1),
+    UVCControlDef("auto-focus", "{B}", UVC_CT_FOCUS_AUTO_CONTROL, 1),
+    UVCControlDef("iris-abs", "{U2}", UVC_CT_IRIS_ABSOLUTE_CONTROL, 1),
+    UVCControlDef("zoom-abs", "{U2}", UVC_CT_ZOOM_ABSOLUTE_CONTROL, 1),
+    UVCControlDef("zoom-rel",
+                  "{S1 zoom;U1 digital-zoom;U1 speed}",
+                  UVC_CT_ZOOM_RELATIVE_CONTROL,
+                  1),
+    UVCControlDef("pan-tilt-abs",
+                  "{S4 pan; S4 tilt}",
+                  UVC_CT_PANTILT_ABSOLUTE_CONTROL,
+                  1),
+    UVCControlDef("pan-tilt-rel",
+                  "{S1 pan;U1 pan-speed; S1 tilt;U1 tilt-speed}",
+                  UVC_CT_PANTILT_RELATIVE_CONTROL,
+                  1),
+    UVCControlDef("privacy", "{B}", UVC_CT_PRIVACY_CONTROL, 1),
+};
+
+/*!
+  @struct UVCVideoControlTopology
+
+  What a controller needs from the VideoControl descriptors:  the UVC version
+  and the unit ids that control requests are addressed to.
+*/
+struct UVCVideoControlTopology {
+  uint16_t uvcVersion = 0x0100;
+  // Indexed by control unit type (0 = processing unit, 1 = camera terminal);
+  // the defaults are used when the descriptors do not name the unit:
+  int unitIds[2] = {0x02, 0x01};
+  std::vector<uint8_t> terminalControlsAvailable;
+  std::vector<uint8_t> processingUnitControlsAvailable;
+};
+
+/*!
+  @function UVCParseVideoControlDescriptors
+
+  Walk a class-specific VideoControl descriptor block (as returned by
+  UVCTransport::videoControlDescriptors) and return the topology it describes.
+  Malformed or truncated descriptors end the walk; whatever was found up to
+  that point is kept.
+*/
+UVCVideoControlTopology UVCParseVideoControlDescriptors(
+    const std::vector<uint8_t>& descriptors);
+
+/*!
+  @class BasicUVCDeviceController
+  @abstract Control requests to one UVC device over a Transport.
+
+  Builds the setup packet for each request and hands it to the transport.
+  Transport is either UVCTransport, in which case every transfer is a virtual
+  call (this is how UVCDeviceController uses it), or a concrete, final
+  transport class such as UVCSimulatedTransport or UVCIOKitTransport.  In the
+  latter case the calls are bound at compile time and can be inlined, which
+  suits single-backend builds that address controls by id and do not need
+  UVCControl objects.
+*/
+template <class Transport>
+class BasicUVCDeviceController {
+ protected:
+  // Carries all control requests to the device:
+  std::shared_ptr<Transport> _transport;
+
+  // Indexed by control unit type (0 = processing unit, 1 = camera terminal):
+  int _unitIds[2];
+  uint16_t _uvcVersion;
+  std::vector<uint8_t> _terminalControlsAvailable;
+  std::vector<uint8_t> _processingUnitControlsAvailable;
+  UVCTransferStatus _lastTransferStatus;
+
+ public:
+  /*!
+    @method BasicUVCDeviceController
+
+    Unit ids and the UVC version are taken from the transport's VideoControl
+    descriptors; defaults are used if transport is nullptr.
+  */
+  explicit BasicUVCDeviceController(std::shared_ptr<Transport> transport);
+
+  /*!
+    @method transport
+
+    Returns the transport that carries this controller's control requests.
+  */
+  const std::shared_ptr<Transport>& transport() const { return _transport; }
+
+  /*!
+    @method uvcVersion
+
+    Returns the version of the UVC specification which the device
+    implements (as a binary-coded decimal value, e.g. 0x0210 = 2.10).
+  */
+  uint16_t uvcVersion() const { return _uvcVersion; }
+
+  /*!
+    @method isInterfaceOpen
+
+    Returns true if the device interface is open.  The interface must be
+    open in order to send/receive control requests.
+  */
+  bool isInterfaceOpen() const { return _transport && _transport->isOpen(); }
+
+  /*!
+    @method setIsInterfaceOpen
+
+    Force the device interface into an open- or closed-state.
+  */
+  void setIsInterfaceOpen(bool isInterfaceOpen);
+
+  /*!
+    @method unitIdForControl
+
+    Returns the id of the unit or terminal that implements the control with
+    the given (valid) control id.
+  */
+  int unitIdForControl(size_t controlId) const {
+    return _unitIds[uvcControlDefinitions[controlId].unitType];
+  }
+
+  /*!
+    @method sendControlRequest
+
+    Perform the request, opening the interface first if necessary.  Returns
+    true if the transfer succeeded.
+  */
+  bool sendControlRequest(UVCControlRequest& controlRequest);
+
+  /*!
+    @method lastTransferStatus
+
+    Returns the outcome of the most recent sendControlRequest.  A transport
+    that could not be opened counts as NoDevice.
+  */
+  UVCTransferStatus lastTransferStatus() const { return _lastTransferStatus; }
+
+  /*!
+    @method getData
+
+    Issue the GET request type (UVC_GET_CUR, UVC_GET_MIN, ...) for selector
+    on the given unit, reading length bytes into value.
+  */
+  bool getData(void* value, int type, int length, int selector, int unitId);
+
+  /*!
+    @method setData
+
+    Issue SET_CUR for selector on the given unit with length bytes of value.
+  */
+  bool setData(void* value, int length, int selector, int unitId);
+
+  /*!
+    @method capabilities
+
+    Read the GET_INFO capability bits of the control with the given id.
+    Returns false if the device does not answer, i.e. the control is not
+    available.
+  */
+  bool capabilities(uvc_capabilities_t* capabilities, size_t controlId);
+
+  /*!
+    @method getValue
+
+    Read the current value of the control with the given id into value,
+    which must be sized for the control.  The data is left in USB byte order.
+  */
+  bool getValue(UVCValue& value, size_t controlId);
+
+  /*!
+    @method setValue
+
+    Write value (in USB byte order) to the control with the given id.
+  */
+  bool setValue(UVCValue& value, size_t controlId);
+
+  /*!
+    @method getValueData
+
+    Read the current value of the control with the given id (in USB byte
+    order) into the length bytes at data.
+  */
+  bool getValueData(void* data, size_t length, size_t controlId);
+
+  /*!
+    @method setValueData
+
+    Write the length bytes at data (in USB byte order) to the control with the
+    given id.
+  */
+  bool setValueData(void* data, size_t length, size_t controlId);
+};
+
+template <class Transport>
+BasicUVCDeviceController<Transport>::BasicUVCDeviceController(
+    std::shared_ptr<Transport> transport)
+    : _transport(std::move(transport)),
+      _lastTransferStatus(UVCTransferStatus::Success) {
+  UVCVideoControlTopology topology;
+
+  if (_transport) {
+    topology =
+        UVCParseVideoControlDescriptors(_transport->videoControlDescriptors());
+  }
+  _unitIds[0] = topology.unitIds[0];
+  _unitIds[1] = topology.unitIds[1];
+  _uvcVersion = topology.uvcVersion;
+  _terminalControlsAvailable = std::move(topology.terminalControlsAvailable);
+  _processingUnitControlsAvailable =
+      std::move(topology.processingUnitControlsAvailable);
+}
+
+template <class Transport>
+void BasicUVCDeviceController<Transport>::setIsInterfaceOpen(
+    bool isInterfaceOpen) {
+  if (!_transport) {
+    return;
+  }
+  if (isInterfaceOpen) {
+    _transport->open();
+  } else {
+    _transport->close();
+  }
+}
+
+template <class Transport>
+bool BasicUVCDeviceController<Transport>::sendControlRequest(
+    UVCControlRequest& controlRequest) {
+  if (!_transport) {
+    return false;
+  }
+
+  // Auto-open interface if not already open (like original Objective-C code)
+  if (!_transport->isOpen()) {
+    if (!_transport->open()) {
+      _lastTransferStatus = UVCTransferStatus::NoDevice;
+      return false;
+    }
+  }
+
+  UVCTransferStatus status = _transport->controlRequest(controlRequest);
+
+  _lastTransferStatus = status;
+  if (status != UVCTransferStatus::Success) {
+    UVC_DIAGNOSTIC(Info, Transfer,
+                   "request 0x%02x wValue 0x%04x wIndex 0x%04x failed (%d)",
+                   controlRequest.bRequest, controlRequest.wValue,
+                   controlRequest.wIndex, static_cast<int>(status));
+    return false;
+  }
+  UVC_DIAGNOSTIC(Debug, Transfer,
+                 "request 0x%02x wValue 0x%04x wIndex 0x%04x: %u bytes",
+                 controlRequest.bRequest, controlRequest.wValue,
+                 controlRequest.wIndex, controlRequest.wLenDone);
+  return true;
+}
+
+template <class Transport>
+bool BasicUVCDeviceController<Transport>::setData(void* value,
+                                                  int length,
+                                                  int selector,
+                                                  int unitId) {
+  UVCControlRequest request;
+
+  request.bmRequestType = UVC_REQUEST_TYPE_SET;
+  request.bRequest = UVC_SET_CUR;
+  request.wValue = (selector << 8);
+  // UVC protocol: (unitId << 8) | interfaceIndex
+  request.wIndex = (unitId << 8) | _transport->interfaceNumber();
+  request.wLength = length;
+  request.pData = value;
+  request.wLenDone = 0;
+
+  return sendControlRequest(request);
+}
+
+template <class Transport>
+bool BasicUVCDeviceController<Transport>::getData(void* value,
+                                                  int type,
+                                                  int length,
+                                                  int selector,
+                                                  int unitId) {
+  UVCControlRequest request;
+
+  request.bmRequestType = UVC_REQUEST_TYPE_GET;
+  request.bRequest = type;  // GET_CUR, GET_MIN, GET_MAX, etc.
+  request.wValue = (selector << 8);
+  // UVC protocol: (unitId << 8) | interfaceIndex
+  request.wIndex = (unitId << 8) | _transport->interfaceNumber();
+  request.wLength = length;
+  request.pData = value;
+  request.wLenDone = 0;
+
+  return sendControlRequest(request);
+}
+
+template <class Transport>
+bool BasicUVCDeviceController<Transport>::capabilities(
+    uvc_capabilities_t* capabilities,
+    size_t controlId) {
+  if (controlId >= std::size(uvcControlDefinitions)) {
+    return false;
+  }
+
+  uint8_t scratch;
+  if (getData(&scratch, UVC_GET_INFO, 1,
+              uvcControlDefinitions[controlId].controlSelector,
+              unitIdForControl(controlId))) {
+    *capabilities = scratch;
+    return true;
+  }
+
+  // If USB request fails, this control is not available
+  return false;
+}
+
+template <class Transport>
+bool BasicUVCDeviceController<Transport>::getValue(UVCValue& value,
+                                                   size_t controlId) {
+  return getValueData(value.valuePtr(), value.byteSize(), controlId);
+}
+
+template <class Transport>
+bool BasicUVCDeviceController<Transport>::setValue(UVCValue& value,
+                                                   size_t controlId) {
+  return setValueData(value.valuePtr(), value.byteSize(), controlId);
+}
+
+template <class Transport>
+bool BasicUVCDeviceController<Transport>::getValueData(void* data,
+                                                       size_t length,
+                                                       size_t controlId) {
+  if (controlId >= std::size(uvcControlDefinitions)) {
+    return false;
+  }
+
+  return getData(data, UVC_GET_CUR, static_cast<int>(length),
+                 uvcControlDefinitions[controlId].controlSelector,
+                 unitIdForControl(controlId));
+}
+
+template <class Transport>
+bool BasicUVCDeviceController<Transport>::setValueData(void* data,
+                                                       size_t length,
+                                                       size_t controlId) {
+  if (controlId >= std::size(uvcControlDefinitions)) {
+    return false;
+  }
+
+  return setData(data, static_cast<int>(length),
+                 uvcControlDefinitions[controlId].controlSelector,
+                 unitIdForControl(controlId));
+}
+
+// UVCDeviceController instantiates the dynamic form once, in UVCController.cpp:
+extern template class BasicUVCDeviceController<UVCTransport>;
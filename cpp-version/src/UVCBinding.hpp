@@ -0,0 +1,352 @@
+//
+// UVCBinding.hpp
+//
+// Binding of packed C++ structs to control value layouts.
+//
+// Translated from Objective-C to C++
+// Copyright © 2016
+// Dr. Jeffrey Frey, IT-NSS
+// University of Delaware
+//
+// $Id$
+//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include "UVCBasicController.hpp"
+#include "UVCLayout.hpp"
+
+/*!
+  @struct UVCBinding
+  @abstract Maps the C++ type T onto the packed layout of a control value.
+
+  There is no general definition:  a type is made bindable by specializing
+  UVCBinding for it, normally by deriving from UVCStructBinding (structs) or
+  UVCScalarBinding (single integers).  A specialization provides
+
+    LayoutType              the UVCLayout T corresponds to
+    matches(type)           true if a UVCType has that layout
+    byteSwap(value)         convert a T between host and USB byte order
+
+  and may name the built-in control it describes with controlName, in which
+  case the control's type signature is checked against LayoutType when the
+  specialization is compiled.  UVCControl::read<T> and UVCControl::write<T>
+  transfer straight into and out of a T through its binding.
+*/
+template <class T>
+struct UVCBinding;
+
+/*!
+  @struct UVCBoundField
+  @abstract One member of a bound struct:  the member pointer and its
+            offsetof() value, e.g.
+
+              UVCBoundField<&UVCPanTiltAbsolute::pan,
+                            offsetof(UVCPanTiltAbsolute, pan)>
+*/
+template <auto Member, size_t Offset>
+struct UVCBoundField {
+ private:
+  template <class MemberPointer>
+  struct Traits;
+  template <class Struct, class Field>
+  struct Traits<Field Struct::*> {
+    using StructType = Struct;
+    using FieldType = Field;
+  };
+
+ public:
+  using StructType = typename Traits<decltype(Member)>::StructType;
+  using FieldType = typename Traits<decltype(Member)>::FieldType;
+  static constexpr size_t offset = Offset;
+};
+
+/*!
+  @function UVCSignatureMatchesComponents
+
+  Returns true if the type signature (as in uvcControlDefinitions, e.g.
+  "{S4 pan; S4 tilt}") consists of exactly the count component types given.
+  Usable in constant expressions.
+*/
+constexpr bool UVCSignatureMatchesComponents(
+    const char* signature,
+    const UVCTypeComponentType* componentTypes,
+    size_t count) {
+  size_t index = 0;
+
+  while (*signature) {
+    // Skip to the type code of the next field:
+    while (*signature && !((*signature >= 'A' && *signature <= 'Z') ||
+                           (*signature >= 'a' && *signature <= 'z'))) {
+      signature++;
+    }
+    if (!*signature) {
+      break;
+    }
+
+    char code = *signature++;
+    char width = (*signature >= '0' && *signature <= '9') ? *signature++ : 0;
+    UVCTypeComponentType fieldType = UVCTypeComponentType::Invalid;
+
+    if (code == 'B' || code == 'b') {
+      fieldType = UVCTypeComponentType::Boolean;
+    } else if (width == '1' || width == '2' || width == '4' || width == '8') {
+      constexpr UVCTypeComponentType signedTypes[] = {
+          UVCTypeComponentType::SInt8, UVCTypeComponentType::SInt16,
+          UVCTypeComponentType::SInt32, UVCTypeComponentType::SInt64};
+      constexpr UVCTypeComponentType unsignedTypes[] = {
+          UVCTypeComponentType::UInt8, UVCTypeComponentType::UInt16,
+          UVCTypeComponentType::UInt32, UVCTypeComponentType::UInt64};
+      constexpr UVCTypeComponentType bitmapTypes[] = {
+          UVCTypeComponentType::Bitmap8, UVCTypeComponentType::Bitmap16,
+          UVCTypeComponentType::Bitmap32, UVCTypeComponentType::Bitmap64};
+      int widthIndex = (width == '1') ? 0 : (width == '2') ? 1
+                                          : (width == '4') ? 2
+                                                           : 3;
+
+      switch (code) {
+        case 'S':
+        case 's':
+          fieldType = signedTypes[widthIndex];
+          break;
+        case 'U':
+        case 'u':
+          fieldType = unsignedTypes[widthIndex];
+          break;
+        case 'M':
+        case 'm':
+          fieldType = bitmapTypes[widthIndex];
+          break;
+      }
+    }
+    if (fieldType == UVCTypeComponentType::Invalid || index >= count ||
+        componentTypes[index] != fieldType) {
+      return false;
+    }
+    index++;
+
+    // Skip the field name:
+    while (*signature && *signature != ';' && *signature != '}') {
+      signature++;
+    }
+  }
+  return index == count;
+}
+
+/*!
+  @function UVCControlIdWithNameConstant
+
+  Compile-time form of UVCDeviceController::controlIdWithName.  Returns
+  std::size(uvcControlDefinitions) if there is no such control.
+*/
+constexpr size_t UVCControlIdWithNameConstant(const char* controlName) {
+  for (size_t id = 0; id < std::size(uvcControlDefinitions); id++) {
+    const char* name = uvcControlDefinitions[id].name;
+    size_t i = 0;
+
+    while (name[i] && name[i] == controlName[i]) {
+      i++;
+    }
+    if (name[i] == controlName[i]) {
+      return id;
+    }
+  }
+  return std::size(uvcControlDefinitions);
+}
+
+/*!
+  @function UVCControlHasLayout
+
+  Returns true if the built-in control named controlName has the fields of
+  Layout.  Usable in constant expressions.
+*/
+template <class Layout>
+constexpr bool UVCControlHasLayout(const char* controlName) {
+  size_t controlId = UVCControlIdWithNameConstant(controlName);
+
+  return controlId < std::size(uvcControlDefinitions) &&
+         UVCSignatureMatchesComponents(
+             uvcControlDefinitions[controlId].typeSignature,
+             Layout::componentTypes, Layout::fieldCount);
+}
+
+/*!
+  @function UVCBoundFieldsMatch
+
+  Returns true if each UVCBoundField in the tuple Fields has the storage type
+  and offset of the corresponding component of Layout.
+*/
+template <class Layout, class Fields, size_t... Index>
+constexpr bool UVCBoundFieldsMatch(std::index_sequence<Index...>) {
+  return ((std::is_same_v<
+               typename std::tuple_element_t<Index, Fields>::FieldType,
+               typename Layout::template Component<Index>::StorageType> &&
+           std::tuple_element_t<Index, Fields>::offset ==
+               Layout::offsets[Index]) &&
+          ...);
+}
+
+/*!
+  @struct UVCStructBinding
+  @abstract Base for the UVCBinding of a packed struct T whose members, in
+            order, are the fields of Layout.
+
+  Verified when instantiated:  T is trivially copyable with standard layout
+  and exactly Layout::byteSize bytes (so it must be packed if its members
+  would otherwise be padded), each field names a member of T of the
+  component's storage type, and each member sits at the component's offset.
+*/
+template <class T, class Layout, class... Fields>
+struct UVCStructBinding {
+  using LayoutType = Layout;
+
+  static_assert(std::is_trivially_copyable_v<T> &&
+                    std::is_standard_layout_v<T>,
+                "a bound struct must be trivially copyable standard layout");
+  static_assert(sizeof(T) == Layout::byteSize,
+                "a bound struct must be exactly as large as its layout");
+  static_assert(sizeof...(Fields) == Layout::fieldCount,
+                "a bound struct needs one field per layout component");
+  static_assert((std::is_same_v<typename Fields::StructType, T> && ...),
+                "every bound field must be a member of the struct");
+  static_assert(UVCBoundFieldsMatch<Layout, std::tuple<Fields...>>(
+                    std::make_index_sequence<Layout::fieldCount>()),
+                "bound fields must match the layout's types and offsets");
+
+  /*!
+    @method matches
+
+    Returns true if type has this binding's layout; a struct bound to a
+    runtime type (e.g. one parsed from a user-supplied signature) should be
+    checked once with this when it is registered.
+  */
+  static bool matches(const UVCType& type) {
+    return type.layoutCodec() == &Layout::codec || Layout::matches(type);
+  }
+
+  /*!
+    @method byteSwap
+
+    Convert value in place between host and USB byte order.
+  */
+  static void byteSwap(T& value) { Layout::byteSwap(&value); }
+};
+
+/*!
+  @struct UVCScalarBinding
+  @abstract Base for the UVCBinding of an integer type T, which binds to any
+            single-field type of the same width (signed, unsigned or bitmap).
+*/
+template <class T, class Component>
+struct UVCScalarBinding {
+  using LayoutType = UVCLayout<Component>;
+
+  static_assert(std::is_same_v<T, typename Component::StorageType>,
+                "a scalar binding must use its own storage type");
+
+  static bool matches(const UVCType& type) {
+    return type.fieldCount() == 1 && type.byteSize() == sizeof(T);
+  }
+
+  static void byteSwap(T& value) { Component::byteSwap(&value); }
+};
+
+template <>
+struct UVCBinding<int8_t> : UVCScalarBinding<int8_t, UVCComponentS1> {};
+template <>
+struct UVCBinding<uint8_t> : UVCScalarBinding<uint8_t, UVCComponentU1> {};
+template <>
+struct UVCBinding<int16_t> : UVCScalarBinding<int16_t, UVCComponentS2> {};
+template <>
+struct UVCBinding<uint16_t> : UVCScalarBinding<uint16_t, UVCComponentU2> {};
+template <>
+struct UVCBinding<int32_t> : UVCScalarBinding<int32_t, UVCComponentS4> {};
+template <>
+struct UVCBinding<uint32_t> : UVCScalarBinding<uint32_t, UVCComponentU4> {};
+template <>
+struct UVCBinding<int64_t> : UVCScalarBinding<int64_t, UVCComponentS8> {};
+template <>
+struct UVCBinding<uint64_t> : UVCScalarBinding<uint64_t, UVCComponentU8> {};
+
+// Values of the built-in multi-field controls:
+
+struct UVCZoomRelative {
+  int8_t zoom;
+  uint8_t digitalZoom;
+  uint8_t speed;
+};
+
+template <>
+struct UVCBinding<UVCZoomRelative>
+    : UVCStructBinding<
+          UVCZoomRelative,
+          UVCLayout<UVCComponentS1, UVCComponentU1, UVCComponentU1>,
+          UVCBoundField<&UVCZoomRelative::zoom,
+                        offsetof(UVCZoomRelative, zoom)>,
+          UVCBoundField<&UVCZoomRelative::digitalZoom,
+                        offsetof(UVCZoomRelative, digitalZoom)>,
+          UVCBoundField<&UVCZoomRelative::speed,
+                        offsetof(UVCZoomRelative, speed)>> {
+  static constexpr const char* controlName = "zoom-rel";
+};
+
+struct UVCPanTiltAbsolute {
+  int32_t pan;
+  int32_t tilt;
+};
+
+template <>
+struct UVCBinding<UVCPanTiltAbsolute>
+    : UVCStructBinding<UVCPanTiltAbsolute,
+                       UVCLayout<UVCComponentS4, UVCComponentS4>,
+                       UVCBoundField<&UVCPanTiltAbsolute::pan,
+                                     offsetof(UVCPanTiltAbsolute, pan)>,
+                       UVCBoundField<&UVCPanTiltAbsolute::tilt,
+                                     offsetof(UVCPanTiltAbsolute, tilt)>> {
+  static constexpr const char* controlName = "pan-tilt-abs";
+};
+
+struct UVCPanTiltRelative {
+  int8_t pan;
+  uint8_t panSpeed;
+  int8_t tilt;
+  uint8_t tiltSpeed;
+};
+
+template <>
+struct UVCBinding<UVCPanTiltRelative>
+    : UVCStructBinding<
+          UVCPanTiltRelative,
+          UVCLayout<UVCComponentS1,
+                    UVCComponentU1,
+                    UVCComponentS1,
+                    UVCComponentU1>,
+          UVCBoundField<&UVCPanTiltRelative::pan,
+                        offsetof(UVCPanTiltRelative, pan)>,
+          UVCBoundField<&UVCPanTiltRelative::panSpeed,
+                        offsetof(UVCPanTiltRelative, panSpeed)>,
+          UVCBoundField<&UVCPanTiltRelative::tilt,
+                        offsetof(UVCPanTiltRelative, tilt)>,
+          UVCBoundField<&UVCPanTiltRelative::tiltSpeed,
+                        offsetof(UVCPanTiltRelative, tiltSpeed)>> {
+  static constexpr const char* controlName = "pan-tilt-rel";
+};
+
+static_assert(UVCControlHasLayout<UVCBinding<UVCZoomRelative>::LayoutType>(
+                  UVCBinding<UVCZoomRelative>::controlName),
+              "UVCZoomRelative does not match the zoom-rel control");
+static_assert(
+    UVCControlHasLayout<UVCBinding<UVCPanTiltAbsolute>::LayoutType>(
+        UVCBinding<UVCPanTiltAbsolute>::controlName),
+    "UVCPanTiltAbsolute does not match the pan-tilt-abs control");
+static_assert(
+    UVCControlHasLayout<UVCBinding<UVCPanTiltRelative>::LayoutType>(
+        UVCBinding<UVCPanTiltRelative>::controlName),
+    "UVCPanTiltRelative does not match the pan-tilt-rel control");
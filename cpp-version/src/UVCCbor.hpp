@@ -0,0 +1,132 @@
+//
+// UVCCbor.hpp
+//
+// Minimal CBOR (RFC 8949) primitives for the binary form of control values.
+//
+// Translated from Objective-C to C++
+// Copyright © 2016
+// Dr. Jeffrey Frey, IT-NSS
+// University of Delaware
+//
+// $Id$
+//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/*!
+  @enum UVCCborMajorType
+
+  The CBOR major types a control value is encoded with.  A value is a map
+  with one entry per field:  the key is the field index (unsigned), the item
+  an unsigned or negative integer, or a simple value (false/true) for Boolean
+  fields.
+*/
+enum UVCCborMajorType : uint8_t {
+  kUVCCborUnsigned = 0,
+  kUVCCborNegative = 1,
+  kUVCCborMap = 5,
+  kUVCCborSimple = 7
+};
+
+// Simple values false and true (major type 7):
+const uint8_t kUVCCborFalse = 20;
+const uint8_t kUVCCborTrue = 21;
+
+/*!
+  @function UVCCborWriteHead
+
+  Append the head of an item (major type plus argument, in the shortest
+  form) at out + offset if it fits in outSize bytes.  Returns its length
+  whether or not it was written, so a NULL out measures.
+*/
+inline size_t UVCCborWriteHead(uint8_t majorType,
+                               uint64_t argument,
+                               uint8_t* out,
+                               size_t outSize,
+                               size_t offset) {
+  uint8_t initial = static_cast<uint8_t>(majorType << 5);
+  size_t argumentSize;
+
+  if (argument < 24) {
+    if (out && offset < outSize) {
+      out[offset] = initial | static_cast<uint8_t>(argument);
+    }
+    return 1;
+  }
+  if (argument <= UINT8_MAX) {
+    initial |= 24;
+    argumentSize = 1;
+  } else if (argument <= UINT16_MAX) {
+    initial |= 25;
+    argumentSize = 2;
+  } else if (argument <= UINT32_MAX) {
+    initial |= 26;
+    argumentSize = 4;
+  } else {
+    initial |= 27;
+    argumentSize = 8;
+  }
+  if (out && offset + 1 + argumentSize <= outSize) {
+    out[offset] = initial;
+    // Arguments are big-endian:
+    for (size_t i = 0; i < argumentSize; i++) {
+      out[offset + argumentSize - i] =
+          static_cast<uint8_t>(argument >> (8 * i));
+    }
+  }
+  return 1 + argumentSize;
+}
+
+/*!
+  @function UVCCborReadHead
+
+  Decode the head of the item at data + offset (data holds length bytes)
+  into its major type and argument, advancing offset past it.  Returns false
+  if the head is truncated or uses an indefinite length.
+*/
+inline bool UVCCborReadHead(const uint8_t* data,
+                            size_t length,
+                            size_t& offset,
+                            uint8_t& majorType,
+                            uint64_t& argument) {
+  if (offset >= length) {
+    return false;
+  }
+
+  uint8_t initial = data[offset++];
+  uint8_t additional = initial & 0x1f;
+  size_t argumentSize;
+
+  majorType = initial >> 5;
+  if (additional < 24) {
+    argument = additional;
+    return true;
+  }
+  switch (additional) {
+    case 24:
+      argumentSize = 1;
+      break;
+    case 25:
+      argumentSize = 2;
+      break;
+    case 26:
+      argumentSize = 4;
+      break;
+    case 27:
+      argumentSize = 8;
+      break;
+    default:
+      return false;
+  }
+  if (length - offset < argumentSize) {
+    return false;
+  }
+  argument = 0;
+  for (size_t i = 0; i < argumentSize; i++) {
+    argument = (argument << 8) | data[offset++];
+  }
+  return true;
+}
@@ -0,0 +1,201 @@
+//
+// UVCCircuitBreaker.cpp
+//
+// Quarantine of devices whose control transfers keep failing.
+//
+// Translated from Objective-C to C++
+// Copyright © 2016
+// Dr. Jeffrey Frey, IT-NSS
+// University of Delaware
+//
+// $Id$
+//
+
+#include "UVCCircuitBreaker.hpp"
+
+#include "UVCDiagnostics.hpp"
+
+const char* UVCCircuitStateString(UVCCircuitState state) {
+  switch (state) {
+    case UVCCircuitState::Closed:
+      return "closed";
+    case UVCCircuitState::Open:
+      return "open";
+    case UVCCircuitState::HalfOpen:
+      return "half-open";
+  }
+  return "<invalid>";
+}
+
+std::shared_ptr<UVCCircuitBreakerTransport> UVCCircuitBreakerTransport::create(
+    std::shared_ptr<UVCTransport> transport,
+    const UVCCircuitBreakerPolicy& policy) {
+  if (!transport) {
+    return nullptr;
+  }
+  return std::make_shared<UVCCircuitBreakerTransport>(transport, policy);
+}
+
+UVCCircuitBreakerTransport::UVCCircuitBreakerTransport(
+    std::shared_ptr<UVCTransport> transport,
+    const UVCCircuitBreakerPolicy& policy)
+    : _transport(transport),
+      _policy(policy),
+      _failureTimes(policy.failureThreshold),
+      _nextFailure(0),
+      _failureCount(0) {}
+
+UVCCircuitState UVCCircuitBreakerTransport::state() const {
+  std::lock_guard<std::mutex> guard(_lock);
+  return _statistics.state;
+}
+
+UVCCircuitBreakerStatistics UVCCircuitBreakerTransport::statistics() const {
+  std::lock_guard<std::mutex> guard(_lock);
+  return _statistics;
+}
+
+void UVCCircuitBreakerTransport::reset() {
+  std::lock_guard<std::mutex> guard(_lock);
+  _statistics.state = UVCCircuitState::Closed;
+  _failureCount = 0;
+}
+
+const UVCDeviceIdentity& UVCCircuitBreakerTransport::identity() const {
+  return _transport->identity();
+}
+
+uint8_t UVCCircuitBreakerTransport::interfaceNumber() const {
+  return _transport->interfaceNumber();
+}
+
+std::vector<uint8_t> UVCCircuitBreakerTransport::videoControlDescriptors()
+    const {
+  return _transport->videoControlDescriptors();
+}
+
+std::vector<uint8_t> UVCCircuitBreakerTransport::videoStreamingDescriptors()
+    const {
+  return _transport->videoStreamingDescriptors();
+}
+
+bool UVCCircuitBreakerTransport::isOpen() const {
+  return _transport->isOpen();
+}
+
+bool UVCCircuitBreakerTransport::open() {
+  return _transport->open();
+}
+
+void UVCCircuitBreakerTransport::close() {
+  _transport->close();
+}
+
+UVCTransferStatus UVCCircuitBreakerTransport::controlRequest(
+    UVCControlRequest& request) {
+  bool isProbe = false;
+
+  if (!admit(&isProbe)) {
+    request.wLenDone = 0;
+    return UVCTransferStatus::Rejected;
+  }
+
+  // Not under the lock, so that rejections do not wait on a slow transfer:
+  UVCTransferStatus status = _transport->controlRequest(request);
+
+  record(status, isProbe);
+  return status;
+}
+
+bool UVCCircuitBreakerTransport::reconnect() {
+  return _transport->reconnect();
+}
+
+bool UVCCircuitBreakerTransport::recover(UVCRecoveryAction action) {
+  return _transport->recover(action);
+}
+
+UVCPowerState UVCCircuitBreakerTransport::powerState() const {
+  return _transport->powerState();
+}
+
+bool UVCCircuitBreakerTransport::admit(bool* isProbe) {
+  std::lock_guard<std::mutex> guard(_lock);
+
+  switch (_statistics.state) {
+    case UVCCircuitState::Closed:
+      return true;
+
+    case UVCCircuitState::Open:
+      if (Clock::now() - _openedAt >=
+          std::chrono::microseconds(_policy.coolDownMicros)) {
+        _statistics.state = UVCCircuitState::HalfOpen;
+        _statistics.probes++;
+        *isProbe = true;
+        return true;
+      }
+      break;
+
+    case UVCCircuitState::HalfOpen:
+      // Only the one probe is let through:
+      break;
+  }
+  _statistics.rejected++;
+  return false;
+}
+
+void UVCCircuitBreakerTransport::record(UVCTransferStatus status,
+                                        bool isProbe) {
+  std::lock_guard<std::mutex> guard(_lock);
+  bool isFailure = (status == UVCTransferStatus::Timeout ||
+                    status == UVCTransferStatus::Error);
+  const char* deviceName = _transport->identity().deviceName.c_str();
+
+  if (isFailure) {
+    _statistics.failures++;
+  }
+  if (isProbe) {
+    if (isFailure) {
+      _statistics.state = UVCCircuitState::Open;
+      _openedAt = Clock::now();
+      UVC_DIAGNOSTIC(Info, Transfer, "%s still failing (%s), kept quarantined",
+                     deviceName, UVCTransferStatusString(status));
+    } else {
+      _statistics.state = UVCCircuitState::Closed;
+      _failureCount = 0;
+      UVC_DIAGNOSTIC(Info, Transfer, "%s answering again, quarantine lifted",
+                     deviceName);
+    }
+    return;
+  }
+
+  // Transfers that were under way when the breaker tripped are not counted
+  // again:
+  if (!isFailure || _statistics.state != UVCCircuitState::Closed ||
+      _failureTimes.empty()) {
+    return;
+  }
+
+  Clock::time_point now = Clock::now();
+
+  _failureTimes[_nextFailure] = now;
+  _nextFailure = (_nextFailure + 1) % _failureTimes.size();
+  if (_failureCount < _failureTimes.size()) {
+    _failureCount++;
+  }
+  // Full, so _nextFailure is the oldest of the last failureThreshold:
+  if (_failureCount == _failureTimes.size() &&
+      now - _failureTimes[_nextFailure] <=
+          std::chrono::microseconds(_policy.windowMicros)) {
+    _statistics.state = UVCCircuitState::Open;
+    _statistics.trips++;
+    _openedAt = now;
+    _failureCount = 0;
+    UVC_DIAGNOSTIC(Warning, Transfer,
+                   "%s (serial %s) failed %u transfers within %.1f s, "
+                   "quarantined for %.1f s",
+                   deviceName, _transport->identity().serialNumber.c_str(),
+                   _policy.failureThreshold, _policy.windowMicros / 1e6,
+                   _policy.coolDownMicros / 1e6);
+  }
+}
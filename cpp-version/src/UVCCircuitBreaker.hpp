@@ -0,0 +1,139 @@
+//
+// UVCCircuitBreaker.hpp
+//
+// Quarantine of devices whose control transfers keep failing.
+//
+// Translated from Objective-C to C++
+// Copyright © 2016
+// Dr. Jeffrey Frey, IT-NSS
+// University of Delaware
+//
+// $Id$
+//
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "UVCTransport.hpp"
+
+/*!
+  @typedef UVCCircuitState
+
+  State of a circuit breaker:  Closed passes transfers through, Open rejects
+  them, HalfOpen lets a single probe through to decide between the two.
+*/
+enum class UVCCircuitState { Closed, Open, HalfOpen };
+
+/*!
+  @function UVCCircuitStateString
+
+  Returns a short textual name for the given state.
+*/
+const char* UVCCircuitStateString(UVCCircuitState state);
+
+/*!
+  @struct UVCCircuitBreakerPolicy
+
+  When a breaker trips and for how long:
+
+    failureThreshold  timeouts or errors within windowMicros that trip it
+    windowMicros
+    coolDownMicros    time an open breaker rejects transfers before letting
+                      a probe through
+*/
+struct UVCCircuitBreakerPolicy {
+  uint32_t failureThreshold = 5;
+  uint32_t windowMicros = 10000000;
+  uint32_t coolDownMicros = 5000000;
+};
+
+/*!
+  @struct UVCCircuitBreakerStatistics
+
+  The breaker's current state and counters.
+*/
+struct UVCCircuitBreakerStatistics {
+  UVCCircuitState state = UVCCircuitState::Closed;
+  uint64_t trips = 0;
+  uint64_t rejected = 0;
+  uint64_t probes = 0;
+  uint64_t failures = 0;
+};
+
+/*!
+  @class UVCCircuitBreakerTransport
+  @abstract Decorator that stops sending transfers to a failing device.
+
+  Transfers that time out or fail with an error count against the device;
+  stalls (a control that is not implemented) and a departed device do not.
+  Once failureThreshold of them fall within windowMicros the breaker opens:
+  every transfer, including any an application has queued, fails at once
+  with Rejected.  After coolDownMicros the next transfer is let through as a
+  probe while others are still rejected; if the device answers the breaker
+  closes, otherwise it stays open for another cool-down.
+*/
+class UVCCircuitBreakerTransport final : public UVCTransport {
+ private:
+  using Clock = std::chrono::steady_clock;
+
+  mutable std::mutex _lock;
+  std::shared_ptr<UVCTransport> _transport;
+  UVCCircuitBreakerPolicy _policy;
+  UVCCircuitBreakerStatistics _statistics;
+  // Times of the latest failures, oldest at _nextFailure once full:
+  std::vector<Clock::time_point> _failureTimes;
+  size_t _nextFailure;
+  size_t _failureCount;
+  Clock::time_point _openedAt;
+
+ public:
+  /*!
+    @method create
+
+    Returns a shared_ptr to a circuit breaker over transport, or nullptr if
+    transport is nullptr.
+  */
+  static std::shared_ptr<UVCCircuitBreakerTransport> create(
+      std::shared_ptr<UVCTransport> transport,
+      const UVCCircuitBreakerPolicy& policy = UVCCircuitBreakerPolicy());
+
+  UVCCircuitBreakerTransport(std::shared_ptr<UVCTransport> transport,
+                             const UVCCircuitBreakerPolicy& policy);
+  ~UVCCircuitBreakerTransport() override = default;
+
+  // Delete copy constructor and assignment operator
+  UVCCircuitBreakerTransport(const UVCCircuitBreakerTransport&) = delete;
+  UVCCircuitBreakerTransport& operator=(const UVCCircuitBreakerTransport&) =
+      delete;
+
+  UVCCircuitState state() const;
+  UVCCircuitBreakerStatistics statistics() const;
+
+  /*!
+    @method reset
+
+    Close the breaker and forget past failures.
+  */
+  void reset();
+
+  const UVCDeviceIdentity& identity() const override;
+  uint8_t interfaceNumber() const override;
+  std::vector<uint8_t> videoControlDescriptors() const override;
+  std::vector<uint8_t> videoStreamingDescriptors() const override;
+  bool isOpen() const override;
+  bool open() override;
+  void close() override;
+  UVCTransferStatus controlRequest(UVCControlRequest& request) override;
+  bool reconnect() override;
+  bool recover(UVCRecoveryAction action) override;
+  UVCPowerState powerState() const override;
+
+ private:
+  bool admit(bool* isProbe);
+  void record(UVCTransferStatus status, bool isProbe);
+};
@@ -13,166 +13,28 @@
 
 #include "UVCController.hpp"
 
-#include <CoreFoundation/CoreFoundation.h>
-#include <IOKit/usb/USB.h>
-
 #include <algorithm>
+#include <chrono>
+#include <cstdio>
 #include <cstring>
-#include <iostream>
+#include <iterator>
 #include <map>
-#include <sstream>
-
-// UVC Class and Subclass definitions
-#define UVC_INTERFACE_CLASS 14
-#define UVC_INTERFACE_SUBCLASS_CONTROL 1
-#define UVC_INTERFACE_SUBCLASS_STREAMING 2
-
-// Note: kIOReturnExclusiveAccess is already defined in IOKit headers
-
-// UVC Control Selectors
-#define UVC_VC_CONTROL_UNDEFINED 0x00
-#define UVC_VC_VIDEO_POWER_MODE_CONTROL 0x01
-#define UVC_VC_REQUEST_ERROR_CODE_CONTROL 0x02
-
-// Processing Unit Control Selectors
-#define UVC_PU_CONTROL_UNDEFINED 0x00
-#define UVC_PU_BACKLIGHT_COMPENSATION_CONTROL 0x01
-#define UVC_PU_BRIGHTNESS_CONTROL 0x02
-#define UVC_PU_CONTRAST_CONTROL 0x03
-#define UVC_PU_GAIN_CONTROL 0x04
-#define UVC_PU_POWER_LINE_FREQUENCY_CONTROL 0x05
-#define UVC_PU_HUE_CONTROL 0x06
-#define UVC_PU_SATURATION_CONTROL 0x07
-#define UVC_PU_SHARPNESS_CONTROL 0x08
-#define UVC_PU_GAMMA_CONTROL 0x09
-#define UVC_PU_WHITE_BALANCE_TEMPERATURE_CONTROL 0x0A
-#define UVC_PU_WHITE_BALANCE_TEMPERATURE_AUTO_CONTROL 0x0B
-#define UVC_PU_WHITE_BALANCE_COMPONENT_CONTROL 0x0C
-#define UVC_PU_WHITE_BALANCE_COMPONENT_AUTO_CONTROL 0x0D
-#define UVC_PU_DIGITAL_MULTIPLIER_CONTROL 0x0E
-#define UVC_PU_DIGITAL_MULTIPLIER_LIMIT_CONTROL 0x0F
-#define UVC_PU_HUE_AUTO_CONTROL 0x10
-#define UVC_PU_ANALOG_VIDEO_STANDARD_CONTROL 0x11
-#define UVC_PU_ANALOG_LOCK_STATUS_CONTROL 0x12
-
-// Camera Terminal Control Selectors
-#define UVC_CT_CONTROL_UNDEFINED 0x00
-#define UVC_CT_SCANNING_MODE_CONTROL 0x01
-#define UVC_CT_AE_MODE_CONTROL 0x02
-#define UVC_CT_AE_PRIORITY_CONTROL 0x03
-#define UVC_CT_EXPOSURE_TIME_ABSOLUTE_CONTROL 0x04
-#define UVC_CT_EXPOSURE_TIME_RELATIVE_CONTROL 0x05
-#define UVC_CT_FOCUS_ABSOLUTE_CONTROL 0x06
-#define UVC_CT_FOCUS_RELATIVE_CONTROL 0x07
-#define UVC_CT_FOCUS_AUTO_CONTROL 0x08
-#define UVC_CT_IRIS_ABSOLUTE_CONTROL 0x09
-#define UVC_CT_IRIS_RELATIVE_CONTROL 0x0A
-#define UVC_CT_ZOOM_ABSOLUTE_CONTROL 0x0B
-#define UVC_CT_ZOOM_RELATIVE_CONTROL 0x0C
-#define UVC_CT_PANTILT_ABSOLUTE_CONTROL 0x0D
-#define UVC_CT_PANTILT_RELATIVE_CONTROL 0x0E
-#define UVC_CT_ROLL_ABSOLUTE_CONTROL 0x0F
-#define UVC_CT_ROLL_RELATIVE_CONTROL 0x10
-#define UVC_CT_PRIVACY_CONTROL 0x11
-
-// UVC Request Types
-#define UVC_SET_CUR 0x01
-#define UVC_GET_CUR 0x81
-#define UVC_GET_MIN 0x82
-#define UVC_GET_MAX 0x83
-#define UVC_GET_RES 0x84
-#define UVC_GET_LEN 0x85
-#define UVC_GET_INFO 0x86
-#define UVC_GET_DEF 0x87
-
-// UVC Unit Types
-#define UVC_VC_INPUT_TERMINAL 0x02
-#define UVC_VC_OUTPUT_TERMINAL 0x03
-#define UVC_VC_SELECTOR_UNIT 0x04
-#define UVC_VC_PROCESSING_UNIT 0x05
-#define UVC_VC_EXTENSION_UNIT 0x06
-
-// UVC descriptor constants (from original Objective-C code)
-#define CS_INTERFACE 0x24
-#define VC_HEADER 0x01
-#define VC_INPUT_TERMINAL 0x02
-#define VC_PROCESSING_UNIT 0x05
-
-// UVC descriptor header structure
-struct UVC_Descriptor_Header {
-  uint8_t bLength;
-  uint8_t bDescriptorType;
-  uint8_t bDescriptorSubType;
-} __attribute__((packed));
-
-// Control structure for tracking UVC controls
-struct UVCControlDef {
-  std::string name;
-  std::string typeSignature;
-  int controlSelector;
-  int unitType;  // 0 = processing unit, 1 = camera terminal
-
-  UVCControlDef(const std::string& n, const std::string& ts, int cs, int ut)
-      : name(n), typeSignature(ts), controlSelector(cs), unitType(ut) {}
-};
-
-// Global control definitions
-static std::vector<UVCControlDef> uvcControlDefinitions = {
-    // Processing Unit Controls
-    UVCControlDef("brightness", "{S2}", UVC_PU_BRIGHTNESS_CONTROL, 0),
-    UVCControlDef("contrast", "{U2}", UVC_PU_CONTRAST_CONTROL, 0),
-    UVCControlDef("hue", "{S2}", UVC_PU_HUE_CONTROL, 0),
-    UVCControlDef("saturation", "{U2}", UVC_PU_SATURATION_CONTROL, 0),
-    UVCControlDef("sharpness", "{U2}", UVC_PU_SHARPNESS_CONTROL, 0),
-    UVCControlDef("gamma", "{U2}", UVC_PU_GAMMA_CONTROL, 0),
-    UVCControlDef("backlight-compensation",
-                  "{U2}",
-                  UVC_PU_BACKLIGHT_COMPENSATION_CONTROL,
-                  0),
-    UVCControlDef("gain", "{U2}", UVC_PU_GAIN_CONTROL, 0),
-    UVCControlDef("power-line-frequency",
-                  "{U1}",
-                  UVC_PU_POWER_LINE_FREQUENCY_CONTROL,
-                  0),
-    UVCControlDef("white-balance-temp",
-                  "{U2}",
-                  UVC_PU_WHITE_BALANCE_TEMPERATURE_CONTROL,
-                  0),
-    UVCControlDef("auto-white-balance-temp",
-                  "{B}",
-                  UVC_PU_WHITE_BALANCE_TEMPERATURE_AUTO_CONTROL,
-                  0),
-
-    // Camera Terminal Controls
-    UVCControlDef("auto-exposure-mode", "{U1}", UVC_CT_AE_MODE_CONTROL, 1),
-    UVCControlDef("auto-exposure-priority",
-                  "{B}",
-                  UVC_CT_AE_PRIORITY_CONTROL,
-                  1),
-    UVCControlDef("exposure-time-abs",
-                  "{U4}",
-                  UVC_CT_EXPOSURE_TIME_ABSOLUTE_CONTROL,
-                  1),
-    UVCControlDef("focus-abs", "{U2}", UVC_CT_FOCUS_ABSOLUTE_CONTROL, 1),
-    UVCControlDef("focus-rel", "{S1}", UVC_CT_FOCUS_RELATIVE_CONTROL, 1),
-    UVCControlDef("auto-focus", "{B}", UVC_CT_FOCUS_AUTO_CONTROL, 1),
-    UVCControlDef("iris-abs", "{U2}", UVC_CT_IRIS_ABSOLUTE_CONTROL, 1),
-    UVCControlDef("zoom-abs", "{U2}", UVC_CT_ZOOM_ABSOLUTE_CONTROL, 1),
-    UVCControlDef("zoom-rel",
-                  "{S1 zoom;U1 digital-zoom;U1 speed}",
-                  UVC_CT_ZOOM_RELATIVE_CONTROL,
-                  1),
-    UVCControlDef("pan-tilt-abs",
-                  "{S4 pan; S4 tilt}",
-                  UVC_CT_PANTILT_ABSOLUTE_CONTROL,
-                  1),
-    UVCControlDef("pan-tilt-rel",
-                  "{S1 pan;U1 pan-speed; S1 tilt;U1 tilt-speed}",
-                  UVC_CT_PANTILT_RELATIVE_CONTROL,
-                  1),
-    UVCControlDef("privacy", "{B}", UVC_CT_PRIVACY_CONTROL, 1),
-};
+#include <thread>
+
+#if defined(__APPLE__)
+#include <CoreFoundation/CoreFoundation.h>
+#include <IOKit/usb/USB.h>
+
+#include "UVCIOKitTransport.hpp"
+#endif
+
+#include "UVCDiagnostics.hpp"
+#include "UVCProtocol.hpp"
+
+template class BasicUVCDeviceController<UVCTransport>;
 
+
+#if defined(__APPLE__)
 // Static helper functions
 CFStringRef CreateCFStringFromIORegistryKey(io_service_t ioService,
                                             const char* key) {
@@ -221,16 +83,42 @@ uint32_t GetUInt32FromIORegistry(io_service_t ioService, const char* key) {
   return value;
 }
 
+UVCDeviceIdentity GetIdentityFromIORegistry(io_service_t ioService,
+                                            uint32_t locationId,
+                                            uint16_t vendorId,
+                                            uint16_t productId) {
+  UVCDeviceIdentity identity;
+
+  identity.locationId = locationId;
+  identity.vendorId = vendorId;
+  identity.productId = productId;
+  identity.deviceName = GetStringFromIORegistry(ioService, "USB Product Name");
+  if (identity.deviceName.empty()) {
+    identity.deviceName = "Unknown UVC Device";
+  }
+  identity.bcdDevice =
+      static_cast<uint16_t>(GetUInt32FromIORegistry(ioService, "bcdDevice"));
+  identity.serialNumber =
+      GetStringFromIORegistry(ioService, "USB Serial Number");
+  if (identity.serialNumber.empty()) {
+    identity.serialNumber = "Unknown UVC Device";
+  }
+  return identity;
+}
+#endif
+
 // UVCController implementation
 std::vector<std::shared_ptr<UVCDeviceController>>
 UVCDeviceController::getUVCControllers() {
   std::vector<std::shared_ptr<UVCDeviceController>> controllers;
 
+#if defined(__APPLE__)
   // Get matching dictionary for USB devices
   CFMutableDictionaryRef matchingDict =
       IOServiceMatching(kIOUSBDeviceClassName);
   if (!matchingDict) {
-    std::cerr << "ERROR: Could not create USB matching dictionary" << std::endl;
+    UVC_DIAGNOSTIC(Error, Enumeration,
+                   "Could not create USB matching dictionary");
     return controllers;
   }
 
@@ -239,8 +127,8 @@ UVCDeviceController::getUVCControllers() {
   kern_return_t kr = IOServiceGetMatchingServices(
       kIOMasterPortDefault, matchingDict, &serviceIterator);
   if (kr != KERN_SUCCESS) {
-    std::cerr << "ERROR: IOServiceGetMatchingServices failed: " << kr
-              << std::endl;
+    UVC_DIAGNOSTIC(Error, Enumeration,
+                   "IOServiceGetMatchingServices failed: %d", kr);
     return controllers;
   }
 
@@ -250,23 +138,33 @@ UVCDeviceController::getUVCControllers() {
     uint32_t locationId = GetUInt32FromIORegistry(usbService, "locationID");
     uint32_t vendorId = GetUInt32FromIORegistry(usbService, "idVendor");
     uint32_t productId = GetUInt32FromIORegistry(usbService, "idProduct");
-    std::cout << "locationId: " << locationId << std::endl;
-    std::cout << "vendorId: " << vendorId << std::endl;
-    std::cout << "productId: " << productId << std::endl;
-    // Check if this is a UVC device
-    auto controller = createWithService(usbService);
-    if (controller) {
+    UVC_DIAGNOSTIC(Info, Enumeration,
+                   "locationId: %u vendorId: %u productId: %u", locationId,
+                   vendorId, productId);
+    // One controller per VideoControl interface, none if not a UVC device
+    for (auto& controller : createAllWithService(usbService)) {
       controllers.push_back(controller);
     }
     IOObjectRelease(usbService);
   }
 
   IOObjectRelease(serviceIterator);
+#endif
   return controllers;
 }
 
+std::shared_ptr<UVCDeviceController> UVCDeviceController::createWithTransport(
+    std::shared_ptr<UVCTransport> transport) {
+  if (!transport) {
+    return nullptr;
+  }
+  return std::make_shared<UVCDeviceController>(transport);
+}
+
+#if defined(__APPLE__)
 std::shared_ptr<UVCDeviceController> UVCDeviceController::createWithService(
-    io_service_t ioService) {
+    io_service_t ioService,
+    int interfaceNumber) {
   // Get device properties
   uint32_t locationId = GetUInt32FromIORegistry(ioService, "locationID");
   uint32_t vendorId = GetUInt32FromIORegistry(ioService, "idVendor");
@@ -334,8 +232,35 @@ std::shared_ptr<UVCDeviceController> UVCDeviceController::createWithService(
   // Create the controller instance
   return std::make_shared<UVCDeviceController>(
       locationId, static_cast<uint16_t>(vendorId),
-      static_cast<uint16_t>(productId), ioService);
+      static_cast<uint16_t>(productId), ioService, interfaceNumber);
+}
+
+std::vector<std::shared_ptr<UVCDeviceController>>
+UVCDeviceController::createAllWithService(io_service_t ioService) {
+  std::vector<std::shared_ptr<UVCDeviceController>> controllers;
+  std::vector<uint8_t> interfaceNumbers =
+      UVCIOKitTransport::videoControlInterfaceNumbers(ioService);
+
+  if (interfaceNumbers.size() <= 1) {
+    // The usual single camera:
+    auto controller = createWithService(ioService);
+    if (controller) {
+      controllers.push_back(controller);
+    }
+    return controllers;
+  }
+
+  UVC_DIAGNOSTIC(Info, Enumeration, "%zu VideoControl interfaces",
+                 interfaceNumbers.size());
+  for (uint8_t interfaceNumber : interfaceNumbers) {
+    auto controller = createWithService(ioService, interfaceNumber);
+    if (controller) {
+      controllers.push_back(controller);
+    }
+  }
+  return controllers;
 }
+#endif
 
 std::shared_ptr<UVCDeviceController> UVCDeviceController::createWithLocationId(
     uint32_t locationId) {
@@ -369,41 +294,59 @@ std::vector<std::string> UVCDeviceController::getAllControlStrings() {
   return names;
 }
 
-UVCDeviceController::UVCDeviceController(uint32_t locationId,
-                                         uint16_t vendorId,
-                                         uint16_t productId,
-                                         io_service_t ioServiceObject)
-    : _locationId(locationId),
-      _vendorId(vendorId),
-      _productId(productId),
-      _controllerInterface(nullptr),
-      _isInterfaceOpen(false),
-      _shouldNotCloseInterface(false),
-      _videoInterfaceIndex(0),
-      _uvcVersion(0x0100) {  // Default to 1.00, will be updated from descriptor
-  // Get device name
-  _deviceName = GetStringFromIORegistry(ioServiceObject, "USB Product Name");
+UVCDeviceController::UVCDeviceController(
+    std::shared_ptr<UVCTransport> transport)
+    : BasicUVCDeviceController<UVCTransport>(std::move(transport)),
+      _locationId(0),
+      _vendorId(0),
+      _productId(0),
+      _arena(UVCArena::create()),
+      _controls(std::size(uvcControlDefinitions),
+                nullptr,
+                UVCArenaAllocator<std::shared_ptr<UVCControl>>(_arena)),
+      _isControlProbed(std::size(uvcControlDefinitions), false),
+      _shadowValues(UVCArenaAllocator<ShadowValue>(_arena)),
+      _reconnectsAutomatically(true),
+      _lockTimeoutMillis(kUVCDeviceLockTimeoutMillis),
+      _cachedValues(UVCArenaAllocator<CachedValue>(_arena)) {
+  if (_transport) {
+    const UVCDeviceIdentity& identity = _transport->identity();
+
+    _deviceName = identity.deviceName;
+    _serialNumber = identity.serialNumber;
+    _locationId = identity.locationId;
+    _vendorId = identity.vendorId;
+    _productId = identity.productId;
+    _quirks = UVCLookupQuirks(identity);
+  }
   if (_deviceName.empty()) {
     _deviceName = "Unknown UVC Device";
   }
-  _serialNumber = GetStringFromIORegistry(ioServiceObject, "USB Serial Number");
   if (_serialNumber.empty()) {
     _serialNumber = "Unknown UVC Device";
   }
-
-  // Initialize interface
-  findControllerInterfaceForServiceObject(ioServiceObject);
 }
 
-UVCDeviceController::~UVCDeviceController() {
-  if (_controllerInterface && _isInterfaceOpen && !_shouldNotCloseInterface) {
-    (*_controllerInterface)->USBInterfaceClose(_controllerInterface);
-  }
-
-  if (_controllerInterface) {
-    (*_controllerInterface)->Release(_controllerInterface);
-  }
+#if defined(__APPLE__)
+UVCDeviceController::UVCDeviceController(uint32_t locationId,
+                                         uint16_t vendorId,
+                                         uint16_t productId,
+                                         io_service_t ioServiceObject,
+                                         int interfaceNumber)
+    : UVCDeviceController(UVCIOKitTransport::createWithService(
+          ioServiceObject,
+          GetIdentityFromIORegistry(ioServiceObject, locationId, vendorId,
+                                    productId),
+          interfaceNumber)) {
+  // Other processes may be driving the same camera (or sub-camera):
+  _deviceLock = UVCDeviceLock::createForDevice(
+      _transport->identity(), nullptr, _transport->interfaceNumber());
+  _probeCache = UVCProbeCache::createForDevice(
+      _transport->identity(), _transport->videoControlDescriptors());
 }
+#endif
+
+UVCDeviceController::~UVCDeviceController() {}
 
 std::string UVCDeviceController::deviceName() const {
   return _deviceName;
@@ -425,397 +368,442 @@ uint16_t UVCDeviceController::productId() const {
   return _productId;
 }
 
-uint16_t UVCDeviceController::uvcVersion() const {
-  return _uvcVersion;
+uint8_t UVCDeviceController::interfaceNumber() const {
+  return _transport ? _transport->interfaceNumber() : 0;
 }
 
-bool UVCDeviceController::isInterfaceOpen() const {
-  return _isInterfaceOpen;
-}
-
-void UVCDeviceController::setIsInterfaceOpen(bool isInterfaceOpen) {
-  if (isInterfaceOpen && !_isInterfaceOpen) {
-    if (_controllerInterface) {
-      IOReturn result =
-          (*_controllerInterface)->USBInterfaceOpen(_controllerInterface);
-      _isInterfaceOpen = (result == kIOReturnSuccess);
-    }
-  } else if (!isInterfaceOpen && _isInterfaceOpen) {
-    if (_controllerInterface && !_shouldNotCloseInterface) {
-      (*_controllerInterface)->USBInterfaceClose(_controllerInterface);
-      _isInterfaceOpen = false;
-    }
-  }
+std::shared_ptr<UVCArena> UVCDeviceController::arena() const {
+  return _arena;
 }
 
 std::shared_ptr<UVCControl> UVCDeviceController::controlWithName(
     const std::string& controlName) {
-  // Check if we already have this control cached
-  auto it = _controls.find(controlName);
-  if (it != _controls.end()) {
-    return it->second;
+  return controlWithId(controlIdWithName(controlName));
+}
+
+std::shared_ptr<UVCControl> UVCDeviceController::controlWithId(
+    size_t controlId) {
+  if (controlId >= _controls.size()) {
+    return nullptr;
   }
 
-  // Check if control is marked as not available
-  if (controlIsNotAvailable(controlName)) {
-    _controls[controlName] = nullptr;  // Cache the failure
+  // Probed before (successfully or not):  the cached outcome stands
+  if (_isControlProbed[controlId]) {
+    return _controls[controlId];
+  }
+
+  // Known to misbehave on this model:  not even GET_INFO is sent
+  const UVCControlQuirks* quirks = _quirks.forControl(controlId);
+  if (quirks && (quirks->flags & kUVCQuirkDisable)) {
+    UVC_DIAGNOSTIC(Debug, Enumeration, "%s disabled by quirk on %s",
+                   uvcControlDefinitions[controlId].name, _deviceName.c_str());
+    _isControlProbed[controlId] = true;
     return nullptr;
   }
 
-  // Find the control definition
-  size_t controlIndex = 0;
-  bool found = false;
-  for (size_t i = 0; i < uvcControlDefinitions.size(); i++) {
-    if (uvcControlDefinitions[i].name == controlName) {
-      controlIndex = i;
-      found = true;
-      break;
-    }
+  // Failed its probe on this model before:  not sent again until that expires
+  UVCTransferStatus probeFailure;
+  if (_probeCache && _probeCache->isKnownToFail(controlId, &probeFailure)) {
+    UVC_DIAGNOSTIC(Debug, Enumeration, "%s skipped on %s (%s when last probed)",
+                   uvcControlDefinitions[controlId].name, _deviceName.c_str(),
+                   UVCTransferStatusString(probeFailure));
+    _isControlProbed[controlId] = true;
+    return nullptr;
+  }
+
+  // Another process's writes must not land between the probe's reads; if it
+  // holds the device too long, the control is probed again next time:
+  UVCDeviceLockGuard lockGuard(_deviceLock.get(), UVCLockMode::Shared,
+                               _lockTimeoutMillis);
+  if (!lockGuard) {
+    UVC_DIAGNOSTIC(Warning, General, "Timed out waiting for %s to probe %s",
+                   _deviceLock->path().c_str(),
+                   uvcControlDefinitions[controlId].name);
+    return nullptr;
   }
+  _isControlProbed[controlId] = true;
 
-  if (!found) {
-    _controls[controlName] = nullptr;  // Cache the failure
+  // Check if control is marked as not available
+  if (controlIsNotAvailable(uvcControlDefinitions[controlId].name)) {
     return nullptr;
   }
 
   // Check capabilities first (like original Objective-C logic)
   uvc_capabilities_t caps = 0;
-  if (!capabilities(&caps, controlIndex)) {
+  if (!capabilities(&caps, controlId)) {
     // If capabilities check fails, this control is not available
-    _controls[controlName] = nullptr;  // Cache the failure
+    if (_probeCache) {
+      _probeCache->recordFailure(controlId, lastTransferStatus());
+    }
     return nullptr;
   }
+  if (_probeCache) {
+    _probeCache->recordSuccess(controlId);
+  }
 
-  // Create the control (only if capabilities check passed)
-  auto control = std::make_shared<UVCControl>(controlName, shared_from_this(),
-                                              controlIndex);
-
-  // Cache it
-  _controls[controlName] = control;
-  return control;
+  // Create the control (only if capabilities check passed) and cache it
+  _controls[controlId] = std::allocate_shared<UVCControl>(
+      UVCArenaAllocator<UVCControl>(_arena),
+      uvcControlDefinitions[controlId].name, shared_from_this(), controlId,
+      _arena);
+  return _controls[controlId];
 }
 
-std::vector<std::string> UVCDeviceController::controlStrings() const {
-  // Like the original, this should return ALL defined control names
-  // The filtering happens in main.cpp when calling controlWithName()
-  return getAllControlStrings();
+bool UVCDeviceController::capabilities(uvc_capabilities_t* capabilities,
+                                       size_t controlId) {
+  using Basic = BasicUVCDeviceController<UVCTransport>;
+
+  if (Basic::capabilities(capabilities, controlId)) {
+    return true;
+  }
+  return shouldReconnect() && Basic::capabilities(capabilities, controlId);
 }
 
-std::string UVCDeviceController::description() const {
-  std::stringstream ss;
-  ss << "UVCController: " << _deviceName << " (0x" << std::hex << _vendorId
-     << ":0x" << _productId << ")"
-     << " Serial Number: " << _serialNumber << " LocationID: 0x" << _locationId
-     << " UVC Version: " << (_uvcVersion >> 8) << "." << std::hex
-     << (_uvcVersion & 0xFF);
-  return ss.str();
+bool UVCDeviceController::getValue(UVCValue& value, size_t controlId) {
+  return getValueData(value.valuePtr(), value.byteSize(), controlId);
 }
 
-// Private helper methods
-bool UVCDeviceController::findControllerInterfaceForServiceObject(
-    io_service_t ioServiceObject) {
-  IOCFPlugInInterface** plugInInterface = nullptr;
-  IOUSBDeviceInterface** deviceInterface = nullptr;
-  IOUSBInterfaceInterface** interfaceInterface = nullptr;
-  SInt32 score;
+bool UVCDeviceController::setValue(UVCValue& value, size_t controlId) {
+  return setValueData(value.valuePtr(), value.byteSize(), controlId);
+}
 
-  // Get device plugin interface
-  IOReturn result = IOCreatePlugInInterfaceForService(
-      ioServiceObject, kIOUSBDeviceUserClientTypeID, kIOCFPlugInInterfaceID,
-      &plugInInterface, &score);
+bool UVCDeviceController::getValueData(void* data,
+                                       size_t length,
+                                       size_t controlId) {
+  using Basic = BasicUVCDeviceController<UVCTransport>;
 
-  if (result != kIOReturnSuccess || !plugInInterface) {
+  if (!Basic::getValueData(data, length, controlId) &&
+      !(shouldReconnect() && Basic::getValueData(data, length, controlId))) {
     return false;
   }
+  cacheValue(data, length, controlId);
+  recordHistory(data, length, controlId);
+  return true;
+}
 
-  // Get device interface
-  HRESULT res =
-      (*plugInInterface)
-          ->QueryInterface(plugInInterface,
-                           CFUUIDGetUUIDBytes(kIOUSBDeviceInterfaceID),
-                           (LPVOID*)&deviceInterface);
-
-  (*plugInInterface)->Release(plugInInterface);
+bool UVCDeviceController::setValueData(void* data,
+                                       size_t length,
+                                       size_t controlId) {
+  using Basic = BasicUVCDeviceController<UVCTransport>;
+  uint64_t sequence = 0;
+  UVCValueTransfer transfer;
+
+  if (_writeJournal) {
+    transfer.controlId = controlId;
+    transfer.isWrite = true;
+    transfer.data = data;
+    transfer.length = length;
+    if (!journalIntent(&transfer, 1, &sequence)) {
+      return false;
+    }
+  }
 
-  if (res || !deviceInterface) {
+  bool isSuspended = _transport &&
+                     _transport->powerState() == UVCPowerState::Suspended;
+  bool isWritten =
+      Basic::setValueData(data, length, controlId) ||
+      (shouldReconnect() && Basic::setValueData(data, length, controlId));
+  if (isSuspended && isWritten) {
+    _powerStatistics.wakeups++;
+  }
+  if (sequence) {
+    transfer.succeeded = isWritten;
+    settleIntent(sequence, &transfer, 1);
+  }
+  if (!isWritten) {
     return false;
   }
+  rememberValue(data, length, controlId);
+  cacheValue(data, length, controlId);
+  recordHistory(data, length, controlId);
+  if (uint32_t micros = settleMicros(controlId)) {
+    std::this_thread::sleep_for(std::chrono::microseconds(micros));
+  }
+  return true;
+}
 
-  // Find UVC control interface
-  io_iterator_t interfaceIterator;
-  IOUSBFindInterfaceRequest interfaceRequest;
-  interfaceRequest.bInterfaceClass = 14;    // UVC interface class
-  interfaceRequest.bInterfaceSubClass = 1;  // UVC control subclass
-  interfaceRequest.bInterfaceProtocol = kIOUSBFindInterfaceDontCare;
-  interfaceRequest.bAlternateSetting = kIOUSBFindInterfaceDontCare;
-  result = (*deviceInterface)
-               ->CreateInterfaceIterator(deviceInterface, &interfaceRequest,
-                                         &interfaceIterator);
+bool UVCDeviceController::getValue(UVCValue& value,
+                                   size_t controlId,
+                                   uint32_t maxAgeMicros) {
+  return getValueData(value.valuePtr(), value.byteSize(), controlId,
+                      maxAgeMicros);
+}
 
-  if (result != kIOReturnSuccess) {
-    (*deviceInterface)->Release(deviceInterface);
+bool UVCDeviceController::getValueData(void* data,
+                                       size_t length,
+                                       size_t controlId,
+                                       uint32_t maxAgeMicros) {
+  if (controlId >= std::size(uvcControlDefinitions) || !_transport) {
     return false;
   }
-
-  io_service_t interfaceService;
-  while ((interfaceService = IOIteratorNext(interfaceIterator))) {
-    // Create plugin interface for this interface
-    IOCFPlugInInterface** interfacePlugIn = nullptr;
-    result = IOCreatePlugInInterfaceForService(
-        interfaceService, kIOUSBInterfaceUserClientTypeID,
-        kIOCFPlugInInterfaceID, &interfacePlugIn, &score);
-
-    if (result == kIOReturnSuccess && interfacePlugIn) {
-      // Get interface interface
-      res = (*interfacePlugIn)
-                ->QueryInterface(interfacePlugIn,
-                                 CFUUIDGetUUIDBytes(kIOUSBInterfaceInterfaceID),
-                                 (LPVOID*)&interfaceInterface);
-
-      (*interfacePlugIn)->Release(interfacePlugIn);
-
-      if (!res && interfaceInterface) {
-        // Cast to the version we need (220)
-        _controllerInterface = (IOUSBInterfaceInterface220**)interfaceInterface;
-        interfaceInterface = nullptr;  // We've taken ownership
-
-        // Get interface number
-        result = (*_controllerInterface)
-                     ->GetInterfaceNumber(_controllerInterface,
-                                          &_videoInterfaceIndex);
-
-        // Try to open the interface
-        result =
-            (*_controllerInterface)->USBInterfaceOpen(_controllerInterface);
-
-        if (result == kIOReturnSuccess) {
-          _isInterfaceOpen = true;
-          _shouldNotCloseInterface = true;  // We opened it
-
-          // Parse UVC descriptors to get real unit IDs
-          parseUVCDescriptors();
-
-          IOObjectRelease(interfaceService);
-          break;
-        } else if (result == kIOReturnExclusiveAccess) {
-          // Interface is already in use (by system driver), but we can still
-          // use it
-          _isInterfaceOpen = true;
-          _shouldNotCloseInterface = false;  // Don't close what we didn't open
-
-          // Parse UVC descriptors to get real unit IDs
-          parseUVCDescriptors();
-
-          IOObjectRelease(interfaceService);
-          break;
-        } else {
-          (*_controllerInterface)->Release(_controllerInterface);
-          _controllerInterface = nullptr;
-        }
-      }
-    }
-
-    IOObjectRelease(interfaceService);
+  if (_cachedValues.empty()) {
+    _cachedValues.resize(std::size(uvcControlDefinitions));
   }
 
-  IOObjectRelease(interfaceIterator);
-  (*deviceInterface)->Release(deviceInterface);
+  if (_transport->powerState() == UVCPowerState::Suspended) {
+    const CachedValue& cached = _cachedValues[controlId];
 
-  return _controllerInterface != nullptr && _isInterfaceOpen;
+    if (cached.length == length &&
+        std::chrono::steady_clock::now() - cached.updatedAt <=
+            std::chrono::microseconds(maxAgeMicros)) {
+      memcpy(data, cached.data, length);
+      _powerStatistics.wakeupsAvoided++;
+      return true;
+    }
+    if (!getValueData(data, length, controlId)) {
+      return false;
+    }
+    _powerStatistics.wakeups++;
+    return true;
+  }
+  return getValueData(data, length, controlId);
 }
 
-void UVCDeviceController::parseUVCDescriptors() {
-  if (!_controllerInterface) {
-    return;
+bool UVCDeviceController::transferValues(UVCValueTransfer* transfers,
+                                         size_t count) {
+  if (!_transport || (count && !transfers)) {
+    return false;
   }
 
-  // Get UVC interface descriptor
-  IOUSBDescriptorHeader* ioDescriptor =
-      (*_controllerInterface)
-          ->FindNextAssociatedDescriptor(_controllerInterface, nullptr,
-                                         CS_INTERFACE);
+  uint64_t sequence = 0;
+  if (!journalIntent(transfers, count, &sequence)) {
+    for (size_t i = 0; i < count; i++) {
+      transfers[i].succeeded = false;
+    }
+    return false;
+  }
+  return sendJournaledTransfers(transfers, count, sequence);
+}
 
-  if (!ioDescriptor)
-    return;
+// Send transfers whose writes were journaled as batch sequence (zero for
+// none), settling the batch once the device has answered:
+bool UVCDeviceController::sendJournaledTransfers(UVCValueTransfer* transfers,
+                                                 size_t count,
+                                                 uint64_t sequence) {
+  for (size_t i = 0; i < count; i++) {
+    transfers[i].succeeded = false;
+  }
+  bool isSuspended = _transport->powerState() == UVCPowerState::Suspended;
+  // A reconnect restores the values written so far; only the transfers that
+  // did not get through are sent again:
+  if (!sendValueTransfers(transfers, count) && shouldReconnect()) {
+    sendValueTransfers(transfers, count);
+  }
+  if (sequence) {
+    settleIntent(sequence, transfers, count);
+  }
 
-  UVC_Descriptor_Header* descriptor =
-      reinterpret_cast<UVC_Descriptor_Header*>(ioDescriptor);
-
-  if (descriptor->bDescriptorSubType == VC_HEADER) {
-    // Parse UVC header to get version
-    struct UVC_VC_Header {
-      uint8_t bLength;
-      uint8_t bDescriptorType;
-      uint8_t bDescriptorSubType;
-      uint16_t bcdUVC;
-      uint16_t wTotalLength;
-      uint32_t dwClockFrequency;
-      uint8_t bInCollection;
-      uint8_t baInterfaceNr1;
-      // ... more fields
-    } __attribute__((packed));
-
-    UVC_VC_Header* header = reinterpret_cast<UVC_VC_Header*>(descriptor);
-    _uvcVersion =
-        OSSwapLittleToHostInt16(header->bcdUVC);  // Convert from little endian
-
-    // Walk through embedded Unit/Terminal descriptors
-    uint8_t* basePtr = reinterpret_cast<uint8_t*>(header);
-    uint8_t* endPtr = basePtr + header->wTotalLength;
-    basePtr += header->bLength;
-
-    while (basePtr < endPtr) {
-      UVC_Descriptor_Header* subDesc =
-          reinterpret_cast<UVC_Descriptor_Header*>(basePtr);
-
-      if (subDesc->bDescriptorType == CS_INTERFACE) {
-        if (subDesc->bDescriptorSubType == VC_PROCESSING_UNIT) {
-          // Processing Unit descriptor - extract unit ID
-          struct UVC_PU_Header {
-            uint8_t bLength;
-            uint8_t bDescriptorType;
-            uint8_t bDescriptorSubType;
-            uint8_t bUnitId;  // This is what we need!
-            uint8_t bSourceId;
-            uint16_t wMaxMultiplier;
-            uint8_t bControlSize;
-            // uint8_t bmControls[]; // variable length
-          } __attribute__((packed));
-
-          UVC_PU_Header* puHeader = reinterpret_cast<UVC_PU_Header*>(basePtr);
-          _unitIds["UVC_PROCESSING_UNIT_ID"] = puHeader->bUnitId;
-
-          // Store control capabilities if needed
-          if (puHeader->bControlSize > 0) {
-            uint8_t* controls = basePtr + sizeof(UVC_PU_Header);
-            _processingUnitControlsAvailable.clear();
-            _processingUnitControlsAvailable.assign(
-                controls, controls + puHeader->bControlSize);
-          }
-        } else if (subDesc->bDescriptorSubType == VC_INPUT_TERMINAL) {
-          // Input Terminal descriptor
-          struct UVC_IT_Header {
-            uint8_t bLength;
-            uint8_t bDescriptorType;
-            uint8_t bDescriptorSubType;
-            uint8_t bTerminalId;  // This is what we need!
-            uint16_t wTerminalType;
-            uint8_t bAssocTerminal;
-            uint8_t iTerminal;
-            // Camera terminal has more fields...
-          } __attribute__((packed));
-
-          UVC_IT_Header* itHeader = reinterpret_cast<UVC_IT_Header*>(basePtr);
-          _unitIds["UVC_INPUT_TERMINAL_ID"] = itHeader->bTerminalId;
-        }
-      }
+  bool isComplete = true, isAnswered = false;
+  for (size_t i = 0; i < count; i++) {
+    const UVCValueTransfer& transfer = transfers[i];
 
-      basePtr += subDesc->bLength;
+    if (!transfer.succeeded) {
+      isComplete = false;
+      continue;
+    }
+    isAnswered = true;
+    if (transfer.isWrite) {
+      rememberValue(transfer.data, transfer.length, transfer.controlId);
     }
+    cacheValue(transfer.data, transfer.length, transfer.controlId);
+    recordHistory(transfer.data, transfer.length, transfer.controlId);
   }
+  if (isSuspended && isAnswered) {
+    _powerStatistics.wakeups++;
+  }
+  return isComplete;
 }
 
-bool UVCDeviceController::sendControlRequest(IOUSBDevRequest controlRequest) {
-  if (!_controllerInterface) {
+UVCPowerStatistics UVCDeviceController::powerStatistics() const {
+  return _powerStatistics;
+}
+
+bool UVCDeviceController::reconnect() {
+  if (!_transport) {
     return false;
   }
 
-  // Auto-open interface if not already open (like original Objective-C code)
-  if (!_isInterfaceOpen) {
-    setIsInterfaceOpen(true);
-    if (!_isInterfaceOpen) {
-      return false;
-    }
+  auto started = std::chrono::steady_clock::now();
+
+  _reconnectStatistics.attempts++;
+  if (!_transport->reconnect()) {
+    UVC_DIAGNOSTIC(Info, Enumeration, "%s (serial %s) could not be reconnected",
+                   _deviceName.c_str(), _serialNumber.c_str());
+    return false;
   }
+  _locationId = _transport->identity().locationId;
 
-  IOReturn result =
-      (*_controllerInterface)
-          ->ControlRequest(_controllerInterface, 0, &controlRequest);
+  // Values read before the device went away may no longer hold:
+  for (CachedValue& cached : _cachedValues) {
+    cached.length = 0;
+  }
 
-  return (result == kIOReturnSuccess);
+  size_t restorable = 0;
+  size_t restored = restoreValues(&restorable);
+  uint32_t micros = static_cast<uint32_t>(
+      std::chrono::duration_cast<std::chrono::microseconds>(
+          std::chrono::steady_clock::now() - started)
+          .count());
+
+  _reconnectStatistics.reconnects++;
+  _reconnectStatistics.restoredControls += restored;
+  _reconnectStatistics.failedRestores += restorable - restored;
+  _reconnectStatistics.lastRecoveryMicros = micros;
+  _reconnectStatistics.maxRecoveryMicros =
+      std::max(_reconnectStatistics.maxRecoveryMicros, micros);
+  UVC_DIAGNOSTIC(Info, Enumeration,
+                 "%s (serial %s) reconnected in %.1f ms, %zu of %zu controls "
+                 "restored",
+                 _deviceName.c_str(), _serialNumber.c_str(), micros / 1000.0,
+                 restored, restorable);
+  return true;
 }
 
-bool UVCDeviceController::setData(void* value,
-                                  int length,
-                                  int selector,
-                                  int unitId) {
-  IOUSBDevRequest request;
-  memset(&request, 0, sizeof(request));
+bool UVCDeviceController::reconnectsAutomatically() const {
+  return _reconnectsAutomatically;
+}
 
-  request.bmRequestType =
-      USBmakebmRequestType(kUSBOut, kUSBClass, kUSBInterface);
-  request.bRequest = UVC_SET_CUR;
-  request.wValue = (selector << 8);
-  request.wIndex =
-      (unitId << 8) |
-      _videoInterfaceIndex;  // UVC protocol: (unitId << 8) | interfaceIndex
-  request.wLength = length;
-  request.pData = value;
-  request.wLenDone = 0;
+void UVCDeviceController::setReconnectsAutomatically(
+    bool reconnectsAutomatically) {
+  _reconnectsAutomatically = reconnectsAutomatically;
+}
 
-  return sendControlRequest(request);
+UVCReconnectStatistics UVCDeviceController::reconnectStatistics() const {
+  return _reconnectStatistics;
 }
 
-bool UVCDeviceController::getData(void* value,
-                                  int type,
-                                  int length,
-                                  int selector,
-                                  int unitId) {
-  IOUSBDevRequest request;
-  memset(&request, 0, sizeof(request));
+void UVCDeviceController::setDeviceLock(
+    std::shared_ptr<UVCDeviceLock> deviceLock,
+    uint32_t timeoutMillis) {
+  _deviceLock = std::move(deviceLock);
+  _lockTimeoutMillis = timeoutMillis;
+}
 
-  request.bmRequestType =
-      USBmakebmRequestType(kUSBIn, kUSBClass, kUSBInterface);
-  request.bRequest = type;  // GET_CUR, GET_MIN, GET_MAX, etc.
-  request.wValue = (selector << 8);
-  request.wIndex =
-      (unitId << 8) |
-      _videoInterfaceIndex;  // UVC protocol: (unitId << 8) | interfaceIndex
-  request.wLength = length;
-  request.pData = value;
-  request.wLenDone = 0;
+const std::shared_ptr<UVCDeviceLock>& UVCDeviceController::deviceLock()
+    const {
+  return _deviceLock;
+}
 
-  return sendControlRequest(request);
+void UVCDeviceController::setProbeCache(
+    std::shared_ptr<UVCProbeCache> probeCache) {
+  _probeCache = std::move(probeCache);
 }
 
-bool UVCDeviceController::capabilities(uvc_capabilities_t* capabilities,
-                                       size_t controlId) {
-  if (controlId >= uvcControlDefinitions.size()) {
-    return false;
-  }
+const std::shared_ptr<UVCProbeCache>& UVCDeviceController::probeCache()
+    const {
+  return _probeCache;
+}
 
-  const auto& controlDef = uvcControlDefinitions[controlId];
+void UVCDeviceController::setWriteJournal(
+    std::shared_ptr<UVCWriteJournal> writeJournal) {
+  _writeJournal = std::move(writeJournal);
+  _journalKey = (_writeJournal && _transport)
+                    ? UVCWriteJournal::deviceKey(_transport->identity(),
+                                                 _transport->interfaceNumber())
+                    : std::string();
+}
 
-  // Get real unit ID from parsed descriptors
-  std::string unitKey = (controlDef.unitType == 0) ? "UVC_PROCESSING_UNIT_ID"
-                                                   : "UVC_INPUT_TERMINAL_ID";
-  auto it = _unitIds.find(unitKey);
-  int unitId;
+const std::shared_ptr<UVCWriteJournal>& UVCDeviceController::writeJournal()
+    const {
+  return _writeJournal;
+}
 
-  if (it == _unitIds.end()) {
-    // Fallback to default IDs if parsing failed
-    unitId = (controlDef.unitType == 0) ? 0x02 : 0x01;
-  } else {
-    unitId = it->second;
-  }
+void UVCDeviceController::setHistory(
+    std::shared_ptr<UVCHistoryWriter> history) {
+  _history = std::move(history);
+  _historySeries.assign(_history ? std::size(uvcControlDefinitions) : 0, -1);
+}
 
-  uint8_t scratch;
-  if (getData(&scratch, UVC_GET_INFO, 1, controlDef.controlSelector, unitId)) {
-    *capabilities = scratch;
-    return true;
+const std::shared_ptr<UVCHistoryWriter>& UVCDeviceController::history()
+    const {
+  return _history;
+}
+
+bool UVCDeviceController::redriveJournal(size_t* redriven, size_t* elided) {
+  size_t redrivenWrites = 0, elidedWrites = 0;
+  bool isComplete = true;
+
+  if (_writeJournal) {
+    for (UVCJournalBatch& batch : _writeJournal->pendingBatches(_journalKey)) {
+      std::vector<UVCValueTransfer> transfers;
+      std::vector<uint8_t> current;
+
+      for (UVCJournalWrite& write : batch.writes) {
+        // A control the device (no longer) implements cannot be re-driven:
+        if (!controlWithId(write.controlId)) {
+          UVC_DIAGNOSTIC(Warning, General,
+                         "%s: journaled %s not re-driven, control not "
+                         "available",
+                         _deviceName.c_str(),
+                         uvcControlDefinitions[write.controlId].name);
+          continue;
+        }
+        current.resize(write.data.size());
+        if (getValueData(current.data(), current.size(), write.controlId) &&
+            current == write.data) {
+          elidedWrites++;
+          continue;
+        }
+
+        UVCValueTransfer transfer;
+        transfer.controlId = write.controlId;
+        transfer.isWrite = true;
+        transfer.data = write.data.data();
+        transfer.length = write.data.size();
+        transfers.push_back(transfer);
+      }
+      // Sent under the batch's own sequence, so that a failure leaves just
+      // the one intent pending:
+      if (transfers.empty()) {
+        _writeJournal->confirm(batch.sequence);
+      } else if (!sendJournaledTransfers(transfers.data(), transfers.size(),
+                                         batch.sequence)) {
+        isComplete = false;
+        continue;
+      }
+      redrivenWrites += transfers.size();
+    }
+  }
+  if (redriven) {
+    *redriven = redrivenWrites;
+  }
+  if (elided) {
+    *elided = elidedWrites;
   }
+  return isComplete;
+}
 
-  // If USB request fails, this control is not available
-  return false;
+std::vector<std::string> UVCDeviceController::controlStrings() const {
+  // Like the original, this should return ALL defined control names
+  // The filtering happens in main.cpp when calling controlWithName()
+  return getAllControlStrings();
+}
+
+std::string UVCDeviceController::description() const {
+  char ids[32];
+  char location[64];
+
+  snprintf(ids, sizeof(ids), " (0x%x:0x%x)", _vendorId, _productId);
+  snprintf(location, sizeof(location), " LocationID: 0x%x UVC Version: %x.%x",
+           _locationId, _uvcVersion >> 8, _uvcVersion & 0xFF);
+
+  std::string s("UVCController: ");
+  s += _deviceName;
+  s += ids;
+  s += " Serial Number: ";
+  s += _serialNumber;
+  s += location;
+  return s;
 }
 
+// Private helper methods
 void UVCDeviceController::getLowValue(std::shared_ptr<UVCValue>* lowValue,
                                       std::shared_ptr<UVCValue>* highValue,
                                       std::shared_ptr<UVCValue>* stepSize,
                                       std::shared_ptr<UVCValue>* defaultValue,
                                       uvc_capabilities_t* capabilities,
                                       size_t controlId) {
-  if (controlId >= uvcControlDefinitions.size()) {
+  if (controlId >= std::size(uvcControlDefinitions)) {
     *lowValue = nullptr;
     *highValue = nullptr;
     *stepSize = nullptr;
@@ -825,30 +813,30 @@ void UVCDeviceController::getLowValue(std::shared_ptr<UVCValue>* lowValue,
 
   const auto& controlDef = uvcControlDefinitions[controlId];
 
-  // Get real unit ID from parsed descriptors
-  std::string unitKey = (controlDef.unitType == 0) ? "UVC_PROCESSING_UNIT_ID"
-                                                   : "UVC_INPUT_TERMINAL_ID";
-  auto it = _unitIds.find(unitKey);
-  int unitId;
-
-  if (it == _unitIds.end()) {
-    // Fallback to default IDs if parsing failed
-    unitId = (controlDef.unitType == 0) ? 0x02 : 0x01;
-  } else {
-    unitId = it->second;
-  }
+  int unitId = unitIdForControl(controlId);
+  const UVCControlQuirks* quirks = _quirks.forControl(controlId);
 
-  // Try to get minimum and maximum values
+  // Try to get minimum and maximum values; a range the model is known to
+  // misreport is not asked for
   if (*lowValue && *highValue) {
-    if (getData((*lowValue)->valuePtr(), UVC_GET_MIN,
-                static_cast<int>((*lowValue)->byteSize()),
-                controlDef.controlSelector, unitId) &&
+    bool hasRange = quirks && quirks->minimum && quirks->maximum;
+
+    if (!hasRange && getData((*lowValue)->valuePtr(), UVC_GET_MIN,
+                             static_cast<int>((*lowValue)->byteSize()),
+                             controlDef.controlSelector, unitId) &&
         getData((*highValue)->valuePtr(), UVC_GET_MAX,
                 static_cast<int>((*highValue)->byteSize()),
                 controlDef.controlSelector, unitId)) {
-      *capabilities |= kUVCControlHasRange;
       (*lowValue)->byteSwapUSBToHostEndian();
       (*highValue)->byteSwapUSBToHostEndian();
+      hasRange = true;
+    }
+    if (hasRange && quirks) {
+      hasRange = scanQuirkValue(**lowValue, quirks->minimum, controlId) &&
+                 scanQuirkValue(**highValue, quirks->maximum, controlId);
+    }
+    if (hasRange) {
+      *capabilities |= kUVCControlHasRange;
     } else {
       *lowValue = nullptr;
       *highValue = nullptr;
@@ -857,11 +845,19 @@ void UVCDeviceController::getLowValue(std::shared_ptr<UVCValue>* lowValue,
 
   // Try to get step size
   if (*stepSize) {
-    if (getData((*stepSize)->valuePtr(), UVC_GET_RES,
-                static_cast<int>((*stepSize)->byteSize()),
-                controlDef.controlSelector, unitId)) {
-      *capabilities |= kUVCControlHasStepSize;
+    bool hasStepSize = false;
+
+    if (quirks && quirks->stepSize) {
+      hasStepSize = scanQuirkValue(**stepSize, quirks->stepSize, controlId);
+    } else if (!(quirks && (quirks->flags & kUVCQuirkNoGetRes)) &&
+               getData((*stepSize)->valuePtr(), UVC_GET_RES,
+                       static_cast<int>((*stepSize)->byteSize()),
+                       controlDef.controlSelector, unitId)) {
       (*stepSize)->byteSwapUSBToHostEndian();
+      hasStepSize = true;
+    }
+    if (hasStepSize) {
+      *capabilities |= kUVCControlHasStepSize;
     } else {
       *stepSize = nullptr;
     }
@@ -880,65 +876,332 @@ void UVCDeviceController::getLowValue(std::shared_ptr<UVCValue>* lowValue,
   }
 }
 
-bool UVCDeviceController::getValue(std::shared_ptr<UVCValue> value,
-                                   size_t controlId) {
-  if (controlId >= uvcControlDefinitions.size()) {
-    return false;
+size_t UVCDeviceController::controlIdWithName(const char* controlName) {
+  for (size_t i = 0; i < std::size(uvcControlDefinitions); i++) {
+    if (strcmp(controlName, uvcControlDefinitions[i].name) == 0) {
+      return i;
+    }
   }
+  return kUVCControlIdInvalid;
+}
 
-  const auto& controlDef = uvcControlDefinitions[controlId];
+size_t UVCDeviceController::controlIdWithName(const std::string& controlName) {
+  return controlIdWithName(controlName.c_str());
+}
 
-  // Get real unit ID from parsed descriptors
-  std::string unitKey = (controlDef.unitType == 0) ? "UVC_PROCESSING_UNIT_ID"
-                                                   : "UVC_INPUT_TERMINAL_ID";
-  auto it = _unitIds.find(unitKey);
-  int unitId;
+size_t UVCDeviceController::controlCount() {
+  return std::size(uvcControlDefinitions);
+}
 
-  if (it == _unitIds.end()) {
-    // Fallback to default IDs if parsing failed
-    unitId = (controlDef.unitType == 0) ? 0x02 : 0x01;
-  } else {
-    unitId = it->second;
+const char* UVCDeviceController::controlNameWithId(size_t controlId) {
+  if (controlId >= std::size(uvcControlDefinitions)) {
+    return nullptr;
   }
+  return uvcControlDefinitions[controlId].name;
+}
+
+const char* UVCDeviceController::controlTypeWithId(size_t controlId) {
+  if (controlId >= std::size(uvcControlDefinitions)) {
+    return nullptr;
+  }
+  return uvcControlDefinitions[controlId].typeSignature;
+}
+
+bool UVCDeviceController::shouldReconnect() {
+  return _reconnectsAutomatically &&
+         lastTransferStatus() == UVCTransferStatus::NoDevice && reconnect();
+}
 
-  return getData(value->valuePtr(), UVC_GET_CUR,
-                 static_cast<int>(value->byteSize()),
-                 controlDef.controlSelector, unitId);
+// Relative controls start a movement rather than set a state, so they are
+// neither restored nor re-driven:
+static bool UVCIsRelativeControl(size_t controlId) {
+  const char* name = uvcControlDefinitions[controlId].name;
+  size_t nameLength = strlen(name);
+
+  return nameLength > 4 && strcmp(name + nameLength - 4, "-rel") == 0;
+}
+
+// Journal the writes among transfers before they are sent, setting sequence
+// to the batch to confirm (zero if there is nothing to journal).  Returns
+// false if the writes must not be sent:
+static bool UVCIsJournaledTransfer(const UVCValueTransfer& transfer) {
+  return transfer.isWrite &&
+         transfer.controlId < std::size(uvcControlDefinitions) &&
+         !UVCIsRelativeControl(transfer.controlId);
 }
 
-bool UVCDeviceController::setValue(std::shared_ptr<UVCValue> value,
-                                   size_t controlId) {
-  if (controlId >= uvcControlDefinitions.size()) {
+static std::vector<UVCJournalWrite> UVCJournalWrites(
+    const UVCValueTransfer* transfers,
+    size_t count) {
+  std::vector<UVCJournalWrite> writes;
+
+  for (size_t i = 0; i < count; i++) {
+    if (UVCIsJournaledTransfer(transfers[i])) {
+      const uint8_t* data = static_cast<const uint8_t*>(transfers[i].data);
+      UVCJournalWrite write;
+      write.controlId = transfers[i].controlId;
+      write.data.assign(data, data + transfers[i].length);
+      writes.push_back(std::move(write));
+    }
+  }
+  return writes;
+}
+
+bool UVCDeviceController::journalIntent(const UVCValueTransfer* transfers,
+                                        size_t count,
+                                        uint64_t* sequence) {
+  *sequence = 0;
+  if (!_writeJournal) {
+    return true;
+  }
+
+  std::vector<UVCJournalWrite> writes = UVCJournalWrites(transfers, count);
+  if (writes.empty()) {
+    return true;
+  }
+
+  *sequence = _writeJournal->logIntent(_journalKey, writes.data(),
+                                       writes.size());
+  if (!*sequence) {
+    UVC_DIAGNOSTIC(Error, Transfer,
+                   "%s: %zu writes not sent, %s could not be written",
+                   _deviceName.c_str(), writes.size(),
+                   _writeJournal->path().c_str());
     return false;
   }
+  return true;
+}
 
-  const auto& controlDef = uvcControlDefinitions[controlId];
+// Close the journaled batch sequence once transfers have been sent:  it is
+// confirmed if every journaled write got through, otherwise kept for
+// re-driving, since some of its writes never reached the device.
+void UVCDeviceController::settleIntent(uint64_t sequence,
+                                       const UVCValueTransfer* transfers,
+                                       size_t count) {
+  for (size_t i = 0; i < count; i++) {
+    if (UVCIsJournaledTransfer(transfers[i]) && !transfers[i].succeeded) {
+      std::vector<UVCJournalWrite> writes = UVCJournalWrites(transfers, count);
+      _writeJournal->fail(sequence, _journalKey, writes.data(), writes.size());
+      return;
+    }
+  }
+  _writeJournal->confirm(sequence);
+}
 
-  // Get real unit ID from parsed descriptors
-  std::string unitKey = (controlDef.unitType == 0) ? "UVC_PROCESSING_UNIT_ID"
-                                                   : "UVC_INPUT_TERMINAL_ID";
-  auto it = _unitIds.find(unitKey);
-  if (it == _unitIds.end()) {
-    // Fallback to default IDs if parsing failed
-    int unitId = (controlDef.unitType == 0) ? 0x02 : 0x01;
-    return setData(value->valuePtr(), static_cast<int>(value->byteSize()),
-                   controlDef.controlSelector, unitId);
+void UVCDeviceController::rememberValue(const void* data,
+                                        size_t length,
+                                        size_t controlId) {
+  if (UVCIsRelativeControl(controlId)) {
+    return;
+  }
+  if (_shadowValues.empty()) {
+    _shadowValues.resize(std::size(uvcControlDefinitions));
   }
 
-  int unitId = it->second;
+  ShadowValue& shadow = _shadowValues[controlId];
+  if (shadow.length < length) {
+    shadow.data = static_cast<uint8_t*>(_arena->allocate(length, 1));
+  }
+  memcpy(shadow.data, data, length);
+  shadow.length = length;
+}
 
-  return setData(value->valuePtr(), static_cast<int>(value->byteSize()),
-                 controlDef.controlSelector, unitId);
+void UVCDeviceController::cacheValue(const void* data,
+                                     size_t length,
+                                     size_t controlId) {
+  if (_cachedValues.empty()) {
+    return;
+  }
+
+  CachedValue& cached = _cachedValues[controlId];
+  if (cached.capacity < length) {
+    cached.data = static_cast<uint8_t*>(_arena->allocate(length, 1));
+    cached.capacity = length;
+  }
+  memcpy(cached.data, data, length);
+  cached.length = length;
+  cached.updatedAt = std::chrono::steady_clock::now();
 }
 
-size_t UVCDeviceController::controlIndexForString(
-    const std::string& controlString) {
-  for (size_t i = 0; i < uvcControlDefinitions.size(); i++) {
-    if (uvcControlDefinitions[i].name == controlString) {
-      return i;
+void UVCDeviceController::recordHistory(const void* data,
+                                        size_t length,
+                                        size_t controlId) {
+  if (!_history || !_transport || controlId >= _historySeries.size()) {
+    return;
+  }
+
+  int32_t& series = _historySeries[controlId];
+  if (series < 0) {
+    series = _history->addSeries(_transport->identity(),
+                                 _transport->interfaceNumber(), controlId);
+  }
+  if (series != kUVCHistorySeriesInvalid) {
+    auto micros = std::chrono::duration_cast<std::chrono::microseconds>(
+                      std::chrono::system_clock::now().time_since_epoch())
+                      .count();
+    _history->record(static_cast<uint16_t>(series),
+                     static_cast<uint64_t>(micros), data, length);
+  }
+}
+
+size_t UVCDeviceController::controlIdForRequest(
+    const UVCControlRequest& request) const {
+  for (size_t controlId = 0; controlId < std::size(uvcControlDefinitions);
+       controlId++) {
+    if (uvcControlDefinitions[controlId].controlSelector ==
+            (request.wValue >> 8) &&
+        unitIdForControl(controlId) == (request.wIndex >> 8)) {
+      return controlId;
+    }
+  }
+  return kUVCControlIdInvalid;
+}
+
+uint32_t UVCDeviceController::settleMicros(size_t controlId) const {
+  const UVCControlQuirks* quirks = _quirks.forControl(controlId);
+  return quirks ? quirks->settleMicros : 0;
+}
+
+bool UVCDeviceController::scanQuirkValue(UVCValue& value,
+                                         const char* text,
+                                         size_t controlId) const {
+  if (!text || value.scanCString(text, UVCTypeScanFlags(0))) {
+    return true;
+  }
+  UVC_DIAGNOSTIC(Warning, Parse, "Ignoring quirk value '%s' for %s on %s",
+                 text, uvcControlDefinitions[controlId].name,
+                 _deviceName.c_str());
+  return false;
+}
+
+// Hand requests to the transport no more at a time than the model allows,
+// pausing after any write to a control that needs time to settle.
+void UVCDeviceController::sendControlRequests(UVCControlRequest* requests,
+                                              UVCTransferStatus* statuses,
+                                              size_t count) {
+  size_t limit = _quirks.maxInFlight ? _quirks.maxInFlight : count;
+
+  for (size_t start = 0; start < count;) {
+    size_t end = start;
+    uint32_t micros = 0;
+
+    while (end < count && end - start < limit && !micros) {
+      const UVCControlRequest& request = requests[end++];
+      if (request.bRequest == UVC_SET_CUR && !_quirks.controls.empty()) {
+        micros = settleMicros(controlIdForRequest(request));
+      }
+    }
+    _transport->controlRequests(requests + start, statuses + start,
+                                end - start);
+    if (micros) {
+      std::this_thread::sleep_for(std::chrono::microseconds(micros));
+    }
+    start = end;
+  }
+}
+
+// Send, in batches of at most one per control, the transfers that have not
+// yet succeeded.  Returns false if the device was found gone.
+bool UVCDeviceController::sendValueTransfers(UVCValueTransfer* transfers,
+                                             size_t count) {
+  UVCControlRequest requests[std::size(uvcControlDefinitions)];
+  UVCTransferStatus statuses[std::size(uvcControlDefinitions)];
+  size_t indices[std::size(uvcControlDefinitions)];
+  UVCTransferStatus lastStatus = UVCTransferStatus::Success;
+  bool isDeviceGone = false;
+
+  if (!_transport->isOpen() && !_transport->open()) {
+    _lastTransferStatus = UVCTransferStatus::NoDevice;
+    return false;
+  }
+  for (size_t next = 0; next < count;) {
+    size_t batched = 0;
+
+    for (; next < count && batched < std::size(requests); next++) {
+      const UVCValueTransfer& transfer = transfers[next];
+
+      if (transfer.succeeded ||
+          transfer.controlId >= std::size(uvcControlDefinitions)) {
+        continue;
+      }
+
+      UVCControlRequest& request = requests[batched];
+      request.bmRequestType =
+          transfer.isWrite ? UVC_REQUEST_TYPE_SET : UVC_REQUEST_TYPE_GET;
+      request.bRequest = transfer.isWrite ? UVC_SET_CUR : UVC_GET_CUR;
+      request.wValue =
+          (uvcControlDefinitions[transfer.controlId].controlSelector << 8);
+      request.wIndex = (unitIdForControl(transfer.controlId) << 8) |
+                       _transport->interfaceNumber();
+      request.wLength = static_cast<uint16_t>(transfer.length);
+      request.pData = transfer.data;
+      request.wLenDone = 0;
+      indices[batched++] = next;
+    }
+    sendControlRequests(requests, statuses, batched);
+
+    for (size_t i = 0; i < batched; i++) {
+      if (statuses[i] == UVCTransferStatus::Success) {
+        transfers[indices[i]].succeeded = true;
+        continue;
+      }
+      lastStatus = statuses[i];
+      isDeviceGone = isDeviceGone || lastStatus == UVCTransferStatus::NoDevice;
+      UVC_DIAGNOSTIC(Info, Transfer,
+                     "request 0x%02x wValue 0x%04x wIndex 0x%04x failed (%d)",
+                     requests[i].bRequest, requests[i].wValue,
+                     requests[i].wIndex, static_cast<int>(lastStatus));
+    }
+  }
+  _lastTransferStatus = isDeviceGone ? UVCTransferStatus::NoDevice : lastStatus;
+  return !isDeviceGone;
+}
+
+size_t UVCDeviceController::restoreValues(size_t* restorable) {
+  UVCControlRequest requests[std::size(uvcControlDefinitions)];
+  UVCTransferStatus statuses[std::size(uvcControlDefinitions)];
+  size_t count = 0;
+  UVCDeviceLockGuard lockGuard(_deviceLock.get(), UVCLockMode::Exclusive,
+                               _lockTimeoutMillis);
+
+  // Automatic-mode controls first (pass 0), everything else after them:
+  for (int pass = 0; pass < 2; pass++) {
+    for (size_t controlId = 0; controlId < _shadowValues.size(); controlId++) {
+      const ShadowValue& shadow = _shadowValues[controlId];
+      const UVCControlDef& controlDef = uvcControlDefinitions[controlId];
+      bool isAutomaticMode = strncmp(controlDef.name, "auto-", 5) == 0;
+
+      if (!shadow.data || isAutomaticMode != (pass == 0)) {
+        continue;
+      }
+
+      UVCControlRequest& request = requests[count++];
+      request.bmRequestType = UVC_REQUEST_TYPE_SET;
+      request.bRequest = UVC_SET_CUR;
+      request.wValue = (controlDef.controlSelector << 8);
+      request.wIndex =
+          (unitIdForControl(controlId) << 8) | _transport->interfaceNumber();
+      request.wLength = static_cast<uint16_t>(shadow.length);
+      request.pData = shadow.data;
+      request.wLenDone = 0;
     }
   }
-  return SIZE_MAX;
+  *restorable = count;
+  if (!lockGuard) {
+    UVC_DIAGNOSTIC(Warning, General,
+                   "Timed out waiting for %s, no values restored",
+                   _deviceLock->path().c_str());
+    return 0;
+  }
+  sendControlRequests(requests, statuses, count);
+
+  size_t restored = 0;
+  for (size_t i = 0; i < count; i++) {
+    if (statuses[i] == UVCTransferStatus::Success) {
+      restored++;
+    }
+  }
+  return restored;
 }
 
 bool UVCDeviceController::controlIsNotAvailable(
@@ -949,7 +1212,7 @@ bool UVCDeviceController::controlIsNotAvailable(
 
 std::map<std::string, int> UVCDeviceController::getControlMapping() {
   std::map<std::string, int> mapping;
-  for (size_t i = 0; i < uvcControlDefinitions.size(); i++) {
+  for (size_t i = 0; i < std::size(uvcControlDefinitions); i++) {
     mapping[uvcControlDefinitions[i].name] = static_cast<int>(i);
   }
   return mapping;
@@ -970,23 +1233,27 @@ UVCDeviceController::getProcessingUnitControlEnableMapping() {
 // UVCControl implementation
 UVCControl::UVCControl(const std::string& controlName,
                        std::weak_ptr<UVCDeviceController> parentController,
-                       size_t controlIndex)
+                       size_t controlIndex,
+                       std::shared_ptr<UVCArena> arena)
     : _parentController(parentController),
       _controlIndex(controlIndex),
-      _controlName(controlName),
+      _controlName(controlName.data(),
+                   controlName.size(),
+                   UVCArenaAllocator<char>(arena)),
       _capabilities(0) {
-  if (_controlIndex < uvcControlDefinitions.size()) {
+  if (_controlIndex < std::size(uvcControlDefinitions)) {
     const auto& controlDef = uvcControlDefinitions[_controlIndex];
 
     // Create the UVCType for this control
-    auto uvcType = UVCType::createFromCString(controlDef.typeSignature.c_str());
+    auto uvcType =
+        UVCType::createFromCString(controlDef.typeSignature, arena);
 
     if (uvcType) {
-      _currentValue = UVCValue::create(uvcType);
-      _minimum = UVCValue::create(uvcType);
-      _maximum = UVCValue::create(uvcType);
-      _stepSize = UVCValue::create(uvcType);
-      _defaultValue = UVCValue::create(uvcType);
+      _currentValue = UVCValue::create(uvcType, arena);
+      _minimum = UVCValue::create(uvcType, arena);
+      _maximum = UVCValue::create(uvcType, arena);
+      _stepSize = UVCValue::create(uvcType, arena);
+      _defaultValue = UVCValue::create(uvcType, arena);
     }
 
     // Get capabilities and range values from parent controller
@@ -1021,7 +1288,7 @@ bool UVCControl::hasDefaultValue() const {
 }
 
 std::string UVCControl::controlName() const {
-  return _controlName;
+  return std::string(_controlName.data(), _controlName.size());
 }
 
 std::shared_ptr<UVCValue> UVCControl::currentValue() {
@@ -1029,13 +1296,47 @@ std::shared_ptr<UVCValue> UVCControl::currentValue() {
     return nullptr;
 
   if (auto controller = _parentController.lock()) {
-    if (controller->getValue(_currentValue, _controlIndex)) {
+    if (controller->getValue(*_currentValue, _controlIndex)) {
       return _currentValue;
     }
   }
   return nullptr;
 }
 
+std::shared_ptr<const UVCValue> UVCControl::lastValue() const {
+  return _currentValue;
+}
+
+size_t UVCControl::formatCurrentValue(char* outString, size_t outSize) const {
+  if (!_currentValue) {
+    if (outString && outSize) {
+      *outString = '\0';
+    }
+    return 0;
+  }
+  return _currentValue->formatValue(outString, outSize);
+}
+
+size_t UVCControl::controlId() const {
+  return _controlIndex;
+}
+
+uvc_capabilities_t UVCControl::capabilities() const {
+  return _capabilities;
+}
+
+size_t UVCControl::valueSize() const {
+  return _currentValue ? _currentValue->byteSize() : 0;
+}
+
+bool UVCControl::writeFromBuffer(const void* buffer, size_t length) {
+  if (!_currentValue || !buffer || length != _currentValue->byteSize()) {
+    return false;
+  }
+  memcpy(_currentValue->valuePtr(), buffer, length);
+  return writeFromCurrentValue();
+}
+
 std::shared_ptr<UVCValue> UVCControl::minimum() const {
   return _minimum;
 }
@@ -1077,7 +1378,18 @@ bool UVCControl::readIntoCurrentValue() {
   }
 
   if (auto controller = _parentController.lock()) {
-    return controller->getValue(_currentValue, _controlIndex);
+    return controller->getValue(*_currentValue, _controlIndex);
+  }
+  return false;
+}
+
+bool UVCControl::readIntoCurrentValue(uint32_t maxAgeMicros) {
+  if (!_currentValue) {
+    return false;
+  }
+
+  if (auto controller = _parentController.lock()) {
+    return controller->getValue(*_currentValue, _controlIndex, maxAgeMicros);
   }
   return false;
 }
@@ -1088,78 +1400,78 @@ bool UVCControl::writeFromCurrentValue() {
   }
 
   if (auto controller = _parentController.lock()) {
-    return controller->setValue(_currentValue, _controlIndex);
+    return controller->setValue(*_currentValue, _controlIndex);
   }
   return false;
 }
 
 std::string UVCControl::summaryString() const {
-  std::stringstream ss;
+  std::string s(_controlName.data(), _controlName.size());
 
   // Start with control name and opening brace
-  ss << _controlName << " {\n";
+  s += " {\n";
 
   // Add type description
   if (_currentValue && _currentValue->valueType()) {
-    ss << "  type-description: {\n";
-    ss << _currentValue->valueType()->typeSummaryString();
-    ss << "  },";
+    s += "  type-description: {\n";
+    s += _currentValue->valueType()->typeSummaryString();
+    s += "  },";
   }
 
   // Add range values if available
   if (hasRange() && _minimum && _maximum) {
-    ss << "\n  minimum: " << _minimum->stringValue();
-    ss << "\n  maximum: " << _maximum->stringValue();
+    s += "\n  minimum: " + _minimum->stringValue();
+    s += "\n  maximum: " + _maximum->stringValue();
   }
 
   // Add step size if available
   if (hasStepSize() && _stepSize) {
-    ss << "\n  step-size: " << _stepSize->stringValue();
+    s += "\n  step-size: " + _stepSize->stringValue();
   }
 
   // Add default value if available
   if (hasDefaultValue() && _defaultValue) {
-    ss << "\n  default-value: " << _defaultValue->stringValue();
+    s += "\n  default-value: " + _defaultValue->stringValue();
   }
 
   // Add current value (make sure we have the latest value)
   if (_currentValue) {
     const_cast<UVCControl*>(this)->readIntoCurrentValue();
-    ss << "\n  current-value: " << _currentValue->stringValue();
+    s += "\n  current-value: " + _currentValue->stringValue();
   }
 
-  ss << "\n}";
+  s += "\n}";
 
-  return ss.str();
+  return s;
 }
 
 std::string UVCControl::description() const {
-  std::stringstream ss;
-  ss << "UVCControl: " << _controlName << "\n";
-  ss << "  Capabilities: ";
+  std::string s("UVCControl: ");
+  s.append(_controlName.data(), _controlName.size());
+  s += "\n  Capabilities: ";
   if (supportsGetValue())
-    ss << "GET ";
+    s += "GET ";
   if (supportsSetValue())
-    ss << "SET ";
-  ss << "\n";
+    s += "SET ";
+  s += "\n";
 
   if (_currentValue) {
-    ss << "  Current Value: " << _currentValue->stringValue() << "\n";
+    s += "  Current Value: " + _currentValue->stringValue() + "\n";
   }
   if (_minimum) {
-    ss << "  Minimum: " << _minimum->stringValue() << "\n";
+    s += "  Minimum: " + _minimum->stringValue() + "\n";
   }
   if (_maximum) {
-    ss << "  Maximum: " << _maximum->stringValue() << "\n";
+    s += "  Maximum: " + _maximum->stringValue() + "\n";
   }
   if (_stepSize) {
-    ss << "  Step Size: " << _stepSize->stringValue() << "\n";
+    s += "  Step Size: " + _stepSize->stringValue() + "\n";
   }
   if (_defaultValue) {
-    ss << "  Default: " << _defaultValue->stringValue() << "\n";
+    s += "  Default: " + _defaultValue->stringValue() + "\n";
   }
 
-  return ss.str();
+  return s;
 }
 
 // Control name constants are already defined at the end of the previous file
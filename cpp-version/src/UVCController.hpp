@@ -13,36 +13,77 @@
 
 #pragma once
 
+#include <chrono>
+#include <cstddef>
 #include <cstdint>
 #include <map>
 #include <memory>
 #include <string>
 #include <vector>
 
-#include <IOKit/IOCFPlugIn.h>
+#if defined(__APPLE__)
 #include <IOKit/IOKitLib.h>
-#include <IOKit/IOMessage.h>
-#include <IOKit/usb/IOUSBLib.h>
-
+#endif
+
+#include "UVCArena.hpp"
+#include "UVCBasicController.hpp"
+#include "UVCBinding.hpp"
+#include "UVCDeviceLock.hpp"
+#include "UVCHistory.hpp"
+#include "UVCProbeCache.hpp"
+#include "UVCQuirks.hpp"
+#include "UVCTransport.hpp"
 #include "UVCValue.hpp"
+#include "UVCWriteJournal.hpp"
 
 // Forward declaration
 class UVCControl;
 
-using uvc_capabilities_t = uint32_t;
-
-// UVC Control Capability Flags
-enum {
-  // Bits 0-7 from UVC standard
-  kUVCControlSupportsGet = 1 << 0,
-  kUVCControlSupportsSet = 1 << 1,
-  kUVCControlDisabledDueToAutomaticMode = 1 << 2,
-  kUVCControlAutoUpdateControl = 1 << 3,
-  kUVCControlAsynchronousControl = 1 << 4,
-  // Bits 8+ are custom
-  kUVCControlHasRange = 1 << 8,
-  kUVCControlHasStepSize = 1 << 9,
-  kUVCControlHasDefaultValue = 1 << 10
+// Returned by controlIdWithName for names that are not implemented:
+const size_t kUVCControlIdInvalid = SIZE_MAX;
+
+/*!
+  @struct UVCReconnectStatistics
+
+  How a controller has fared recovering from its device dropping off the
+  bus.  Times are in microseconds, from the start of a reconnect to the end
+  of its restore.
+*/
+struct UVCReconnectStatistics {
+  uint64_t attempts = 0;
+  uint64_t reconnects = 0;
+  uint64_t restoredControls = 0;
+  uint64_t failedRestores = 0;
+  uint32_t lastRecoveryMicros = 0;
+  uint32_t maxRecoveryMicros = 0;
+};
+
+/*!
+  @struct UVCPowerStatistics
+
+  How a controller has dealt with its device's runtime suspend:  wakeups
+  counts the reads, writes and batches that found the device suspended and
+  resumed it (those that failed are not counted), wakeupsAvoided the reads
+  answered from remembered values instead.
+*/
+struct UVCPowerStatistics {
+  uint64_t wakeups = 0;
+  uint64_t wakeupsAvoided = 0;
+};
+
+/*!
+  @struct UVCValueTransfer
+
+  One read or write of a UVCDeviceController::transferValues batch.  data
+  holds (or receives) the length bytes of the value, in USB byte order;
+  succeeded is filled in.
+*/
+struct UVCValueTransfer {
+  size_t controlId = kUVCControlIdInvalid;
+  bool isWrite = false;
+  void* data = nullptr;
+  size_t length = 0;
+  bool succeeded = false;
 };
 
 /*!
@@ -56,9 +97,13 @@ enum {
   instantiated.  The vendor- and product-id; USB location id; interface index;
   version of the UVC specification implemented; and the control enablement bit
   vectors are all explored and retained when available.
+
+  Control requests go through BasicUVCDeviceController<UVCTransport>, i.e. the
+  runtime transport interface, so that one controller works with any backend.
 */
 class UVCDeviceController
-    : public std::enable_shared_from_this<UVCDeviceController> {
+    : public BasicUVCDeviceController<UVCTransport>,
+      public std::enable_shared_from_this<UVCDeviceController> {
   friend class UVCControl;
 
  private:
@@ -67,17 +112,58 @@ class UVCDeviceController
   uint16_t _vendorId, _productId;
   std::string _serialNumber;
 
-  // All necessary functionality comes from USB standard 2.2.0:
-  IOUSBInterfaceInterface220** _controllerInterface;
-
-  bool _isInterfaceOpen;
-  bool _shouldNotCloseInterface;
-  uint8_t _videoInterfaceIndex;
-  std::map<std::string, std::shared_ptr<UVCControl>> _controls;
-  std::map<std::string, int> _unitIds;
-  uint16_t _uvcVersion;
-  std::vector<uint8_t> _terminalControlsAvailable;
-  std::vector<uint8_t> _processingUnitControlsAvailable;
+  // Backs the controls, their values, types and names; released with the
+  // last of them:
+  std::shared_ptr<UVCArena> _arena;
+
+  // Indexed by control id; a probed control that is not available stays
+  // nullptr:
+  std::vector<std::shared_ptr<UVCControl>,
+              UVCArenaAllocator<std::shared_ptr<UVCControl>>>
+      _controls;
+  std::vector<bool> _isControlProbed;
+
+  // Last value each control accepted (in USB byte order), written back after
+  // a reconnect; sized on the first write, the data placed in the arena:
+  struct ShadowValue {
+    uint8_t* data = nullptr;
+    size_t length = 0;
+  };
+  std::vector<ShadowValue, UVCArenaAllocator<ShadowValue>> _shadowValues;
+  bool _reconnectsAutomatically;
+  UVCReconnectStatistics _reconnectStatistics;
+
+  // Held around multi-transfer sequences; nullptr for none:
+  std::shared_ptr<UVCDeviceLock> _deviceLock;
+  uint32_t _lockTimeoutMillis;
+
+  // Last value each control was read as or written with (in USB byte order)
+  // and when, handed to reads that accept it while the device is suspended;
+  // sized on the first such read, the data placed in the arena:
+  struct CachedValue {
+    uint8_t* data = nullptr;
+    size_t capacity = 0;
+    size_t length = 0;
+    std::chrono::steady_clock::time_point updatedAt;
+  };
+  std::vector<CachedValue, UVCArenaAllocator<CachedValue>> _cachedValues;
+  UVCPowerStatistics _powerStatistics;
+
+  // Workarounds for this model, looked up once at construction:
+  UVCDeviceQuirks _quirks;
+
+  // Controls that failed their probe on this model before; nullptr for none:
+  std::shared_ptr<UVCProbeCache> _probeCache;
+
+  // Writes are journaled here under _journalKey before they are sent;
+  // nullptr for none:
+  std::shared_ptr<UVCWriteJournal> _writeJournal;
+  std::string _journalKey;
+
+  // Values read and written are recorded here; the series of each control,
+  // by control id, is added on its first value (-1 until then):
+  std::shared_ptr<UVCHistoryWriter> _history;
+  std::vector<int32_t> _historySeries;
 
  public:
   /*!
@@ -85,10 +171,24 @@ class UVCDeviceController
 
     Scan the USB bus and locate all video devices that appear to be
     UVC-compliant. Returns a vector containing all such devices, or empty vector
-    if no devices were present.
+    if no devices were present.  A device with several VideoControl interfaces
+    is present once per interface, all with the same locationId.
   */
   static std::vector<std::shared_ptr<UVCDeviceController>> getUVCControllers();
 
+  /*!
+    @method createWithTransport
+
+    Returns a shared_ptr to an instance which sends its control requests over
+    the given transport.  Unit ids and the UVC version are taken from the
+    transport's VideoControl descriptors.
+
+    Returns nullptr if transport is nullptr.
+  */
+  static std::shared_ptr<UVCDeviceController> createWithTransport(
+      std::shared_ptr<UVCTransport> transport);
+
+#if defined(__APPLE__)
   /*!
     @method createWithService
 
@@ -96,11 +196,27 @@ class UVCDeviceController
     the I/O Registry.  The caller retains ownership of the reference ioService
     and is responsible for releasing it.
 
+    The VideoControl interface numbered interfaceNumber is used, or the first
+    that can be opened if interfaceNumber is negative.
+
     If the device referenced by ioService is not UVC-compliant, nullptr is
     returned.
   */
   static std::shared_ptr<UVCDeviceController> createWithService(
-      io_service_t ioService);
+      io_service_t ioService,
+      int interfaceNumber = -1);
+
+  /*!
+    @method createAllWithService
+
+    Returns one instance per VideoControl interface of the given device from
+    the I/O Registry, each with its own transport (and so its own I/O queue
+    and device lock):  the sub-cameras of a composite device can be driven
+    in parallel.  Returns an empty vector if the device is not UVC-compliant.
+  */
+  static std::vector<std::shared_ptr<UVCDeviceController>>
+  createAllWithService(io_service_t ioService);
+#endif
 
   /*!
     @method createWithLocationId
@@ -109,7 +225,8 @@ class UVCDeviceController
     device is found (and appears to be UVC-compliant) a shared_ptr to an
     instance is returned.  Otherwise, nullptr is returned.
 
-    Note that the locationID should uniquely identify a single device.
+    Note that the locationID should uniquely identify a single device; of a
+    device with several VideoControl interfaces, the first is returned.
   */
   static std::shared_ptr<UVCDeviceController> createWithLocationId(
       uint32_t locationId);
@@ -137,11 +254,51 @@ class UVCDeviceController
   */
   static std::vector<std::string> getAllControlStrings();
 
-  // Constructor and destructor
+  /*!
+    @method controlIdWithName
+
+    Returns the numeric id of the named control, or kUVCControlIdInvalid if
+    no control by that name is implemented.  Ids are stable for the life of
+    the program and can be used with controlWithId to avoid name lookups on
+    every access.
+  */
+  static size_t controlIdWithName(const char* controlName);
+  static size_t controlIdWithName(const std::string& controlName);
+
+  /*!
+    @method controlCount
+
+    Returns the number of implemented controls; control ids run from zero to
+    controlCount() - 1.
+  */
+  static size_t controlCount();
+
+  /*!
+    @method controlNameWithId
+
+    Returns the name of the control with the given id, or nullptr if the id
+    is out of range.  The string remains valid for the life of the program.
+  */
+  static const char* controlNameWithId(size_t controlId);
+
+  /*!
+    @method controlTypeWithId
+
+    Returns the UVCType signature (e.g. "{S4 pan; S4 tilt}") of the control
+    with the given id, or nullptr if the id is out of range.  The string
+    remains valid for the life of the program.
+  */
+  static const char* controlTypeWithId(size_t controlId);
+
+  // Constructors and destructor
+  explicit UVCDeviceController(std::shared_ptr<UVCTransport> transport);
+#if defined(__APPLE__)
   UVCDeviceController(uint32_t locationId,
                       uint16_t vendorId,
                       uint16_t productId,
-                      io_service_t ioServiceObject);
+                      io_service_t ioServiceObject,
+                      int interfaceNumber = -1);
+#endif
   ~UVCDeviceController();
 
   // Delete copy constructor and assignment operator
@@ -184,27 +341,20 @@ class UVCDeviceController
   uint16_t productId() const;
 
   /*!
-    @method uvcVersion
-
-    Returns the version of the UVC specification which the device
-    implements (as a binary-coded decimal value, e.g. 0x0210 = 2.10).
-  */
-  uint16_t uvcVersion() const;
-
-  /*!
-    @method isInterfaceOpen
+    @method interfaceNumber
 
-    Returns true if the device interface is open.  The interface must be
-    open in order to send/receive control requests.
+    Returns the number of the VideoControl interface this instance drives;
+    only a composite device has more than one.
   */
-  bool isInterfaceOpen() const;
+  uint8_t interfaceNumber() const;
 
   /*!
-    @method setIsInterfaceOpen
+    @method arena
 
-    Force the device interface into an open- or closed-state.
+    Returns the arena holding this controller's per-device metadata:  every
+    UVCControl it has created along with their values, types and names.
   */
-  void setIsInterfaceOpen(bool isInterfaceOpen);
+  std::shared_ptr<UVCArena> arena() const;
 
   /*!
     @method controlStrings
@@ -228,6 +378,169 @@ class UVCDeviceController
   */
   std::shared_ptr<UVCControl> controlWithName(const std::string& controlName);
 
+  /*!
+    @method controlWithId
+
+    Same as controlWithName, with the control referenced by the id returned
+    from controlIdWithName.  Once a control has been probed, subsequent calls
+    perform no heap allocations.
+  */
+  std::shared_ptr<UVCControl> controlWithId(size_t controlId);
+
+  /*!
+    @method capabilities, getValue, setValue, getValueData, setValueData
+
+    As in BasicUVCDeviceController, except that a request which finds the
+    device gone calls reconnect() (if reconnectsAutomatically) and is retried
+    once.  Values written successfully are remembered for the restore.
+  */
+  bool capabilities(uvc_capabilities_t* capabilities, size_t controlId);
+  bool getValue(UVCValue& value, size_t controlId);
+  bool setValue(UVCValue& value, size_t controlId);
+  bool getValueData(void* data, size_t length, size_t controlId);
+  bool setValueData(void* data, size_t length, size_t controlId);
+
+  /*!
+    @method getValue, getValueData (allowing stale values)
+
+    As above, except that a device which is runtime-suspended (see
+    UVCTransport::powerState) is not woken if the control's value was read or
+    written within the last maxAgeMicros:  that value is returned instead.
+    Values are remembered from the controller's first such read onward.
+  */
+  bool getValue(UVCValue& value, size_t controlId, uint32_t maxAgeMicros);
+  bool getValueData(void* data,
+                    size_t length,
+                    size_t controlId,
+                    uint32_t maxAgeMicros);
+
+  /*!
+    @method transferValues
+
+    Carry out count reads and writes back to back, in a single
+    UVCTransport::controlRequests call, so that a suspended device is woken
+    once for the whole batch rather than for each value.  As with
+    setValueData, values written are remembered for the restore after a
+    reconnect.
+
+    Returns true if every transfer succeeded.
+  */
+  bool transferValues(UVCValueTransfer* transfers, size_t count);
+
+  /*!
+    @method powerStatistics
+
+    Returns the counts of device wake-ups caused and avoided.
+  */
+  UVCPowerStatistics powerStatistics() const;
+
+  /*!
+    @method reconnect
+
+    Re-open the device after it dropped off the bus (see
+    UVCTransport::reconnect) and write back the last value the device
+    accepted for each control, in a single batch:  automatic-mode controls
+    first, so that the manual values after them stick.  Relative (motion)
+    controls are not restored.
+
+    Returns true if the device is back; controls that could not be restored
+    are counted in reconnectStatistics().
+  */
+  bool reconnect();
+
+  /*!
+    @method reconnectsAutomatically
+
+    Returns true if requests that find the device gone reconnect it (the
+    default).
+  */
+  bool reconnectsAutomatically() const;
+  void setReconnectsAutomatically(bool reconnectsAutomatically);
+
+  /*!
+    @method reconnectStatistics
+
+    Returns the counters and timings of this controller's reconnects.
+  */
+  UVCReconnectStatistics reconnectStatistics() const;
+
+  /*!
+    @method setDeviceLock
+
+    Hold deviceLock around the controller's multi-transfer sequences:  shared
+    while probing a control, exclusive while restoring values after a
+    reconnect.  A sequence that cannot get the lock within timeoutMillis is
+    not performed.  Controllers for USB devices found on the system get a
+    lock from UVCDeviceLock::createForDevice; others have none until one is
+    set.  nullptr removes the lock.
+  */
+  void setDeviceLock(std::shared_ptr<UVCDeviceLock> deviceLock,
+                     uint32_t timeoutMillis = kUVCDeviceLockTimeoutMillis);
+
+  /*!
+    @method deviceLock
+
+    Returns the lock held around multi-transfer sequences, which applications
+    can also take around their own; nullptr if there is none.
+  */
+  const std::shared_ptr<UVCDeviceLock>& deviceLock() const;
+
+  /*!
+    @method setProbeCache
+
+    Consult probeCache before probing a control:  one that stalled or timed
+    out on GET_INFO (on any camera of this model, in any run) is treated as
+    absent without sending anything until the entry expires.  Probes record
+    their outcome in it.  Controllers for USB devices found on the system get
+    the cache from UVCProbeCache::createForDevice; others have none until one
+    is set.  nullptr removes the cache.
+  */
+  void setProbeCache(std::shared_ptr<UVCProbeCache> probeCache);
+
+  /*!
+    @method probeCache
+
+    Returns the cache of failed probes, nullptr if there is none.
+  */
+  const std::shared_ptr<UVCProbeCache>& probeCache() const;
+
+  /*!
+    @method setWriteJournal
+
+    Journal every write (setValueData and the writes of a transferValues
+    batch) in writeJournal before it is sent, and confirm it once the device
+    has accepted every write; a batch with a write that failed is kept for
+    redriveJournal.  Writes that cannot be journaled are not sent.  Relative
+    controls are not journaled, since sending them again would repeat the
+    movement.  nullptr removes the journal.
+  */
+  void setWriteJournal(std::shared_ptr<UVCWriteJournal> writeJournal);
+  const std::shared_ptr<UVCWriteJournal>& writeJournal() const;
+
+  /*!
+    @method redriveJournal
+
+    Send again the writes of this device's batches that the journal found
+    unconfirmed (cut short by a crash) or that failed, oldest first, and
+    confirm them.  The current value of each control is read first and
+    values the device already holds are not written again, so a batch may be
+    re-driven any number of times.  Counts the writes sent and left out in
+    redriven and elided if not nullptr.
+
+    Returns false if a batch could not be completed; it is left for the next
+    attempt.
+  */
+  bool redriveJournal(size_t* redriven = nullptr, size_t* elided = nullptr);
+
+  /*!
+    @method setHistory
+
+    Record every value read from or written to the device in history, with
+    the time it was read or written.  nullptr stops recording.
+  */
+  void setHistory(std::shared_ptr<UVCHistoryWriter> history);
+  const std::shared_ptr<UVCHistoryWriter>& history() const;
+
   /*!
     @method description
 
@@ -237,28 +550,43 @@ class UVCDeviceController
 
  private:
   // Private helper methods
-  bool findControllerInterfaceForServiceObject(io_service_t ioServiceObject);
-  void parseUVCDescriptors();
-  bool sendControlRequest(IOUSBDevRequest controlRequest);
-  bool setData(void* value, int length, int selector, int unitId);
-  bool getData(void* value, int type, int length, int selector, int unitId);
-  bool capabilities(uvc_capabilities_t* capabilities, size_t controlId);
   void getLowValue(std::shared_ptr<UVCValue>* lowValue,
                    std::shared_ptr<UVCValue>* highValue,
                    std::shared_ptr<UVCValue>* stepSize,
                    std::shared_ptr<UVCValue>* defaultValue,
                    uvc_capabilities_t* capabilities,
                    size_t controlId);
-  bool getValue(std::shared_ptr<UVCValue> value, size_t controlId);
-  bool setValue(std::shared_ptr<UVCValue> value, size_t controlId);
 
   // Static helper methods
   static std::map<std::string, int> getControlMapping();
   static std::map<std::string, int> getTerminalControlEnableMapping();
   static std::map<std::string, int> getProcessingUnitControlEnableMapping();
-  static size_t controlIndexForString(const std::string& controlString);
 
   bool controlIsNotAvailable(const std::string& controlString) const;
+
+  bool shouldReconnect();
+  void rememberValue(const void* data, size_t length, size_t controlId);
+  bool journalIntent(const UVCValueTransfer* transfers,
+                     size_t count,
+                     uint64_t* sequence);
+  void settleIntent(uint64_t sequence,
+                    const UVCValueTransfer* transfers,
+                    size_t count);
+  void cacheValue(const void* data, size_t length, size_t controlId);
+  void recordHistory(const void* data, size_t length, size_t controlId);
+  bool sendJournaledTransfers(UVCValueTransfer* transfers,
+                              size_t count,
+                              uint64_t sequence);
+  bool sendValueTransfers(UVCValueTransfer* transfers, size_t count);
+  void sendControlRequests(UVCControlRequest* requests,
+                           UVCTransferStatus* statuses,
+                           size_t count);
+  size_t controlIdForRequest(const UVCControlRequest& request) const;
+  uint32_t settleMicros(size_t controlId) const;
+  bool scanQuirkValue(UVCValue& value,
+                      const char* text,
+                      size_t controlId) const;
+  size_t restoreValues(size_t* restorable);
 };
 
 /*!
@@ -274,17 +602,19 @@ class UVCControl {
  private:
   std::weak_ptr<UVCDeviceController> _parentController;
   size_t _controlIndex;
-  std::string _controlName;
+  UVCArenaString _controlName;
   uvc_capabilities_t _capabilities;
   std::shared_ptr<UVCValue> _currentValue;
   std::shared_ptr<UVCValue> _minimum, _maximum, _stepSize;
   std::shared_ptr<UVCValue> _defaultValue;
 
  public:
-  // Constructor
+  // Constructor; the control's values, type and name are placed in arena
+  // when one is provided
   UVCControl(const std::string& controlName,
              std::weak_ptr<UVCDeviceController> parentController,
-             size_t controlIndex);
+             size_t controlIndex,
+             std::shared_ptr<UVCArena> arena = nullptr);
 
   // Destructor
   ~UVCControl() = default;
@@ -336,6 +666,14 @@ class UVCControl {
   */
   std::string controlName() const;
 
+  /*!
+    @method controlId
+
+    Returns the numeric id of the control (see controlIdWithName in
+    UVCController).
+  */
+  size_t controlId() const;
+
   /*!
     @method currentValue
 
@@ -347,6 +685,86 @@ class UVCControl {
   */
   std::shared_ptr<UVCValue> currentValue();
 
+  /*!
+    @method formatCurrentValue
+
+    Write the textual form of the most recently read (or set) current value
+    to the caller's outString, which holds outSize bytes.  No device I/O and
+    no heap allocations are performed.
+
+    Returns the length of the full text; if not less than outSize the output
+    was truncated.
+  */
+  size_t formatCurrentValue(char* outString, size_t outSize) const;
+
+  /*!
+    @method lastValue
+
+    Returns the UVCValue holding the most recently read (or set) current
+    value, without device I/O; nullptr if the control has no value type.
+  */
+  std::shared_ptr<const UVCValue> lastValue() const;
+
+  /*!
+    @method capabilities
+
+    Returns the capability bits of this control:  the GET_INFO bits reported
+    by the device and the kUVCControlHas* bits for attributes it provided.
+  */
+  uvc_capabilities_t capabilities() const;
+
+  /*!
+    @method valueSize
+
+    Returns the number of bytes occupied by a value of this control.
+  */
+  size_t valueSize() const;
+
+  /*!
+    @method writeFromBuffer
+
+    Copy length bytes (which must equal valueSize()) from buffer into the
+    current value and write it to the device, avoiding the read that
+    currentValue() would perform.
+
+    Returns true if successful.
+  */
+  bool writeFromBuffer(const void* buffer, size_t length);
+
+  /*!
+    @method read
+
+    Read the current value of the control from the device straight into
+    value, a type with a UVCBinding (e.g. UVCPanTiltAbsolute for
+    pan-tilt-abs), converting it to host byte order.  The UVCValue returned by
+    currentValue() is not involved and not updated.
+
+    Returns false if T's layout does not match this control's type or the
+    read fails.
+  */
+  template <class T>
+  bool read(T& value);
+
+  /*!
+    @method write
+
+    Write value, a type with a UVCBinding, to the control on the device
+    without passing through the UVCValue returned by currentValue().
+
+    Returns false if T's layout does not match this control's type or the
+    write fails.
+  */
+  template <class T>
+  bool write(const T& value);
+
+  /*!
+    @method isBindableTo
+
+    Returns true if values of this control can be read and written as T.
+  */
+  template <class T>
+  bool isBindableTo() const;
+
   /*!
     @method minimum
 
@@ -412,6 +830,15 @@ class UVCControl {
   */
   bool readIntoCurrentValue();
 
+  /*!
+    @method readIntoCurrentValue (allowing stale values)
+
+    As readIntoCurrentValue, except that a runtime-suspended device is not
+    woken if the value read or written within the last maxAgeMicros can be
+    used instead (see UVCDeviceController::getValue).
+  */
+  bool readIntoCurrentValue(uint32_t maxAgeMicros);
+
   /*!
     @method writeFromCurrentValue
 
@@ -440,6 +867,43 @@ class UVCControl {
   std::string description() const;
 };
 
+template <class T>
+bool UVCControl::isBindableTo() const {
+  return _currentValue && _currentValue->valueType() &&
+         UVCBinding<T>::matches(*_currentValue->valueType());
+}
+
+template <class T>
+bool UVCControl::read(T& value) {
+  if (!isBindableTo<T>()) {
+    return false;
+  }
+
+  auto controller = _parentController.lock();
+  if (!controller ||
+      !controller->getValueData(&value, sizeof(T), _controlIndex)) {
+    return false;
+  }
+  UVCBinding<T>::byteSwap(value);
+  return true;
+}
+
+template <class T>
+bool UVCControl::write(const T& value) {
+  if (!isBindableTo<T>()) {
+    return false;
+  }
+
+  auto controller = _parentController.lock();
+  if (!controller) {
+    return false;
+  }
+
+  T usbValue = value;
+  UVCBinding<T>::byteSwap(usbValue);
+  return controller->setValueData(&usbValue, sizeof(T), _controlIndex);
+}
+
 //
 // Control names, Terminal
 //
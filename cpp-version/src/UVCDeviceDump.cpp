@@ -0,0 +1,400 @@
+//
+// UVCDeviceDump.cpp
+//
+// Capture of the static capabilities of a UVC device to a text file, and
+// reconstruction of a simulated device from such a file.
+//
+// Translated from Objective-C to C++
+// Copyright © 2016
+// Dr. Jeffrey Frey, IT-NSS
+// University of Delaware
+//
+// $Id$
+//
+
+#include "UVCDeviceDump.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "UVCDiagnostics.hpp"
+#include "UVCProtocol.hpp"
+
+// Highest selector probed on each unit; extension units may define up to
+// 31 controls (bmControls bits 0-30 map to selectors 1-31).
+#define UVC_DEVICE_DUMP_MAX_SELECTOR 31
+
+// Largest control payload read when the device does not answer GET_LEN:
+#define UVC_DEVICE_DUMP_MAX_LENGTH 64
+
+static bool DumpGet(UVCTransport& transport,
+                    uint8_t request,
+                    uint8_t unitId,
+                    uint8_t selector,
+                    uint16_t length,
+                    std::vector<uint8_t>& payload) {
+  payload.assign(length, 0);
+
+  UVCControlRequest controlRequest;
+  controlRequest.bmRequestType = UVC_REQUEST_TYPE_GET;
+  controlRequest.bRequest = request;
+  controlRequest.wValue = selector << 8;
+  controlRequest.wIndex = (unitId << 8) | transport.interfaceNumber();
+  controlRequest.wLength = length;
+  controlRequest.pData = payload.data();
+  controlRequest.wLenDone = 0;
+
+  if (transport.controlRequest(controlRequest) != UVCTransferStatus::Success ||
+      controlRequest.wLenDone == 0) {
+    payload.clear();
+    return false;
+  }
+  payload.resize(controlRequest.wLenDone);
+  return true;
+}
+
+static void AppendHex(std::string& out, const std::vector<uint8_t>& bytes) {
+  static const char hexDigits[] = "0123456789abcdef";
+
+  if (bytes.empty()) {
+    out += '-';
+    return;
+  }
+  for (uint8_t byte : bytes) {
+    out += hexDigits[byte >> 4];
+    out += hexDigits[byte & 0xF];
+  }
+}
+
+static bool ParseHex(const char* text, std::vector<uint8_t>& bytes) {
+  bytes.clear();
+  if (strcmp(text, "-") == 0) {
+    return true;
+  }
+
+  size_t length = strlen(text);
+  if (length % 2) {
+    return false;
+  }
+  for (size_t i = 0; i < length; i += 2) {
+    char digits[3] = {text[i], text[i + 1], '\0'};
+    char* end;
+    unsigned long byte = strtoul(digits, &end, 16);
+    if (*end != '\0' || !isxdigit(digits[0])) {
+      return false;
+    }
+    bytes.push_back(static_cast<uint8_t>(byte));
+  }
+  return true;
+}
+
+// Returns the ids of all units and terminals that can carry controls.
+static std::vector<uint8_t> DumpEntityIds(
+    const std::vector<uint8_t>& descriptors) {
+  std::vector<uint8_t> entityIds;
+
+  if (descriptors.size() < 7 || descriptors[2] != VC_HEADER) {
+    return entityIds;
+  }
+
+  size_t totalLength = descriptors[5] | (descriptors[6] << 8);
+  size_t end = std::min(totalLength, descriptors.size());
+  size_t offset = descriptors[0];
+
+  while (offset + 4 <= end) {
+    uint8_t length = descriptors[offset];
+    if (length < 4 || offset + length > end)
+      break;
+
+    if (descriptors[offset + 1] == CS_INTERFACE) {
+      switch (descriptors[offset + 2]) {
+        case UVC_VC_INPUT_TERMINAL:
+        case UVC_VC_SELECTOR_UNIT:
+        case UVC_VC_PROCESSING_UNIT:
+        case UVC_VC_EXTENSION_UNIT:
+        case UVC_VC_ENCODING_UNIT:
+          entityIds.push_back(descriptors[offset + 3]);
+          break;
+      }
+    }
+    offset += length;
+  }
+  return entityIds;
+}
+
+bool UVCDeviceDump::captureFromTransport(UVCTransport& transport,
+                                         UVCDeviceDump& dump) {
+  if (!transport.isOpen() && !transport.open()) {
+    UVC_DIAGNOSTIC(Error, General, "unable to open device %s",
+                   transport.identity().deviceName.c_str());
+    return false;
+  }
+
+  dump.identity = transport.identity();
+  dump.interfaceNumber = transport.interfaceNumber();
+  dump.videoControlDescriptors = transport.videoControlDescriptors();
+  dump.videoStreamingDescriptors = transport.videoStreamingDescriptors();
+  dump.controls.clear();
+
+  // Entity id zero addresses the interface's own controls (power mode,
+  // request error code):
+  std::vector<uint8_t> entityIds = DumpEntityIds(dump.videoControlDescriptors);
+  entityIds.insert(entityIds.begin(), 0);
+
+  for (uint8_t unitId : entityIds) {
+    for (uint8_t selector = 1; selector <= UVC_DEVICE_DUMP_MAX_SELECTOR;
+         selector++) {
+      UVCDeviceDumpControl control;
+      std::vector<uint8_t> payload;
+
+      if (!DumpGet(transport, UVC_GET_INFO, unitId, selector, 1, payload)) {
+        continue;
+      }
+      control.unitId = unitId;
+      control.selector = selector;
+      control.info = payload[0];
+
+      if (DumpGet(transport, UVC_GET_LEN, unitId, selector, 2, payload) &&
+          payload.size() == 2) {
+        control.length = payload[0] | (payload[1] << 8);
+      } else if (DumpGet(transport, UVC_GET_CUR, unitId, selector,
+                         UVC_DEVICE_DUMP_MAX_LENGTH, payload)) {
+        control.length = static_cast<uint16_t>(payload.size());
+      }
+
+      if (control.length) {
+        DumpGet(transport, UVC_GET_MIN, unitId, selector, control.length,
+                control.minimum);
+        DumpGet(transport, UVC_GET_MAX, unitId, selector, control.length,
+                control.maximum);
+        DumpGet(transport, UVC_GET_RES, unitId, selector, control.length,
+                control.stepSize);
+        DumpGet(transport, UVC_GET_DEF, unitId, selector, control.length,
+                control.defaultValue);
+        if (control.info & 0x01) {
+          DumpGet(transport, UVC_GET_CUR, unitId, selector, control.length,
+                  control.currentValue);
+        }
+      }
+      dump.controls.push_back(control);
+    }
+  }
+  return true;
+}
+
+bool UVCDeviceDump::writeToFile(const std::string& path) const {
+  FILE* file = fopen(path.c_str(), "w");
+  if (!file) {
+    UVC_DIAGNOSTIC(Error, General, "unable to create dump file %s: %s",
+                   path.c_str(), strerror(errno));
+    return false;
+  }
+
+  std::string line;
+  fprintf(file, "# UVC device capability dump\n");
+  fprintf(file, "uvc-device-dump %d\n", UVC_DEVICE_DUMP_VERSION);
+  fprintf(file, "name %s\n", identity.deviceName.c_str());
+  fprintf(file, "serial %s\n", identity.serialNumber.c_str());
+  fprintf(file, "location-id 0x%08x\n", identity.locationId);
+  fprintf(file, "vendor-id 0x%04x\n", identity.vendorId);
+  fprintf(file, "product-id 0x%04x\n", identity.productId);
+  fprintf(file, "bcd-device 0x%04x\n", identity.bcdDevice);
+  fprintf(file, "interface %u\n", interfaceNumber);
+
+  line = "vc-descriptors ";
+  AppendHex(line, videoControlDescriptors);
+  fprintf(file, "%s\n", line.c_str());
+  line = "vs-descriptors ";
+  AppendHex(line, videoStreamingDescriptors);
+  fprintf(file, "%s\n", line.c_str());
+
+  for (const auto& control : controls) {
+    char prefix[64];
+    snprintf(prefix, sizeof(prefix),
+             "control unit=%u selector=%u info=0x%02x length=%u",
+             control.unitId, control.selector, control.info, control.length);
+    line = prefix;
+    line += " min=";
+    AppendHex(line, control.minimum);
+    line += " max=";
+    AppendHex(line, control.maximum);
+    line += " res=";
+    AppendHex(line, control.stepSize);
+    line += " def=";
+    AppendHex(line, control.defaultValue);
+    line += " cur=";
+    AppendHex(line, control.currentValue);
+    fprintf(file, "%s\n", line.c_str());
+  }
+
+  bool isWritten = !ferror(file);
+  if (fclose(file) != 0) {
+    isWritten = false;
+  }
+  if (!isWritten) {
+    UVC_DIAGNOSTIC(Error, General, "unable to write dump file %s",
+                   path.c_str());
+  }
+  return isWritten;
+}
+
+static bool ParseControlLine(char* fields, UVCDeviceDumpControl& control) {
+  bool hasUnit = false, hasSelector = false;
+  char* savePtr = nullptr;
+
+  for (char* field = strtok_r(fields, " \t", &savePtr); field;
+       field = strtok_r(nullptr, " \t", &savePtr)) {
+    char* value = strchr(field, '=');
+    if (!value) {
+      return false;
+    }
+    *value++ = '\0';
+
+    if (strcmp(field, "unit") == 0) {
+      control.unitId = static_cast<uint8_t>(strtoul(value, nullptr, 0));
+      hasUnit = true;
+    } else if (strcmp(field, "selector") == 0) {
+      control.selector = static_cast<uint8_t>(strtoul(value, nullptr, 0));
+      hasSelector = true;
+    } else if (strcmp(field, "info") == 0) {
+      control.info = static_cast<uint8_t>(strtoul(value, nullptr, 0));
+    } else if (strcmp(field, "length") == 0) {
+      control.length = static_cast<uint16_t>(strtoul(value, nullptr, 0));
+    } else if (strcmp(field, "min") == 0) {
+      if (!ParseHex(value, control.minimum))
+        return false;
+    } else if (strcmp(field, "max") == 0) {
+      if (!ParseHex(value, control.maximum))
+        return false;
+    } else if (strcmp(field, "res") == 0) {
+      if (!ParseHex(value, control.stepSize))
+        return false;
+    } else if (strcmp(field, "def") == 0) {
+      if (!ParseHex(value, control.defaultValue))
+        return false;
+    } else if (strcmp(field, "cur") == 0) {
+      if (!ParseHex(value, control.currentValue))
+        return false;
+    }
+    // Unknown fields are skipped so newer dumps stay readable.
+  }
+  return hasUnit && hasSelector;
+}
+
+bool UVCDeviceDump::readFromFile(const std::string& path, UVCDeviceDump& dump) {
+  FILE* file = fopen(path.c_str(), "r");
+  if (!file) {
+    UVC_DIAGNOSTIC(Error, General, "unable to open dump file %s: %s",
+                   path.c_str(), strerror(errno));
+    return false;
+  }
+
+  char* line = nullptr;
+  size_t lineCapacity = 0;
+  ssize_t lineLength;
+  int lineNumber = 0;
+  bool hasVersion = false;
+  bool isValid = true;
+
+  dump = UVCDeviceDump();
+  while (isValid && (lineLength = getline(&line, &lineCapacity, file)) >= 0) {
+    lineNumber++;
+    while (lineLength > 0 &&
+           (line[lineLength - 1] == '\n' || line[lineLength - 1] == '\r')) {
+      line[--lineLength] = '\0';
+    }
+    if (lineLength == 0 || line[0] == '#') {
+      continue;
+    }
+
+    char* value = strchr(line, ' ');
+    if (value) {
+      *value++ = '\0';
+    } else {
+      value = line + lineLength;
+    }
+
+    if (strcmp(line, "uvc-device-dump") == 0) {
+      if (atoi(value) != UVC_DEVICE_DUMP_VERSION) {
+        UVC_DIAGNOSTIC(Error, Parse, "%s:%d: unsupported dump version %s",
+                       path.c_str(), lineNumber, value);
+        isValid = false;
+      }
+      hasVersion = true;
+    } else if (!hasVersion) {
+      UVC_DIAGNOSTIC(Error, Parse, "%s is not a UVC device dump", path.c_str());
+      isValid = false;
+    } else if (strcmp(line, "name") == 0) {
+      dump.identity.deviceName = value;
+    } else if (strcmp(line, "serial") == 0) {
+      dump.identity.serialNumber = value;
+    } else if (strcmp(line, "location-id") == 0) {
+      dump.identity.locationId = strtoul(value, nullptr, 0);
+    } else if (strcmp(line, "vendor-id") == 0) {
+      dump.identity.vendorId =
+          static_cast<uint16_t>(strtoul(value, nullptr, 0));
+    } else if (strcmp(line, "product-id") == 0) {
+      dump.identity.productId =
+          static_cast<uint16_t>(strtoul(value, nullptr, 0));
+    } else if (strcmp(line, "bcd-device") == 0) {
+      dump.identity.bcdDevice =
+          static_cast<uint16_t>(strtoul(value, nullptr, 0));
+    } else if (strcmp(line, "interface") == 0) {
+      dump.interfaceNumber = static_cast<uint8_t>(strtoul(value, nullptr, 0));
+    } else if (strcmp(line, "vc-descriptors") == 0) {
+      isValid = ParseHex(value, dump.videoControlDescriptors);
+    } else if (strcmp(line, "vs-descriptors") == 0) {
+      isValid = ParseHex(value, dump.videoStreamingDescriptors);
+    } else if (strcmp(line, "control") == 0) {
+      UVCDeviceDumpControl control;
+      isValid = ParseControlLine(value, control);
+      if (isValid) {
+        dump.controls.push_back(control);
+      }
+    }
+    // Unknown keys are skipped so newer dumps stay readable.
+
+    if (!isValid && hasVersion) {
+      UVC_DIAGNOSTIC(Error, Parse, "%s:%d: malformed %s record", path.c_str(),
+                     lineNumber, line);
+    }
+  }
+  free(line);
+  fclose(file);
+
+  if (isValid && !hasVersion) {
+    UVC_DIAGNOSTIC(Error, Parse, "%s is not a UVC device dump", path.c_str());
+    isValid = false;
+  }
+  return isValid;
+}
+
+std::shared_ptr<UVCSimulatedTransport> UVCDeviceDump::createSimulatedTransport()
+    const {
+  auto transport = UVCSimulatedTransport::create(identity);
+
+  transport->setInterfaceNumber(interfaceNumber);
+  transport->setVideoControlDescriptors(videoControlDescriptors);
+  transport->setVideoStreamingDescriptors(videoStreamingDescriptors);
+  for (const auto& control : controls) {
+    if (!transport->addControl(control.unitId, control.selector, control.info,
+                               control.length, control.minimum,
+                               control.maximum, control.stepSize,
+                               control.defaultValue)) {
+      UVC_DIAGNOSTIC(Warning, Parse,
+                     "dumped control %u/%u has inconsistent payload "
+                     "lengths, skipped",
+                     control.unitId, control.selector);
+      continue;
+    }
+    if (!control.currentValue.empty()) {
+      transport->setCurrentValue(control.unitId, control.selector,
+                                 control.currentValue);
+    }
+  }
+  return transport;
+}
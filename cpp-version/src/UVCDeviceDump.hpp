@@ -0,0 +1,118 @@
+//
+// UVCDeviceDump.hpp
+//
+// Capture of the static capabilities of a UVC device to a text file, and
+// reconstruction of a simulated device from such a file.
+//
+// Translated from Objective-C to C++
+// Copyright © 2016
+// Dr. Jeffrey Frey, IT-NSS
+// University of Delaware
+//
+// $Id$
+//
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "UVCSimulatedTransport.hpp"
+#include "UVCTransport.hpp"
+
+/*
+  Dump file layout:  one "key value" pair per line; lines starting with '#'
+  and blank lines are ignored.  Byte strings are written as contiguous hex
+  digits in USB byte order, "-" standing for "not provided by the device".
+
+    uvc-device-dump 1
+    name <device name>
+    serial <serial number>
+    location-id 0x14100000
+    vendor-id 0x046d
+    product-id 0x0825
+    bcd-device 0x0010
+    interface 0
+    vc-descriptors 0d2401...
+    vs-descriptors 0e2401...
+    control unit=2 selector=2 info=0x03 length=2 min=0000 max=ff00 ...
+
+  Each control line also carries res=, def= and cur= fields.  Dumps written
+  before bcd-device was added read as device release zero.
+*/
+#define UVC_DEVICE_DUMP_VERSION 1
+
+/*!
+  @struct UVCDeviceDumpControl
+
+  The responses of one control to GET_INFO, GET_LEN, GET_MIN, GET_MAX,
+  GET_RES, GET_DEF and GET_CUR.  Payloads the device would not provide
+  (the request stalled) are empty.
+*/
+struct UVCDeviceDumpControl {
+  uint8_t unitId = 0;
+  uint8_t selector = 0;
+  uint8_t info = 0;
+  uint16_t length = 0;
+  std::vector<uint8_t> minimum, maximum, stepSize, defaultValue, currentValue;
+};
+
+/*!
+  @class UVCDeviceDump
+  @abstract Everything static about a UVC device.
+
+  A dump holds the identity of the device, its raw VideoControl and
+  VideoStreaming descriptor blocks and the capabilities of every control
+  that answered GET_INFO.  Dumps are captured from any transport, stored as
+  line-oriented text, and turned back into a UVCSimulatedTransport that
+  answers exactly as the original device did.
+*/
+class UVCDeviceDump {
+ public:
+  UVCDeviceIdentity identity;
+  uint8_t interfaceNumber = 0;
+  std::vector<uint8_t> videoControlDescriptors;
+  std::vector<uint8_t> videoStreamingDescriptors;
+  std::vector<UVCDeviceDumpControl> controls;
+
+  /*!
+    @method captureFromTransport
+
+    Fill dump from the device behind transport.  Every unit and terminal
+    named in the VideoControl descriptors (and the interface itself) is
+    probed with GET_INFO for each selector; controls that answer have their
+    remaining attributes read.
+
+    Returns false if the transport could not be opened.
+  */
+  static bool captureFromTransport(UVCTransport& transport,
+                                   UVCDeviceDump& dump);
+
+  /*!
+    @method readFromFile
+
+    Parse the dump file at path into dump.  Problems are reported to stderr
+    with their line number; returns false if the file could not be read or
+    is not a valid dump.
+  */
+  static bool readFromFile(const std::string& path, UVCDeviceDump& dump);
+
+  /*!
+    @method writeToFile
+
+    Write this dump to the file at path, replacing its contents.  Returns
+    false (after reporting to stderr) if the file could not be written.
+  */
+  bool writeToFile(const std::string& path) const;
+
+  /*!
+    @method createSimulatedTransport
+
+    Returns a shared_ptr to a simulated camera replicating this dump:  same
+    identity, descriptors and control responses, with every control starting
+    at the value it had when the dump was taken.
+  */
+  std::shared_ptr<UVCSimulatedTransport> createSimulatedTransport() const;
+};
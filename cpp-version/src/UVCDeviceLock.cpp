@@ -0,0 +1,143 @@
+//
+// UVCDeviceLock.cpp
+//
+// Advisory locking of a device across processes.
+//
+// Translated from Objective-C to C++
+// Copyright © 2016
+// Dr. Jeffrey Frey, IT-NSS
+// University of Delaware
+//
+// $Id$
+//
+
+#include "UVCDeviceLock.hpp"
+
+#include <fcntl.h>
+#include <sys/file.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+
+using SteadyClock = std::chrono::steady_clock;
+
+static int UVCDeviceLockOpen(const std::string& path) {
+  return open(path.c_str(), O_RDONLY | O_CREAT | O_CLOEXEC, 0666);
+}
+
+// flock(2) has no timeout:  retry a non-blocking attempt with a growing
+// delay until the deadline.
+static bool UVCDeviceLockPoll(int fd,
+                              int operation,
+                              SteadyClock::time_point deadline) {
+  auto delay = std::chrono::microseconds(500);
+
+  while (flock(fd, operation | LOCK_NB) != 0) {
+    if (errno != EWOULDBLOCK && errno != EINTR) {
+      return false;
+    }
+
+    auto now = SteadyClock::now();
+    if (now >= deadline) {
+      return false;
+    }
+    std::this_thread::sleep_for(std::min<SteadyClock::duration>(
+        delay, deadline - now));
+    delay = std::min(delay * 2, std::chrono::microseconds(16000));
+  }
+  return true;
+}
+
+std::shared_ptr<UVCDeviceLock> UVCDeviceLock::createForDevice(
+    const UVCDeviceIdentity& identity,
+    const char* directory,
+    uint8_t interfaceNumber) {
+  if (!directory) {
+    directory = getenv("UVC_UTIL_LOCK_DIR");
+  }
+  if (!directory || !*directory) {
+    directory = "/tmp";
+  }
+
+  std::string path(directory);
+  char name[64];
+
+  if (!identity.serialNumber.empty() &&
+      identity.serialNumber != "Unknown UVC Device") {
+    snprintf(name, sizeof(name), "/uvc-util-%04x-%04x-", identity.vendorId,
+             identity.productId);
+    path += name;
+    for (char c : identity.serialNumber) {
+      path += (isalnum(static_cast<unsigned char>(c)) || c == '-' || c == '.')
+                  ? c
+                  : '_';
+    }
+  } else {
+    snprintf(name, sizeof(name), "/uvc-util-loc-%08x", identity.locationId);
+    path += name;
+  }
+  if (interfaceNumber) {
+    snprintf(name, sizeof(name), "-if%u", interfaceNumber);
+    path += name;
+  }
+  path += ".lock";
+  return std::make_shared<UVCDeviceLock>(path);
+}
+
+UVCDeviceLock::UVCDeviceLock(const std::string& path)
+    : _path(path), _fd(-1), _depth(0) {}
+
+UVCDeviceLock::~UVCDeviceLock() {
+  if (_fd >= 0) {
+    ::close(_fd);
+  }
+}
+
+const std::string& UVCDeviceLock::path() const {
+  return _path;
+}
+
+bool UVCDeviceLock::lock(UVCLockMode mode, uint32_t timeoutMillis) {
+  if (_depth) {
+    _depth++;
+    return true;
+  }
+  if (_fd < 0 && (_fd = UVCDeviceLockOpen(_path)) < 0) {
+    return false;
+  }
+
+  // Take a place in the queue, then wait for the lock itself:
+  int queueFd = UVCDeviceLockOpen(_path + ".queue");
+  if (queueFd < 0) {
+    return false;
+  }
+
+  auto deadline =
+      SteadyClock::now() + std::chrono::milliseconds(timeoutMillis);
+  bool isLocked =
+      UVCDeviceLockPoll(queueFd, LOCK_EX, deadline) &&
+      UVCDeviceLockPoll(_fd, mode == UVCLockMode::Exclusive ? LOCK_EX : LOCK_SH,
+                        deadline);
+
+  ::close(queueFd);
+  if (isLocked) {
+    _depth = 1;
+  }
+  return isLocked;
+}
+
+void UVCDeviceLock::unlock() {
+  if (_depth && --_depth == 0) {
+    flock(_fd, LOCK_UN);
+  }
+}
+
+bool UVCDeviceLock::isLocked() const {
+  return _depth != 0;
+}
@@ -0,0 +1,130 @@
+//
+// UVCDeviceLock.hpp
+//
+// Advisory locking of a device across processes.
+//
+// Translated from Objective-C to C++
+// Copyright © 2016
+// Dr. Jeffrey Frey, IT-NSS
+// University of Delaware
+//
+// $Id$
+//
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "UVCTransport.hpp"
+
+/*!
+  @typedef UVCLockMode
+
+  Shared holders only read from the device and may overlap each other;
+  an exclusive holder has the device to itself.
+*/
+enum class UVCLockMode { Shared, Exclusive };
+
+// Default wait for a device lock:
+const uint32_t kUVCDeviceLockTimeoutMillis = 2000;
+
+/*!
+  @class UVCDeviceLock
+  @abstract Per-device advisory lock shared by cooperating processes.
+
+  The lock is an flock(2) on a file named after the device:  vendor and
+  product id plus serial number, or the locationID (the port) for devices
+  without a serial number.  Files are created in $UVC_UTIL_LOCK_DIR, or /tmp,
+  and never removed, since removing a lock file races with its next user.
+
+  Waiters queue on a second, ".queue" file held exclusively while waiting
+  for the lock itself, so that a waiting exclusive holder keeps new shared
+  holders out rather than being starved by them.
+
+  Each instance is one holder, not thread-safe, and may be locked again
+  while held; it is released when unlock() has been called as many times.
+  Different instances (in the same or other processes) exclude each other.
+*/
+class UVCDeviceLock {
+ private:
+  std::string _path;
+  int _fd;
+  unsigned _depth;
+
+ public:
+  /*!
+    @method createForDevice
+
+    Returns a shared_ptr to a lock for the device with the given identity, in
+    directory if not nullptr.  The VideoControl interfaces of a composite
+    device are locked independently; interface zero has the device's lock.
+  */
+  static std::shared_ptr<UVCDeviceLock> createForDevice(
+      const UVCDeviceIdentity& identity,
+      const char* directory = nullptr,
+      uint8_t interfaceNumber = 0);
+
+  explicit UVCDeviceLock(const std::string& path);
+  ~UVCDeviceLock();
+
+  // Delete copy constructor and assignment operator
+  UVCDeviceLock(const UVCDeviceLock&) = delete;
+  UVCDeviceLock& operator=(const UVCDeviceLock&) = delete;
+
+  /*!
+    @method path
+
+    Returns the path of the lock file.
+  */
+  const std::string& path() const;
+
+  /*!
+    @method lock
+
+    Wait up to timeoutMillis for the lock in the given mode.  Locking a held
+    lock again succeeds at once, in the mode it is held in:  a sequence nested
+    in another runs under the outer one's lock.  Returns false on timeout or
+    if the lock file cannot be opened.
+  */
+  bool lock(UVCLockMode mode, uint32_t timeoutMillis);
+
+  /*!
+    @method unlock
+
+    Undo one successful lock().
+  */
+  void unlock();
+
+  bool isLocked() const;
+};
+
+/*!
+  @class UVCDeviceLockGuard
+  @abstract Holds a UVCDeviceLock for the guard's lifetime.
+
+  A guard without a lock (nullptr) holds nothing and always succeeds.
+*/
+class UVCDeviceLockGuard {
+ private:
+  UVCDeviceLock* _lock;
+  bool _isHeld;
+
+ public:
+  UVCDeviceLockGuard(UVCDeviceLock* lock,
+                     UVCLockMode mode,
+                     uint32_t timeoutMillis = kUVCDeviceLockTimeoutMillis)
+      : _lock(lock), _isHeld(!lock || lock->lock(mode, timeoutMillis)) {}
+  ~UVCDeviceLockGuard() {
+    if (_lock && _isHeld) {
+      _lock->unlock();
+    }
+  }
+
+  UVCDeviceLockGuard(const UVCDeviceLockGuard&) = delete;
+  UVCDeviceLockGuard& operator=(const UVCDeviceLockGuard&) = delete;
+
+  // True if the lock was obtained (or there is none):
+  explicit operator bool() const { return _isHeld; }
+};
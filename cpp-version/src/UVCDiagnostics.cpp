@@ -0,0 +1,240 @@
+//
+// UVCDiagnostics.cpp
+//
+// Routing of error, warning and informational messages.
+//
+// Translated from Objective-C to C++
+// Copyright © 2016
+// Dr. Jeffrey Frey, IT-NSS
+// University of Delaware
+//
+// $Id$
+//
+
+#include "UVCDiagnostics.hpp"
+
+#include <cstdarg>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+static uint32_t UVCDiagnosticFilterWord(UVCDiagnosticLevel maxLevel,
+                                        uint32_t categories) {
+  uint32_t filter = 0;
+
+  categories &= kUVCDiagnosticAllCategories;
+  for (unsigned level = 0; level <= static_cast<unsigned>(maxLevel);
+       level++) {
+    filter |= categories << (8 * level);
+  }
+  return filter;
+}
+
+// Errors and warnings from every category; constant-initialized:
+std::atomic<uint32_t> uvcDiagnosticFilter(kUVCDiagnosticAllCategories |
+                                          (kUVCDiagnosticAllCategories << 8));
+static std::atomic<bool> uvcDiagnosticFilterIsSet(false);
+
+//
+// The default handler's sink:  a bounded multi-producer ring of formatted
+// lines.  Each slot's sequence tells producers and the drainer whose turn it
+// is; it is stored relative to the slot index so that the all-zero initial
+// state is valid.  Only one thread drains at a time and it writes everything
+// pending with as few writes to stderr as possible.
+//
+static const size_t kUVCDiagnosticRingSlots = 32;
+static const size_t kUVCDiagnosticLineSize = 528;
+
+struct UVCDiagnosticSlot {
+  std::atomic<size_t> sequence;
+  size_t length;
+  char line[kUVCDiagnosticLineSize];
+};
+
+static UVCDiagnosticSlot uvcDiagnosticRing[kUVCDiagnosticRingSlots];
+static std::atomic<size_t> uvcDiagnosticRingTail(0);
+// Advanced only by the thread holding the draining flag; read by others to
+// see whether anything is left after they let go of it:
+static std::atomic<size_t> uvcDiagnosticRingHead(0);
+static std::atomic_flag uvcDiagnosticRingDraining = ATOMIC_FLAG_INIT;
+static std::atomic<bool> uvcDiagnosticFlushAtExit(false);
+
+static bool UVCDiagnosticRingPush(const char* line, size_t length) {
+  size_t position = uvcDiagnosticRingTail.load(std::memory_order_relaxed);
+  UVCDiagnosticSlot* slot;
+
+  while (true) {
+    size_t index = position % kUVCDiagnosticRingSlots;
+
+    slot = &uvcDiagnosticRing[index];
+
+    size_t sequence = slot->sequence.load(std::memory_order_acquire) + index;
+    ptrdiff_t lag = static_cast<ptrdiff_t>(sequence - position);
+
+    if (lag == 0) {
+      if (uvcDiagnosticRingTail.compare_exchange_weak(
+              position, position + 1, std::memory_order_relaxed)) {
+        break;
+      }
+    } else if (lag < 0) {
+      // Full:
+      return false;
+    } else {
+      position = uvcDiagnosticRingTail.load(std::memory_order_relaxed);
+    }
+  }
+  if (length > kUVCDiagnosticLineSize) {
+    length = kUVCDiagnosticLineSize;
+  }
+  memcpy(slot->line, line, length);
+  slot->length = length;
+  slot->sequence.store(
+      position + 1 - (position % kUVCDiagnosticRingSlots),
+      std::memory_order_release);
+  return true;
+}
+
+static bool UVCDiagnosticRingIsEmpty() {
+  size_t position = uvcDiagnosticRingHead.load(std::memory_order_acquire);
+  size_t index = position % kUVCDiagnosticRingSlots;
+
+  return uvcDiagnosticRing[index].sequence.load(std::memory_order_acquire) +
+             index !=
+         position + 1;
+}
+
+void UVCFlushDiagnostics() {
+  do {
+    // Whoever holds the flag writes out what we pushed:
+    if (uvcDiagnosticRingDraining.test_and_set(std::memory_order_acquire)) {
+      return;
+    }
+
+    char batch[4096];
+    size_t used = 0;
+
+    while (!UVCDiagnosticRingIsEmpty()) {
+      size_t position = uvcDiagnosticRingHead.load(std::memory_order_relaxed);
+      size_t index = position % kUVCDiagnosticRingSlots;
+      UVCDiagnosticSlot& slot = uvcDiagnosticRing[index];
+
+      if (used + slot.length > sizeof(batch)) {
+        fwrite(batch, 1, used, stderr);
+        used = 0;
+      }
+      memcpy(batch + used, slot.line, slot.length);
+      used += slot.length;
+      slot.sequence.store(position + kUVCDiagnosticRingSlots - index,
+                          std::memory_order_release);
+      uvcDiagnosticRingHead.store(position + 1, std::memory_order_release);
+    }
+    if (used) {
+      fwrite(batch, 1, used, stderr);
+    }
+    uvcDiagnosticRingDraining.clear(std::memory_order_release);
+  } while (!UVCDiagnosticRingIsEmpty());
+}
+
+static void UVCDiagnosticFlushAtExit() {
+  UVCFlushDiagnostics();
+}
+
+static void UVCDiagnosticToStderr(UVCDiagnosticLevel level,
+                                  const char* message,
+                                  void* context) {
+  static const char* const prefixes[] = {"ERROR:  ", "WARNING:  ", "INFO:  ",
+                                         "DEBUG:  "};
+  char line[kUVCDiagnosticLineSize];
+  int length = snprintf(line, sizeof(line), "%s%s\n",
+                        prefixes[static_cast<int>(level)], message);
+
+  if (length < 0) {
+    return;
+  }
+  if (static_cast<size_t>(length) >= sizeof(line)) {
+    length = sizeof(line) - 1;
+    line[length - 1] = '\n';
+  }
+
+  bool isUrgent = (level <= UVCDiagnosticLevel::Warning);
+
+  if (!UVCDiagnosticRingPush(line, length)) {
+    UVCFlushDiagnostics();
+    if (!UVCDiagnosticRingPush(line, length)) {
+      // Still full, another thread is draining:  write around the ring.
+      fwrite(line, 1, length, stderr);
+      return;
+    }
+  }
+  if (isUrgent) {
+    UVCFlushDiagnostics();
+  } else if (!uvcDiagnosticFlushAtExit.exchange(true)) {
+    atexit(UVCDiagnosticFlushAtExit);
+  }
+}
+
+// Handler and context are swapped together; constant-initialized, so no
+// static constructor runs for them:
+struct UVCDiagnosticSink {
+  UVCDiagnosticHandler handler;
+  void* context;
+};
+
+static const UVCDiagnosticSink uvcDefaultDiagnosticSink = {
+    UVCDiagnosticToStderr, nullptr};
+static std::atomic<const UVCDiagnosticSink*> uvcDiagnosticSink(
+    &uvcDefaultDiagnosticSink);
+
+void UVCSetDiagnosticHandler(UVCDiagnosticHandler handler, void* context) {
+  if (!uvcDiagnosticFilterIsSet) {
+    uvcDiagnosticFilter = UVCDiagnosticFilterWord(
+        handler ? UVCDiagnosticLevel::Info : UVCDiagnosticLevel::Warning,
+        kUVCDiagnosticAllCategories);
+  }
+  if (!handler) {
+    uvcDiagnosticSink = &uvcDefaultDiagnosticSink;
+    return;
+  }
+  // Sinks are never freed:  a message being delivered on another thread may
+  // still be using the previous one.  Out of memory, the previous one stays.
+  if (auto* sink = new (std::nothrow) UVCDiagnosticSink{handler, context}) {
+    uvcDiagnosticSink = sink;
+  }
+}
+
+void UVCSetDiagnosticFilter(UVCDiagnosticLevel maxLevel, uint32_t categories) {
+  uvcDiagnosticFilterIsSet = true;
+  uvcDiagnosticFilter = UVCDiagnosticFilterWord(maxLevel, categories);
+}
+
+static void UVCDiagnosticDeliver(UVCDiagnosticLevel level,
+                                 const char* format,
+                                 va_list args) {
+  char message[512];
+
+  vsnprintf(message, sizeof(message), format, args);
+
+  const UVCDiagnosticSink* sink = uvcDiagnosticSink;
+  sink->handler(level, message, sink->context);
+}
+
+void UVCDiagnosticWrite(UVCDiagnosticLevel level, const char* format, ...) {
+  va_list args;
+
+  va_start(args, format);
+  UVCDiagnosticDeliver(level, format, args);
+  va_end(args);
+}
+
+void UVCDiagnostic(UVCDiagnosticLevel level, const char* format, ...) {
+  va_list args;
+
+  if (!UVCDiagnosticIsEnabled(level, UVCDiagnosticCategory::General)) {
+    return;
+  }
+  va_start(args, format);
+  UVCDiagnosticDeliver(level, format, args);
+  va_end(args);
+}
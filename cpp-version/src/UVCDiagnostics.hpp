@@ -0,0 +1,163 @@
+//
+// UVCDiagnostics.hpp
+//
+// Routing of error, warning and informational messages.
+//
+// Translated from Objective-C to C++
+// Copyright © 2016
+// Dr. Jeffrey Frey, IT-NSS
+// University of Delaware
+//
+// $Id$
+//
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+/*!
+  @typedef UVCDiagnosticLevel
+
+  Severity of a diagnostic message, most severe first.
+*/
+enum class UVCDiagnosticLevel { Error, Warning, Info, Debug };
+
+/*!
+  @typedef UVCDiagnosticCategory
+
+  The part of the library a diagnostic message comes from:  device
+  enumeration, VideoControl descriptor parsing, control transfers, parsing of
+  type strings, values, dumps and traces, or anything else (General).
+*/
+enum class UVCDiagnosticCategory {
+  General,
+  Enumeration,
+  Descriptor,
+  Transfer,
+  Parse
+};
+
+/*!
+  @defined UVC_DIAGNOSTIC_MAX_LEVEL
+
+  Least severe level (as an integer, 0 = Error ... 3 = Debug) compiled into
+  the library:  UVC_DIAGNOSTIC messages below it are removed entirely,
+  arguments included.  Set by the UVC_UTIL_LOG_LEVEL CMake option.
+*/
+#ifndef UVC_DIAGNOSTIC_MAX_LEVEL
+#define UVC_DIAGNOSTIC_MAX_LEVEL 2
+#endif
+
+// Bit mask selecting every category:
+const uint32_t kUVCDiagnosticAllCategories = 0x1f;
+
+inline constexpr uint32_t UVCDiagnosticCategoryMask(
+    UVCDiagnosticCategory category) {
+  return 1u << static_cast<unsigned>(category);
+}
+
+/*!
+  @typedef UVCDiagnosticHandler
+
+  Receives every diagnostic message that passes the filter (without a
+  trailing newline) along with the context pointer it was registered with.
+  May be called from any thread that uses the library.
+*/
+using UVCDiagnosticHandler = void (*)(UVCDiagnosticLevel level,
+                                      const char* message,
+                                      void* context);
+
+/*!
+  @function UVCSetDiagnosticHandler
+
+  Route diagnostic messages to handler.  Passing nullptr restores the
+  default, which writes messages to stderr prefixed with "ERROR:  ",
+  "WARNING:  ", "INFO:  " or "DEBUG:  ".  The default handler appends
+  messages to a lock-free ring:  errors and warnings are written out before
+  the call that reported them returns, less severe messages when the ring
+  fills, on UVCFlushDiagnostics() and at exit.
+*/
+void UVCSetDiagnosticHandler(UVCDiagnosticHandler handler, void* context);
+
+/*!
+  @function UVCSetDiagnosticFilter
+
+  Deliver messages of level maxLevel and more severe, from the categories
+  whose UVCDiagnosticCategoryMask bits are set in categories.  Other messages
+  are not formatted.
+
+  Until this is called the filter follows the handler:  errors and warnings
+  for the default handler, informational messages as well for any other.
+*/
+void UVCSetDiagnosticFilter(UVCDiagnosticLevel maxLevel, uint32_t categories);
+
+/*!
+  @function UVCFlushDiagnostics
+
+  Write any messages the default handler is holding to stderr.
+*/
+void UVCFlushDiagnostics();
+
+// The runtime filter:  bit (8 * level + category) is set for each enabled
+// combination, so a check is a single load and test.
+extern std::atomic<uint32_t> uvcDiagnosticFilter;
+
+/*!
+  @function UVCDiagnosticIsEnabled
+
+  Returns true if a message of level and category would be delivered.
+  Constant false for levels compiled out.
+*/
+inline bool UVCDiagnosticIsEnabled(UVCDiagnosticLevel level,
+                                   UVCDiagnosticCategory category) {
+  if (static_cast<int>(level) > UVC_DIAGNOSTIC_MAX_LEVEL) {
+    return false;
+  }
+  return (uvcDiagnosticFilter.load(std::memory_order_relaxed) >>
+          (8 * static_cast<unsigned>(level))) &
+         UVCDiagnosticCategoryMask(category);
+}
+
+/*!
+  @function UVCDiagnosticWrite
+
+  Format a message printf-style and pass it to the current handler,
+  regardless of the filter.  Messages longer than 511 bytes are truncated.
+*/
+void UVCDiagnosticWrite(UVCDiagnosticLevel level, const char* format, ...)
+#if defined(__GNUC__)
+    __attribute__((format(printf, 2, 3)))
+#endif
+    ;
+
+/*!
+  @defined UVC_DIAGNOSTIC
+
+  Report a message, e.g.
+
+    UVC_DIAGNOSTIC(Info, Enumeration, "found %u devices", count);
+
+  The arguments are only evaluated, and the message only formatted, if the
+  level is compiled in and the filter enables it.
+*/
+#define UVC_DIAGNOSTIC(level, category, ...)                             \
+  do {                                                                   \
+    if (UVCDiagnosticIsEnabled(UVCDiagnosticLevel::level,                \
+                               UVCDiagnosticCategory::category)) {       \
+      UVCDiagnosticWrite(UVCDiagnosticLevel::level, __VA_ARGS__);        \
+    }                                                                    \
+  } while (0)
+
+/*!
+  @function UVCDiagnostic
+
+  Format a message printf-style and pass it to the current handler if the
+  filter enables level for the General category.  Messages longer than 511
+  bytes are truncated.
+*/
+void UVCDiagnostic(UVCDiagnosticLevel level, const char* format, ...)
+#if defined(__GNUC__)
+    __attribute__((format(printf, 2, 3)))
+#endif
+    ;
@@ -0,0 +1,266 @@
+//
+// UVCFleetAudit.cpp
+//
+// Comparison of control settings across a fleet of devices.
+//
+// Translated from Objective-C to C++
+// Copyright © 2016
+// Dr. Jeffrey Frey, IT-NSS
+// University of Delaware
+//
+// $Id$
+//
+
+#include "UVCFleetAudit.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+
+#include "UVCType.hpp"
+
+// FNV-1a prime, mixing one 64-bit word at a time into a snapshot's hash:
+static const uint64_t kUVCAuditHashPrime = 0x100000001b3ULL;
+static const uint64_t kUVCAuditHashBasis = 0xcbf29ce484222325ULL;
+
+static bool UVCAuditIsRelativeControl(const char* name) {
+  size_t nameLength = strlen(name);
+
+  return nameLength > 4 && strcmp(name + nameLength - 4, "-rel") == 0;
+}
+
+static size_t UVCAuditValueSize(const UVCControlDef& def) {
+  std::shared_ptr<UVCType> type = UVCType::createFromCString(def.typeSignature);
+  return type ? type->byteSize() : 0;
+}
+
+std::shared_ptr<UVCFleetAudit> UVCFleetAudit::create(size_t deviceCount) {
+  if (!deviceCount) {
+    return nullptr;
+  }
+  return std::make_shared<UVCFleetAudit>(deviceCount);
+}
+
+UVCFleetAudit::UVCFleetAudit(size_t deviceCount)
+    : _deviceCount(deviceCount),
+      _columns(std::size(uvcControlDefinitions), SIZE_MAX),
+      _snapshotHashes(deviceCount) {
+  for (size_t controlId = 0; controlId < std::size(uvcControlDefinitions);
+       controlId++) {
+    const UVCControlDef& def = uvcControlDefinitions[controlId];
+    size_t valueSize = UVCAuditValueSize(def);
+
+    if (!UVCAuditIsRelativeControl(def.name) && valueSize &&
+        valueSize <= sizeof(uint64_t)) {
+      _columns[controlId] = _controlIds.size();
+      _controlIds.push_back(controlId);
+      _valueSizes.push_back(valueSize);
+    }
+  }
+  _values.resize(_controlIds.size() * deviceCount);
+  _present.resize(_controlIds.size() * deviceCount);
+}
+
+size_t UVCFleetAudit::deviceCount() const {
+  return _deviceCount;
+}
+
+bool UVCFleetAudit::capture(size_t deviceIndex,
+                            UVCDeviceController& controller) {
+  if (deviceIndex >= _deviceCount) {
+    return false;
+  }
+
+  UVCValueTransfer transfers[std::size(uvcControlDefinitions)];
+  uint8_t data[std::size(uvcControlDefinitions)][sizeof(uint64_t)];
+  size_t count = 0;
+
+  for (size_t column = 0; column < _controlIds.size(); column++) {
+    size_t controlId = _controlIds[column];
+    auto control = controller.controlWithId(controlId);
+
+    _present[column * _deviceCount + deviceIndex] = 0;
+    _values[column * _deviceCount + deviceIndex] = 0;
+    if (!control || !control->supportsGetValue()) {
+      continue;
+    }
+    transfers[count].controlId = controlId;
+    transfers[count].isWrite = false;
+    transfers[count].data = data[count];
+    transfers[count].length = control->valueSize();
+    count++;
+  }
+
+  bool isComplete = controller.transferValues(transfers, count);
+  for (size_t i = 0; i < count; i++) {
+    if (transfers[i].succeeded) {
+      setValue(deviceIndex, transfers[i].controlId, transfers[i].data,
+               transfers[i].length);
+    }
+  }
+  return isComplete;
+}
+
+bool UVCFleetAudit::setValue(size_t deviceIndex,
+                             size_t controlId,
+                             const void* data,
+                             size_t length) {
+  if (deviceIndex >= _deviceCount || controlId >= _columns.size() ||
+      _columns[controlId] == SIZE_MAX ||
+      length != _valueSizes[_columns[controlId]]) {
+    return false;
+  }
+
+  const uint8_t* bytes = static_cast<const uint8_t*>(data);
+  uint64_t value = 0;
+  for (size_t i = 0; i < length; i++) {
+    value |= static_cast<uint64_t>(bytes[i]) << (8 * i);
+  }
+
+  size_t index = _columns[controlId] * _deviceCount + deviceIndex;
+  _values[index] = value;
+  _present[index] = 1;
+  return true;
+}
+
+bool UVCFleetAudit::value(size_t deviceIndex,
+                          size_t controlId,
+                          void* data,
+                          size_t length) const {
+  if (deviceIndex >= _deviceCount || controlId >= _columns.size() ||
+      _columns[controlId] == SIZE_MAX ||
+      length != _valueSizes[_columns[controlId]]) {
+    return false;
+  }
+
+  size_t index = _columns[controlId] * _deviceCount + deviceIndex;
+  uint8_t* bytes = static_cast<uint8_t*>(data);
+  for (size_t i = 0; i < length; i++) {
+    bytes[i] = static_cast<uint8_t>(_values[index] >> (8 * i));
+  }
+  return _present[index] != 0;
+}
+
+void UVCFleetAudit::analyze() {
+  std::vector<uint8_t> differs(_deviceCount);
+  std::vector<uint64_t> sorted;
+
+  _results.clear();
+  std::fill(_snapshotHashes.begin(), _snapshotHashes.end(),
+            kUVCAuditHashBasis);
+
+  for (size_t column = 0; column < _controlIds.size(); column++) {
+    const uint64_t* values = _values.data() + column * _deviceCount;
+    const uint8_t* present = _present.data() + column * _deviceCount;
+    uint64_t* hashes = _snapshotHashes.data();
+
+    // Whether a device has the value is part of its snapshot as well:
+    for (size_t d = 0; d < _deviceCount; d++) {
+      hashes[d] = (hashes[d] ^ values[d]) * kUVCAuditHashPrime;
+      hashes[d] = (hashes[d] ^ present[d]) * kUVCAuditHashPrime;
+    }
+
+    // The only value that can hold a strict majority (Boyer-Moore vote),
+    // then how many hold it:
+    uint64_t candidate = 0;
+    size_t votes = 0;
+    for (size_t d = 0; d < _deviceCount; d++) {
+      if (present[d]) {
+        if (!votes) {
+          candidate = values[d];
+        }
+        votes = (values[d] == candidate) ? votes + 1 : votes - 1;
+      }
+    }
+
+    size_t presentCount = 0, matches = 0;
+    for (size_t d = 0; d < _deviceCount; d++) {
+      presentCount += present[d];
+      matches += present[d] & (values[d] == candidate);
+    }
+    if (!presentCount) {
+      continue;
+    }
+
+    // No value holds a majority:  settle for the most common one.
+    if (matches * 2 <= presentCount) {
+      sorted.clear();
+      for (size_t d = 0; d < _deviceCount; d++) {
+        if (present[d]) {
+          sorted.push_back(values[d]);
+        }
+      }
+      std::sort(sorted.begin(), sorted.end());
+      matches = 0;
+      for (size_t start = 0, end; start < sorted.size(); start = end) {
+        for (end = start; end < sorted.size() && sorted[end] == sorted[start];
+             end++) {
+        }
+        if (end - start > matches) {
+          matches = end - start;
+          candidate = sorted[start];
+        }
+      }
+    }
+
+    for (size_t d = 0; d < _deviceCount; d++) {
+      differs[d] = present[d] & (values[d] != candidate);
+    }
+
+    size_t controlId = _controlIds[column];
+    UVCAuditControl result;
+    result.controlId = controlId;
+    result.present = presentCount;
+    result.majorityCount = matches;
+    result.hasMajority = matches * 2 > presentCount;
+    for (size_t i = 0; i < _valueSizes[column]; i++) {
+      result.majorityValue.push_back(
+          static_cast<uint8_t>(candidate >> (8 * i)));
+    }
+    for (size_t d = 0; d < _deviceCount; d++) {
+      if (differs[d]) {
+        result.outliers.push_back(d);
+      }
+    }
+    _results.push_back(std::move(result));
+  }
+
+  // Devices with equal hashes, in runs:
+  std::vector<size_t> order(_deviceCount);
+  for (size_t d = 0; d < _deviceCount; d++) {
+    order[d] = d;
+  }
+  std::sort(order.begin(), order.end(), [this](size_t a, size_t b) {
+    return _snapshotHashes[a] != _snapshotHashes[b]
+               ? _snapshotHashes[a] < _snapshotHashes[b]
+               : a < b;
+  });
+
+  _groups.clear();
+  for (size_t d : order) {
+    if (_groups.empty() || _groups.back().snapshotHash != _snapshotHashes[d]) {
+      _groups.emplace_back();
+      _groups.back().snapshotHash = _snapshotHashes[d];
+    }
+    _groups.back().devices.push_back(d);
+  }
+  std::sort(_groups.begin(), _groups.end(),
+            [](const UVCAuditGroup& a, const UVCAuditGroup& b) {
+              return a.devices.size() != b.devices.size()
+                         ? a.devices.size() > b.devices.size()
+                         : a.devices[0] < b.devices[0];
+            });
+}
+
+const std::vector<UVCAuditControl>& UVCFleetAudit::controls() const {
+  return _results;
+}
+
+const std::vector<UVCAuditGroup>& UVCFleetAudit::groups() const {
+  return _groups;
+}
+
+uint64_t UVCFleetAudit::snapshotHash(size_t deviceIndex) const {
+  return (deviceIndex < _snapshotHashes.size()) ? _snapshotHashes[deviceIndex]
+                                                : 0;
+}
@@ -0,0 +1,163 @@
+//
+// UVCFleetAudit.hpp
+//
+// Comparison of control settings across a fleet of devices.
+//
+// Translated from Objective-C to C++
+// Copyright © 2016
+// Dr. Jeffrey Frey, IT-NSS
+// University of Delaware
+//
+// $Id$
+//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "UVCController.hpp"
+
+/*!
+  @struct UVCAuditControl
+
+  The outcome of auditing one control:  the value most devices hold (in USB
+  byte order) and how many hold it, and the devices holding another value.
+  Devices that lack the control, or did not return it, count in neither;
+  present is the number that did.  Without a strict majority, majorityValue
+  is the most common value (hasMajority is false).
+*/
+struct UVCAuditControl {
+  size_t controlId = kUVCControlIdInvalid;
+  size_t present = 0;
+  size_t majorityCount = 0;
+  bool hasMajority = false;
+  std::vector<uint8_t> majorityValue;
+  std::vector<size_t> outliers;
+};
+
+/*!
+  @struct UVCAuditGroup
+
+  Devices whose snapshots are identical:  the same value, or the same lack of
+  one, for every audited control.
+*/
+struct UVCAuditGroup {
+  uint64_t snapshotHash = 0;
+  std::vector<size_t> devices;
+};
+
+/*!
+  @class UVCFleetAudit
+  @abstract Finds the devices whose settings stray from the rest.
+
+  A snapshot of every absolute control is taken from each device, in one
+  transferValues batch, into a column per control holding that control's
+  value for every device, each packed in 64 bits.  analyze() then works a
+  column at a time with branch-free passes over the devices (which the
+  compiler vectorizes):  the majority value is found by a vote and counted,
+  and the devices that differ from it are picked out.  Each device's whole
+  snapshot is hashed along the way, so that devices with identical settings
+  are grouped without comparing snapshots pairwise.
+
+  Devices are referred to by their index, 0 to deviceCount - 1.  Snapshots
+  of different devices may be taken from different threads; analyze() must
+  not overlap them.  Relative controls are not audited.
+*/
+class UVCFleetAudit {
+ private:
+  size_t _deviceCount;
+  // The audited controls and the size of their values, and the column of
+  // each control id (SIZE_MAX for controls not audited):
+  std::vector<size_t> _controlIds;
+  std::vector<size_t> _valueSizes;
+  std::vector<size_t> _columns;
+  // _controlIds.size() columns of _deviceCount values, and whether each
+  // device returned the value:
+  std::vector<uint64_t> _values;
+  std::vector<uint8_t> _present;
+
+  std::vector<uint64_t> _snapshotHashes;
+  std::vector<UVCAuditControl> _results;
+  std::vector<UVCAuditGroup> _groups;
+
+ public:
+  /*!
+    @method create
+
+    Returns a shared_ptr to an audit of deviceCount devices, none of which
+    has a snapshot yet, or nullptr if deviceCount is zero.
+  */
+  static std::shared_ptr<UVCFleetAudit> create(size_t deviceCount);
+
+  explicit UVCFleetAudit(size_t deviceCount);
+
+  size_t deviceCount() const;
+
+  /*!
+    @method capture
+
+    Take the snapshot of device deviceIndex:  read every audited control the
+    controller offers, in one batch.  Replaces any earlier snapshot of the
+    device.  Returns false if deviceIndex is out of range or a value could
+    not be read (the values that were read are kept).
+  */
+  bool capture(size_t deviceIndex, UVCDeviceController& controller);
+
+  /*!
+    @method setValue
+
+    Enter a value (length bytes, in USB byte order) in the snapshot of
+    device deviceIndex, as if capture() had read it.  Returns false if the
+    device or control is out of range or not audited, or length is wrong.
+  */
+  bool setValue(size_t deviceIndex,
+                size_t controlId,
+                const void* data,
+                size_t length);
+
+  /*!
+    @method value
+
+    Copy the value of the control in the snapshot of device deviceIndex (in
+    USB byte order) to data.  Returns false if the device did not return it
+    or length is wrong.
+  */
+  bool value(size_t deviceIndex,
+             size_t controlId,
+             void* data,
+             size_t length) const;
+
+  /*!
+    @method analyze
+
+    Compare the snapshots taken so far; the results are available from
+    controls(), groups() and snapshotHash() until the next analyze().
+  */
+  void analyze();
+
+  /*!
+    @method controls
+
+    Returns the outcome for each audited control that at least one device
+    returned, in control id order.
+  */
+  const std::vector<UVCAuditControl>& controls() const;
+
+  /*!
+    @method groups
+
+    Returns the devices grouped by identical snapshot, largest group first.
+  */
+  const std::vector<UVCAuditGroup>& groups() const;
+
+  /*!
+    @method snapshotHash
+
+    Returns the hash of the snapshot of device deviceIndex, 0 if it is out
+    of range.
+  */
+  uint64_t snapshotHash(size_t deviceIndex) const;
+};
@@ -0,0 +1,612 @@
+//
+// UVCHistory.cpp
+//
+// Compact on-disk time series of control values.
+//
+// Translated from Objective-C to C++
+// Copyright © 2016
+// Dr. Jeffrey Frey, IT-NSS
+// University of Delaware
+//
+// $Id$
+//
+
+#include "UVCHistory.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include "UVCBasicController.hpp"
+#include "UVCDiagnostics.hpp"
+#include "UVCType.hpp"
+
+static const char uvcHistoryMagic[8] = {'U', 'V', 'C', 'H', 'I', 'S', 'T', 0};
+
+// Magic and version:
+static const size_t kUVCHistoryHeaderLength = 10;
+
+static void AppendVarint(std::vector<uint8_t>& out, uint64_t value) {
+  while (value >= 0x80) {
+    out.push_back(static_cast<uint8_t>(value | 0x80));
+    value >>= 7;
+  }
+  out.push_back(static_cast<uint8_t>(value));
+}
+
+// Zig-zag, so that small changes either way take few bytes:
+static void AppendSVarint(std::vector<uint8_t>& out, int64_t value) {
+  AppendVarint(out, (static_cast<uint64_t>(value) << 1) ^
+                        static_cast<uint64_t>(value >> 63));
+}
+
+static void AppendUInt(std::vector<uint8_t>& out,
+                       uint64_t value,
+                       size_t byteSize) {
+  for (size_t i = 0; i < byteSize; i++) {
+    out.push_back(static_cast<uint8_t>(value >> (8 * i)));
+  }
+}
+
+static void AppendString(std::vector<uint8_t>& out, const std::string& s) {
+  AppendVarint(out, s.size());
+  out.insert(out.end(), s.begin(), s.end());
+}
+
+static uint32_t UVCHistoryChecksum(uint32_t hash,
+                                   const uint8_t* bytes,
+                                   size_t length) {
+  for (size_t i = 0; i < length; i++) {
+    hash = (hash ^ bytes[i]) * 0x01000193U;
+  }
+  return hash;
+}
+
+// Bounds-checked cursor over the mapped file; every read fails once the data
+// is exhausted.
+struct UVCHistoryCursor {
+  const uint8_t* p;
+  const uint8_t* end;
+
+  bool readUInt(uint64_t& value, size_t byteSize) {
+    if (static_cast<size_t>(end - p) < byteSize)
+      return false;
+    value = 0;
+    for (size_t i = 0; i < byteSize; i++) {
+      value |= static_cast<uint64_t>(p[i]) << (8 * i);
+    }
+    p += byteSize;
+    return true;
+  }
+
+  bool readVarint(uint64_t& value) {
+    value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+      if (p >= end)
+        return false;
+      uint8_t byte = *p++;
+      value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+      if (!(byte & 0x80))
+        return true;
+    }
+    return false;
+  }
+
+  bool readSVarint(int64_t& value) {
+    uint64_t zigzag;
+    if (!readVarint(zigzag))
+      return false;
+    value = static_cast<int64_t>(zigzag >> 1) ^
+            -static_cast<int64_t>(zigzag & 1);
+    return true;
+  }
+
+  bool readString(std::string& value) {
+    uint64_t length;
+    if (!readVarint(length) || static_cast<uint64_t>(end - p) < length)
+      return false;
+    value.assign(reinterpret_cast<const char*>(p), length);
+    p += length;
+    return true;
+  }
+};
+
+// The fields of a control's value, from its type signature; false if the
+// signature cannot be parsed:
+static bool UVCHistoryFields(const std::string& typeSignature,
+                             std::vector<UVCHistoryField>& fields,
+                             size_t& valueSize) {
+  std::shared_ptr<UVCType> type =
+      UVCType::createFromCString(typeSignature.c_str());
+  if (!type) {
+    return false;
+  }
+
+  fields.clear();
+  for (size_t i = 0; i < type->fieldCount(); i++) {
+    UVCTypeComponentType componentType = type->fieldTypeAtIndex(i);
+    UVCHistoryField field;
+
+    field.offset = type->offsetToFieldAtIndex(i);
+    field.size = UVCTypeComponentByteSize(componentType);
+    field.isSigned = componentType == UVCTypeComponentType::SInt8 ||
+                     componentType == UVCTypeComponentType::SInt16 ||
+                     componentType == UVCTypeComponentType::SInt32 ||
+                     componentType == UVCTypeComponentType::SInt64;
+    fields.push_back(field);
+  }
+  valueSize = type->byteSize();
+  return !fields.empty();
+}
+
+static int64_t UVCHistoryFieldValue(const uint8_t* value,
+                                    const UVCHistoryField& field) {
+  uint64_t bits = 0;
+
+  for (size_t i = 0; i < field.size; i++) {
+    bits |= static_cast<uint64_t>(value[field.offset + i]) << (8 * i);
+  }
+  if (field.isSigned && field.size < 8 &&
+      (bits >> (8 * field.size - 1)) & 1) {
+    bits |= ~0ULL << (8 * field.size);
+  }
+  return static_cast<int64_t>(bits);
+}
+
+//
+// UVCHistoryWriter
+//
+
+std::shared_ptr<UVCHistoryWriter> UVCHistoryWriter::create(
+    const std::string& path,
+    const UVCHistoryPolicy& policy) {
+  struct stat fileStatus;
+  std::vector<UVCHistorySeries> series;
+  FILE* file;
+
+  if (stat(path.c_str(), &fileStatus) == 0 && fileStatus.st_size > 0) {
+    std::shared_ptr<UVCHistoryReader> reader = UVCHistoryReader::open(path);
+    if (!reader) {
+      return nullptr;
+    }
+    if (reader->validLength() < static_cast<size_t>(fileStatus.st_size)) {
+      UVC_DIAGNOSTIC(Warning, General,
+                     "History %s ends in a torn record, %lld bytes dropped",
+                     path.c_str(),
+                     static_cast<long long>(fileStatus.st_size -
+                                            reader->validLength()));
+      if (truncate(path.c_str(), reader->validLength()) != 0) {
+        UVC_DIAGNOSTIC(Error, General, "unable to truncate history file %s: %s",
+                       path.c_str(), strerror(errno));
+        return nullptr;
+      }
+    }
+    series = reader->series();
+    file = fopen(path.c_str(), "ab");
+  } else {
+    file = fopen(path.c_str(), "wb");
+    if (file) {
+      std::vector<uint8_t> header(uvcHistoryMagic,
+                                  uvcHistoryMagic + sizeof(uvcHistoryMagic));
+      AppendUInt(header, UVC_HISTORY_VERSION, 2);
+      fwrite(header.data(), 1, header.size(), file);
+    }
+  }
+  if (!file) {
+    UVC_DIAGNOSTIC(Error, General, "unable to open history file %s: %s",
+                   path.c_str(), strerror(errno));
+    return nullptr;
+  }
+  return std::make_shared<UVCHistoryWriter>(file, policy, series);
+}
+
+UVCHistoryWriter::UVCHistoryWriter(FILE* file,
+                                   const UVCHistoryPolicy& policy,
+                                   const std::vector<UVCHistorySeries>& series)
+    : _file(file), _policy(policy) {
+  if (!_policy.blockSamples) {
+    _policy.blockSamples = 1;
+  }
+  for (const UVCHistorySeries& description : series) {
+    addSeriesLocked(description, true);
+  }
+}
+
+UVCHistoryWriter::~UVCHistoryWriter() {
+  flush();
+  if (_file) {
+    fclose(_file);
+  }
+}
+
+UVCHistoryStatistics UVCHistoryWriter::statistics() {
+  std::lock_guard<std::mutex> guard(_lock);
+  return _statistics;
+}
+
+uint16_t UVCHistoryWriter::addSeries(const UVCDeviceIdentity& identity,
+                                     uint8_t interfaceNumber,
+                                     size_t controlId) {
+  if (controlId >= std::size(uvcControlDefinitions)) {
+    return kUVCHistorySeriesInvalid;
+  }
+
+  UVCHistorySeries description;
+  description.vendorId = identity.vendorId;
+  description.productId = identity.productId;
+  description.interfaceNumber = interfaceNumber;
+  description.serialNumber = identity.serialNumber;
+  description.controlName = uvcControlDefinitions[controlId].name;
+  description.typeSignature = uvcControlDefinitions[controlId].typeSignature;
+
+  std::lock_guard<std::mutex> guard(_lock);
+  return addSeriesLocked(description, false);
+}
+
+// Find or add the series; a new one is written to the file unless isWritten
+// (it was read from the file).  Called with the lock held, or from the
+// constructor.
+uint16_t UVCHistoryWriter::addSeriesLocked(
+    const UVCHistorySeries& description,
+    bool isWritten) {
+  for (size_t i = 0; i < _series.size(); i++) {
+    const UVCHistorySeries& known = _series[i].description;
+    if (known.vendorId == description.vendorId &&
+        known.productId == description.productId &&
+        known.interfaceNumber == description.interfaceNumber &&
+        known.serialNumber == description.serialNumber &&
+        known.controlName == description.controlName &&
+        known.typeSignature == description.typeSignature) {
+      return static_cast<uint16_t>(i);
+    }
+  }
+  if (_series.size() >= kUVCHistorySeriesInvalid) {
+    UVC_DIAGNOSTIC(Warning, General, "History holds too many series, %s of "
+                   "%04x:%04x not recorded", description.controlName.c_str(),
+                   description.vendorId, description.productId);
+    return kUVCHistorySeriesInvalid;
+  }
+
+  Series series;
+  if (!UVCHistoryFields(description.typeSignature, series.fields,
+                        series.valueSize)) {
+    return kUVCHistorySeriesInvalid;
+  }
+  series.description = description;
+  series.lastValues.resize(series.fields.size());
+  series.columns.resize(1 + series.fields.size());
+
+  uint16_t index = static_cast<uint16_t>(_series.size());
+  if (!isWritten) {
+    _record.clear();
+    _record.push_back('S');
+    AppendUInt(_record, index, 2);
+    AppendVarint(_record, description.vendorId);
+    AppendVarint(_record, description.productId);
+    _record.push_back(description.interfaceNumber);
+    AppendString(_record, description.serialNumber);
+    AppendString(_record, description.controlName);
+    AppendString(_record, description.typeSignature);
+    if (fwrite(_record.data(), 1, _record.size(), _file) != _record.size()) {
+      return kUVCHistorySeriesInvalid;
+    }
+    _statistics.bytesWritten += _record.size();
+  }
+  _series.push_back(std::move(series));
+  return index;
+}
+
+bool UVCHistoryWriter::record(uint16_t series,
+                              uint64_t micros,
+                              const void* value,
+                              size_t length) {
+  std::lock_guard<std::mutex> guard(_lock);
+
+  if (series >= _series.size() || length != _series[series].valueSize) {
+    return false;
+  }
+
+  Series& s = _series[series];
+  // A block's samples are in time order, so that its header bounds them:
+  if (s.count && (s.count >= _policy.blockSamples || micros < s.lastMicros ||
+                  micros - s.firstMicros >= _policy.blockMicros)) {
+    if (!writeBlock(series)) {
+      return false;
+    }
+  }
+  if (!s.count) {
+    s.firstMicros = s.lastMicros = micros;
+    s.lastSpacing = 0;
+    std::fill(s.lastValues.begin(), s.lastValues.end(), 0);
+  }
+
+  int64_t spacing = static_cast<int64_t>(micros - s.lastMicros);
+  AppendSVarint(s.columns[0], spacing - s.lastSpacing);
+  s.lastSpacing = spacing;
+  s.lastMicros = micros;
+
+  const uint8_t* bytes = static_cast<const uint8_t*>(value);
+  for (size_t i = 0; i < s.fields.size(); i++) {
+    int64_t fieldValue = UVCHistoryFieldValue(bytes, s.fields[i]);
+    AppendSVarint(s.columns[1 + i],
+                  static_cast<int64_t>(static_cast<uint64_t>(fieldValue) -
+                                       static_cast<uint64_t>(s.lastValues[i])));
+    s.lastValues[i] = fieldValue;
+  }
+  s.count++;
+  _statistics.samples++;
+  return true;
+}
+
+bool UVCHistoryWriter::flush() {
+  std::lock_guard<std::mutex> guard(_lock);
+  bool isWritten = true;
+
+  for (size_t i = 0; i < _series.size(); i++) {
+    if (_series[i].count && !writeBlock(static_cast<uint16_t>(i))) {
+      isWritten = false;
+    }
+  }
+  return fflush(_file) == 0 && isWritten;
+}
+
+// Write the block gathered for a series and start the next one; the column
+// buffers keep their capacity.  Called with the lock held.
+bool UVCHistoryWriter::writeBlock(uint16_t seriesIndex) {
+  Series& s = _series[seriesIndex];
+  uint32_t checksum = 0x811c9dc5U;
+  size_t bodyLength = 0;
+
+  for (const std::vector<uint8_t>& column : s.columns) {
+    checksum = UVCHistoryChecksum(checksum, column.data(), column.size());
+    bodyLength += column.size();
+  }
+
+  _record.clear();
+  _record.push_back('B');
+  AppendUInt(_record, seriesIndex, 2);
+  AppendUInt(_record, s.count, 4);
+  AppendUInt(_record, bodyLength, 4);
+  AppendUInt(_record, s.firstMicros, 8);
+  AppendUInt(_record, s.lastMicros, 8);
+  AppendUInt(_record, checksum, 4);
+
+  bool isWritten =
+      fwrite(_record.data(), 1, _record.size(), _file) == _record.size();
+  for (std::vector<uint8_t>& column : s.columns) {
+    isWritten = isWritten &&
+                fwrite(column.data(), 1, column.size(), _file) == column.size();
+    column.clear();
+  }
+  s.count = 0;
+  if (!isWritten) {
+    UVC_DIAGNOSTIC(Error, General, "unable to write history block: %s",
+                   strerror(errno));
+    return false;
+  }
+  _statistics.blocks++;
+  _statistics.bytesWritten += _record.size() + bodyLength;
+  return true;
+}
+
+//
+// UVCHistoryReader
+//
+
+std::shared_ptr<UVCHistoryReader> UVCHistoryReader::open(
+    const std::string& path) {
+  int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    UVC_DIAGNOSTIC(Error, General, "unable to open history file %s: %s",
+                   path.c_str(), strerror(errno));
+    return nullptr;
+  }
+
+  struct stat fileStatus;
+  void* map = MAP_FAILED;
+  size_t mapLength = 0;
+  if (fstat(fd, &fileStatus) == 0 &&
+      fileStatus.st_size >= static_cast<off_t>(kUVCHistoryHeaderLength)) {
+    mapLength = static_cast<size_t>(fileStatus.st_size);
+    map = mmap(nullptr, mapLength, PROT_READ, MAP_PRIVATE, fd, 0);
+  }
+  ::close(fd);
+  if (map == MAP_FAILED) {
+    UVC_DIAGNOSTIC(Error, General, "unable to map history file %s",
+                   path.c_str());
+    return nullptr;
+  }
+
+  auto reader = std::make_shared<UVCHistoryReader>(map, mapLength);
+  if (!reader->index()) {
+    UVC_DIAGNOSTIC(Error, General, "%s is not a history file", path.c_str());
+    return nullptr;
+  }
+  return reader;
+}
+
+UVCHistoryReader::UVCHistoryReader(void* map, size_t mapLength)
+    : _map(map), _mapLength(mapLength), _validLength(0) {}
+
+UVCHistoryReader::~UVCHistoryReader() {
+  if (_map) {
+    munmap(_map, _mapLength);
+  }
+}
+
+const std::vector<UVCHistorySeries>& UVCHistoryReader::series() const {
+  return _series;
+}
+
+size_t UVCHistoryReader::valueSize(uint16_t series) const {
+  return (series < _valueSizes.size()) ? _valueSizes[series] : 0;
+}
+
+uint64_t UVCHistoryReader::sampleCount(uint16_t series) const {
+  uint64_t count = 0;
+
+  for (const Block& block : _blocks) {
+    if (block.series == series) {
+      count += block.count;
+    }
+  }
+  return count;
+}
+
+size_t UVCHistoryReader::validLength() const {
+  return _validLength;
+}
+
+// Walk the records, reading series and the headers of blocks; stop at the
+// first record that is cut short or not understood.  Returns false if the
+// file does not start with a history header.
+bool UVCHistoryReader::index() {
+  const uint8_t* start = static_cast<const uint8_t*>(_map);
+  UVCHistoryCursor cursor = {start, start + _mapLength};
+  uint64_t version;
+
+  if (memcmp(start, uvcHistoryMagic, sizeof(uvcHistoryMagic)) != 0) {
+    return false;
+  }
+  cursor.p += sizeof(uvcHistoryMagic);
+  if (!cursor.readUInt(version, 2) || version != UVC_HISTORY_VERSION) {
+    return false;
+  }
+  _validLength = kUVCHistoryHeaderLength;
+
+  while (cursor.p < cursor.end) {
+    uint64_t kind, series;
+    if (!cursor.readUInt(kind, 1) || !cursor.readUInt(series, 2)) {
+      break;
+    }
+    if (kind == 'S') {
+      UVCHistorySeries description;
+      uint64_t vendorId, productId, interfaceNumber;
+      std::vector<UVCHistoryField> fields;
+      size_t valueSize;
+
+      if (series != _series.size() || !cursor.readVarint(vendorId) ||
+          !cursor.readVarint(productId) ||
+          !cursor.readUInt(interfaceNumber, 1) ||
+          !cursor.readString(description.serialNumber) ||
+          !cursor.readString(description.controlName) ||
+          !cursor.readString(description.typeSignature) ||
+          !UVCHistoryFields(description.typeSignature, fields, valueSize)) {
+        break;
+      }
+      description.vendorId = static_cast<uint16_t>(vendorId);
+      description.productId = static_cast<uint16_t>(productId);
+      description.interfaceNumber = static_cast<uint8_t>(interfaceNumber);
+      _series.push_back(std::move(description));
+      _fields.push_back(std::move(fields));
+      _valueSizes.push_back(valueSize);
+    } else if (kind == 'B') {
+      uint64_t count, bodyLength, firstMicros, lastMicros, checksum;
+
+      if (series >= _series.size() || !cursor.readUInt(count, 4) ||
+          !cursor.readUInt(bodyLength, 4) || !cursor.readUInt(firstMicros, 8) ||
+          !cursor.readUInt(lastMicros, 8) || !cursor.readUInt(checksum, 4) ||
+          static_cast<uint64_t>(cursor.end - cursor.p) < bodyLength) {
+        break;
+      }
+      Block block;
+      block.series = static_cast<uint16_t>(series);
+      block.count = static_cast<uint32_t>(count);
+      block.firstMicros = firstMicros;
+      block.lastMicros = lastMicros;
+      block.body = cursor.p;
+      block.bodyLength = static_cast<uint32_t>(bodyLength);
+      block.checksum = static_cast<uint32_t>(checksum);
+      _blocks.push_back(block);
+      cursor.p += bodyLength;
+    } else {
+      break;
+    }
+    _validLength = static_cast<size_t>(cursor.p - start);
+  }
+  return true;
+}
+
+bool UVCHistoryReader::read(uint16_t series,
+                            uint64_t fromMicros,
+                            uint64_t toMicros,
+                            std::vector<uint64_t>& micros,
+                            std::vector<uint8_t>& values) const {
+  if (series >= _series.size()) {
+    return false;
+  }
+
+  const std::vector<UVCHistoryField>& fields = _fields[series];
+  size_t valueSize = _valueSizes[series];
+
+  for (const Block& block : _blocks) {
+    if (block.series != series || block.lastMicros < fromMicros ||
+        block.firstMicros > toMicros) {
+      continue;
+    }
+    if (UVCHistoryChecksum(0x811c9dc5U, block.body, block.bodyLength) !=
+        block.checksum) {
+      UVC_DIAGNOSTIC(Warning, General, "History block of %s is corrupt",
+                     _series[series].controlName.c_str());
+      return false;
+    }
+
+    // Each column holds count entries:  decode the timestamps, then fill in
+    // the values field by field.
+    UVCHistoryCursor cursor = {block.body, block.body + block.bodyLength};
+    size_t first = micros.size();
+    uint64_t time = block.firstMicros;
+    int64_t spacing = 0;
+
+    for (uint32_t i = 0; i < block.count; i++) {
+      int64_t change;
+      if (!cursor.readSVarint(change)) {
+        return false;
+      }
+      spacing += change;
+      time += static_cast<uint64_t>(spacing);
+      micros.push_back(time);
+    }
+    values.resize(values.size() + block.count * valueSize);
+    uint8_t* blockValues = values.data() + values.size() -
+                           block.count * valueSize;
+    for (const UVCHistoryField& field : fields) {
+      int64_t fieldValue = 0;
+      for (uint32_t i = 0; i < block.count; i++) {
+        int64_t change;
+        if (!cursor.readSVarint(change)) {
+          return false;
+        }
+        fieldValue = static_cast<int64_t>(static_cast<uint64_t>(fieldValue) +
+                                          static_cast<uint64_t>(change));
+        for (size_t b = 0; b < field.size; b++) {
+          blockValues[i * valueSize + field.offset + b] =
+              static_cast<uint8_t>(static_cast<uint64_t>(fieldValue) >>
+                                   (8 * b));
+        }
+      }
+    }
+
+    // Keep only the samples in range; a block straddling either end of it
+    // holds some that are not:
+    size_t kept = first;
+    for (size_t i = first; i < micros.size(); i++) {
+      if (micros[i] >= fromMicros && micros[i] <= toMicros) {
+        if (kept != i) {
+          micros[kept] = micros[i];
+          memmove(values.data() + kept * valueSize,
+                  values.data() + i * valueSize, valueSize);
+        }
+        kept++;
+      }
+    }
+    micros.resize(kept);
+    values.resize(kept * valueSize);
+  }
+  return true;
+}
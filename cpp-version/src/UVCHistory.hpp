@@ -0,0 +1,286 @@
+//
+// UVCHistory.hpp
+//
+// Compact on-disk time series of control values.
+//
+// Translated from Objective-C to C++
+// Copyright © 2016
+// Dr. Jeffrey Frey, IT-NSS
+// University of Delaware
+//
+// $Id$
+//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "UVCTransport.hpp"
+
+/*
+  History file layout (multi-byte integers little-endian; "varint" is an
+  unsigned LEB128 quantity, "svarint" a zig-zag encoded signed one):
+
+    header  "UVCHIST" u8:0 u16:version
+    series  'S' u16:series varint:vendorId varint:productId
+            u8:interfaceNumber varint:len bytes:serialNumber
+            varint:len bytes:controlName varint:len bytes:typeSignature
+    block   'B' u16:series u32:sampleCount u32:bodyLength
+            u64:firstMicros u64:lastMicros u32:checksum bytes:body
+
+  A series is one control of one device; a block holds sampleCount
+  consecutive samples of a series, in columns:  the timestamps
+  (microseconds since the epoch) as the change in their spacing, then for
+  each field of the control's type its values as the change from the
+  previous sample.  Every entry is an svarint; at the start of a block the
+  previous timestamp is firstMicros, the previous spacing and values zero.
+  A value that holds still costs a byte per field, a sample taken on a
+  steady schedule a byte for its time.
+
+  The fixed-size block header lets a reader step from block to block, and
+  choose blocks by time, without decoding them.  checksum is the FNV-1a hash
+  of the body.
+*/
+#define UVC_HISTORY_VERSION 1
+
+// Returned by UVCHistoryWriter::addSeries when no series could be added:
+const uint16_t kUVCHistorySeriesInvalid = UINT16_MAX;
+
+/*!
+  @struct UVCHistorySeries
+
+  The device (vendor and product id, serial number and VideoControl
+  interface) and control whose values a series holds.
+*/
+struct UVCHistorySeries {
+  uint16_t vendorId = 0;
+  uint16_t productId = 0;
+  uint8_t interfaceNumber = 0;
+  std::string serialNumber;
+  std::string controlName;
+  std::string typeSignature;
+};
+
+/*!
+  @struct UVCHistoryPolicy
+
+  A series' block is written once it holds blockSamples samples or its
+  first sample is blockMicros old, whichever comes first; samples in a block
+  not yet written are lost if the process dies.
+*/
+struct UVCHistoryPolicy {
+  uint32_t blockSamples = 4096;
+  uint64_t blockMicros = 60000000;
+};
+
+/*!
+  @struct UVCHistoryStatistics
+
+  Counters kept by a UVCHistoryWriter.
+*/
+struct UVCHistoryStatistics {
+  uint64_t samples = 0;
+  uint64_t blocks = 0;
+  uint64_t bytesWritten = 0;
+};
+
+// Where each field of a control's value lies, for the codecs; internal:
+struct UVCHistoryField {
+  size_t offset = 0;
+  size_t size = 0;
+  bool isSigned = false;
+};
+
+/*!
+  @class UVCHistoryWriter
+  @abstract Appends control values to a history file.
+
+  Samples are gathered per series in memory, already encoded, and written a
+  block at a time (through stdio):  most samples cost a few bytes of memory,
+  and once a series' first block is written, no allocation.  Thread-safe.
+*/
+class UVCHistoryWriter {
+ private:
+  struct Series {
+    UVCHistorySeries description;
+    std::vector<UVCHistoryField> fields;
+    size_t valueSize = 0;
+
+    // The block being gathered; columns[0] holds the timestamps, then one
+    // column per field:
+    uint32_t count = 0;
+    uint64_t firstMicros = 0;
+    uint64_t lastMicros = 0;
+    int64_t lastSpacing = 0;
+    std::vector<int64_t> lastValues;
+    std::vector<std::vector<uint8_t>> columns;
+  };
+
+  std::mutex _lock;
+  FILE* _file;
+  UVCHistoryPolicy _policy;
+  std::vector<Series> _series;
+  std::vector<uint8_t> _record;
+  UVCHistoryStatistics _statistics;
+
+ public:
+  /*!
+    @method create
+
+    Returns a shared_ptr to a writer appending to the history at path, or
+    starting one if there is no file there.  Series of an existing history
+    are carried on; a block torn by a crash at its end is cut off.  Returns
+    nullptr if the file could not be opened or is not a history.
+  */
+  static std::shared_ptr<UVCHistoryWriter> create(
+      const std::string& path,
+      const UVCHistoryPolicy& policy = UVCHistoryPolicy());
+
+  UVCHistoryWriter(FILE* file,
+                   const UVCHistoryPolicy& policy,
+                   const std::vector<UVCHistorySeries>& series);
+  ~UVCHistoryWriter();
+
+  // Delete copy constructor and assignment operator
+  UVCHistoryWriter(const UVCHistoryWriter&) = delete;
+  UVCHistoryWriter& operator=(const UVCHistoryWriter&) = delete;
+
+  UVCHistoryStatistics statistics();
+
+  /*!
+    @method addSeries
+
+    Returns the series for the given control of the device with the given
+    identity, added to the file if it is not there yet.  Returns
+    kUVCHistorySeriesInvalid if the control id is out of range or the file
+    holds as many series as it can.
+  */
+  uint16_t addSeries(const UVCDeviceIdentity& identity,
+                     uint8_t interfaceNumber,
+                     size_t controlId);
+
+  /*!
+    @method record
+
+    Add a sample to series:  the value (length bytes, in USB byte order, as
+    the device returned or accepted it) at micros since the epoch.  Returns
+    false if series is not valid, length does not match the control's type,
+    or a block could not be written.
+  */
+  bool record(uint16_t series,
+              uint64_t micros,
+              const void* value,
+              size_t length);
+
+  /*!
+    @method flush
+
+    Write the samples gathered so far for every series.  Returns false if
+    they could not be written.
+  */
+  bool flush();
+
+ private:
+  uint16_t addSeriesLocked(const UVCHistorySeries& description,
+                           bool isWritten);
+  bool writeBlock(uint16_t seriesIndex);
+};
+
+/*!
+  @class UVCHistoryReader
+  @abstract Read-only view of a history file.
+
+  The file is mapped into memory and indexed by its block headers when
+  opened; samples are decoded only from the blocks a read asks for.  A
+  partial block at the end of the file (a recording cut short) and the rest
+  of the file after it are ignored.
+*/
+class UVCHistoryReader {
+ private:
+  struct Block {
+    uint16_t series;
+    uint32_t count;
+    uint64_t firstMicros;
+    uint64_t lastMicros;
+    const uint8_t* body;
+    uint32_t bodyLength;
+    uint32_t checksum;
+  };
+
+  void* _map;
+  size_t _mapLength;
+  size_t _validLength;
+  std::vector<UVCHistorySeries> _series;
+  std::vector<std::vector<UVCHistoryField>> _fields;
+  std::vector<size_t> _valueSizes;
+  std::vector<Block> _blocks;
+
+ public:
+  /*!
+    @method open
+
+    Returns a shared_ptr to a reader of the history at path, or nullptr if
+    it could not be mapped or is not a history.
+  */
+  static std::shared_ptr<UVCHistoryReader> open(const std::string& path);
+
+  UVCHistoryReader(void* map, size_t mapLength);
+  ~UVCHistoryReader();
+
+  // Delete copy constructor and assignment operator
+  UVCHistoryReader(const UVCHistoryReader&) = delete;
+  UVCHistoryReader& operator=(const UVCHistoryReader&) = delete;
+
+  /*!
+    @method series
+
+    Returns the series of the file; a series' index is its number.
+  */
+  const std::vector<UVCHistorySeries>& series() const;
+
+  /*!
+    @method valueSize
+
+    Returns the size in bytes of the values of series, zero if there is no
+    such series.
+  */
+  size_t valueSize(uint16_t series) const;
+
+  /*!
+    @method sampleCount
+
+    Returns the number of samples of series in the file.
+  */
+  uint64_t sampleCount(uint16_t series) const;
+
+  /*!
+    @method validLength
+
+    Returns the length of the file up to the end of its last intact record.
+  */
+  size_t validLength() const;
+
+  /*!
+    @method read
+
+    Append the samples of series taken from fromMicros to toMicros
+    (inclusive) to micros and values, the latter valueSize(series) bytes per
+    sample in USB byte order.  Blocks outside the range are skipped without
+    being decoded.  Returns false if a block that was needed is corrupt (the
+    samples before it are appended).
+  */
+  bool read(uint16_t series,
+            uint64_t fromMicros,
+            uint64_t toMicros,
+            std::vector<uint64_t>& micros,
+            std::vector<uint8_t>& values) const;
+
+ private:
+  bool index();
+};
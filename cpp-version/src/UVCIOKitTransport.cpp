@@ -0,0 +1,542 @@
+//
+// UVCIOKitTransport.cpp
+//
+// UVCTransport implementation backed by the IOKit USB user client.
+//
+// Translated from Objective-C to C++
+// Copyright © 2016
+// Dr. Jeffrey Frey, IT-NSS
+// University of Delaware
+//
+// $Id$
+//
+
+#include "UVCIOKitTransport.hpp"
+
+#if defined(__APPLE__)
+
+#include <algorithm>
+
+#include <CoreFoundation/CoreFoundation.h>
+#include <IOKit/usb/USB.h>
+
+#include "UVCProtocol.hpp"
+
+// Note: kIOReturnExclusiveAccess is already defined in IOKit headers
+
+std::shared_ptr<UVCIOKitTransport> UVCIOKitTransport::createWithService(
+    io_service_t ioService,
+    const UVCDeviceIdentity& identity,
+    int interfaceNumber) {
+  return std::make_shared<UVCIOKitTransport>(identity, ioService,
+                                             interfaceNumber);
+}
+
+std::vector<uint8_t> UVCIOKitTransport::videoControlInterfaceNumbers(
+    io_service_t ioService) {
+  std::vector<uint8_t> interfaceNumbers;
+  IOCFPlugInInterface** plugInInterface = nullptr;
+  IOUSBDeviceInterface** deviceInterface = nullptr;
+  SInt32 score;
+
+  IOReturn result = IOCreatePlugInInterfaceForService(
+      ioService, kIOUSBDeviceUserClientTypeID, kIOCFPlugInInterfaceID,
+      &plugInInterface, &score);
+
+  if (result != kIOReturnSuccess || !plugInInterface) {
+    return interfaceNumbers;
+  }
+
+  HRESULT res =
+      (*plugInInterface)
+          ->QueryInterface(plugInInterface,
+                           CFUUIDGetUUIDBytes(kIOUSBDeviceInterfaceID),
+                           (LPVOID*)&deviceInterface);
+
+  (*plugInInterface)->Release(plugInInterface);
+
+  if (res || !deviceInterface) {
+    return interfaceNumbers;
+  }
+
+  io_iterator_t interfaceIterator;
+  IOUSBFindInterfaceRequest interfaceRequest;
+  interfaceRequest.bInterfaceClass = UVC_INTERFACE_CLASS;
+  interfaceRequest.bInterfaceSubClass = UVC_INTERFACE_SUBCLASS_CONTROL;
+  interfaceRequest.bInterfaceProtocol = kIOUSBFindInterfaceDontCare;
+  interfaceRequest.bAlternateSetting = kIOUSBFindInterfaceDontCare;
+  result = (*deviceInterface)
+               ->CreateInterfaceIterator(deviceInterface, &interfaceRequest,
+                                         &interfaceIterator);
+  (*deviceInterface)->Release(deviceInterface);
+
+  if (result != kIOReturnSuccess) {
+    return interfaceNumbers;
+  }
+
+  io_service_t interfaceService;
+  while ((interfaceService = IOIteratorNext(interfaceIterator))) {
+    CFTypeRef property = IORegistryEntryCreateCFProperty(
+        interfaceService, CFSTR("bInterfaceNumber"), kCFAllocatorDefault, 0);
+    SInt32 interfaceNumber;
+
+    if (property && CFGetTypeID(property) == CFNumberGetTypeID() &&
+        CFNumberGetValue(static_cast<CFNumberRef>(property),
+                         kCFNumberSInt32Type, &interfaceNumber)) {
+      interfaceNumbers.push_back(static_cast<uint8_t>(interfaceNumber));
+    }
+    if (property) {
+      CFRelease(property);
+    }
+    IOObjectRelease(interfaceService);
+  }
+  IOObjectRelease(interfaceIterator);
+  return interfaceNumbers;
+}
+
+UVCIOKitTransport::UVCIOKitTransport(const UVCDeviceIdentity& identity,
+                                     io_service_t ioServiceObject,
+                                     int interfaceNumber)
+    : _identity(identity),
+      _controllerInterface(nullptr),
+      _isInterfaceOpen(false),
+      _shouldNotCloseInterface(false),
+      _videoInterfaceIndex(0),
+      _requestedInterfaceNumber(interfaceNumber) {
+  // A reconnect re-opens the interface found now:
+  if (findControllerInterfaceForServiceObject(ioServiceObject)) {
+    _requestedInterfaceNumber = _videoInterfaceIndex;
+  }
+}
+
+UVCIOKitTransport::~UVCIOKitTransport() {
+  if (_controllerInterface && _isInterfaceOpen && !_shouldNotCloseInterface) {
+    (*_controllerInterface)->USBInterfaceClose(_controllerInterface);
+  }
+
+  if (_controllerInterface) {
+    (*_controllerInterface)->Release(_controllerInterface);
+  }
+}
+
+const UVCDeviceIdentity& UVCIOKitTransport::identity() const {
+  return _identity;
+}
+
+uint8_t UVCIOKitTransport::interfaceNumber() const {
+  return _videoInterfaceIndex;
+}
+
+std::vector<uint8_t> UVCIOKitTransport::videoControlDescriptors() const {
+  std::vector<uint8_t> descriptors;
+
+  if (!_controllerInterface) {
+    return descriptors;
+  }
+
+  // Get UVC interface descriptor
+  IOUSBDescriptorHeader* ioDescriptor =
+      (*_controllerInterface)
+          ->FindNextAssociatedDescriptor(_controllerInterface, nullptr,
+                                         CS_INTERFACE);
+
+  if (!ioDescriptor)
+    return descriptors;
+
+  const uint8_t* basePtr = reinterpret_cast<const uint8_t*>(ioDescriptor);
+  if (basePtr[2] != VC_HEADER || basePtr[0] < 7) {
+    return descriptors;
+  }
+
+  // The VC header's wTotalLength spans all of the unit/terminal descriptors:
+  uint16_t totalLength = basePtr[5] | (basePtr[6] << 8);
+  descriptors.assign(basePtr, basePtr + totalLength);
+  return descriptors;
+}
+
+std::vector<uint8_t> UVCIOKitTransport::videoStreamingDescriptors() const {
+  return _videoStreamingDescriptors;
+}
+
+bool UVCIOKitTransport::isOpen() const {
+  return _isInterfaceOpen;
+}
+
+bool UVCIOKitTransport::open() {
+  if (!_isInterfaceOpen && _controllerInterface) {
+    IOReturn result =
+        (*_controllerInterface)->USBInterfaceOpen(_controllerInterface);
+    _isInterfaceOpen = (result == kIOReturnSuccess);
+  }
+  return _isInterfaceOpen;
+}
+
+void UVCIOKitTransport::close() {
+  if (_isInterfaceOpen && _controllerInterface && !_shouldNotCloseInterface) {
+    (*_controllerInterface)->USBInterfaceClose(_controllerInterface);
+    _isInterfaceOpen = false;
+  }
+}
+
+UVCTransferStatus UVCIOKitTransport::controlRequest(
+    UVCControlRequest& request) {
+  if (!_controllerInterface) {
+    return UVCTransferStatus::NoDevice;
+  }
+
+  IOUSBDevRequest controlRequest;
+  controlRequest.bmRequestType = request.bmRequestType;
+  controlRequest.bRequest = request.bRequest;
+  controlRequest.wValue = request.wValue;
+  controlRequest.wIndex = request.wIndex;
+  controlRequest.wLength = request.wLength;
+  controlRequest.pData = request.pData;
+  controlRequest.wLenDone = 0;
+
+  IOReturn result =
+      (*_controllerInterface)
+          ->ControlRequest(_controllerInterface, 0, &controlRequest);
+  request.wLenDone = controlRequest.wLenDone;
+
+  if (result == kIOReturnSuccess) {
+    return UVCTransferStatus::Success;
+  }
+  if (result == kIOUSBPipeStalled) {
+    return UVCTransferStatus::Stall;
+  }
+  if (result == kIOReturnTimeout || result == kIOUSBTransactionTimeout) {
+    return UVCTransferStatus::Timeout;
+  }
+  if (result == kIOReturnNoDevice || result == kIOReturnNotResponding ||
+      result == kIOReturnNotAttached) {
+    return UVCTransferStatus::NoDevice;
+  }
+  return UVCTransferStatus::Error;
+}
+
+bool UVCIOKitTransport::reconnect() {
+  // The interface of the departed device is of no further use:
+  if (_controllerInterface) {
+    if (_isInterfaceOpen && !_shouldNotCloseInterface) {
+      (*_controllerInterface)->USBInterfaceClose(_controllerInterface);
+    }
+    (*_controllerInterface)->Release(_controllerInterface);
+    _controllerInterface = nullptr;
+  }
+  _isInterfaceOpen = false;
+  _shouldNotCloseInterface = false;
+  _videoStreamingDescriptors.clear();
+
+  CFMutableDictionaryRef matchingDict =
+      IOServiceMatching(kIOUSBDeviceClassName);
+  if (!matchingDict) {
+    return false;
+  }
+
+  io_iterator_t serviceIterator;
+  if (IOServiceGetMatchingServices(kIOMasterPortDefault, matchingDict,
+                                   &serviceIterator) != KERN_SUCCESS) {
+    return false;
+  }
+
+  // The location changes if the device comes back on another port, so only
+  // devices without a serial number are matched by it:
+  bool hasSerialNumber = !_identity.serialNumber.empty() &&
+                         _identity.serialNumber != "Unknown UVC Device";
+  bool isFound = false;
+  io_service_t usbService;
+
+  while (!isFound && (usbService = IOIteratorNext(serviceIterator))) {
+    uint32_t locationId = GetUInt32FromIORegistry(usbService, "locationID");
+
+    if (hasSerialNumber) {
+      isFound =
+          GetUInt32FromIORegistry(usbService, "idVendor") ==
+              _identity.vendorId &&
+          GetUInt32FromIORegistry(usbService, "idProduct") ==
+              _identity.productId &&
+          GetStringFromIORegistry(usbService, "USB Serial Number") ==
+              _identity.serialNumber;
+    } else {
+      isFound = (locationId == _identity.locationId);
+    }
+    if (isFound) {
+      _identity.locationId = locationId;
+      findControllerInterfaceForServiceObject(usbService);
+    }
+    IOObjectRelease(usbService);
+  }
+  IOObjectRelease(serviceIterator);
+
+  return _controllerInterface && _isInterfaceOpen;
+}
+
+bool UVCIOKitTransport::recover(UVCRecoveryAction action) {
+  if (!_controllerInterface) {
+    return false;
+  }
+
+  IOReturn result;
+
+  switch (action) {
+    case UVCRecoveryAction::ClearStall:
+      result = (*_controllerInterface)
+                   ->ClearPipeStallBothEnds(_controllerInterface, 0);
+      return result == kIOReturnSuccess;
+
+    case UVCRecoveryAction::ReopenInterface:
+      (*_controllerInterface)->USBInterfaceClose(_controllerInterface);
+      result = (*_controllerInterface)->USBInterfaceOpen(_controllerInterface);
+      // As on creation, an interface the system driver holds is still usable:
+      _isInterfaceOpen = (result == kIOReturnSuccess ||
+                          result == kIOReturnExclusiveAccess);
+      return _isInterfaceOpen;
+
+    case UVCRecoveryAction::ResetPort:
+      return reEnumerateDevice();
+  }
+  return false;
+}
+
+bool UVCIOKitTransport::reEnumerateDevice() {
+  io_service_t deviceService = 0;
+  IOCFPlugInInterface** plugInInterface = nullptr;
+  IOUSBDeviceInterface187** deviceInterface = nullptr;
+  SInt32 score;
+
+  if ((*_controllerInterface)
+              ->GetDevice(_controllerInterface, &deviceService) !=
+          kIOReturnSuccess ||
+      !deviceService) {
+    return false;
+  }
+
+  IOReturn result = IOCreatePlugInInterfaceForService(
+      deviceService, kIOUSBDeviceUserClientTypeID, kIOCFPlugInInterfaceID,
+      &plugInInterface, &score);
+
+  if (result != kIOReturnSuccess || !plugInInterface) {
+    return false;
+  }
+
+  HRESULT res =
+      (*plugInInterface)
+          ->QueryInterface(plugInInterface,
+                           CFUUIDGetUUIDBytes(kIOUSBDeviceInterfaceID187),
+                           (LPVOID*)&deviceInterface);
+
+  (*plugInInterface)->Release(plugInInterface);
+
+  if (res || !deviceInterface) {
+    return false;
+  }
+
+  // Re-enumeration resets the port; the device needs to be opened for it:
+  result = (*deviceInterface)->USBDeviceOpen(deviceInterface);
+  if (result == kIOReturnSuccess) {
+    result = (*deviceInterface)->USBDeviceReEnumerate(deviceInterface, 0);
+    (*deviceInterface)->USBDeviceClose(deviceInterface);
+  }
+  (*deviceInterface)->Release(deviceInterface);
+
+  if (result != kIOReturnSuccess) {
+    return false;
+  }
+  // The interface went away with the old device:
+  _isInterfaceOpen = false;
+  return true;
+}
+
+bool UVCIOKitTransport::findControllerInterfaceForServiceObject(
+    io_service_t ioServiceObject) {
+  IOCFPlugInInterface** plugInInterface = nullptr;
+  IOUSBDeviceInterface** deviceInterface = nullptr;
+  IOUSBInterfaceInterface** interfaceInterface = nullptr;
+  SInt32 score;
+
+  // Get device plugin interface
+  IOReturn result = IOCreatePlugInInterfaceForService(
+      ioServiceObject, kIOUSBDeviceUserClientTypeID, kIOCFPlugInInterfaceID,
+      &plugInInterface, &score);
+
+  if (result != kIOReturnSuccess || !plugInInterface) {
+    return false;
+  }
+
+  // Get device interface
+  HRESULT res =
+      (*plugInInterface)
+          ->QueryInterface(plugInInterface,
+                           CFUUIDGetUUIDBytes(kIOUSBDeviceInterfaceID),
+                           (LPVOID*)&deviceInterface);
+
+  (*plugInInterface)->Release(plugInInterface);
+
+  if (res || !deviceInterface) {
+    return false;
+  }
+
+  // Find UVC control interface
+  io_iterator_t interfaceIterator;
+  IOUSBFindInterfaceRequest interfaceRequest;
+  interfaceRequest.bInterfaceClass = UVC_INTERFACE_CLASS;
+  interfaceRequest.bInterfaceSubClass = UVC_INTERFACE_SUBCLASS_CONTROL;
+  interfaceRequest.bInterfaceProtocol = kIOUSBFindInterfaceDontCare;
+  interfaceRequest.bAlternateSetting = kIOUSBFindInterfaceDontCare;
+  result = (*deviceInterface)
+               ->CreateInterfaceIterator(deviceInterface, &interfaceRequest,
+                                         &interfaceIterator);
+
+  if (result != kIOReturnSuccess) {
+    (*deviceInterface)->Release(deviceInterface);
+    return false;
+  }
+
+  io_service_t interfaceService;
+  while ((interfaceService = IOIteratorNext(interfaceIterator))) {
+    // Create plugin interface for this interface
+    IOCFPlugInInterface** interfacePlugIn = nullptr;
+    result = IOCreatePlugInInterfaceForService(
+        interfaceService, kIOUSBInterfaceUserClientTypeID,
+        kIOCFPlugInInterfaceID, &interfacePlugIn, &score);
+
+    if (result == kIOReturnSuccess && interfacePlugIn) {
+      // Get interface interface
+      res = (*interfacePlugIn)
+                ->QueryInterface(interfacePlugIn,
+                                 CFUUIDGetUUIDBytes(kIOUSBInterfaceInterfaceID),
+                                 (LPVOID*)&interfaceInterface);
+
+      (*interfacePlugIn)->Release(interfacePlugIn);
+
+      if (!res && interfaceInterface) {
+        // Cast to the version we need (220)
+        _controllerInterface = (IOUSBInterfaceInterface220**)interfaceInterface;
+        interfaceInterface = nullptr;  // We've taken ownership
+
+        // Get interface number
+        result = (*_controllerInterface)
+                     ->GetInterfaceNumber(_controllerInterface,
+                                          &_videoInterfaceIndex);
+
+        // Another VideoControl interface of a composite device:
+        if (_requestedInterfaceNumber >= 0 &&
+            (result != kIOReturnSuccess ||
+             _videoInterfaceIndex != _requestedInterfaceNumber)) {
+          (*_controllerInterface)->Release(_controllerInterface);
+          _controllerInterface = nullptr;
+          IOObjectRelease(interfaceService);
+          continue;
+        }
+
+        // Try to open the interface
+        result =
+            (*_controllerInterface)->USBInterfaceOpen(_controllerInterface);
+
+        if (result == kIOReturnSuccess) {
+          _isInterfaceOpen = true;
+          _shouldNotCloseInterface = true;  // We opened it
+
+          IOObjectRelease(interfaceService);
+          break;
+        } else if (result == kIOReturnExclusiveAccess) {
+          // Interface is already in use (by system driver), but we can still
+          // use it
+          _isInterfaceOpen = true;
+          _shouldNotCloseInterface = false;  // Don't close what we didn't open
+
+          IOObjectRelease(interfaceService);
+          break;
+        } else {
+          (*_controllerInterface)->Release(_controllerInterface);
+          _controllerInterface = nullptr;
+        }
+      }
+    }
+
+    IOObjectRelease(interfaceService);
+  }
+
+  IOObjectRelease(interfaceIterator);
+  collectVideoStreamingDescriptors(deviceInterface);
+  (*deviceInterface)->Release(deviceInterface);
+
+  return _controllerInterface != nullptr && _isInterfaceOpen;
+}
+
+void UVCIOKitTransport::collectVideoStreamingDescriptors(
+    IOUSBDeviceInterface** deviceInterface) {
+  io_iterator_t interfaceIterator;
+  IOUSBFindInterfaceRequest interfaceRequest;
+  interfaceRequest.bInterfaceClass = UVC_INTERFACE_CLASS;
+  interfaceRequest.bInterfaceSubClass = UVC_INTERFACE_SUBCLASS_STREAMING;
+  interfaceRequest.bInterfaceProtocol = kIOUSBFindInterfaceDontCare;
+  // Class-specific descriptors are attached to alternate setting zero:
+  interfaceRequest.bAlternateSetting = 0;
+
+  if ((*deviceInterface)
+          ->CreateInterfaceIterator(deviceInterface, &interfaceRequest,
+                                    &interfaceIterator) != kIOReturnSuccess) {
+    return;
+  }
+
+  // The VC header's baInterfaceNr lists the streaming interfaces of this
+  // VideoControl interface; on a composite device the others belong to
+  // another camera:
+  std::vector<uint8_t> vcDescriptors = videoControlDescriptors();
+  std::vector<uint8_t> collection;
+  if (vcDescriptors.size() >= 12 &&
+      vcDescriptors.size() >= 12u + vcDescriptors[11]) {
+    collection.assign(vcDescriptors.begin() + 12,
+                      vcDescriptors.begin() + 12 + vcDescriptors[11]);
+  }
+
+  io_service_t interfaceService;
+  while ((interfaceService = IOIteratorNext(interfaceIterator))) {
+    IOCFPlugInInterface** interfacePlugIn = nullptr;
+    IOUSBInterfaceInterface220** streamingInterface = nullptr;
+    SInt32 score;
+    IOReturn result = IOCreatePlugInInterfaceForService(
+        interfaceService, kIOUSBInterfaceUserClientTypeID,
+        kIOCFPlugInInterfaceID, &interfacePlugIn, &score);
+
+    if (result == kIOReturnSuccess && interfacePlugIn) {
+      HRESULT res =
+          (*interfacePlugIn)
+              ->QueryInterface(interfacePlugIn,
+                               CFUUIDGetUUIDBytes(kIOUSBInterfaceInterfaceID),
+                               (LPVOID*)&streamingInterface);
+      (*interfacePlugIn)->Release(interfacePlugIn);
+
+      UInt8 streamingInterfaceNumber = 0;
+      if (!res && streamingInterface && !collection.empty() &&
+          ((*streamingInterface)
+                   ->GetInterfaceNumber(streamingInterface,
+                                        &streamingInterfaceNumber) !=
+               kIOReturnSuccess ||
+           std::find(collection.begin(), collection.end(),
+                     streamingInterfaceNumber) == collection.end())) {
+        (*streamingInterface)->Release(streamingInterface);
+        streamingInterface = nullptr;
+      }
+      if (!res && streamingInterface) {
+        // Descriptors can be read without opening the interface:
+        IOUSBDescriptorHeader* ioDescriptor = nullptr;
+        while ((ioDescriptor = (*streamingInterface)
+                                   ->FindNextAssociatedDescriptor(
+                                       streamingInterface, ioDescriptor,
+                                       CS_INTERFACE))) {
+          const uint8_t* basePtr =
+              reinterpret_cast<const uint8_t*>(ioDescriptor);
+          _videoStreamingDescriptors.insert(_videoStreamingDescriptors.end(),
+                                            basePtr, basePtr + basePtr[0]);
+        }
+        (*streamingInterface)->Release(streamingInterface);
+      }
+    }
+    IOObjectRelease(interfaceService);
+  }
+  IOObjectRelease(interfaceIterator);
+}
+
+#endif /* __APPLE__ */
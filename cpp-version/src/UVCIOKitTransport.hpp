@@ -0,0 +1,124 @@
+//
+// UVCIOKitTransport.hpp
+//
+// UVCTransport implementation backed by the IOKit USB user client.
+//
+// Translated from Objective-C to C++
+// Copyright © 2016
+// Dr. Jeffrey Frey, IT-NSS
+// University of Delaware
+//
+// $Id$
+//
+
+#pragma once
+
+#if defined(__APPLE__)
+
+#include <IOKit/IOCFPlugIn.h>
+#include <IOKit/IOKitLib.h>
+#include <IOKit/IOMessage.h>
+#include <IOKit/usb/IOUSBLib.h>
+
+#include "UVCTransport.hpp"
+
+// I/O Registry property lookups (UVCController.cpp):
+std::string GetStringFromIORegistry(io_service_t ioService, const char* key);
+uint32_t GetUInt32FromIORegistry(io_service_t ioService, const char* key);
+
+/*!
+  @class UVCIOKitTransport
+  @abstract Control requests carried by IOUSBInterfaceInterface220.
+
+  On creation the device's interfaces are searched for the first
+  VideoControl interface (class 14, subclass 1) that can be opened, or the
+  one with a given interface number; control requests are then issued on
+  that interface's default pipe.  Composite devices (stereo, RGB+IR and other
+  multi-sensor cameras) have several VideoControl interfaces, each reached
+  through a transport of its own.
+*/
+class UVCIOKitTransport final : public UVCTransport {
+ private:
+  UVCDeviceIdentity _identity;
+
+  // All necessary functionality comes from USB standard 2.2.0:
+  IOUSBInterfaceInterface220** _controllerInterface;
+
+  bool _isInterfaceOpen;
+  bool _shouldNotCloseInterface;
+  uint8_t _videoInterfaceIndex;
+  // The VideoControl interface to open, -1 for the first that opens:
+  int _requestedInterfaceNumber;
+  std::vector<uint8_t> _videoStreamingDescriptors;
+
+ public:
+  /*!
+    @method createWithService
+
+    Returns a shared_ptr to a transport for the VideoControl interface of the
+    device referenced by ioService:  the one numbered interfaceNumber, or the
+    first that can be opened if interfaceNumber is negative.  The caller
+    retains ownership of ioService.
+
+    If no VideoControl interface could be opened the transport is still
+    returned, but every control request fails with NoDevice.
+  */
+  static std::shared_ptr<UVCIOKitTransport> createWithService(
+      io_service_t ioService,
+      const UVCDeviceIdentity& identity,
+      int interfaceNumber = -1);
+
+  /*!
+    @method videoControlInterfaceNumbers
+
+    Returns the interface numbers of the VideoControl interfaces of the
+    device referenced by ioService, in the order the I/O Registry lists them.
+  */
+  static std::vector<uint8_t> videoControlInterfaceNumbers(
+      io_service_t ioService);
+
+  UVCIOKitTransport(const UVCDeviceIdentity& identity,
+                    io_service_t ioServiceObject,
+                    int interfaceNumber = -1);
+  ~UVCIOKitTransport() override;
+
+  // Delete copy constructor and assignment operator
+  UVCIOKitTransport(const UVCIOKitTransport&) = delete;
+  UVCIOKitTransport& operator=(const UVCIOKitTransport&) = delete;
+
+  const UVCDeviceIdentity& identity() const override;
+  uint8_t interfaceNumber() const override;
+  std::vector<uint8_t> videoControlDescriptors() const override;
+  std::vector<uint8_t> videoStreamingDescriptors() const override;
+  bool isOpen() const override;
+  bool open() override;
+  void close() override;
+  UVCTransferStatus controlRequest(UVCControlRequest& request) override;
+
+  /*!
+    @method reconnect
+
+    Release the interface of the departed device and search the I/O Registry
+    for it again:  by vendor, product and serial number if the device has a
+    serial number, otherwise by locationID (the port it was plugged into).
+    The same VideoControl interface of the device found is opened, and the
+    identity's locationId updated.
+  */
+  bool reconnect() override;
+
+  /*!
+    @method recover
+
+    ClearStall clears a halt on the default pipe, ReopenInterface closes and
+    re-opens the VideoControl interface, and ResetPort has the device
+    re-enumerate (USBDeviceReEnumerate), after which it must be reconnected.
+  */
+  bool recover(UVCRecoveryAction action) override;
+
+ private:
+  bool reEnumerateDevice();
+  bool findControllerInterfaceForServiceObject(io_service_t ioServiceObject);
+  void collectVideoStreamingDescriptors(IOUSBDeviceInterface** deviceInterface);
+};
+
+#endif /* __APPLE__ */
@@ -0,0 +1,237 @@
+//
+// UVCIdlePower.cpp
+//
+// Lower power mode for devices that have been idle.
+//
+// Translated from Objective-C to C++
+// Copyright © 2016
+// Dr. Jeffrey Frey, IT-NSS
+// University of Delaware
+//
+// $Id$
+//
+
+#include "UVCIdlePower.hpp"
+
+#include <algorithm>
+
+#include "UVCDiagnostics.hpp"
+#include "UVCProtocol.hpp"
+
+// bDevicePowerMode (UVC 1.5, table 4-4):  D3..D0 select the mode, D4 is set
+// if the vendor-dependent mode is supported.
+static const uint8_t kUVCPowerModeFull = 0x00;
+static const uint8_t kUVCPowerModeVendorDependent = 0x01;
+static const uint8_t kUVCPowerModeVendorDependentSupported = 0x10;
+
+std::shared_ptr<UVCIdlePowerTransport> UVCIdlePowerTransport::create(
+    std::shared_ptr<UVCTransport> transport,
+    const UVCIdlePowerPolicy& policy) {
+  if (!transport) {
+    return nullptr;
+  }
+  return std::make_shared<UVCIdlePowerTransport>(transport, policy);
+}
+
+UVCIdlePowerTransport::UVCIdlePowerTransport(
+    std::shared_ptr<UVCTransport> transport,
+    const UVCIdlePowerPolicy& policy)
+    : _transport(transport),
+      _policy(policy),
+      _support(PowerModeSupport::Unknown),
+      _isLowPower(false),
+      _isPinned(false),
+      _transfersInFlight(0),
+      _lastActivity(Clock::now()) {}
+
+UVCIdlePowerStatistics UVCIdlePowerTransport::statistics() const {
+  std::lock_guard<std::mutex> guard(_lock);
+  return _statistics;
+}
+
+bool UVCIdlePowerTransport::enterLowPowerIfIdle() {
+  std::lock_guard<std::mutex> guard(_lock);
+
+  if (_isLowPower) {
+    return true;
+  }
+  if (_isPinned || _transfersInFlight ||
+      _support == PowerModeSupport::Unsupported ||
+      Clock::now() - _lastActivity <
+          std::chrono::microseconds(_policy.idleMicros)) {
+    return false;
+  }
+
+  uint8_t mode = 0;
+  if (_support == PowerModeSupport::Unknown) {
+    bool isSupported =
+        powerModeRequest(UVC_GET_CUR, &mode) == UVCTransferStatus::Success &&
+        (mode & kUVCPowerModeVendorDependentSupported);
+
+    _support = isSupported ? PowerModeSupport::Supported
+                           : PowerModeSupport::Unsupported;
+    if (!isSupported) {
+      UVC_DIAGNOSTIC(Info, General,
+                     "%s has no lower power mode, left at full power",
+                     _transport->identity().deviceName.c_str());
+      return false;
+    }
+  }
+
+  mode = kUVCPowerModeVendorDependent;
+  if (powerModeRequest(UVC_SET_CUR, &mode) != UVCTransferStatus::Success) {
+    return false;
+  }
+  _isLowPower = true;
+  _statistics.lowPowerEntries++;
+  UVC_DIAGNOSTIC(Debug, General, "%s idle, switched to lower power mode",
+                 _transport->identity().deviceName.c_str());
+  return true;
+}
+
+bool UVCIdlePowerTransport::wake() {
+  std::lock_guard<std::mutex> guard(_lock);
+  return wakeLocked() == UVCTransferStatus::Success;
+}
+
+void UVCIdlePowerTransport::setPinned(bool isPinned) {
+  std::lock_guard<std::mutex> guard(_lock);
+  _isPinned = isPinned;
+  if (isPinned) {
+    wakeLocked();
+  }
+}
+
+bool UVCIdlePowerTransport::isPinned() const {
+  std::lock_guard<std::mutex> guard(_lock);
+  return _isPinned;
+}
+
+bool UVCIdlePowerTransport::isLowPower() const {
+  std::lock_guard<std::mutex> guard(_lock);
+  return _isLowPower;
+}
+
+const UVCDeviceIdentity& UVCIdlePowerTransport::identity() const {
+  return _transport->identity();
+}
+
+uint8_t UVCIdlePowerTransport::interfaceNumber() const {
+  return _transport->interfaceNumber();
+}
+
+std::vector<uint8_t> UVCIdlePowerTransport::videoControlDescriptors() const {
+  return _transport->videoControlDescriptors();
+}
+
+std::vector<uint8_t> UVCIdlePowerTransport::videoStreamingDescriptors()
+    const {
+  return _transport->videoStreamingDescriptors();
+}
+
+bool UVCIdlePowerTransport::isOpen() const {
+  return _transport->isOpen();
+}
+
+bool UVCIdlePowerTransport::open() {
+  return _transport->open();
+}
+
+void UVCIdlePowerTransport::close() {
+  _transport->close();
+}
+
+UVCTransferStatus UVCIdlePowerTransport::controlRequest(
+    UVCControlRequest& request) {
+  {
+    std::lock_guard<std::mutex> guard(_lock);
+    UVCTransferStatus status = wakeLocked();
+
+    if (status != UVCTransferStatus::Success) {
+      request.wLenDone = 0;
+      return status;
+    }
+    _transfersInFlight++;
+  }
+
+  // Not under the lock, so that transfers are not serialized here; the
+  // device is not put in the lower power mode while any is in flight:
+  UVCTransferStatus status = _transport->controlRequest(request);
+
+  std::lock_guard<std::mutex> guard(_lock);
+  _transfersInFlight--;
+  _lastActivity = Clock::now();
+  return status;
+}
+
+bool UVCIdlePowerTransport::reconnect() {
+  // Whether the device kept its power mode is unknown; if it was in the
+  // lower one, the next transfer sets full power again either way:
+  return _transport->reconnect();
+}
+
+bool UVCIdlePowerTransport::recover(UVCRecoveryAction action) {
+  return _transport->recover(action);
+}
+
+UVCPowerState UVCIdlePowerTransport::powerState() const {
+  {
+    std::lock_guard<std::mutex> guard(_lock);
+    if (_isLowPower) {
+      return UVCPowerState::Suspended;
+    }
+  }
+  return _transport->powerState();
+}
+
+// GET_CUR or SET_CUR of VC_VIDEO_POWER_MODE_CONTROL, addressed to the
+// VideoControl interface itself (unit 0):
+UVCTransferStatus UVCIdlePowerTransport::powerModeRequest(uint8_t bRequest,
+                                                          uint8_t* mode) {
+  UVCControlRequest request;
+
+  request.bmRequestType =
+      (bRequest == UVC_SET_CUR) ? UVC_REQUEST_TYPE_SET : UVC_REQUEST_TYPE_GET;
+  request.bRequest = bRequest;
+  request.wValue = UVC_VC_VIDEO_POWER_MODE_CONTROL << 8;
+  request.wIndex = _transport->interfaceNumber();
+  request.wLength = 1;
+  request.pData = mode;
+  request.wLenDone = 0;
+
+  UVCTransferStatus status = _transport->controlRequest(request);
+  if (status == UVCTransferStatus::Success && request.wLenDone != 1) {
+    status = UVCTransferStatus::Error;
+  }
+  return status;
+}
+
+UVCTransferStatus UVCIdlePowerTransport::wakeLocked() {
+  if (!_isLowPower) {
+    return UVCTransferStatus::Success;
+  }
+
+  uint8_t mode = kUVCPowerModeFull;
+  auto started = Clock::now();
+  UVCTransferStatus status = powerModeRequest(UVC_SET_CUR, &mode);
+
+  if (status != UVCTransferStatus::Success) {
+    UVC_DIAGNOSTIC(Warning, Transfer, "%s did not return to full power (%s)",
+                   _transport->identity().deviceName.c_str(),
+                   UVCTransferStatusString(status));
+    return status;
+  }
+
+  auto micros = std::chrono::duration_cast<std::chrono::microseconds>(
+                    Clock::now() - started)
+                    .count();
+
+  _isLowPower = false;
+  _lastActivity = Clock::now();
+  _statistics.wakeups++;
+  _statistics.lastWakeMicros = static_cast<uint32_t>(micros);
+  _statistics.maxWakeMicros =
+      std::max(_statistics.maxWakeMicros, _statistics.lastWakeMicros);
+  _statistics.totalWakeMicros += _statistics.lastWakeMicros;
+  return status;
+}
@@ -0,0 +1,142 @@
+//
+// UVCIdlePower.hpp
+//
+// Lower power mode for devices that have been idle.
+//
+// Translated from Objective-C to C++
+// Copyright © 2016
+// Dr. Jeffrey Frey, IT-NSS
+// University of Delaware
+//
+// $Id$
+//
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "UVCTransport.hpp"
+
+/*!
+  @struct UVCIdlePowerPolicy
+
+  A device that has carried no transfer for idleMicros may be put in its
+  vendor-dependent power mode.
+*/
+struct UVCIdlePowerPolicy {
+  uint32_t idleMicros = 30000000;
+};
+
+/*!
+  @struct UVCIdlePowerStatistics
+
+  Counters kept by a UVCIdlePowerTransport.  A wake-up is a return to full
+  power, timed from the request to the device's answer.
+*/
+struct UVCIdlePowerStatistics {
+  uint64_t lowPowerEntries = 0;
+  uint64_t wakeups = 0;
+  uint64_t totalWakeMicros = 0;
+  uint32_t lastWakeMicros = 0;
+  uint32_t maxWakeMicros = 0;
+};
+
+/*!
+  @class UVCIdlePowerTransport
+  @abstract Decorator that puts another transport's idle device in a lower
+            power mode.
+
+  The device is switched to its vendor-dependent power mode with
+  VC_VIDEO_POWER_MODE_CONTROL by enterLowPowerIfIdle(), which the
+  application calls periodically; a device whose bDevicePowerMode does not
+  advertise that mode is left alone.  The next transfer first returns the
+  device to full power.  An application that sees a request coming can call
+  wake() in advance, so that the wake-up overlaps its own work.
+
+  While in the lower power mode, powerState() reports the device Suspended,
+  so a UVCDeviceController answers stale-tolerant reads from its cache
+  without waking it.  A pinned device is kept at full power.
+*/
+class UVCIdlePowerTransport final : public UVCTransport {
+ private:
+  using Clock = std::chrono::steady_clock;
+
+  enum class PowerModeSupport { Unknown, Supported, Unsupported };
+
+  mutable std::mutex _lock;
+  std::shared_ptr<UVCTransport> _transport;
+  UVCIdlePowerPolicy _policy;
+  UVCIdlePowerStatistics _statistics;
+  PowerModeSupport _support;
+  bool _isLowPower;
+  bool _isPinned;
+  unsigned _transfersInFlight;
+  Clock::time_point _lastActivity;
+
+ public:
+  /*!
+    @method create
+
+    Returns a shared_ptr to an idle power manager over transport, or nullptr
+    if transport is nullptr.
+  */
+  static std::shared_ptr<UVCIdlePowerTransport> create(
+      std::shared_ptr<UVCTransport> transport,
+      const UVCIdlePowerPolicy& policy = UVCIdlePowerPolicy());
+
+  UVCIdlePowerTransport(std::shared_ptr<UVCTransport> transport,
+                        const UVCIdlePowerPolicy& policy);
+  ~UVCIdlePowerTransport() override = default;
+
+  // Delete copy constructor and assignment operator
+  UVCIdlePowerTransport(const UVCIdlePowerTransport&) = delete;
+  UVCIdlePowerTransport& operator=(const UVCIdlePowerTransport&) = delete;
+
+  UVCIdlePowerStatistics statistics() const;
+
+  /*!
+    @method enterLowPowerIfIdle
+
+    Switch the device to its vendor-dependent power mode if it is idle, not
+    pinned and supports that mode.  Returns true if the device is in the
+    lower power mode afterwards.
+  */
+  bool enterLowPowerIfIdle();
+
+  /*!
+    @method wake
+
+    Return the device to full power now rather than on its next transfer.
+    Returns false if the device did not accept the request.
+  */
+  bool wake();
+
+  /*!
+    @method setPinned
+
+    Keep the device at full power (waking it if need be) or release it.
+  */
+  void setPinned(bool isPinned);
+  bool isPinned() const;
+  bool isLowPower() const;
+
+  const UVCDeviceIdentity& identity() const override;
+  uint8_t interfaceNumber() const override;
+  std::vector<uint8_t> videoControlDescriptors() const override;
+  std::vector<uint8_t> videoStreamingDescriptors() const override;
+  bool isOpen() const override;
+  bool open() override;
+  void close() override;
+  UVCTransferStatus controlRequest(UVCControlRequest& request) override;
+  bool reconnect() override;
+  bool recover(UVCRecoveryAction action) override;
+  UVCPowerState powerState() const override;
+
+ private:
+  UVCTransferStatus powerModeRequest(uint8_t bRequest, uint8_t* mode);
+  UVCTransferStatus wakeLocked();
+};
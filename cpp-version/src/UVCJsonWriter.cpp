@@ -0,0 +1,224 @@
+//
+// UVCJsonWriter.cpp
+//
+// Buffered, streaming JSON output.
+//
+// Translated from Objective-C to C++
+// Copyright © 2016
+// Dr. Jeffrey Frey, IT-NSS
+// University of Delaware
+//
+// $Id$
+//
+
+#include "UVCJsonWriter.hpp"
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstring>
+#include <type_traits>
+
+#include "UVCLayout.hpp"
+
+UVCJsonWriter::UVCJsonWriter(FILE* stream)
+    : _stream(stream), _used(0), _hasElement(), _depth(0), _afterKey(false) {}
+
+UVCJsonWriter::~UVCJsonWriter() {
+  flush();
+}
+
+void UVCJsonWriter::write(const char* text, size_t length) {
+  while (length) {
+    if (_used == kBufferSize) {
+      fwrite(_buffer, 1, _used, _stream);
+      _used = 0;
+    }
+
+    size_t chunk = std::min(length, kBufferSize - _used);
+    memcpy(_buffer + _used, text, chunk);
+    _used += chunk;
+    text += chunk;
+    length -= chunk;
+  }
+}
+
+void UVCJsonWriter::put(char c) {
+  if (_used == kBufferSize) {
+    fwrite(_buffer, 1, _used, _stream);
+    _used = 0;
+  }
+  _buffer[_used++] = c;
+}
+
+// Called before every value, key or container:  values following a key
+// continue its member, anything else is a new element of the container.
+void UVCJsonWriter::separate() {
+  if (_afterKey) {
+    _afterKey = false;
+    return;
+  }
+  if (_depth > 0 && _depth <= kMaxDepth) {
+    if (_hasElement[_depth - 1]) {
+      put(',');
+    }
+    _hasElement[_depth - 1] = true;
+  }
+}
+
+void UVCJsonWriter::open(char bracket) {
+  separate();
+  put(bracket);
+  if (_depth < kMaxDepth) {
+    _hasElement[_depth] = false;
+  }
+  _depth++;
+}
+
+void UVCJsonWriter::close(char bracket) {
+  if (_depth > 0) {
+    _depth--;
+  }
+  put(bracket);
+}
+
+void UVCJsonWriter::beginObject() {
+  open('{');
+}
+
+void UVCJsonWriter::endObject() {
+  close('}');
+}
+
+void UVCJsonWriter::beginArray() {
+  open('[');
+}
+
+void UVCJsonWriter::endArray() {
+  close(']');
+}
+
+void UVCJsonWriter::key(const char* name) {
+  string(name);
+  put(':');
+  _afterKey = true;
+}
+
+void UVCJsonWriter::string(const char* text) {
+  string(text, text ? strlen(text) : 0);
+}
+
+void UVCJsonWriter::string(const char* text, size_t length) {
+  static const char hexDigits[] = "0123456789abcdef";
+  size_t run = 0;
+
+  separate();
+  put('"');
+  // Unescaped runs are copied in one piece:
+  for (size_t i = 0; i < length; i++) {
+    unsigned char c = static_cast<unsigned char>(text[i]);
+
+    if (c >= 0x20 && c != '"' && c != '\\') {
+      continue;
+    }
+    write(text + run, i - run);
+    run = i + 1;
+    switch (c) {
+      case '"':
+        write("\\\"", 2);
+        break;
+      case '\\':
+        write("\\\\", 2);
+        break;
+      case '\n':
+        write("\\n", 2);
+        break;
+      case '\r':
+        write("\\r", 2);
+        break;
+      case '\t':
+        write("\\t", 2);
+        break;
+      default: {
+        char escape[] = {'\\', 'u', '0', '0', hexDigits[c >> 4],
+                         hexDigits[c & 0xf]};
+        write(escape, sizeof(escape));
+        break;
+      }
+    }
+  }
+  write(text + run, length - run);
+  put('"');
+}
+
+void UVCJsonWriter::integer(int64_t value) {
+  char text[24];
+  int length = snprintf(text, sizeof(text), "%" PRId64, value);
+
+  separate();
+  write(text, static_cast<size_t>(length));
+}
+
+void UVCJsonWriter::unsignedInteger(uint64_t value) {
+  char text[24];
+  int length = snprintf(text, sizeof(text), "%" PRIu64, value);
+
+  separate();
+  write(text, static_cast<size_t>(length));
+}
+
+void UVCJsonWriter::boolean(bool value) {
+  separate();
+  if (value) {
+    write("true", 4);
+  } else {
+    write("false", 5);
+  }
+}
+
+void UVCJsonWriter::null() {
+  separate();
+  write("null", 4);
+}
+
+void UVCJsonWriter::value(const UVCType& type, const void* buffer) {
+  size_t fieldCount = type.fieldCount();
+  const uint8_t* fieldPtr = static_cast<const uint8_t*>(buffer);
+
+  auto writeField = [&](auto component) {
+    using Component = decltype(component);
+    auto fieldValue = Component::load(fieldPtr);
+
+    if constexpr (Component::componentType == UVCTypeComponentType::Boolean) {
+      boolean(fieldValue != 0);
+    } else if constexpr (std::is_signed_v<typename Component::StorageType>) {
+      integer(fieldValue);
+    } else {
+      unsignedInteger(fieldValue);
+    }
+    fieldPtr += Component::byteSize;
+  };
+
+  if (fieldCount == 1) {
+    UVCComponentDispatch(type.fieldTypeAtIndex(0), writeField);
+    return;
+  }
+  beginObject();
+  for (size_t i = 0; i < fieldCount; i++) {
+    key(type.fieldNameAtIndex(i).c_str());
+    UVCComponentDispatch(type.fieldTypeAtIndex(i), writeField);
+  }
+  endObject();
+}
+
+void UVCJsonWriter::endRecord() {
+  put('\n');
+  flush();
+}
+
+void UVCJsonWriter::flush() {
+  if (_used) {
+    fwrite(_buffer, 1, _used, _stream);
+    _used = 0;
+  }
+  fflush(_stream);
+}
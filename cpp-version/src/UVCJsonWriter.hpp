@@ -0,0 +1,118 @@
+//
+// UVCJsonWriter.hpp
+//
+// Buffered, streaming JSON output.
+//
+// Translated from Objective-C to C++
+// Copyright © 2016
+// Dr. Jeffrey Frey, IT-NSS
+// University of Delaware
+//
+// $Id$
+//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+
+#include "UVCType.hpp"
+
+/*!
+  @class UVCJsonWriter
+  @abstract Writes JSON to a stdio stream as it is produced.
+
+  Output accumulates in a fixed buffer that is written to the stream when it
+  fills, on flush() and on endRecord(); nothing is assembled in strings.
+  Separators between members and elements are inserted automatically, so
+  callers only describe structure:
+
+    writer.beginObject();
+    writer.key("control");
+    writer.string("zoom-abs");
+    writer.key("value");
+    writer.value(*type, buffer);
+    writer.endObject();
+    writer.endRecord();
+
+  endRecord() terminates a top-level item with a newline and flushes it,
+  which yields NDJSON when called after each item.
+*/
+class UVCJsonWriter {
+ private:
+  static const size_t kBufferSize = 4096;
+  static const size_t kMaxDepth = 32;
+
+  FILE* _stream;
+  char _buffer[kBufferSize];
+  size_t _used;
+  // Per nesting level:  whether an element has been written, so the next one
+  // needs a comma.
+  bool _hasElement[kMaxDepth];
+  size_t _depth;
+  bool _afterKey;
+
+  void write(const char* text, size_t length);
+  void put(char c);
+  void separate();
+  void open(char bracket);
+  void close(char bracket);
+
+ public:
+  explicit UVCJsonWriter(FILE* stream);
+  ~UVCJsonWriter();
+
+  // Delete copy constructor and assignment operator
+  UVCJsonWriter(const UVCJsonWriter&) = delete;
+  UVCJsonWriter& operator=(const UVCJsonWriter&) = delete;
+
+  void beginObject();
+  void endObject();
+  void beginArray();
+  void endArray();
+
+  /*!
+    @method key
+
+    Write the name of the next member of the current object.
+  */
+  void key(const char* name);
+
+  /*!
+    @method string
+
+    Write text as a JSON string, escaping quotes, backslashes and control
+    characters.
+  */
+  void string(const char* text);
+  void string(const char* text, size_t length);
+
+  void integer(int64_t value);
+  void unsignedInteger(uint64_t value);
+  void boolean(bool value);
+  void null();
+
+  /*!
+    @method value
+
+    Write the data in buffer, structured by type, with native JSON types:  a
+    single-field value as a number (or true/false for a Boolean field), a
+    multi-field value as an object keyed by field name.
+  */
+  void value(const UVCType& type, const void* buffer);
+
+  /*!
+    @method endRecord
+
+    End a top-level item:  write a newline and flush.
+  */
+  void endRecord();
+
+  /*!
+    @method flush
+
+    Write buffered output to the stream and flush the stream.
+  */
+  void flush();
+};
@@ -0,0 +1,54 @@
+//
+// UVCLayout.cpp
+//
+// Compile-time codecs for fixed UVCType layouts.
+//
+// Translated from Objective-C to C++
+// Copyright © 2016
+// Dr. Jeffrey Frey, IT-NSS
+// University of Delaware
+//
+// $Id$
+//
+
+#include "UVCLayout.hpp"
+
+#include <algorithm>
+
+// Layouts compiled into the library:  every single-field type, plus the
+// multi-field signatures of the controls in uvcControlDefinitions.
+static const UVCLayoutCodec* const uvcBuiltInLayoutCodecs[] = {
+    &UVCLayout<UVCComponentB>::codec,
+    &UVCLayout<UVCComponentS1>::codec,
+    &UVCLayout<UVCComponentU1>::codec,
+    &UVCLayout<UVCComponentM1>::codec,
+    &UVCLayout<UVCComponentS2>::codec,
+    &UVCLayout<UVCComponentU2>::codec,
+    &UVCLayout<UVCComponentM2>::codec,
+    &UVCLayout<UVCComponentS4>::codec,
+    &UVCLayout<UVCComponentU4>::codec,
+    &UVCLayout<UVCComponentM4>::codec,
+    &UVCLayout<UVCComponentS8>::codec,
+    &UVCLayout<UVCComponentU8>::codec,
+    &UVCLayout<UVCComponentM8>::codec,
+    // zoom-rel
+    &UVCLayout<UVCComponentS1, UVCComponentU1, UVCComponentU1>::codec,
+    // pan-tilt-abs
+    &UVCLayout<UVCComponentS4, UVCComponentS4>::codec,
+    // pan-tilt-rel
+    &UVCLayout<UVCComponentS1, UVCComponentU1, UVCComponentS1,
+               UVCComponentU1>::codec,
+};
+
+const UVCLayoutCodec* UVCLayoutCodecForComponents(
+    const UVCTypeComponentType* componentTypes,
+    size_t count) {
+  for (const UVCLayoutCodec* codec : uvcBuiltInLayoutCodecs) {
+    if (codec->fieldCount == count &&
+        std::equal(componentTypes, componentTypes + count,
+                   codec->componentTypes)) {
+      return codec;
+    }
+  }
+  return nullptr;
+}
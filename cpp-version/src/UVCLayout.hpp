@@ -0,0 +1,733 @@
+//
+// UVCLayout.hpp
+//
+// Compile-time codecs for fixed UVCType layouts.
+//
+// Translated from Objective-C to C++
+// Copyright © 2016
+// Dr. Jeffrey Frey, IT-NSS
+// University of Delaware
+//
+// $Id$
+//
+
+#pragma once
+
+#include <strings.h>
+
+#include <array>
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include "UVCCbor.hpp"
+#include "UVCType.hpp"
+
+/*!
+  @struct UVCComponent
+  @abstract Operations on one atomic field of a UVCType.
+
+  Storage is the host type holding the field.  Every operation works on a
+  pointer to the (possibly unaligned) field within a packed buffer.  The
+  interpreted UVCType methods dispatch to these for each field at runtime;
+  UVCLayout binds them at compile time.
+*/
+template <UVCTypeComponentType Type, typename Storage>
+struct UVCComponent {
+  using StorageType = Storage;
+  static constexpr UVCTypeComponentType componentType = Type;
+  static constexpr size_t byteSize = sizeof(Storage);
+
+  // Booleans and bitmaps are not ordered, so they are never clamped:
+  static constexpr bool isOrdered =
+      Type != UVCTypeComponentType::Boolean &&
+      Type != UVCTypeComponentType::Bitmap8 &&
+      Type != UVCTypeComponentType::Bitmap16 &&
+      Type != UVCTypeComponentType::Bitmap32 &&
+      Type != UVCTypeComponentType::Bitmap64;
+
+  static Storage load(const void* field) {
+    Storage value;
+    memcpy(&value, field, sizeof(value));
+    return value;
+  }
+
+  static void store(void* field, Storage value) {
+    memcpy(field, &value, sizeof(value));
+  }
+
+  /*!
+    @method byteSwap
+
+    Convert the field between host and USB (little) endian; the conversion is
+    its own inverse.  A no-op on little-endian hosts.
+  */
+  static void byteSwap(void* field) {
+#if __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+    if constexpr (sizeof(Storage) == 2) {
+      uint16_t bits;
+      memcpy(&bits, field, sizeof(bits));
+      bits = __builtin_bswap16(bits);
+      memcpy(field, &bits, sizeof(bits));
+    } else if constexpr (sizeof(Storage) == 4) {
+      uint32_t bits;
+      memcpy(&bits, field, sizeof(bits));
+      bits = __builtin_bswap32(bits);
+      memcpy(field, &bits, sizeof(bits));
+    } else if constexpr (sizeof(Storage) == 8) {
+      uint64_t bits;
+      memcpy(&bits, field, sizeof(bits));
+      bits = __builtin_bswap64(bits);
+      memcpy(field, &bits, sizeof(bits));
+    }
+#endif
+  }
+
+  /*!
+    @method format
+
+    Write the textual form of the field to outString (outSize bytes, may be
+    zero) as snprintf does; returns the length of the full text.
+  */
+  static size_t format(const void* field, char* outString, size_t outSize) {
+    Storage value = load(field);
+    int length;
+
+    if constexpr (Type == UVCTypeComponentType::Boolean) {
+      length = snprintf(outString, outSize, "%s", value ? "true" : "false");
+    } else if constexpr (sizeof(Storage) <= 4 && std::is_signed_v<Storage>) {
+      length = snprintf(outString, outSize, "%d", static_cast<int>(value));
+    } else if constexpr (sizeof(Storage) <= 4) {
+      length =
+          snprintf(outString, outSize, "%u", static_cast<unsigned>(value));
+    } else if constexpr (std::is_signed_v<Storage>) {
+      length = snprintf(outString, outSize, "%lld",
+                        static_cast<long long>(value));
+    } else {
+      length = snprintf(outString, outSize, "%llu",
+                        static_cast<unsigned long long>(value));
+    }
+    return (length > 0) ? static_cast<size_t>(length) : 0;
+  }
+
+  /*!
+    @method scan
+
+    Parse one component value from cString into field:  "default",
+    "minimum" and "maximum" (when the corresponding limit is non-NULL),
+    yes/no words for booleans, or an integer in any base strtoll accepts.
+    On success *nChar (if non-NULL) receives the number of characters
+    consumed.
+  */
+  static bool scan(const char* cString,
+                   void* field,
+                   const void* minimum,
+                   const void* maximum,
+                   const void* defaultValue,
+                   size_t* nChar) {
+    if (!cString || !field) {
+      return false;
+    }
+
+    // Skip leading whitespace
+    while (isspace(*cString))
+      cString++;
+    const char* start = cString;
+
+    // Handle special keywords
+    const void* limit = nullptr;
+    if (strncasecmp(cString, "default", 7) == 0) {
+      if (!defaultValue)
+        return false;
+      limit = defaultValue;
+    } else if (strncasecmp(cString, "minimum", 7) == 0) {
+      limit = minimum;
+    } else if (strncasecmp(cString, "maximum", 7) == 0) {
+      limit = maximum;
+    }
+    if (limit) {
+      memcpy(field, limit, sizeof(Storage));
+      if (nChar)
+        *nChar = 7;
+      return true;
+    }
+
+    // Handle boolean special strings
+    if constexpr (Type == UVCTypeComponentType::Boolean) {
+      static const char* const trues[] = {"y", "yes", "true", "t", "1"};
+      static const char* const falses[] = {"n", "no", "false", "f", "0"};
+
+      for (const char* word : trues) {
+        size_t len = strlen(word);
+        if (strncasecmp(cString, word, len) == 0) {
+          store(field, 1);
+          if (nChar)
+            *nChar = len;
+          return true;
+        }
+      }
+      for (const char* word : falses) {
+        size_t len = strlen(word);
+        if (strncasecmp(cString, word, len) == 0) {
+          store(field, 0);
+          if (nChar)
+            *nChar = len;
+          return true;
+        }
+      }
+    }
+
+    // Parse numeric values
+    char* endPtr;
+    long long intValue = strtoll(cString, &endPtr, 0);  // hex, octal, decimal
+
+    if (endPtr == cString) {
+      // Not a valid number
+      return false;
+    }
+    store(field, static_cast<Storage>(intValue));
+    if (nChar)
+      *nChar = endPtr - start;
+    return true;
+  }
+
+  /*!
+    @method clamp
+
+    Bring the field into [minimum, maximum]; either limit may be NULL.
+  */
+  static void clamp(void* field, const void* minimum, const void* maximum) {
+    if constexpr (isOrdered) {
+      Storage value = load(field);
+
+      if (minimum && value < load(minimum)) {
+        store(field, load(minimum));
+      } else if (maximum && value > load(maximum)) {
+        store(field, load(maximum));
+      }
+    }
+  }
+
+  /*!
+    @method encode
+
+    Append the CBOR item for the field at out + offset (if it fits in
+    outSize bytes) and return its length.
+  */
+  static size_t encode(const void* field,
+                       uint8_t* out,
+                       size_t outSize,
+                       size_t offset) {
+    Storage value = load(field);
+
+    if constexpr (Type == UVCTypeComponentType::Boolean) {
+      return UVCCborWriteHead(kUVCCborSimple,
+                              value ? kUVCCborTrue : kUVCCborFalse, out,
+                              outSize, offset);
+    } else if constexpr (std::is_signed_v<Storage>) {
+      if (value < 0) {
+        // CBOR negative integers carry -1 - value:
+        return UVCCborWriteHead(kUVCCborNegative,
+                                ~static_cast<uint64_t>(
+                                    static_cast<int64_t>(value)),
+                                out, outSize, offset);
+      }
+    }
+    return UVCCborWriteHead(kUVCCborUnsigned, static_cast<uint64_t>(value),
+                            out, outSize, offset);
+  }
+
+  /*!
+    @method decode
+
+    Decode the CBOR item at data + offset into field, advancing offset.
+    Returns false if the item is not an integer (or boolean) that fits in
+    the field.
+  */
+  static bool decode(const uint8_t* data,
+                     size_t length,
+                     size_t& offset,
+                     void* field) {
+    uint8_t majorType;
+    uint64_t argument;
+
+    if (!UVCCborReadHead(data, length, offset, majorType, argument)) {
+      return false;
+    }
+    if constexpr (Type == UVCTypeComponentType::Boolean) {
+      if (majorType == kUVCCborSimple &&
+          (argument == kUVCCborFalse || argument == kUVCCborTrue)) {
+        store(field, argument == kUVCCborTrue);
+        return true;
+      }
+      if (majorType == kUVCCborUnsigned && argument <= 1) {
+        store(field, static_cast<Storage>(argument));
+        return true;
+      }
+      return false;
+    } else {
+      constexpr uint64_t largest =
+          static_cast<uint64_t>(std::numeric_limits<Storage>::max());
+
+      if (majorType == kUVCCborUnsigned && argument <= largest) {
+        store(field, static_cast<Storage>(argument));
+        return true;
+      }
+      if constexpr (std::is_signed_v<Storage>) {
+        // The most negative value is -1 - largest:
+        if (majorType == kUVCCborNegative && argument <= largest) {
+          store(field,
+                static_cast<Storage>(-1 - static_cast<int64_t>(argument)));
+          return true;
+        }
+      }
+      return false;
+    }
+  }
+};
+
+using UVCComponentB = UVCComponent<UVCTypeComponentType::Boolean, uint8_t>;
+using UVCComponentS1 = UVCComponent<UVCTypeComponentType::SInt8, int8_t>;
+using UVCComponentU1 = UVCComponent<UVCTypeComponentType::UInt8, uint8_t>;
+using UVCComponentM1 = UVCComponent<UVCTypeComponentType::Bitmap8, uint8_t>;
+using UVCComponentS2 = UVCComponent<UVCTypeComponentType::SInt16, int16_t>;
+using UVCComponentU2 = UVCComponent<UVCTypeComponentType::UInt16, uint16_t>;
+using UVCComponentM2 = UVCComponent<UVCTypeComponentType::Bitmap16, uint16_t>;
+using UVCComponentS4 = UVCComponent<UVCTypeComponentType::SInt32, int32_t>;
+using UVCComponentU4 = UVCComponent<UVCTypeComponentType::UInt32, uint32_t>;
+using UVCComponentM4 = UVCComponent<UVCTypeComponentType::Bitmap32, uint32_t>;
+using UVCComponentS8 = UVCComponent<UVCTypeComponentType::SInt64, int64_t>;
+using UVCComponentU8 = UVCComponent<UVCTypeComponentType::UInt64, uint64_t>;
+using UVCComponentM8 = UVCComponent<UVCTypeComponentType::Bitmap64, uint64_t>;
+
+/*!
+  @function UVCComponentDispatch
+
+  Call operation with a value of the UVCComponent type matching
+  componentType; this is the single runtime switch used by the interpreted
+  UVCType paths.  Returns false (without calling operation) for an invalid
+  componentType.
+*/
+template <typename Operation>
+bool UVCComponentDispatch(UVCTypeComponentType componentType,
+                          Operation&& operation) {
+  switch (componentType) {
+    case UVCTypeComponentType::Boolean:
+      operation(UVCComponentB());
+      return true;
+    case UVCTypeComponentType::SInt8:
+      operation(UVCComponentS1());
+      return true;
+    case UVCTypeComponentType::UInt8:
+      operation(UVCComponentU1());
+      return true;
+    case UVCTypeComponentType::Bitmap8:
+      operation(UVCComponentM1());
+      return true;
+    case UVCTypeComponentType::SInt16:
+      operation(UVCComponentS2());
+      return true;
+    case UVCTypeComponentType::UInt16:
+      operation(UVCComponentU2());
+      return true;
+    case UVCTypeComponentType::Bitmap16:
+      operation(UVCComponentM2());
+      return true;
+    case UVCTypeComponentType::SInt32:
+      operation(UVCComponentS4());
+      return true;
+    case UVCTypeComponentType::UInt32:
+      operation(UVCComponentU4());
+      return true;
+    case UVCTypeComponentType::Bitmap32:
+      operation(UVCComponentM4());
+      return true;
+    case UVCTypeComponentType::SInt64:
+      operation(UVCComponentS8());
+      return true;
+    case UVCTypeComponentType::UInt64:
+      operation(UVCComponentU8());
+      return true;
+    case UVCTypeComponentType::Bitmap64:
+      operation(UVCComponentM8());
+      return true;
+    case UVCTypeComponentType::Max:
+    case UVCTypeComponentType::Invalid:
+      break;
+  }
+  return false;
+}
+
+/*!
+  @function UVCFormatText
+
+  Append text at outString + offset (as much as fits in outSize bytes,
+  NUL-terminated) and return its length.
+*/
+inline size_t UVCFormatText(const char* text,
+                            size_t textLength,
+                            char* outString,
+                            size_t outSize,
+                            size_t offset) {
+  if (offset + 1 < outSize) {
+    size_t copyLength = textLength < outSize - offset - 1
+                            ? textLength
+                            : outSize - offset - 1;
+    memcpy(outString + offset, text, copyLength);
+    outString[offset + copyLength] = '\0';
+  }
+  return textLength;
+}
+
+/*!
+  @function UVCFormatComponent
+
+  Append the textual form of a field at outString + offset (if it fits) and
+  return its length.
+*/
+template <class Component>
+size_t UVCFormatComponent(const uint8_t* field,
+                          char* outString,
+                          size_t outSize,
+                          size_t offset) {
+  return (offset < outSize)
+             ? Component::format(field, outString + offset, outSize - offset)
+             : Component::format(field, nullptr, 0);
+}
+
+/*!
+  @struct UVCLayoutCodec
+
+  Table of the operations of one UVCLayout, through which a UVCType whose
+  fields match the layout reaches the compiled code.  The buffer arguments
+  are packed data of the layout's byteSize.
+*/
+struct UVCLayoutCodec {
+  const UVCTypeComponentType* componentTypes;
+  size_t fieldCount;
+
+  size_t (*formatBuffer)(const UVCType& type,
+                         const void* buffer,
+                         char* outString,
+                         size_t outSize);
+  bool (*scanField)(size_t index,
+                    const char* cString,
+                    void* buffer,
+                    const void* minimum,
+                    const void* maximum,
+                    const void* defaultValue,
+                    size_t* nChar);
+  void (*byteSwap)(void* buffer);
+  bool (*isEqualBuffer)(const void* buffer, const void* otherBuffer);
+  void (*clampBuffer)(void* buffer, const void* minimum, const void* maximum);
+  size_t (*encodeBuffer)(const void* buffer, uint8_t* out, size_t outSize);
+  bool (*decodeBuffer)(const uint8_t* data,
+                       size_t length,
+                       void* buffer,
+                       size_t* consumed);
+};
+
+/*!
+  @struct UVCLayout
+  @abstract A fixed sequence of UVCComponent fields, e.g.
+            UVCLayout<UVCComponentS4, UVCComponentS4> for "{S4 pan; S4 tilt}".
+
+  Field offsets and the total size are compile-time constants, and every
+  operation is unrolled over the fields with no per-field switch.
+*/
+template <class... Components>
+struct UVCLayout {
+  static_assert(sizeof...(Components) > 0, "a layout needs at least one field");
+
+  template <size_t Index>
+  using Component = std::tuple_element_t<Index, std::tuple<Components...>>;
+
+  static constexpr size_t fieldCount = sizeof...(Components);
+  static constexpr size_t byteSize = (Components::byteSize + ...);
+  static constexpr UVCTypeComponentType componentTypes[] = {
+      Components::componentType...};
+  static constexpr std::array<size_t, fieldCount> offsets = []() {
+    constexpr size_t sizes[] = {Components::byteSize...};
+    std::array<size_t, fieldCount> fieldOffsets{};
+    size_t offset = 0;
+
+    for (size_t i = 0; i < fieldCount; i++) {
+      fieldOffsets[i] = offset;
+      offset += sizes[i];
+    }
+    return fieldOffsets;
+  }();
+
+  static const UVCLayoutCodec codec;
+
+  /*!
+    @method matches
+
+    Returns true if the fields of type have exactly this layout's types.
+  */
+  static bool matches(const UVCType& type) {
+    if (type.fieldCount() != fieldCount) {
+      return false;
+    }
+    for (size_t i = 0; i < fieldCount; i++) {
+      if (type.fieldTypeAtIndex(i) != componentTypes[i]) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  /*!
+    @method formatBuffer
+
+    Same as UVCType::formatBuffer for a type with this layout; the field names
+    are taken from type.
+  */
+  static size_t formatBuffer(const UVCType& type,
+                             const void* buffer,
+                             char* outString,
+                             size_t outSize) {
+    const uint8_t* bufferPtr = static_cast<const uint8_t*>(buffer);
+
+    if (outString && outSize) {
+      *outString = '\0';
+    } else {
+      outSize = 0;
+    }
+    if constexpr (fieldCount == 1) {
+      return UVCFormatComponent<Component<0>>(bufferPtr, outString, outSize,
+                                              0);
+    } else {
+      size_t offset = UVCFormatText("{", 1, outString, outSize, 0);
+
+      formatFields(type, bufferPtr, outString, outSize, offset,
+                   std::make_index_sequence<fieldCount>());
+      offset += UVCFormatText("}", 1, outString, outSize, offset);
+      return offset;
+    }
+  }
+
+  /*!
+    @method scanField
+
+    Parse the value of field index from cString into its place in buffer, as
+    UVCComponent::scan does.  minimum, maximum and defaultValue are whole
+    buffers (or NULL).
+  */
+  static bool scanField(size_t index,
+                        const char* cString,
+                        void* buffer,
+                        const void* minimum,
+                        const void* maximum,
+                        const void* defaultValue,
+                        size_t* nChar) {
+    return scanFieldAt(index, cString, static_cast<uint8_t*>(buffer),
+                       static_cast<const uint8_t*>(minimum),
+                       static_cast<const uint8_t*>(maximum),
+                       static_cast<const uint8_t*>(defaultValue), nChar,
+                       std::make_index_sequence<fieldCount>());
+  }
+
+  /*!
+    @method byteSwap
+
+    Convert every field of buffer between host and USB (little) endian.
+  */
+  static void byteSwap(void* buffer) {
+    swapFields(static_cast<uint8_t*>(buffer),
+               std::make_index_sequence<fieldCount>());
+  }
+
+  /*!
+    @method isEqualBuffer
+
+    Returns true if the two buffers hold the same data.
+  */
+  static bool isEqualBuffer(const void* buffer, const void* otherBuffer) {
+    return memcmp(buffer, otherBuffer, byteSize) == 0;
+  }
+
+  /*!
+    @method clampBuffer
+
+    Bring every ordered field of buffer into the range given by the
+    corresponding fields of minimum and maximum (either may be NULL).
+  */
+  static void clampBuffer(void* buffer,
+                          const void* minimum,
+                          const void* maximum) {
+    clampFields(static_cast<uint8_t*>(buffer),
+                static_cast<const uint8_t*>(minimum),
+                static_cast<const uint8_t*>(maximum),
+                std::make_index_sequence<fieldCount>());
+  }
+
+  /*!
+    @method encodeBuffer
+
+    Same as UVCType::encodeBuffer for a type with this layout.
+  */
+  static size_t encodeBuffer(const void* buffer, uint8_t* out, size_t outSize) {
+    const uint8_t* bufferPtr = static_cast<const uint8_t*>(buffer);
+    size_t offset = UVCCborWriteHead(kUVCCborMap, fieldCount, out, outSize, 0);
+
+    encodeFields(bufferPtr, out, outSize, offset,
+                 std::make_index_sequence<fieldCount>());
+    return offset;
+  }
+
+  /*!
+    @method decodeBuffer
+
+    Same as UVCType::decodeBuffer for a type with this layout.
+  */
+  static bool decodeBuffer(const uint8_t* data,
+                           size_t length,
+                           void* buffer,
+                           size_t* consumed) {
+    size_t offset = 0;
+    uint8_t majorType;
+    uint64_t entryCount, index;
+
+    if (!UVCCborReadHead(data, length, offset, majorType, entryCount) ||
+        majorType != kUVCCborMap) {
+      return false;
+    }
+    while (entryCount--) {
+      if (!UVCCborReadHead(data, length, offset, majorType, index) ||
+          majorType != kUVCCborUnsigned || index >= fieldCount ||
+          !decodeFieldAt(static_cast<size_t>(index), data, length, offset,
+                         static_cast<uint8_t*>(buffer),
+                         std::make_index_sequence<fieldCount>())) {
+        return false;
+      }
+    }
+    if (consumed) {
+      *consumed = offset;
+    }
+    return true;
+  }
+
+ private:
+  template <size_t... Index>
+  static void encodeFields(const uint8_t* bufferPtr,
+                           uint8_t* out,
+                           size_t outSize,
+                           size_t& offset,
+                           std::index_sequence<Index...>) {
+    ((offset += UVCCborWriteHead(kUVCCborUnsigned, Index, out, outSize,
+                                 offset),
+      offset += Component<Index>::encode(bufferPtr + offsets[Index], out,
+                                         outSize, offset)),
+     ...);
+  }
+
+  template <size_t... Index>
+  static bool decodeFieldAt(size_t index,
+                            const uint8_t* data,
+                            size_t length,
+                            size_t& offset,
+                            uint8_t* buffer,
+                            std::index_sequence<Index...>) {
+    bool isDecoded = false;
+
+    ((index == Index &&
+      (isDecoded = Component<Index>::decode(data, length, offset,
+                                            buffer + offsets[Index]),
+       true)) ||
+     ...);
+    return isDecoded;
+  }
+
+  template <size_t... Index>
+  static void formatFields(const UVCType& type,
+                           const uint8_t* bufferPtr,
+                           char* outString,
+                           size_t outSize,
+                           size_t& offset,
+                           std::index_sequence<Index...>) {
+    ((offset += formatField<Index>(type, bufferPtr, outString, outSize,
+                                   offset)),
+     ...);
+  }
+
+  template <size_t Index>
+  static size_t formatField(const UVCType& type,
+                            const uint8_t* bufferPtr,
+                            char* outString,
+                            size_t outSize,
+                            size_t offset) {
+    const auto& fieldName = type._fields[Index].fieldName;
+    size_t start = offset;
+
+    if constexpr (Index > 0) {
+      offset += UVCFormatText(",", 1, outString, outSize, offset);
+    }
+    offset += UVCFormatText(fieldName.data(), fieldName.size(), outString,
+                            outSize, offset);
+    offset += UVCFormatText("=", 1, outString, outSize, offset);
+    offset += UVCFormatComponent<Component<Index>>(
+        bufferPtr + offsets[Index], outString, outSize, offset);
+    return offset - start;
+  }
+
+  template <size_t... Index>
+  static bool scanFieldAt(size_t index,
+                          const char* cString,
+                          uint8_t* buffer,
+                          const uint8_t* minimum,
+                          const uint8_t* maximum,
+                          const uint8_t* defaultValue,
+                          size_t* nChar,
+                          std::index_sequence<Index...>) {
+    bool isScanned = false;
+
+    ((index == Index &&
+      (isScanned = Component<Index>::scan(
+           cString, buffer + offsets[Index],
+           minimum ? minimum + offsets[Index] : nullptr,
+           maximum ? maximum + offsets[Index] : nullptr,
+           defaultValue ? defaultValue + offsets[Index] : nullptr, nChar),
+       true)) ||
+     ...);
+    return isScanned;
+  }
+
+  template <size_t... Index>
+  static void swapFields(uint8_t* buffer, std::index_sequence<Index...>) {
+    (Component<Index>::byteSwap(buffer + offsets[Index]), ...);
+  }
+
+  template <size_t... Index>
+  static void clampFields(uint8_t* buffer,
+                          const uint8_t* minimum,
+                          const uint8_t* maximum,
+                          std::index_sequence<Index...>) {
+    (Component<Index>::clamp(buffer + offsets[Index],
+                             minimum ? minimum + offsets[Index] : nullptr,
+                             maximum ? maximum + offsets[Index] : nullptr),
+     ...);
+  }
+};
+
+template <class... Components>
+const UVCLayoutCodec UVCLayout<Components...>::codec = {
+    componentTypes, fieldCount,  formatBuffer, scanField,   byteSwap,
+    isEqualBuffer,  clampBuffer, encodeBuffer, decodeBuffer};
+
+/*!
+  @function UVCLayoutCodecForComponents
+
+  Returns the codec of the built-in layout with exactly the given component
+  types, or nullptr if there is none (the type is then interpreted).  The
+  built-in layouts cover every control signature uvc-util implements and all
+  single-field types.
+*/
+const UVCLayoutCodec* UVCLayoutCodecForComponents(
+    const UVCTypeComponentType* componentTypes,
+    size_t count);
@@ -0,0 +1,273 @@
+//
+// UVCProbeCache.cpp
+//
+// Persistent record of the controls a camera model failed to probe.
+//
+// Translated from Objective-C to C++
+// Copyright © 2016
+// Dr. Jeffrey Frey, IT-NSS
+// University of Delaware
+//
+// $Id$
+//
+
+#include "UVCProbeCache.hpp"
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+
+#include "UVCBasicController.hpp"
+#include "UVCDeviceLock.hpp"
+#include "UVCDiagnostics.hpp"
+
+static bool UVCProbeCacheMakeDirectory(const std::string& path) {
+  return mkdir(path.c_str(), 0755) == 0 || errno == EEXIST;
+}
+
+// $UVC_UTIL_CACHE_DIR, else a uvc-util directory in the user's cache
+// directory (created as needed); empty if there is none:
+static std::string UVCProbeCacheDirectory() {
+  const char* directory = getenv("UVC_UTIL_CACHE_DIR");
+  if (directory && *directory) {
+    return directory;
+  }
+
+  std::string path;
+  const char* home = getenv("HOME");
+#if defined(__APPLE__)
+  if (!home || !*home) {
+    return std::string();
+  }
+  path = std::string(home) + "/Library/Caches";
+#else
+  const char* cacheHome = getenv("XDG_CACHE_HOME");
+  if (cacheHome && *cacheHome) {
+    path = cacheHome;
+  } else if (home && *home) {
+    path = std::string(home) + "/.cache";
+    if (!UVCProbeCacheMakeDirectory(path)) {
+      return std::string();
+    }
+  } else {
+    return std::string();
+  }
+#endif
+  path += "/uvc-util";
+  return UVCProbeCacheMakeDirectory(path) ? path : std::string();
+}
+
+// FNV-1a, over the device release and the VideoControl descriptors:
+static uint64_t UVCProbeCacheModelHash(
+    const UVCDeviceIdentity& identity,
+    const std::vector<uint8_t>& videoControlDescriptors) {
+  uint64_t hash = 0xcbf29ce484222325ULL;
+  auto mix = [&hash](uint8_t byte) {
+    hash = (hash ^ byte) * 0x100000001b3ULL;
+  };
+
+  mix(static_cast<uint8_t>(identity.bcdDevice >> 8));
+  mix(static_cast<uint8_t>(identity.bcdDevice));
+  for (uint8_t byte : videoControlDescriptors) {
+    mix(byte);
+  }
+  return hash;
+}
+
+std::shared_ptr<UVCProbeCache> UVCProbeCache::createForDevice(
+    const UVCDeviceIdentity& identity,
+    const std::vector<uint8_t>& videoControlDescriptors,
+    const char* directory,
+    const UVCProbeCachePolicy& policy) {
+  std::string path = directory ? directory : UVCProbeCacheDirectory();
+  char name[64];
+
+  if (path.empty()) {
+    UVC_DIAGNOSTIC(Debug, General, "No directory for the probe cache of %s",
+                   identity.deviceName.c_str());
+    return nullptr;
+  }
+  snprintf(name, sizeof(name), "/uvc-util-probe-%04x-%04x-%016llx.cache",
+           identity.vendorId, identity.productId,
+           static_cast<unsigned long long>(
+               UVCProbeCacheModelHash(identity, videoControlDescriptors)));
+  path += name;
+  return std::make_shared<UVCProbeCache>(path, policy);
+}
+
+UVCProbeCache::UVCProbeCache(const std::string& path,
+                             const UVCProbeCachePolicy& policy)
+    : _path(path),
+      _policy(policy),
+      _entries(std::size(uvcControlDefinitions)),
+      _isChanged(false),
+      _reprobes(false) {
+  load(_entries);
+}
+
+UVCProbeCache::~UVCProbeCache() {
+  save();
+}
+
+const std::string& UVCProbeCache::path() const {
+  return _path;
+}
+
+void UVCProbeCache::setReprobes(bool reprobes) {
+  _reprobes = reprobes;
+}
+
+bool UVCProbeCache::reprobes() const {
+  return _reprobes;
+}
+
+bool UVCProbeCache::isKnownToFail(size_t controlId,
+                                  UVCTransferStatus* reason) const {
+  if (_reprobes || controlId >= _entries.size() ||
+      _entries[controlId].expires <= time(nullptr)) {
+    return false;
+  }
+  if (reason) {
+    *reason = _entries[controlId].reason;
+  }
+  return true;
+}
+
+void UVCProbeCache::recordFailure(size_t controlId, UVCTransferStatus status) {
+  uint32_t ttlSeconds;
+
+  switch (status) {
+    case UVCTransferStatus::Stall:
+      ttlSeconds = _policy.stallTtlSeconds;
+      break;
+    case UVCTransferStatus::Timeout:
+      ttlSeconds = _policy.timeoutTtlSeconds;
+      break;
+    default:
+      return;
+  }
+  if (!ttlSeconds || controlId >= _entries.size()) {
+    return;
+  }
+
+  Entry& entry = _entries[controlId];
+  entry.reason = status;
+  entry.expires = time(nullptr) + ttlSeconds;
+  entry.isChanged = _isChanged = true;
+}
+
+void UVCProbeCache::recordSuccess(size_t controlId) {
+  if (controlId >= _entries.size() || !_entries[controlId].expires) {
+    return;
+  }
+
+  Entry& entry = _entries[controlId];
+  entry.expires = 0;
+  entry.isChanged = _isChanged = true;
+}
+
+// Each line names a control, how its probe failed and when that is forgotten
+// (seconds since the epoch); expired and unknown entries are skipped:
+void UVCProbeCache::load(std::vector<Entry>& entries) const {
+  FILE* file = fopen(_path.c_str(), "r");
+  if (!file) {
+    return;
+  }
+
+  char line[128], controlName[64], reasonName[16];
+  long long expires;
+  time_t now = time(nullptr);
+
+  while (fgets(line, sizeof(line), file)) {
+    if (line[0] == '#' ||
+        sscanf(line, "%63s %15s %lld", controlName, reasonName, &expires) !=
+            3 ||
+        expires <= now) {
+      continue;
+    }
+
+    auto controlDef = std::find_if(
+        std::begin(uvcControlDefinitions), std::end(uvcControlDefinitions),
+        [&controlName](const UVCControlDef& def) {
+          return strcmp(def.name, controlName) == 0;
+        });
+    if (controlDef == std::end(uvcControlDefinitions)) {
+      continue;
+    }
+
+    Entry& entry = entries[controlDef - std::begin(uvcControlDefinitions)];
+    if (strcmp(reasonName, UVCTransferStatusString(
+                               UVCTransferStatus::Stall)) == 0) {
+      entry.reason = UVCTransferStatus::Stall;
+    } else if (strcmp(reasonName, UVCTransferStatusString(
+                                      UVCTransferStatus::Timeout)) == 0) {
+      entry.reason = UVCTransferStatus::Timeout;
+    } else {
+      continue;
+    }
+    entry.expires = static_cast<time_t>(expires);
+  }
+  fclose(file);
+}
+
+bool UVCProbeCache::save() {
+  if (!_isChanged) {
+    return true;
+  }
+
+  // Merge with what other processes wrote since this one loaded the file,
+  // holding off the others until the new file is in place:
+  UVCDeviceLock fileLock(_path + ".lock");
+  UVCDeviceLockGuard lockGuard(&fileLock, UVCLockMode::Exclusive);
+  if (!lockGuard) {
+    UVC_DIAGNOSTIC(Warning, General, "Timed out waiting to update %s",
+                   _path.c_str());
+    return false;
+  }
+
+  std::vector<Entry> entries(_entries.size());
+  load(entries);
+  for (size_t controlId = 0; controlId < _entries.size(); controlId++) {
+    if (_entries[controlId].isChanged) {
+      entries[controlId] = _entries[controlId];
+    }
+  }
+
+  std::string temporaryPath =
+      _path + ".tmp." + std::to_string(static_cast<long>(getpid()));
+  FILE* file = fopen(temporaryPath.c_str(), "w");
+  if (!file) {
+    UVC_DIAGNOSTIC(Warning, General, "Unable to write %s: %s",
+                   temporaryPath.c_str(), strerror(errno));
+    return false;
+  }
+
+  time_t now = time(nullptr);
+
+  fprintf(file, "# uvc-util probe cache:  control, failure, expiry\n");
+  for (size_t controlId = 0; controlId < entries.size(); controlId++) {
+    if (entries[controlId].expires > now) {
+      fprintf(file, "%s %s %lld\n", uvcControlDefinitions[controlId].name,
+              UVCTransferStatusString(entries[controlId].reason),
+              static_cast<long long>(entries[controlId].expires));
+    }
+  }
+  if (fclose(file) != 0 || rename(temporaryPath.c_str(), _path.c_str()) != 0) {
+    UVC_DIAGNOSTIC(Warning, General, "Unable to write %s: %s", _path.c_str(),
+                   strerror(errno));
+    unlink(temporaryPath.c_str());
+    return false;
+  }
+
+  for (Entry& entry : _entries) {
+    entry.isChanged = false;
+  }
+  _isChanged = false;
+  return true;
+}
@@ -0,0 +1,136 @@
+//
+// UVCProbeCache.hpp
+//
+// Persistent record of the controls a camera model failed to probe.
+//
+// Translated from Objective-C to C++
+// Copyright © 2016
+// Dr. Jeffrey Frey, IT-NSS
+// University of Delaware
+//
+// $Id$
+//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "UVCTransport.hpp"
+
+/*!
+  @struct UVCProbeCachePolicy
+
+  How long a failed probe is remembered, by the way it failed (zero = not
+  remembered).  A stall is the firmware saying the control is not there; a
+  timeout says as much about the camera as about the control, and since the
+  cache is shared by every camera of the model, one wedged camera would hide
+  its controls on all the others, so timeouts are not remembered by default.
+*/
+struct UVCProbeCachePolicy {
+  uint32_t stallTtlSeconds = 30 * 24 * 3600;
+  uint32_t timeoutTtlSeconds = 0;
+};
+
+/*!
+  @class UVCProbeCache
+  @abstract Controls of a camera model known to fail their GET_INFO probe.
+
+  Entries are kept per model in a file named after the vendor and product
+  id and a hash of the device release and VideoControl descriptors, so
+  cameras of the same model share them and a firmware update starts
+  afresh.  Files are placed in $UVC_UTIL_CACHE_DIR, or a uvc-util
+  directory in the user's cache directory.
+
+  Changes are written back by save() (and on destruction), merged with what
+  other processes may have written in the meantime.  Not thread-safe.
+*/
+class UVCProbeCache {
+ private:
+  struct Entry {
+    UVCTransferStatus reason = UVCTransferStatus::Stall;
+    time_t expires = 0;
+    bool isChanged = false;
+  };
+
+  std::string _path;
+  UVCProbeCachePolicy _policy;
+  // Indexed by control id; an entry that has not expired is a known failure:
+  std::vector<Entry> _entries;
+  bool _isChanged;
+  bool _reprobes;
+
+ public:
+  /*!
+    @method createForDevice
+
+    Returns a shared_ptr to the cache for the model with the given identity
+    and VideoControl descriptors, in directory if not nullptr.  Returns
+    nullptr if no cache directory can be created.
+  */
+  static std::shared_ptr<UVCProbeCache> createForDevice(
+      const UVCDeviceIdentity& identity,
+      const std::vector<uint8_t>& videoControlDescriptors,
+      const char* directory = nullptr,
+      const UVCProbeCachePolicy& policy = UVCProbeCachePolicy());
+
+  UVCProbeCache(const std::string& path, const UVCProbeCachePolicy& policy);
+  ~UVCProbeCache();
+
+  // Delete copy constructor and assignment operator
+  UVCProbeCache(const UVCProbeCache&) = delete;
+  UVCProbeCache& operator=(const UVCProbeCache&) = delete;
+
+  const std::string& path() const;
+
+  /*!
+    @method setReprobes
+
+    When set, entries are not consulted (every control is probed) but are
+    still updated by the outcome of the probes.
+  */
+  void setReprobes(bool reprobes);
+  bool reprobes() const;
+
+  /*!
+    @method isKnownToFail
+
+    Returns true if the control failed its probe within its time to live,
+    setting reason (if not nullptr) to how it failed.  Always false while
+    reprobing.
+  */
+  bool isKnownToFail(size_t controlId,
+                     UVCTransferStatus* reason = nullptr) const;
+
+  /*!
+    @method recordFailure
+
+    Remember that the control's probe failed with status, for as long as the
+    policy says.  Only stalls and timeouts can be remembered; other failures
+    (the device gone, a transfer rejected by a circuit breaker) say nothing
+    about the control.
+  */
+  void recordFailure(size_t controlId, UVCTransferStatus status);
+
+  /*!
+    @method recordSuccess
+
+    Forget any failure of the control.
+  */
+  void recordSuccess(size_t controlId);
+
+  /*!
+    @method save
+
+    Write changed entries to the cache file.  Returns false if it could not
+    be written.
+  */
+  bool save();
+
+ private:
+  void load(std::vector<Entry>& entries) const;
+};
@@ -0,0 +1,108 @@
+//
+// UVCProtocol.hpp
+//
+// USB Video Class (UVC) protocol constants shared by the controller and the
+// transports that carry its control requests.
+//
+// Translated from Objective-C to C++
+// Copyright © 2016
+// Dr. Jeffrey Frey, IT-NSS
+// University of Delaware
+//
+// $Id$
+//
+
+#pragma once
+
+#include <cstdint>
+
+// UVC Class and Subclass definitions
+#define UVC_INTERFACE_CLASS 14
+#define UVC_INTERFACE_SUBCLASS_CONTROL 1
+#define UVC_INTERFACE_SUBCLASS_STREAMING 2
+
+// UVC Control Selectors
+#define UVC_VC_CONTROL_UNDEFINED 0x00
+#define UVC_VC_VIDEO_POWER_MODE_CONTROL 0x01
+#define UVC_VC_REQUEST_ERROR_CODE_CONTROL 0x02
+
+// Processing Unit Control Selectors
+#define UVC_PU_CONTROL_UNDEFINED 0x00
+#define UVC_PU_BACKLIGHT_COMPENSATION_CONTROL 0x01
+#define UVC_PU_BRIGHTNESS_CONTROL 0x02
+#define UVC_PU_CONTRAST_CONTROL 0x03
+#define UVC_PU_GAIN_CONTROL 0x04
+#define UVC_PU_POWER_LINE_FREQUENCY_CONTROL 0x05
+#define UVC_PU_HUE_CONTROL 0x06
+#define UVC_PU_SATURATION_CONTROL 0x07
+#define UVC_PU_SHARPNESS_CONTROL 0x08
+#define UVC_PU_GAMMA_CONTROL 0x09
+#define UVC_PU_WHITE_BALANCE_TEMPERATURE_CONTROL 0x0A
+#define UVC_PU_WHITE_BALANCE_TEMPERATURE_AUTO_CONTROL 0x0B
+#define UVC_PU_WHITE_BALANCE_COMPONENT_CONTROL 0x0C
+#define UVC_PU_WHITE_BALANCE_COMPONENT_AUTO_CONTROL 0x0D
+#define UVC_PU_DIGITAL_MULTIPLIER_CONTROL 0x0E
+#define UVC_PU_DIGITAL_MULTIPLIER_LIMIT_CONTROL 0x0F
+#define UVC_PU_HUE_AUTO_CONTROL 0x10
+#define UVC_PU_ANALOG_VIDEO_STANDARD_CONTROL 0x11
+#define UVC_PU_ANALOG_LOCK_STATUS_CONTROL 0x12
+
+// Camera Terminal Control Selectors
+#define UVC_CT_CONTROL_UNDEFINED 0x00
+#define UVC_CT_SCANNING_MODE_CONTROL 0x01
+#define UVC_CT_AE_MODE_CONTROL 0x02
+#define UVC_CT_AE_PRIORITY_CONTROL 0x03
+#define UVC_CT_EXPOSURE_TIME_ABSOLUTE_CONTROL 0x04
+#define UVC_CT_EXPOSURE_TIME_RELATIVE_CONTROL 0x05
+#define UVC_CT_FOCUS_ABSOLUTE_CONTROL 0x06
+#define UVC_CT_FOCUS_RELATIVE_CONTROL 0x07
+#define UVC_CT_FOCUS_AUTO_CONTROL 0x08
+#define UVC_CT_IRIS_ABSOLUTE_CONTROL 0x09
+#define UVC_CT_IRIS_RELATIVE_CONTROL 0x0A
+#define UVC_CT_ZOOM_ABSOLUTE_CONTROL 0x0B
+#define UVC_CT_ZOOM_RELATIVE_CONTROL 0x0C
+#define UVC_CT_PANTILT_ABSOLUTE_CONTROL 0x0D
+#define UVC_CT_PANTILT_RELATIVE_CONTROL 0x0E
+#define UVC_CT_ROLL_ABSOLUTE_CONTROL 0x0F
+#define UVC_CT_ROLL_RELATIVE_CONTROL 0x10
+#define UVC_CT_PRIVACY_CONTROL 0x11
+
+// UVC Request Types
+#define UVC_SET_CUR 0x01
+#define UVC_GET_CUR 0x81
+#define UVC_GET_MIN 0x82
+#define UVC_GET_MAX 0x83
+#define UVC_GET_RES 0x84
+#define UVC_GET_LEN 0x85
+#define UVC_GET_INFO 0x86
+#define UVC_GET_DEF 0x87
+
+// bmRequestType for class-specific requests addressed to an interface
+#define UVC_REQUEST_TYPE_SET 0x21  // host-to-device | class | interface
+#define UVC_REQUEST_TYPE_GET 0xA1  // device-to-host | class | interface
+
+// UVC Unit Types
+#define UVC_VC_INPUT_TERMINAL 0x02
+#define UVC_VC_OUTPUT_TERMINAL 0x03
+#define UVC_VC_SELECTOR_UNIT 0x04
+#define UVC_VC_PROCESSING_UNIT 0x05
+#define UVC_VC_EXTENSION_UNIT 0x06
+#define UVC_VC_ENCODING_UNIT 0x07
+
+// UVC descriptor constants (from original Objective-C code)
+#define CS_INTERFACE 0x24
+#define VC_HEADER 0x01
+#define VC_INPUT_TERMINAL 0x02
+#define VC_OUTPUT_TERMINAL 0x03
+#define VC_PROCESSING_UNIT 0x05
+
+// Terminal types
+#define UVC_ITT_CAMERA 0x0201
+#define UVC_TT_STREAMING 0x0101
+
+// UVC descriptor header structure
+struct UVC_Descriptor_Header {
+  uint8_t bLength;
+  uint8_t bDescriptorType;
+  uint8_t bDescriptorSubType;
+} __attribute__((packed));
@@ -0,0 +1,297 @@
+//
+// UVCQuirks.cpp
+//
+// Per-model workarounds for cameras that misreport or mishandle controls.
+//
+// Translated from Objective-C to C++
+// Copyright © 2016
+// Dr. Jeffrey Frey, IT-NSS
+// University of Delaware
+//
+// $Id$
+//
+
+#include "UVCQuirks.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <iterator>
+#include <mutex>
+
+#include "UVCBasicController.hpp"
+#include "UVCDiagnostics.hpp"
+#include "UVCValue.hpp"
+
+// Known-bad models, sorted by vendor id, product id and device release (the
+// order is checked at compile time).  Only models whose misbehaviour has
+// been verified on the hardware belong here; none has been yet.
+static constexpr std::array<UVCQuirk, 0> kUVCBuiltInQuirks = {};
+
+static constexpr bool UVCQuirkPrecedes(const UVCQuirk& a, const UVCQuirk& b) {
+  return a.vendorId != b.vendorId     ? a.vendorId < b.vendorId
+         : a.productId != b.productId ? a.productId < b.productId
+                                      : a.bcdDevice < b.bcdDevice;
+}
+
+static constexpr bool UVCQuirksAreSorted(const UVCQuirk* quirks,
+                                         size_t count) {
+  for (size_t i = 1; i < count; i++) {
+    if (UVCQuirkPrecedes(quirks[i], quirks[i - 1])) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static_assert(UVCQuirksAreSorted(kUVCBuiltInQuirks.data(),
+                                 kUVCBuiltInQuirks.size()),
+              "kUVCBuiltInQuirks must be sorted by vendor, product, release");
+
+// Entries loaded from quirks files, and the text their pointers refer to:
+static std::mutex uvcQuirksFileLock;
+static std::vector<UVCQuirk> uvcQuirksFromFiles;
+static std::deque<std::string> uvcQuirksStrings;
+
+const UVCQuirk* UVCBuiltInQuirks(size_t& count) {
+  count = kUVCBuiltInQuirks.size();
+  return kUVCBuiltInQuirks.data();
+}
+
+static void UVCApplyQuirk(const UVCQuirk& quirk,
+                          const UVCDeviceIdentity& identity,
+                          UVCDeviceQuirks& quirks) {
+  if (quirk.bcdDevice && quirk.bcdDevice != identity.bcdDevice) {
+    return;
+  }
+  if (quirk.maxInFlight) {
+    quirks.maxInFlight = quirk.maxInFlight;
+  }
+  if (!quirk.flags && !quirk.minimum && !quirk.maximum && !quirk.stepSize &&
+      !quirk.settleMicros) {
+    return;
+  }
+  if (quirks.controls.empty()) {
+    quirks.controls.resize(std::size(uvcControlDefinitions));
+  }
+  for (size_t controlId = 0; controlId < quirks.controls.size();
+       controlId++) {
+    if (quirk.control &&
+        strcmp(quirk.control, uvcControlDefinitions[controlId].name) != 0) {
+      continue;
+    }
+
+    UVCControlQuirks& control = quirks.controls[controlId];
+    control.flags |= quirk.flags;
+    control.minimum = quirk.minimum ? quirk.minimum : control.minimum;
+    control.maximum = quirk.maximum ? quirk.maximum : control.maximum;
+    control.stepSize = quirk.stepSize ? quirk.stepSize : control.stepSize;
+    if (quirk.settleMicros) {
+      control.settleMicros = quirk.settleMicros;
+    }
+  }
+}
+
+UVCDeviceQuirks UVCLookupQuirks(const UVCDeviceIdentity& identity) {
+  static std::once_flag environmentLoaded;
+  UVCDeviceQuirks quirks;
+  UVCQuirk key = {};
+
+  std::call_once(environmentLoaded, []() {
+    const char* path = getenv("UVC_UTIL_QUIRKS");
+    if (path && *path) {
+      UVCLoadQuirksFile(path);
+    }
+  });
+
+  key.vendorId = identity.vendorId;
+  key.productId = identity.productId;
+  auto range = std::equal_range(
+      kUVCBuiltInQuirks.begin(), kUVCBuiltInQuirks.end(), key,
+      [](const UVCQuirk& a, const UVCQuirk& b) {
+        return a.vendorId != b.vendorId ? a.vendorId < b.vendorId
+                                        : a.productId < b.productId;
+      });
+  for (auto quirk = range.first; quirk != range.second; quirk++) {
+    UVCApplyQuirk(*quirk, identity, quirks);
+  }
+
+  std::lock_guard<std::mutex> guard(uvcQuirksFileLock);
+  for (const UVCQuirk& quirk : uvcQuirksFromFiles) {
+    if (quirk.vendorId == identity.vendorId &&
+        quirk.productId == identity.productId) {
+      UVCApplyQuirk(quirk, identity, quirks);
+    }
+  }
+  if (quirks.maxInFlight || !quirks.controls.empty()) {
+    UVC_DIAGNOSTIC(Info, Enumeration, "Applying quirks for %04x:%04x (%s)",
+                   identity.vendorId, identity.productId,
+                   identity.deviceName.c_str());
+  }
+  return quirks;
+}
+
+// Check that text is a valid value for the named control:
+static bool UVCQuirkValueIsValid(const char* controlName, const char* text) {
+  for (const auto& controlDef : uvcControlDefinitions) {
+    if (strcmp(controlName, controlDef.name) == 0) {
+      auto value = UVCValue::create(
+          UVCType::createFromCString(controlDef.typeSignature));
+      return value && value->scanCString(text, UVCTypeScanFlags(0));
+    }
+  }
+  return false;
+}
+
+// Parse one line of a quirks file into quirk, keeping its text in strings;
+// on failure error says why:
+static bool UVCParseQuirkLine(char* line,
+                              UVCQuirk& quirk,
+                              std::deque<std::string>& strings,
+                              const char*& error) {
+  char* context = nullptr;
+  char* device = strtok_r(line, " \t", &context);
+  char* control = strtok_r(nullptr, " \t", &context);
+  unsigned vendorId, productId, bcdDevice = 0;
+
+  quirk = UVCQuirk();
+  error = "malformed quirk";
+  if (!device || !control ||
+      sscanf(device, "%x:%x:%x", &vendorId, &productId, &bcdDevice) < 2 ||
+      vendorId > 0xFFFF || productId > 0xFFFF || bcdDevice > 0xFFFF) {
+    return false;
+  }
+  quirk.vendorId = static_cast<uint16_t>(vendorId);
+  quirk.productId = static_cast<uint16_t>(productId);
+  quirk.bcdDevice = static_cast<uint16_t>(bcdDevice);
+
+  if (strcmp(control, "*") != 0) {
+    auto controlDef = std::find_if(
+        std::begin(uvcControlDefinitions), std::end(uvcControlDefinitions),
+        [control](const UVCControlDef& def) {
+          return strcmp(def.name, control) == 0;
+        });
+    if (controlDef == std::end(uvcControlDefinitions)) {
+      error = "unknown control";
+      return false;
+    }
+    quirk.control = controlDef->name;
+  }
+
+  char* setting;
+  while ((setting = strtok_r(nullptr, " \t", &context))) {
+    char* value = strchr(setting, '=');
+    const char** text = nullptr;
+
+    if (value) {
+      *value++ = '\0';
+    }
+    if (strcmp(setting, "disable") == 0 && !value) {
+      quirk.flags |= kUVCQuirkDisable;
+    } else if (strcmp(setting, "no-get-res") == 0 && !value) {
+      quirk.flags |= kUVCQuirkNoGetRes;
+    } else if (strcmp(setting, "minimum") == 0 && value) {
+      text = &quirk.minimum;
+    } else if (strcmp(setting, "maximum") == 0 && value) {
+      text = &quirk.maximum;
+    } else if (strcmp(setting, "step") == 0 && value) {
+      text = &quirk.stepSize;
+    } else if (strcmp(setting, "max-in-flight") == 0 && value) {
+      quirk.maxInFlight = static_cast<uint8_t>(
+          std::min<unsigned long>(strtoul(value, nullptr, 0), 255));
+    } else if (strcmp(setting, "settle-us") == 0 && value) {
+      quirk.settleMicros = static_cast<uint32_t>(strtoul(value, nullptr, 0));
+    } else if (strcmp(setting, "disable") == 0 ||
+               strcmp(setting, "no-get-res") == 0) {
+      error = "setting takes no value";
+      return false;
+    } else if (strcmp(setting, "minimum") == 0 ||
+               strcmp(setting, "maximum") == 0 ||
+               strcmp(setting, "step") == 0 ||
+               strcmp(setting, "max-in-flight") == 0 ||
+               strcmp(setting, "settle-us") == 0) {
+      error = "setting needs a value";
+      return false;
+    } else {
+      error = "unknown setting";
+      return false;
+    }
+
+    if (text) {
+      // Controls' values differ in type, so one value cannot fit them all:
+      if (!quirk.control) {
+        error = "minimum, maximum and step need a control, not *";
+        return false;
+      }
+      if (!UVCQuirkValueIsValid(quirk.control, value)) {
+        error = "value does not fit the control";
+        return false;
+      }
+      strings.emplace_back(value);
+      *text = strings.back().c_str();
+    }
+  }
+  return true;
+}
+
+bool UVCLoadQuirksFile(const std::string& path) {
+  FILE* file = fopen(path.c_str(), "r");
+  if (!file) {
+    UVC_DIAGNOSTIC(Error, Parse, "Unable to open quirks file %s",
+                   path.c_str());
+    return false;
+  }
+
+  std::vector<UVCQuirk> quirks;
+  std::deque<std::string> strings;
+  char* line = nullptr;
+  size_t lineCapacity = 0;
+  ssize_t lineLength;
+  int lineNumber = 0;
+  bool isValid = true;
+
+  while (isValid && (lineLength = getline(&line, &lineCapacity, file)) >= 0) {
+    lineNumber++;
+    while (lineLength > 0 &&
+           (line[lineLength - 1] == '\n' || line[lineLength - 1] == '\r')) {
+      line[--lineLength] = '\0';
+    }
+    char first = line[strspn(line, " \t")];
+    if (first == '\0' || first == '#') {
+      continue;
+    }
+
+    UVCQuirk quirk;
+    const char* error;
+    isValid = UVCParseQuirkLine(line, quirk, strings, error);
+    if (isValid) {
+      quirks.push_back(quirk);
+    } else {
+      UVC_DIAGNOSTIC(Error, Parse, "%s:%d: %s", path.c_str(), lineNumber,
+                     error);
+    }
+  }
+  free(line);
+  fclose(file);
+  if (!isValid) {
+    return false;
+  }
+
+  // Re-point the entries at copies of their text that live as long as they
+  // do; std::deque keeps those where they are as more are added:
+  std::lock_guard<std::mutex> guard(uvcQuirksFileLock);
+  for (UVCQuirk& quirk : quirks) {
+    for (const char** text :
+         {&quirk.minimum, &quirk.maximum, &quirk.stepSize}) {
+      if (*text) {
+        uvcQuirksStrings.emplace_back(*text);
+        *text = uvcQuirksStrings.back().c_str();
+      }
+    }
+    uvcQuirksFromFiles.push_back(quirk);
+  }
+  return true;
+}
@@ -0,0 +1,129 @@
+//
+// UVCQuirks.hpp
+//
+// Per-model workarounds for cameras that misreport or mishandle controls.
+//
+// Translated from Objective-C to C++
+// Copyright © 2016
+// Dr. Jeffrey Frey, IT-NSS
+// University of Delaware
+//
+// $Id$
+//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "UVCTransport.hpp"
+
+/*!
+  @enum UVCQuirkFlags
+
+  Workarounds applied to a control:
+
+    kUVCQuirkDisable   the control is treated as absent and never probed
+    kUVCQuirkNoGetRes  GET_RES is never sent (the control has no step size
+                       unless one is given)
+*/
+enum UVCQuirkFlags : uint32_t {
+  kUVCQuirkDisable = 1 << 0,
+  kUVCQuirkNoGetRes = 1 << 1
+};
+
+/*!
+  @struct UVCQuirk
+
+  One entry of the quirks table.  It applies to devices with the given
+  vendor and product id and, unless bcdDevice is zero, that device release.
+  control names the control it applies to, or is nullptr for all of them.
+
+    flags         UVCQuirkFlags
+    minimum       textual values (as accepted by UVCValue::scanCString)
+    maximum       replacing what the device reports; when both minimum and
+    stepSize      maximum are given, GET_MIN and GET_MAX are not sent
+    maxInFlight   most control transfers handed to the device at once
+                  (zero = no limit); device-wide
+    settleMicros  time the device needs after a SET_CUR before it handles
+                  another request
+*/
+struct UVCQuirk {
+  uint16_t vendorId;
+  uint16_t productId;
+  uint16_t bcdDevice;
+  const char* control;
+  uint32_t flags;
+  const char* minimum;
+  const char* maximum;
+  const char* stepSize;
+  uint8_t maxInFlight;
+  uint32_t settleMicros;
+};
+
+/*!
+  @struct UVCControlQuirks
+
+  The workarounds that apply to one control of a device.
+*/
+struct UVCControlQuirks {
+  uint32_t flags = 0;
+  const char* minimum = nullptr;
+  const char* maximum = nullptr;
+  const char* stepSize = nullptr;
+  uint32_t settleMicros = 0;
+};
+
+/*!
+  @struct UVCDeviceQuirks
+
+  The workarounds that apply to a device, as returned by UVCLookupQuirks.
+  controls is indexed by control id, and empty if no control has any.
+*/
+struct UVCDeviceQuirks {
+  uint8_t maxInFlight = 0;
+  std::vector<UVCControlQuirks> controls;
+
+  // The control's workarounds, or nullptr if it has none:
+  const UVCControlQuirks* forControl(size_t controlId) const {
+    return controlId < controls.size() ? &controls[controlId] : nullptr;
+  }
+};
+
+/*!
+  @function UVCLookupQuirks
+
+  Collect the workarounds for the device with the given identity and device
+  release:  the built-in entries first, then those loaded from files (which
+  take precedence).  The file named by $UVC_UTIL_QUIRKS, if set, is loaded
+  on the first lookup.
+*/
+UVCDeviceQuirks UVCLookupQuirks(const UVCDeviceIdentity& identity);
+
+/*!
+  @function UVCLoadQuirksFile
+
+  Add the entries of a quirks file to those consulted by UVCLookupQuirks.
+  Each line holds a device, a control and the workarounds for it:
+
+    <vendor-id>:<product-id>[:<bcdDevice>] (<control-name>|*) <setting> ...
+
+  with ids in hexadecimal and settings among disable, no-get-res,
+  minimum=<value>, maximum=<value>, step=<value>, max-in-flight=<count> and
+  settle-us=<microseconds>; minimum, maximum and step need a control name.
+  Blank lines and those starting with '#' are ignored.
+
+  Returns false (adding nothing) if the file cannot be read or a line cannot
+  be parsed.
+*/
+bool UVCLoadQuirksFile(const std::string& path);
+
+/*!
+  @function UVCBuiltInQuirks
+
+  Returns the built-in table, sorted by vendor id, product id and device
+  release, and sets count to the number of entries.
+*/
+const UVCQuirk* UVCBuiltInQuirks(size_t& count);
@@ -0,0 +1,737 @@
+//
+// UVCSimulatedTransport.cpp
+//
+// UVCTransport implementation that models a UVC camera in memory.
+//
+// Translated from Objective-C to C++
+// Copyright © 2016
+// Dr. Jeffrey Frey, IT-NSS
+// University of Delaware
+//
+// $Id$
+//
+
+#include "UVCSimulatedTransport.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <thread>
+
+#include "UVCProtocol.hpp"
+#include "UVCType.hpp"
+
+// bmControls bit for each Processing Unit selector (UVC 1.5, table 3-8);
+// -1 marks selectors without a bit.
+static const int processingUnitControlBits[] = {
+    -1,  // UVC_PU_CONTROL_UNDEFINED
+    8,   // UVC_PU_BACKLIGHT_COMPENSATION_CONTROL
+    0,   // UVC_PU_BRIGHTNESS_CONTROL
+    1,   // UVC_PU_CONTRAST_CONTROL
+    9,   // UVC_PU_GAIN_CONTROL
+    10,  // UVC_PU_POWER_LINE_FREQUENCY_CONTROL
+    2,   // UVC_PU_HUE_CONTROL
+    3,   // UVC_PU_SATURATION_CONTROL
+    4,   // UVC_PU_SHARPNESS_CONTROL
+    5,   // UVC_PU_GAMMA_CONTROL
+    6,   // UVC_PU_WHITE_BALANCE_TEMPERATURE_CONTROL
+    12,  // UVC_PU_WHITE_BALANCE_TEMPERATURE_AUTO_CONTROL
+    7,   // UVC_PU_WHITE_BALANCE_COMPONENT_CONTROL
+    13,  // UVC_PU_WHITE_BALANCE_COMPONENT_AUTO_CONTROL
+    14,  // UVC_PU_DIGITAL_MULTIPLIER_CONTROL
+    15,  // UVC_PU_DIGITAL_MULTIPLIER_LIMIT_CONTROL
+    11,  // UVC_PU_HUE_AUTO_CONTROL
+    16,  // UVC_PU_ANALOG_VIDEO_STANDARD_CONTROL
+    17,  // UVC_PU_ANALOG_LOCK_STATUS_CONTROL
+    18   // UVC_PU_CONTRAST_AUTO_CONTROL
+};
+
+// bmControls bit for each Camera Terminal selector (UVC 1.5, table 3-6):
+static const int cameraTerminalControlBits[] = {
+    -1,  // UVC_CT_CONTROL_UNDEFINED
+    0,   // UVC_CT_SCANNING_MODE_CONTROL
+    1,   // UVC_CT_AE_MODE_CONTROL
+    2,   // UVC_CT_AE_PRIORITY_CONTROL
+    3,   // UVC_CT_EXPOSURE_TIME_ABSOLUTE_CONTROL
+    4,   // UVC_CT_EXPOSURE_TIME_RELATIVE_CONTROL
+    5,   // UVC_CT_FOCUS_ABSOLUTE_CONTROL
+    6,   // UVC_CT_FOCUS_RELATIVE_CONTROL
+    17,  // UVC_CT_FOCUS_AUTO_CONTROL
+    7,   // UVC_CT_IRIS_ABSOLUTE_CONTROL
+    8,   // UVC_CT_IRIS_RELATIVE_CONTROL
+    9,   // UVC_CT_ZOOM_ABSOLUTE_CONTROL
+    10,  // UVC_CT_ZOOM_RELATIVE_CONTROL
+    11,  // UVC_CT_PANTILT_ABSOLUTE_CONTROL
+    12,  // UVC_CT_PANTILT_RELATIVE_CONTROL
+    13,  // UVC_CT_ROLL_ABSOLUTE_CONTROL
+    14,  // UVC_CT_ROLL_RELATIVE_CONTROL
+    18   // UVC_CT_PRIVACY_CONTROL
+};
+
+// Control structure for the built-in presets
+struct UVCSimulatedControlSpec {
+  bool onTerminal;  // false = processing unit, true = camera terminal
+  uint8_t selector;
+  uint8_t info;
+  const char* typeSignature;
+  const char* minimum;
+  const char* maximum;
+  const char* stepSize;
+  const char* defaultValue;
+};
+
+// GET_INFO bits
+#define SIM_INFO_GET_SET 0x03
+#define SIM_INFO_GET_SET_AUTO 0x0B  // plus auto-update
+
+static const UVCSimulatedControlSpec minimalPreset[] = {
+    {false, UVC_PU_BRIGHTNESS_CONTROL, SIM_INFO_GET_SET, "{S2}", "-64", "64",
+     "1", "0"},
+    {false, UVC_PU_CONTRAST_CONTROL, SIM_INFO_GET_SET, "{U2}", "0", "95", "1",
+     "32"},
+};
+
+static const UVCSimulatedControlSpec webcamPreset[] = {
+    {false, UVC_PU_BRIGHTNESS_CONTROL, SIM_INFO_GET_SET, "{S2}", "-64", "64",
+     "1", "0"},
+    {false, UVC_PU_CONTRAST_CONTROL, SIM_INFO_GET_SET, "{U2}", "0", "64", "1",
+     "32"},
+    {false, UVC_PU_HUE_CONTROL, SIM_INFO_GET_SET, "{S2}", "-40", "40", "1",
+     "0"},
+    {false, UVC_PU_SATURATION_CONTROL, SIM_INFO_GET_SET, "{U2}", "0", "128",
+     "1", "64"},
+    {false, UVC_PU_SHARPNESS_CONTROL, SIM_INFO_GET_SET, "{U2}", "0", "6", "1",
+     "3"},
+    {false, UVC_PU_GAMMA_CONTROL, SIM_INFO_GET_SET, "{U2}", "72", "500", "1",
+     "100"},
+    {false, UVC_PU_WHITE_BALANCE_TEMPERATURE_CONTROL, SIM_INFO_GET_SET_AUTO,
+     "{U2}", "2800", "6500", "1", "4600"},
+    {false, UVC_PU_WHITE_BALANCE_TEMPERATURE_AUTO_CONTROL, SIM_INFO_GET_SET,
+     "{B}", "0", "1", "1", "1"},
+    {false, UVC_PU_BACKLIGHT_COMPENSATION_CONTROL, SIM_INFO_GET_SET, "{U2}",
+     "0", "2", "1", "1"},
+    {false, UVC_PU_GAIN_CONTROL, SIM_INFO_GET_SET, "{U2}", "0", "100", "1",
+     "0"},
+    {false, UVC_PU_POWER_LINE_FREQUENCY_CONTROL, SIM_INFO_GET_SET, "{U1}", "0",
+     "2", "1", "1"},
+    {true, UVC_CT_AE_MODE_CONTROL, SIM_INFO_GET_SET, "{U1}", nullptr, nullptr,
+     "9", "8"},
+    {true, UVC_CT_AE_PRIORITY_CONTROL, SIM_INFO_GET_SET, "{B}", "0", "1", "1",
+     "0"},
+    {true, UVC_CT_EXPOSURE_TIME_ABSOLUTE_CONTROL, SIM_INFO_GET_SET_AUTO,
+     "{U4}", "3", "2047", "1", "166"},
+    {true, UVC_CT_FOCUS_ABSOLUTE_CONTROL, SIM_INFO_GET_SET_AUTO, "{U2}", "0",
+     "250", "5", "0"},
+    {true, UVC_CT_FOCUS_AUTO_CONTROL, SIM_INFO_GET_SET, "{B}", "0", "1", "1",
+     "1"},
+};
+
+static const UVCSimulatedControlSpec panTiltZoomPreset[] = {
+    {false, UVC_PU_BRIGHTNESS_CONTROL, SIM_INFO_GET_SET, "{S2}", "0", "255",
+     "1", "128"},
+    {false, UVC_PU_CONTRAST_CONTROL, SIM_INFO_GET_SET, "{U2}", "0", "255", "1",
+     "128"},
+    {false, UVC_PU_SATURATION_CONTROL, SIM_INFO_GET_SET, "{U2}", "0", "255",
+     "1", "128"},
+    {false, UVC_PU_SHARPNESS_CONTROL, SIM_INFO_GET_SET, "{U2}", "0", "255",
+     "1", "128"},
+    {false, UVC_PU_WHITE_BALANCE_TEMPERATURE_CONTROL, SIM_INFO_GET_SET_AUTO,
+     "{U2}", "2000", "6500", "10", "4000"},
+    {false, UVC_PU_WHITE_BALANCE_TEMPERATURE_AUTO_CONTROL, SIM_INFO_GET_SET,
+     "{B}", "0", "1", "1", "1"},
+    {false, UVC_PU_BACKLIGHT_COMPENSATION_CONTROL, SIM_INFO_GET_SET, "{U2}",
+     "0", "1", "1", "0"},
+    {false, UVC_PU_GAIN_CONTROL, SIM_INFO_GET_SET, "{U2}", "0", "255", "1",
+     "0"},
+    {false, UVC_PU_POWER_LINE_FREQUENCY_CONTROL, SIM_INFO_GET_SET, "{U1}", "0",
+     "2", "1", "2"},
+    {true, UVC_CT_AE_MODE_CONTROL, SIM_INFO_GET_SET, "{U1}", nullptr, nullptr,
+     "9", "8"},
+    {true, UVC_CT_EXPOSURE_TIME_ABSOLUTE_CONTROL, SIM_INFO_GET_SET_AUTO,
+     "{U4}", "1", "10000", "1", "156"},
+    {true, UVC_CT_FOCUS_ABSOLUTE_CONTROL, SIM_INFO_GET_SET_AUTO, "{U2}", "0",
+     "1023", "1", "0"},
+    {true, UVC_CT_FOCUS_RELATIVE_CONTROL, SIM_INFO_GET_SET, "{S1}", "-1", "1",
+     "1", "0"},
+    {true, UVC_CT_FOCUS_AUTO_CONTROL, SIM_INFO_GET_SET, "{B}", "0", "1", "1",
+     "1"},
+    {true, UVC_CT_IRIS_ABSOLUTE_CONTROL, SIM_INFO_GET_SET, "{U2}", "160",
+     "1100", "10", "200"},
+    {true, UVC_CT_ZOOM_ABSOLUTE_CONTROL, SIM_INFO_GET_SET, "{U2}", "100", "500",
+     "1", "100"},
+    {true, UVC_CT_ZOOM_RELATIVE_CONTROL, SIM_INFO_GET_SET,
+     "{S1 zoom;U1 digital-zoom;U1 speed}", "{-1,0,1}", "{1,1,7}", "{1,1,1}",
+     "{0,0,1}"},
+    {true, UVC_CT_PANTILT_ABSOLUTE_CONTROL, SIM_INFO_GET_SET,
+     "{S4 pan; S4 tilt}", "{-648000,-324000}", "{648000,324000}",
+     "{3600,3600}", "{0,0}"},
+    {true, UVC_CT_PANTILT_RELATIVE_CONTROL, SIM_INFO_GET_SET,
+     "{S1 pan;U1 pan-speed; S1 tilt;U1 tilt-speed}", "{-1,1,-1,1}",
+     "{1,24,1,20}", "{1,1,1,1}", "{0,1,0,1}"},
+    {true, UVC_CT_PRIVACY_CONTROL, SIM_INFO_GET_SET_AUTO, "{B}", "0", "1", "1",
+     "0"},
+};
+
+static uint16_t controlKey(uint8_t unitId, uint8_t selector) {
+  return static_cast<uint16_t>((unitId << 8) | selector);
+}
+
+std::shared_ptr<UVCSimulatedTransport> UVCSimulatedTransport::create(
+    const UVCDeviceIdentity& identity) {
+  return std::make_shared<UVCSimulatedTransport>(identity);
+}
+
+std::shared_ptr<UVCSimulatedTransport> UVCSimulatedTransport::createWithPreset(
+    UVCSimulatedPreset preset,
+    const UVCDeviceIdentity& identity) {
+  auto transport = create(identity);
+  const UVCSimulatedControlSpec* specs = nullptr;
+  size_t specCount = 0;
+
+  switch (preset) {
+    case UVCSimulatedPreset::Minimal:
+      transport->setUnitIds(1, 3);
+      specs = minimalPreset;
+      specCount = sizeof(minimalPreset) / sizeof(minimalPreset[0]);
+      break;
+    case UVCSimulatedPreset::Webcam:
+      transport->setUnitIds(1, 2);
+      specs = webcamPreset;
+      specCount = sizeof(webcamPreset) / sizeof(webcamPreset[0]);
+      break;
+    case UVCSimulatedPreset::PanTiltZoom:
+      transport->setUVCVersion(0x0110);
+      transport->setUnitIds(1, 4);
+      specs = panTiltZoomPreset;
+      specCount = sizeof(panTiltZoomPreset) / sizeof(panTiltZoomPreset[0]);
+      break;
+  }
+
+  for (size_t i = 0; i < specCount; i++) {
+    const UVCSimulatedControlSpec& spec = specs[i];
+    uint8_t unitId =
+        spec.onTerminal ? transport->_terminalId : transport->_processingUnitId;
+
+    if (!transport->addControl(unitId, spec.selector, spec.info,
+                               spec.typeSignature, spec.minimum, spec.maximum,
+                               spec.stepSize, spec.defaultValue)) {
+      return nullptr;
+    }
+  }
+  return transport;
+}
+
+UVCSimulatedTransport::UVCSimulatedTransport(const UVCDeviceIdentity& identity)
+    : _identity(identity),
+      _interfaceNumber(0),
+      _uvcVersion(0x0100),
+      _terminalId(1),
+      _processingUnitId(2),
+      _isOpen(false),
+      _isPlugged(true),
+      _isStale(false),
+      _isHung(false),
+      _devicePowerMode(0),
+      _lastTransfer(std::chrono::steady_clock::now()),
+      _random(identity.locationId ? identity.locationId : 1) {}
+
+void UVCSimulatedTransport::setUnitIds(uint8_t terminalId,
+                                       uint8_t processingUnitId) {
+  std::lock_guard<std::mutex> guard(_lock);
+  _terminalId = terminalId;
+  _processingUnitId = processingUnitId;
+}
+
+void UVCSimulatedTransport::setUVCVersion(uint16_t uvcVersion) {
+  std::lock_guard<std::mutex> guard(_lock);
+  _uvcVersion = uvcVersion;
+}
+
+bool UVCSimulatedTransport::addControl(uint8_t unitId,
+                                       uint8_t selector,
+                                       uint8_t info,
+                                       uint16_t length,
+                                       const std::vector<uint8_t>& minimum,
+                                       const std::vector<uint8_t>& maximum,
+                                       const std::vector<uint8_t>& stepSize,
+                                       const std::vector<uint8_t>& defaultValue) {
+  for (const auto* payload : {&minimum, &maximum, &stepSize, &defaultValue}) {
+    if (!payload->empty() && payload->size() != length) {
+      return false;
+    }
+  }
+
+  SimulatedControl control;
+  control.info = info;
+  control.length = length;
+  control.minimum = minimum;
+  control.maximum = maximum;
+  control.stepSize = stepSize;
+  control.defaultValue = defaultValue;
+  control.currentValue = defaultValue.empty()
+                             ? std::vector<uint8_t>(length, 0)
+                             : defaultValue;
+
+  std::lock_guard<std::mutex> guard(_lock);
+  _controls[controlKey(unitId, selector)] = control;
+  return true;
+}
+
+bool UVCSimulatedTransport::addControl(uint8_t unitId,
+                                       uint8_t selector,
+                                       uint8_t info,
+                                       const char* typeSignature,
+                                       const char* minimum,
+                                       const char* maximum,
+                                       const char* stepSize,
+                                       const char* defaultValue) {
+  auto type = UVCType::createFromCString(typeSignature);
+  if (!type) {
+    return false;
+  }
+
+  std::vector<uint8_t> payloads[4];
+  const char* values[4] = {minimum, maximum, stepSize, defaultValue};
+
+  for (int i = 0; i < 4; i++) {
+    if (!values[i]) {
+      continue;
+    }
+    payloads[i].resize(type->byteSize(), 0);
+    if (!type->scanCString(values[i], payloads[i].data(),
+                           UVCTypeScanFlags::ShowWarnings)) {
+      return false;
+    }
+    type->byteSwapHostToUSBEndian(payloads[i].data());
+  }
+  return addControl(unitId, selector, info,
+                    static_cast<uint16_t>(type->byteSize()), payloads[0],
+                    payloads[1], payloads[2], payloads[3]);
+}
+
+void UVCSimulatedTransport::setVideoControlDescriptors(
+    const std::vector<uint8_t>& descriptors) {
+  std::lock_guard<std::mutex> guard(_lock);
+  _videoControlDescriptors = descriptors;
+}
+
+void UVCSimulatedTransport::setVideoStreamingDescriptors(
+    const std::vector<uint8_t>& descriptors) {
+  std::lock_guard<std::mutex> guard(_lock);
+  _videoStreamingDescriptors = descriptors;
+}
+
+bool UVCSimulatedTransport::setCurrentValue(
+    uint8_t unitId,
+    uint8_t selector,
+    const std::vector<uint8_t>& currentValue) {
+  std::lock_guard<std::mutex> guard(_lock);
+  auto it = _controls.find(controlKey(unitId, selector));
+
+  if (it == _controls.end() || currentValue.size() != it->second.length) {
+    return false;
+  }
+  it->second.currentValue = currentValue;
+  return true;
+}
+
+void UVCSimulatedTransport::setInterfaceNumber(uint8_t interfaceNumber) {
+  std::lock_guard<std::mutex> guard(_lock);
+  _interfaceNumber = interfaceNumber;
+}
+
+void UVCSimulatedTransport::setLatency(const UVCSimulatedLatency& latency) {
+  std::lock_guard<std::mutex> guard(_lock);
+  _latency = latency;
+}
+
+void UVCSimulatedTransport::setFailures(const UVCSimulatedFailures& failures) {
+  std::lock_guard<std::mutex> guard(_lock);
+  _failures = failures;
+}
+
+void UVCSimulatedTransport::setAutosuspend(
+    const UVCSimulatedAutosuspend& autosuspend) {
+  std::lock_guard<std::mutex> guard(_lock);
+  _autosuspend = autosuspend;
+}
+
+void UVCSimulatedTransport::setPowerMode(
+    const UVCSimulatedPowerMode& powerMode) {
+  std::lock_guard<std::mutex> guard(_lock);
+  _powerMode = powerMode;
+}
+
+void UVCSimulatedTransport::setBus(std::shared_ptr<UVCSimulatedBus> bus) {
+  std::lock_guard<std::mutex> guard(_lock);
+  _bus = bus;
+}
+
+void UVCSimulatedTransport::setSeed(uint32_t seed) {
+  std::lock_guard<std::mutex> guard(_lock);
+  _random.seed(seed ? seed : 1);
+}
+
+void UVCSimulatedTransport::unplug() {
+  std::lock_guard<std::mutex> guard(_lock);
+  if (_isPlugged) {
+    _isPlugged = false;
+    _isStale = true;
+    _isOpen = false;
+    _statistics.disconnects++;
+  }
+}
+
+void UVCSimulatedTransport::replug() {
+  std::lock_guard<std::mutex> guard(_lock);
+  if (!_isPlugged) {
+    _isPlugged = true;
+    _isHung = false;
+    _lastTransfer = std::chrono::steady_clock::now();
+    revertToDefaultValues();
+  }
+}
+
+bool UVCSimulatedTransport::isPlugged() const {
+  std::lock_guard<std::mutex> guard(_lock);
+  return _isPlugged;
+}
+
+UVCSimulatedStatistics UVCSimulatedTransport::statistics() const {
+  std::lock_guard<std::mutex> guard(_lock);
+  return _statistics;
+}
+
+const UVCDeviceIdentity& UVCSimulatedTransport::identity() const {
+  return _identity;
+}
+
+uint8_t UVCSimulatedTransport::interfaceNumber() const {
+  std::lock_guard<std::mutex> guard(_lock);
+  return _interfaceNumber;
+}
+
+std::vector<uint8_t> UVCSimulatedTransport::videoControlDescriptors() const {
+  std::lock_guard<std::mutex> guard(_lock);
+  if (!_videoControlDescriptors.empty()) {
+    return _videoControlDescriptors;
+  }
+  return synthesizeVideoControlDescriptors();
+}
+
+std::vector<uint8_t> UVCSimulatedTransport::videoStreamingDescriptors() const {
+  std::lock_guard<std::mutex> guard(_lock);
+  return _videoStreamingDescriptors;
+}
+
+bool UVCSimulatedTransport::isOpen() const {
+  std::lock_guard<std::mutex> guard(_lock);
+  return _isOpen;
+}
+
+bool UVCSimulatedTransport::open() {
+  std::lock_guard<std::mutex> guard(_lock);
+  _isOpen = _isPlugged && !_isStale;
+  return _isOpen;
+}
+
+void UVCSimulatedTransport::close() {
+  std::lock_guard<std::mutex> guard(_lock);
+  _isOpen = false;
+}
+
+bool UVCSimulatedTransport::reconnect() {
+  std::lock_guard<std::mutex> guard(_lock);
+  if (!_isPlugged) {
+    return false;
+  }
+  if (_isStale) {
+    _isStale = false;
+    _statistics.reconnects++;
+  }
+  _isOpen = true;
+  return true;
+}
+
+bool UVCSimulatedTransport::recover(UVCRecoveryAction action) {
+  std::lock_guard<std::mutex> guard(_lock);
+  if (!_isPlugged || _isStale) {
+    return false;
+  }
+  _statistics.recoveries++;
+  if (action >= _failures.hangClearedBy) {
+    _isHung = false;
+  }
+  if (action == UVCRecoveryAction::ResetPort) {
+    // The device re-enumerates:  it comes back with its defaults, behind a
+    // new handle
+    revertToDefaultValues();
+    _isStale = true;
+    _isOpen = false;
+  }
+  return true;
+}
+
+UVCPowerState UVCSimulatedTransport::powerState() const {
+  std::lock_guard<std::mutex> guard(_lock);
+  return isSuspended() ? UVCPowerState::Suspended : UVCPowerState::Active;
+}
+
+bool UVCSimulatedTransport::isSuspended() const {
+  return _isPlugged && _autosuspend.idleMicros &&
+         std::chrono::steady_clock::now() - _lastTransfer >=
+             std::chrono::microseconds(_autosuspend.idleMicros);
+}
+
+UVCTransferStatus UVCSimulatedTransport::controlRequest(
+    UVCControlRequest& request) {
+  std::lock_guard<std::mutex> guard(_lock);
+  std::unique_lock<std::mutex> busGuard;
+
+  request.wLenDone = 0;
+  if (!_isPlugged || _isStale) {
+    return UVCTransferStatus::NoDevice;
+  }
+  // Resume signaling is confined to the device's own port:
+  if (isSuspended()) {
+    std::this_thread::sleep_for(
+        std::chrono::microseconds(_autosuspend.resumeMicros));
+    _statistics.wakeups++;
+  }
+  _lastTransfer = std::chrono::steady_clock::now();
+  if (_bus) {
+    busGuard = std::unique_lock<std::mutex>(_bus->transferLock());
+    _bus->countTransfer();
+  }
+  _statistics.transfers++;
+
+  if (_failures.disconnectAfterTransfers &&
+      _statistics.transfers >= _failures.disconnectAfterTransfers) {
+    _failures.disconnectAfterTransfers = 0;
+    _isPlugged = false;
+    _isStale = true;
+    _isOpen = false;
+    _statistics.disconnects++;
+    return UVCTransferStatus::NoDevice;
+  }
+
+  if (_failures.hangAfterTransfers &&
+      _statistics.transfers >= _failures.hangAfterTransfers) {
+    _failures.hangAfterTransfers = 0;
+    _isHung = true;
+    _statistics.hangs++;
+  }
+
+  if (_isHung ||
+      (_failures.timeoutProbability > 0.0 &&
+       std::uniform_real_distribution<double>(0.0, 1.0)(_random) <
+           _failures.timeoutProbability)) {
+    std::this_thread::sleep_for(
+        std::chrono::microseconds(_failures.timeoutMicros));
+    _statistics.timeouts++;
+    return UVCTransferStatus::Timeout;
+  }
+
+  uint32_t latencyMicros = drawLatencyMicros();
+  if (latencyMicros) {
+    std::this_thread::sleep_for(std::chrono::microseconds(latencyMicros));
+  }
+
+  uint8_t selector = request.wValue >> 8;
+  uint8_t unitId = request.wIndex >> 8;
+
+  if (_powerMode.isSupported && unitId == 0 &&
+      selector == UVC_VC_VIDEO_POWER_MODE_CONTROL &&
+      (request.wIndex & 0xFF) == _interfaceNumber) {
+    return powerModeRequest(request);
+  }
+  if (_devicePowerMode) {
+    _statistics.lowPowerStalls++;
+    _statistics.stalls++;
+    return UVCTransferStatus::Stall;
+  }
+
+  auto it = _controls.find(controlKey(unitId, selector));
+
+  if (it == _controls.end() || (request.wIndex & 0xFF) != _interfaceNumber) {
+    _statistics.stalls++;
+    return UVCTransferStatus::Stall;
+  }
+
+  SimulatedControl& control = it->second;
+  const std::vector<uint8_t>* payload = nullptr;
+  uint8_t scratch[2];
+  size_t scratchLength = 0;
+
+  if (request.bmRequestType == UVC_REQUEST_TYPE_SET &&
+      request.bRequest == UVC_SET_CUR) {
+    if (!(control.info & 0x02) || request.wLength != control.length ||
+        !request.pData) {
+      _statistics.stalls++;
+      return UVCTransferStatus::Stall;
+    }
+    memcpy(control.currentValue.data(), request.pData, control.length);
+    request.wLenDone = control.length;
+    return UVCTransferStatus::Success;
+  }
+
+  if (request.bmRequestType != UVC_REQUEST_TYPE_GET) {
+    _statistics.stalls++;
+    return UVCTransferStatus::Stall;
+  }
+
+  switch (request.bRequest) {
+    case UVC_GET_CUR:
+      payload = (control.info & 0x01) ? &control.currentValue : nullptr;
+      break;
+    case UVC_GET_MIN:
+      payload = &control.minimum;
+      break;
+    case UVC_GET_MAX:
+      payload = &control.maximum;
+      break;
+    case UVC_GET_RES:
+      payload = _failures.stallOnGetRes ? nullptr : &control.stepSize;
+      break;
+    case UVC_GET_DEF:
+      payload = &control.defaultValue;
+      break;
+    case UVC_GET_INFO:
+      scratch[0] = control.info;
+      scratchLength = 1;
+      break;
+    case UVC_GET_LEN:
+      scratch[0] = control.length & 0xFF;
+      scratch[1] = control.length >> 8;
+      scratchLength = 2;
+      break;
+  }
+
+  const uint8_t* source = scratch;
+  size_t sourceLength = scratchLength;
+  if (payload) {
+    source = payload->data();
+    sourceLength = payload->size();
+  }
+  if (!sourceLength || !request.pData) {
+    _statistics.stalls++;
+    return UVCTransferStatus::Stall;
+  }
+
+  request.wLenDone =
+      static_cast<uint32_t>(std::min<size_t>(sourceLength, request.wLength));
+  memcpy(request.pData, source, request.wLenDone);
+  return UVCTransferStatus::Success;
+}
+
+std::vector<uint8_t> UVCSimulatedTransport::synthesizeVideoControlDescriptors()
+    const {
+  uint32_t terminalControls = 0, processingUnitControls = 0;
+
+  for (const auto& entry : _controls) {
+    uint8_t unitId = entry.first >> 8;
+    uint8_t selector = entry.first & 0xFF;
+
+    if (unitId == _terminalId &&
+        selector < sizeof(cameraTerminalControlBits) / sizeof(int) &&
+        cameraTerminalControlBits[selector] >= 0) {
+      terminalControls |= 1u << cameraTerminalControlBits[selector];
+    } else if (unitId == _processingUnitId &&
+               selector < sizeof(processingUnitControlBits) / sizeof(int) &&
+               processingUnitControlBits[selector] >= 0) {
+      processingUnitControls |= 1u << processingUnitControlBits[selector];
+    }
+  }
+
+  std::vector<uint8_t> descriptors = {
+      // VC header (UVC 1.1 layout, one streaming interface):
+      13, CS_INTERFACE, VC_HEADER, static_cast<uint8_t>(_uvcVersion & 0xFF),
+      static_cast<uint8_t>(_uvcVersion >> 8), 0, 0,  // wTotalLength, below
+      0x00, 0x6C, 0xDC, 0x02,                        // dwClockFrequency 48MHz
+      1, static_cast<uint8_t>(_interfaceNumber + 1),
+      // Camera terminal:
+      18, CS_INTERFACE, VC_INPUT_TERMINAL, _terminalId, UVC_ITT_CAMERA & 0xFF,
+      UVC_ITT_CAMERA >> 8, 0, 0, 0, 0, 0, 0, 0, 0, 3,
+      static_cast<uint8_t>(terminalControls & 0xFF),
+      static_cast<uint8_t>((terminalControls >> 8) & 0xFF),
+      static_cast<uint8_t>((terminalControls >> 16) & 0xFF),
+      // Processing unit:
+      12, CS_INTERFACE, VC_PROCESSING_UNIT, _processingUnitId, _terminalId, 0,
+      0, 3, static_cast<uint8_t>(processingUnitControls & 0xFF),
+      static_cast<uint8_t>((processingUnitControls >> 8) & 0xFF),
+      static_cast<uint8_t>((processingUnitControls >> 16) & 0xFF), 0,
+      // Output terminal:
+      9, CS_INTERFACE, VC_OUTPUT_TERMINAL,
+      static_cast<uint8_t>(std::max(_terminalId, _processingUnitId) + 1),
+      UVC_TT_STREAMING & 0xFF, UVC_TT_STREAMING >> 8, 0, _processingUnitId,
+      0};
+
+  descriptors[5] = descriptors.size() & 0xFF;
+  descriptors[6] = descriptors.size() >> 8;
+  return descriptors;
+}
+
+UVCTransferStatus UVCSimulatedTransport::powerModeRequest(
+    UVCControlRequest& request) {
+  if (!request.pData || request.wLength < 1) {
+    _statistics.stalls++;
+    return UVCTransferStatus::Stall;
+  }
+
+  uint8_t* data = static_cast<uint8_t*>(request.pData);
+
+  if (request.bmRequestType == UVC_REQUEST_TYPE_SET &&
+      request.bRequest == UVC_SET_CUR) {
+    uint8_t mode = data[0] & 0x0F;
+
+    // Full power (0) and the vendor-dependent mode (1) only:
+    if (mode > 1) {
+      _statistics.stalls++;
+      return UVCTransferStatus::Stall;
+    }
+    if (_devicePowerMode && !mode) {
+      std::this_thread::sleep_for(
+          std::chrono::microseconds(_powerMode.wakeMicros));
+      _statistics.powerModeWakeups++;
+    }
+    _devicePowerMode = mode;
+  } else if (request.bmRequestType == UVC_REQUEST_TYPE_GET &&
+             request.bRequest == UVC_GET_CUR) {
+    // D4:  the vendor-dependent mode is supported; D5:  USB powered
+    data[0] = 0x30 | _devicePowerMode;
+  } else if (request.bmRequestType == UVC_REQUEST_TYPE_GET &&
+             request.bRequest == UVC_GET_INFO) {
+    data[0] = 0x03;
+  } else {
+    _statistics.stalls++;
+    return UVCTransferStatus::Stall;
+  }
+  request.wLenDone = 1;
+  return UVCTransferStatus::Success;
+}
+
+void UVCSimulatedTransport::revertToDefaultValues() {
+  _devicePowerMode = 0;
+  for (auto& entry : _controls) {
+    SimulatedControl& control = entry.second;
+    control.currentValue = control.defaultValue.empty()
+                               ? std::vector<uint8_t>(control.length, 0)
+                               : control.defaultValue;
+  }
+}
+
+uint32_t UVCSimulatedTransport::drawLatencyMicros() {
+  uint32_t micros = _latency.baseMicros;
+
+  if (_latency.jitterMicros) {
+    micros +=
+        std::uniform_int_distribution<uint32_t>(0, _latency.jitterMicros)(
+            _random);
+  }
+  if (_latency.spikeProbability > 0.0 &&
+      std::uniform_real_distribution<double>(0.0, 1.0)(_random) <
+          _latency.spikeProbability) {
+    micros += _latency.spikeMicros;
+  }
+  return micros;
+}
@@ -0,0 +1,345 @@
+//
+// UVCSimulatedTransport.hpp
+//
+// UVCTransport implementation that models a UVC camera in memory.
+//
+// Translated from Objective-C to C++
+// Copyright © 2016
+// Dr. Jeffrey Frey, IT-NSS
+// University of Delaware
+//
+// $Id$
+//
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <vector>
+
+#include "UVCTransport.hpp"
+
+/*!
+  @typedef UVCSimulatedPreset
+
+  Enumerates the built-in descriptor/control sets a simulated camera can be
+  created with:
+
+    Minimal       brightness and contrast only; processing unit id 3
+    Webcam        typical fixed webcam: image controls, exposure, auto-focus
+    PanTiltZoom   conference camera: adds zoom, pan/tilt, iris and privacy
+*/
+enum class UVCSimulatedPreset { Minimal, Webcam, PanTiltZoom };
+
+/*!
+  @struct UVCSimulatedLatency
+
+  Per-transfer latency model:  every transfer takes baseMicros plus a
+  uniformly-distributed jitter of up to jitterMicros.  With probability
+  spikeProbability, spikeMicros is added on top.
+*/
+struct UVCSimulatedLatency {
+  uint32_t baseMicros = 0;
+  uint32_t jitterMicros = 0;
+  double spikeProbability = 0.0;
+  uint32_t spikeMicros = 0;
+};
+
+/*!
+  @struct UVCSimulatedFailures
+
+  Failure modes a simulated camera can exhibit:
+
+    timeoutProbability        chance that a transfer times out (after
+                              timeoutMicros have elapsed)
+    stallOnGetRes             every GET_RES request stalls
+    disconnectAfterTransfers  the device drops off the bus once this many
+                              transfers have been carried (zero = never)
+    hangAfterTransfers        the firmware wedges once this many transfers
+                              have been carried (zero = never):  every
+                              transfer times out until a recovery action of
+                              at least hangClearedBy is performed
+*/
+struct UVCSimulatedFailures {
+  double timeoutProbability = 0.0;
+  uint32_t timeoutMicros = 5000;
+  bool stallOnGetRes = false;
+  uint64_t disconnectAfterTransfers = 0;
+  uint64_t hangAfterTransfers = 0;
+  UVCRecoveryAction hangClearedBy = UVCRecoveryAction::ClearStall;
+};
+
+/*!
+  @struct UVCSimulatedAutosuspend
+
+  USB autosuspend:  a camera that has carried no transfer for idleMicros
+  (zero = never) is runtime-suspended, and the next transfer first waits
+  resumeMicros for it to wake.
+*/
+struct UVCSimulatedAutosuspend {
+  uint32_t idleMicros = 0;
+  uint32_t resumeMicros = 20000;
+};
+
+/*!
+  @struct UVCSimulatedPowerMode
+
+  VC_VIDEO_POWER_MODE_CONTROL:  when isSupported, the camera answers the
+  control on its interface and accepts the vendor-dependent (low) power mode,
+  in which it stalls every other request.  Returning to full power takes
+  wakeMicros.  A power cycle leaves the camera at full power.
+*/
+struct UVCSimulatedPowerMode {
+  bool isSupported = false;
+  uint32_t wakeMicros = 10000;
+};
+
+/*!
+  @struct UVCSimulatedStatistics
+
+  Counters kept by a simulated camera.
+*/
+struct UVCSimulatedStatistics {
+  uint64_t transfers = 0;
+  uint64_t stalls = 0;
+  uint64_t timeouts = 0;
+  uint64_t disconnects = 0;
+  uint64_t reconnects = 0;
+  uint64_t hangs = 0;
+  uint64_t recoveries = 0;
+  uint64_t wakeups = 0;
+  uint64_t powerModeWakeups = 0;
+  uint64_t lowPowerStalls = 0;
+};
+
+/*!
+  @class UVCSimulatedBus
+  @abstract Shared upstream link of a group of simulated cameras.
+
+  Control transfers of all cameras attached (directly or through hubs) to the
+  same host port are serialized, just as they are on a real bus.  Cameras
+  without a bus transfer independently of each other.
+*/
+class UVCSimulatedBus {
+ private:
+  std::mutex _transferLock;
+  std::atomic<uint64_t> _transfers;
+
+ public:
+  UVCSimulatedBus() : _transfers(0) {}
+
+  std::mutex& transferLock() { return _transferLock; }
+  uint64_t transfers() const { return _transfers.load(); }
+  void countTransfer() { _transfers++; }
+};
+
+/*!
+  @class UVCSimulatedTransport
+  @abstract In-memory model of a UVC camera.
+
+  Each simulated control is addressed by unit id and selector and holds the
+  INFO, MIN, MAX, RES, DEF and CUR payloads (in USB byte order) the device
+  would return.  The VideoControl descriptor block is synthesized from the
+  unit ids and the controls that were added, unless one is set explicitly.
+
+  Instances are safe to use from multiple threads.
+*/
+class UVCSimulatedTransport final : public UVCTransport {
+ private:
+  struct SimulatedControl {
+    uint8_t info;
+    uint16_t length;
+    std::vector<uint8_t> minimum, maximum, stepSize, defaultValue;
+    std::vector<uint8_t> currentValue;
+  };
+
+  mutable std::mutex _lock;
+  UVCDeviceIdentity _identity;
+  uint8_t _interfaceNumber;
+  uint16_t _uvcVersion;
+  uint8_t _terminalId, _processingUnitId;
+  std::map<uint16_t, SimulatedControl> _controls;
+  std::vector<uint8_t> _videoControlDescriptors;
+  std::vector<uint8_t> _videoStreamingDescriptors;
+  bool _isOpen;
+  bool _isPlugged;
+  // Set when the device drops off the bus; like a real handle, the transport
+  // stays unusable until reconnect() even once the device is back:
+  bool _isStale;
+  bool _isHung;
+  UVCSimulatedLatency _latency;
+  UVCSimulatedFailures _failures;
+  UVCSimulatedAutosuspend _autosuspend;
+  UVCSimulatedPowerMode _powerMode;
+  // bDevicePowerMode bits D3..D0; zero is full power:
+  uint8_t _devicePowerMode;
+  std::chrono::steady_clock::time_point _lastTransfer;
+  UVCSimulatedStatistics _statistics;
+  std::shared_ptr<UVCSimulatedBus> _bus;
+  std::minstd_rand _random;
+
+ public:
+  /*!
+    @method create
+
+    Returns a shared_ptr to a simulated camera with no controls.
+  */
+  static std::shared_ptr<UVCSimulatedTransport> create(
+      const UVCDeviceIdentity& identity);
+
+  /*!
+    @method createWithPreset
+
+    Returns a shared_ptr to a simulated camera populated with one of the
+    built-in control sets.
+  */
+  static std::shared_ptr<UVCSimulatedTransport> createWithPreset(
+      UVCSimulatedPreset preset,
+      const UVCDeviceIdentity& identity);
+
+  explicit UVCSimulatedTransport(const UVCDeviceIdentity& identity);
+  ~UVCSimulatedTransport() override = default;
+
+  // Delete copy constructor and assignment operator
+  UVCSimulatedTransport(const UVCSimulatedTransport&) = delete;
+  UVCSimulatedTransport& operator=(const UVCSimulatedTransport&) = delete;
+
+  /*!
+    @method setUnitIds
+
+    Set the ids of the camera terminal and the processing unit.
+  */
+  void setUnitIds(uint8_t terminalId, uint8_t processingUnitId);
+
+  /*!
+    @method setUVCVersion
+
+    Set the UVC version reported in the VC header (BCD, e.g. 0x0110).
+  */
+  void setUVCVersion(uint16_t uvcVersion);
+
+  /*!
+    @method addControl
+
+    Add (or replace) the control at unitId/selector.  The payloads are given
+    in USB byte order; an empty minimum, maximum, stepSize or defaultValue
+    makes the corresponding GET request stall.  The current value starts out
+    as the default value (or zeroes).
+
+    Returns false if the payload lengths disagree.
+  */
+  bool addControl(uint8_t unitId,
+                  uint8_t selector,
+                  uint8_t info,
+                  uint16_t length,
+                  const std::vector<uint8_t>& minimum,
+                  const std::vector<uint8_t>& maximum,
+                  const std::vector<uint8_t>& stepSize,
+                  const std::vector<uint8_t>& defaultValue);
+
+  /*!
+    @method addControl (textual)
+
+    Add (or replace) the control at unitId/selector, structured according to
+    the UVCType description typeSignature.  The values are parsed with
+    UVCType::scanCString; nullptr leaves the corresponding payload empty.
+
+    Returns false if typeSignature or any of the values cannot be parsed.
+  */
+  bool addControl(uint8_t unitId,
+                  uint8_t selector,
+                  uint8_t info,
+                  const char* typeSignature,
+                  const char* minimum,
+                  const char* maximum,
+                  const char* stepSize,
+                  const char* defaultValue);
+
+  /*!
+    @method setCurrentValue
+
+    Replace the current value of the control at unitId/selector (in USB byte
+    order).  Returns false if there is no such control or the length is
+    wrong.
+  */
+  bool setCurrentValue(uint8_t unitId,
+                       uint8_t selector,
+                       const std::vector<uint8_t>& currentValue);
+
+  /*!
+    @method setVideoControlDescriptors
+
+    Use the given VideoControl descriptor block verbatim rather than
+    synthesizing one.
+  */
+  void setVideoControlDescriptors(const std::vector<uint8_t>& descriptors);
+
+  /*!
+    @method setVideoStreamingDescriptors
+
+    Set the class-specific VideoStreaming descriptors the camera reports
+    (none by default).
+  */
+  void setVideoStreamingDescriptors(const std::vector<uint8_t>& descriptors);
+
+  void setInterfaceNumber(uint8_t interfaceNumber);
+  void setLatency(const UVCSimulatedLatency& latency);
+  void setFailures(const UVCSimulatedFailures& failures);
+  void setAutosuspend(const UVCSimulatedAutosuspend& autosuspend);
+  void setPowerMode(const UVCSimulatedPowerMode& powerMode);
+  void setBus(std::shared_ptr<UVCSimulatedBus> bus);
+  void setSeed(uint32_t seed);
+
+  /*!
+    @method unplug
+
+    Simulate the device dropping off the bus:  the transport closes and every
+    request fails with NoDevice until the device is replugged and the
+    transport reconnected.
+  */
+  void unplug();
+
+  /*!
+    @method replug
+
+    Simulate the device returning to the bus.  Control values revert to their
+    defaults, as they would after a power cycle.  Requests keep failing with
+    NoDevice until reconnect() is called.
+  */
+  void replug();
+
+  bool isPlugged() const;
+  UVCSimulatedStatistics statistics() const;
+
+  const UVCDeviceIdentity& identity() const override;
+  uint8_t interfaceNumber() const override;
+  std::vector<uint8_t> videoControlDescriptors() const override;
+  std::vector<uint8_t> videoStreamingDescriptors() const override;
+  bool isOpen() const override;
+  bool open() override;
+  void close() override;
+  UVCTransferStatus controlRequest(UVCControlRequest& request) override;
+  bool reconnect() override;
+
+  /*!
+    @method recover
+
+    Every action succeeds while the device is on the bus; a hang is cleared
+    by hangClearedBy or any stronger action.  ResetPort also reverts control
+    values to their defaults and leaves the transport to be reconnected.
+  */
+  bool recover(UVCRecoveryAction action) override;
+  UVCPowerState powerState() const override;
+
+ private:
+  bool isSuspended() const;
+  void revertToDefaultValues();
+  UVCTransferStatus powerModeRequest(UVCControlRequest& request);
+  std::vector<uint8_t> synthesizeVideoControlDescriptors() const;
+  uint32_t drawLatencyMicros();
+};
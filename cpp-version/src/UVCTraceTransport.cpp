@@ -0,0 +1,565 @@
+//
+// UVCTraceTransport.cpp
+//
+// Recording and replay of control transfer traces.
+//
+// Translated from Objective-C to C++
+// Copyright © 2016
+// Dr. Jeffrey Frey, IT-NSS
+// University of Delaware
+//
+// $Id$
+//
+
+#include "UVCTraceTransport.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <thread>
+
+#include "UVCDiagnostics.hpp"
+
+static const char uvcTraceMagic[8] = {'U', 'V', 'C', 'T', 'R', 'A', 'C', 'E'};
+
+static void AppendVarint(std::vector<uint8_t>& out, uint64_t value) {
+  while (value >= 0x80) {
+    out.push_back(static_cast<uint8_t>(value | 0x80));
+    value >>= 7;
+  }
+  out.push_back(static_cast<uint8_t>(value));
+}
+
+static void AppendUInt16(std::vector<uint8_t>& out, uint16_t value) {
+  out.push_back(value & 0xFF);
+  out.push_back(value >> 8);
+}
+
+static void AppendBytes(std::vector<uint8_t>& out,
+                        const void* bytes,
+                        size_t length) {
+  const uint8_t* p = static_cast<const uint8_t*>(bytes);
+  out.insert(out.end(), p, p + length);
+}
+
+static void AppendString(std::vector<uint8_t>& out, const std::string& s) {
+  AppendVarint(out, s.size());
+  AppendBytes(out, s.data(), s.size());
+}
+
+// Bounds-checked cursor over an in-memory trace; every read fails once the
+// data is exhausted.
+struct UVCTraceCursor {
+  const uint8_t* p;
+  const uint8_t* end;
+
+  bool readByte(uint8_t& value) {
+    if (p >= end)
+      return false;
+    value = *p++;
+    return true;
+  }
+
+  bool readUInt16(uint16_t& value) {
+    if (end - p < 2)
+      return false;
+    value = p[0] | (p[1] << 8);
+    p += 2;
+    return true;
+  }
+
+  bool readVarint(uint64_t& value) {
+    value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+      uint8_t byte;
+      if (!readByte(byte))
+        return false;
+      value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+      if (!(byte & 0x80))
+        return true;
+    }
+    return false;
+  }
+
+  bool readBytes(std::vector<uint8_t>& value, uint64_t length) {
+    if (static_cast<uint64_t>(end - p) < length)
+      return false;
+    value.assign(p, p + length);
+    p += length;
+    return true;
+  }
+
+  bool readString(std::string& value) {
+    uint64_t length;
+    if (!readVarint(length) || static_cast<uint64_t>(end - p) < length)
+      return false;
+    value.assign(reinterpret_cast<const char*>(p), length);
+    p += length;
+    return true;
+  }
+};
+
+static uint64_t TransferKey(uint8_t bmRequestType,
+                            uint8_t bRequest,
+                            uint16_t wValue,
+                            uint16_t wIndex,
+                            uint16_t wLength) {
+  return (static_cast<uint64_t>(bmRequestType) << 56) |
+         (static_cast<uint64_t>(bRequest) << 48) |
+         (static_cast<uint64_t>(wValue) << 32) |
+         (static_cast<uint64_t>(wIndex) << 16) | wLength;
+}
+
+//
+// UVCTraceWriter
+//
+
+std::shared_ptr<UVCTraceWriter> UVCTraceWriter::create(
+    const std::string& path) {
+  FILE* file = fopen(path.c_str(), "wb");
+  if (!file) {
+    UVC_DIAGNOSTIC(Error, General, "unable to create trace file %s: %s",
+                   path.c_str(), strerror(errno));
+    return nullptr;
+  }
+  return std::make_shared<UVCTraceWriter>(file);
+}
+
+UVCTraceWriter::UVCTraceWriter(FILE* file)
+    : _file(file),
+      _deviceCount(0),
+      _lastStart(std::chrono::steady_clock::now()) {
+  _record.reserve(128);
+  AppendBytes(_record, uvcTraceMagic, sizeof(uvcTraceMagic));
+  AppendUInt16(_record, UVC_TRACE_VERSION);
+  fwrite(_record.data(), 1, _record.size(), _file);
+  fflush(_file);
+}
+
+UVCTraceWriter::~UVCTraceWriter() {
+  if (_file) {
+    fclose(_file);
+  }
+}
+
+uint32_t UVCTraceWriter::addDevice(UVCTransport& transport) {
+  const UVCDeviceIdentity& identity = transport.identity();
+  std::vector<uint8_t> descriptors = transport.videoControlDescriptors();
+  std::lock_guard<std::mutex> guard(_lock);
+  uint32_t device = _deviceCount++;
+
+  _record.clear();
+  _record.push_back('D');
+  AppendVarint(_record, device);
+  AppendVarint(_record, identity.locationId);
+  AppendVarint(_record, identity.vendorId);
+  AppendVarint(_record, identity.productId);
+  _record.push_back(transport.interfaceNumber());
+  AppendString(_record, identity.deviceName);
+  AppendString(_record, identity.serialNumber);
+  AppendVarint(_record, descriptors.size());
+  AppendBytes(_record, descriptors.data(), descriptors.size());
+  fwrite(_record.data(), 1, _record.size(), _file);
+  fflush(_file);
+  return device;
+}
+
+void UVCTraceWriter::writeTransfer(uint32_t device,
+                                   std::chrono::steady_clock::time_point start,
+                                   std::chrono::steady_clock::time_point end,
+                                   const UVCControlRequest& request,
+                                   UVCTransferStatus status) {
+  using std::chrono::duration_cast;
+  using std::chrono::microseconds;
+  std::lock_guard<std::mutex> guard(_lock);
+
+  // Concurrent transfers may complete out of order; clamp so the deltas stay
+  // unsigned:
+  if (start < _lastStart) {
+    start = _lastStart;
+  }
+
+  bool isDeviceToHost = (request.bmRequestType & 0x80) != 0;
+  size_t payloadLength = isDeviceToHost ? request.wLenDone : request.wLength;
+
+  _record.clear();
+  _record.push_back('T');
+  AppendVarint(_record, device);
+  AppendVarint(_record, duration_cast<microseconds>(start - _lastStart).count());
+  AppendVarint(_record,
+               end > start ? duration_cast<microseconds>(end - start).count()
+                           : 0);
+  _record.push_back(request.bmRequestType);
+  _record.push_back(request.bRequest);
+  AppendUInt16(_record, request.wValue);
+  AppendUInt16(_record, request.wIndex);
+  AppendUInt16(_record, request.wLength);
+  _record.push_back(static_cast<uint8_t>(status));
+  AppendVarint(_record, request.wLenDone);
+  if (request.pData) {
+    AppendBytes(_record, request.pData, payloadLength);
+  } else {
+    _record.insert(_record.end(), payloadLength, 0);
+  }
+  fwrite(_record.data(), 1, _record.size(), _file);
+  fflush(_file);
+  _lastStart = start;
+}
+
+//
+// UVCRecordingTransport
+//
+
+std::shared_ptr<UVCRecordingTransport> UVCRecordingTransport::create(
+    std::shared_ptr<UVCTransport> transport,
+    std::shared_ptr<UVCTraceWriter> writer) {
+  if (!transport || !writer) {
+    return nullptr;
+  }
+  return std::make_shared<UVCRecordingTransport>(transport, writer);
+}
+
+UVCRecordingTransport::UVCRecordingTransport(
+    std::shared_ptr<UVCTransport> transport,
+    std::shared_ptr<UVCTraceWriter> writer)
+    : _transport(transport), _writer(writer) {
+  _device = _writer->addDevice(*_transport);
+}
+
+const UVCDeviceIdentity& UVCRecordingTransport::identity() const {
+  return _transport->identity();
+}
+
+uint8_t UVCRecordingTransport::interfaceNumber() const {
+  return _transport->interfaceNumber();
+}
+
+std::vector<uint8_t> UVCRecordingTransport::videoControlDescriptors() const {
+  return _transport->videoControlDescriptors();
+}
+
+std::vector<uint8_t> UVCRecordingTransport::videoStreamingDescriptors() const {
+  return _transport->videoStreamingDescriptors();
+}
+
+bool UVCRecordingTransport::isOpen() const {
+  return _transport->isOpen();
+}
+
+bool UVCRecordingTransport::open() {
+  return _transport->open();
+}
+
+void UVCRecordingTransport::close() {
+  _transport->close();
+}
+
+bool UVCRecordingTransport::reconnect() {
+  return _transport->reconnect();
+}
+
+bool UVCRecordingTransport::recover(UVCRecoveryAction action) {
+  return _transport->recover(action);
+}
+
+UVCPowerState UVCRecordingTransport::powerState() const {
+  return _transport->powerState();
+}
+
+UVCTransferStatus UVCRecordingTransport::controlRequest(
+    UVCControlRequest& request) {
+  auto start = std::chrono::steady_clock::now();
+  UVCTransferStatus status = _transport->controlRequest(request);
+  auto end = std::chrono::steady_clock::now();
+
+  _writer->writeTransfer(_device, start, end, request, status);
+  return status;
+}
+
+//
+// UVCReplayTransport
+//
+
+std::vector<std::shared_ptr<UVCReplayTransport>>
+UVCReplayTransport::createFromTrace(const std::string& path,
+                                    UVCReplayOrder order,
+                                    UVCReplayTiming timing) {
+  std::vector<std::shared_ptr<UVCReplayTransport>> transports;
+  std::vector<uint8_t> trace;
+  FILE* file = fopen(path.c_str(), "rb");
+
+  if (!file) {
+    UVC_DIAGNOSTIC(Error, General, "unable to open trace file %s: %s",
+                   path.c_str(), strerror(errno));
+    return transports;
+  }
+
+  uint8_t buffer[16384];
+  size_t count;
+  while ((count = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+    trace.insert(trace.end(), buffer, buffer + count);
+  }
+  fclose(file);
+
+  UVCTraceCursor cursor = {trace.data(), trace.data() + trace.size()};
+  std::vector<uint8_t> magic;
+  uint16_t version;
+
+  if (!cursor.readBytes(magic, sizeof(uvcTraceMagic)) ||
+      memcmp(magic.data(), uvcTraceMagic, sizeof(uvcTraceMagic)) != 0 ||
+      !cursor.readUInt16(version)) {
+    UVC_DIAGNOSTIC(Error, Parse, "%s is not a UVC trace file", path.c_str());
+    return transports;
+  }
+  if (version != UVC_TRACE_VERSION) {
+    UVC_DIAGNOSTIC(Error, Parse, "%s has unsupported trace version %u",
+                   path.c_str(), version);
+    return transports;
+  }
+
+  auto clock = std::make_shared<Clock>();
+  uint64_t startMicros = 0;
+  uint8_t recordType;
+
+  while (cursor.readByte(recordType)) {
+    bool isValid = false;
+    uint64_t device;
+
+    if (!cursor.readVarint(device)) {
+      // Truncated record
+    } else if (recordType == 'D') {
+      UVCDeviceIdentity identity;
+      uint64_t locationId, vendorId, productId;
+      uint8_t interfaceNumber;
+      uint64_t descriptorsLength;
+      std::vector<uint8_t> descriptors;
+
+      if (device == transports.size() && cursor.readVarint(locationId) &&
+          cursor.readVarint(vendorId) && cursor.readVarint(productId) &&
+          cursor.readByte(interfaceNumber) &&
+          cursor.readString(identity.deviceName) &&
+          cursor.readString(identity.serialNumber) &&
+          cursor.readVarint(descriptorsLength) &&
+          cursor.readBytes(descriptors, descriptorsLength)) {
+        identity.locationId = static_cast<uint32_t>(locationId);
+        identity.vendorId = static_cast<uint16_t>(vendorId);
+        identity.productId = static_cast<uint16_t>(productId);
+        transports.push_back(std::make_shared<UVCReplayTransport>(
+            identity, interfaceNumber, descriptors, order, timing, clock));
+        isValid = true;
+      }
+    } else if (recordType == 'T') {
+      Transfer transfer;
+      uint64_t deltaMicros, durationMicros, lenDone;
+      uint8_t status;
+
+      if (device < transports.size() && cursor.readVarint(deltaMicros) &&
+          cursor.readVarint(durationMicros) &&
+          cursor.readByte(transfer.bmRequestType) &&
+          cursor.readByte(transfer.bRequest) &&
+          cursor.readUInt16(transfer.wValue) &&
+          cursor.readUInt16(transfer.wIndex) &&
+          cursor.readUInt16(transfer.wLength) && cursor.readByte(status) &&
+          status <= static_cast<uint8_t>(UVCTransferStatus::Rejected) &&
+          cursor.readVarint(lenDone)) {
+        uint64_t payloadLength =
+            (transfer.bmRequestType & 0x80) ? lenDone : transfer.wLength;
+
+        if (cursor.readBytes(transfer.payload, payloadLength)) {
+          startMicros += deltaMicros;
+          transfer.startMicros = startMicros;
+          transfer.durationMicros = static_cast<uint32_t>(durationMicros);
+          transfer.status = static_cast<UVCTransferStatus>(status);
+          transports[device]->addTransfer(std::move(transfer));
+          isValid = true;
+        }
+      }
+    }
+    if (!isValid) {
+      // A recording cut short by a crash ends in a partial record; keep
+      // everything before it.
+      UVC_DIAGNOSTIC(Warning, Parse,
+                     "%s: invalid or truncated record at offset %zu, "
+                     "ignoring the remainder of the trace",
+                     path.c_str(),
+                     static_cast<size_t>(cursor.p - trace.data() - 1));
+      break;
+    }
+  }
+  if (transports.empty()) {
+    UVC_DIAGNOSTIC(Error, Parse, "%s contains no devices", path.c_str());
+  }
+  return transports;
+}
+
+UVCReplayTransport::UVCReplayTransport(
+    const UVCDeviceIdentity& identity,
+    uint8_t interfaceNumber,
+    const std::vector<uint8_t>& videoControlDescriptors,
+    UVCReplayOrder order,
+    UVCReplayTiming timing,
+    std::shared_ptr<Clock> clock)
+    : _identity(identity),
+      _interfaceNumber(interfaceNumber),
+      _videoControlDescriptors(videoControlDescriptors),
+      _cursor(0),
+      _replayedCount(0),
+      _divergences(0),
+      _isOpen(false),
+      _order(order),
+      _timing(timing),
+      _clock(clock ? clock : std::make_shared<Clock>()) {}
+
+void UVCReplayTransport::addTransfer(Transfer&& transfer) {
+  std::lock_guard<std::mutex> guard(_lock);
+  uint64_t key = TransferKey(transfer.bmRequestType, transfer.bRequest,
+                             transfer.wValue, transfer.wIndex,
+                             transfer.wLength);
+
+  _transfersByKey[key].push_back(_transfers.size());
+  _transfers.push_back(std::move(transfer));
+  _isReplayed.push_back(false);
+}
+
+size_t UVCReplayTransport::transferCount() const {
+  std::lock_guard<std::mutex> guard(_lock);
+  return _transfers.size();
+}
+
+size_t UVCReplayTransport::remainingTransfers() const {
+  std::lock_guard<std::mutex> guard(_lock);
+  return _transfers.size() - _replayedCount;
+}
+
+uint64_t UVCReplayTransport::divergences() const {
+  std::lock_guard<std::mutex> guard(_lock);
+  return _divergences;
+}
+
+const UVCDeviceIdentity& UVCReplayTransport::identity() const {
+  return _identity;
+}
+
+uint8_t UVCReplayTransport::interfaceNumber() const {
+  return _interfaceNumber;
+}
+
+std::vector<uint8_t> UVCReplayTransport::videoControlDescriptors() const {
+  return _videoControlDescriptors;
+}
+
+bool UVCReplayTransport::isOpen() const {
+  std::lock_guard<std::mutex> guard(_lock);
+  return _isOpen;
+}
+
+bool UVCReplayTransport::open() {
+  std::lock_guard<std::mutex> guard(_lock);
+  _isOpen = true;
+  return true;
+}
+
+void UVCReplayTransport::close() {
+  std::lock_guard<std::mutex> guard(_lock);
+  _isOpen = false;
+}
+
+void UVCReplayTransport::markReplayed(const Transfer* transfer) {
+  size_t index = transfer - _transfers.data();
+  if (!_isReplayed[index]) {
+    _isReplayed[index] = true;
+    _replayedCount++;
+  }
+}
+
+const UVCReplayTransport::Transfer* UVCReplayTransport::nextKeyedTransfer(
+    uint64_t key) {
+  auto it = _transfersByKey.find(key);
+  if (it == _transfersByKey.end()) {
+    return nullptr;
+  }
+
+  size_t& keyCursor = _keyCursors[key];
+  const Transfer* transfer = &_transfers[it->second[keyCursor]];
+  if (keyCursor + 1 < it->second.size()) {
+    keyCursor++;
+  }
+  return transfer;
+}
+
+UVCTransferStatus UVCReplayTransport::controlRequest(
+    UVCControlRequest& request) {
+  std::unique_lock<std::mutex> guard(_lock);
+  uint64_t key = TransferKey(request.bmRequestType, request.bRequest,
+                             request.wValue, request.wIndex, request.wLength);
+  const Transfer* transfer = nullptr;
+
+  request.wLenDone = 0;
+  if (_order == UVCReplayOrder::Recorded) {
+    if (_cursor < _transfers.size()) {
+      const Transfer& next = _transfers[_cursor];
+      if (TransferKey(next.bmRequestType, next.bRequest, next.wValue,
+                      next.wIndex, next.wLength) == key) {
+        transfer = &next;
+        _cursor++;
+      }
+    }
+    if (!transfer) {
+      _divergences++;
+      transfer = nextKeyedTransfer(key);
+    }
+  } else {
+    transfer = nextKeyedTransfer(key);
+  }
+  if (!transfer) {
+    // Never recorded; a real device would most likely stall.
+    if (_order == UVCReplayOrder::Keyed) {
+      _divergences++;
+    }
+    return UVCTransferStatus::Stall;
+  }
+
+  markReplayed(transfer);
+
+  bool isDeviceToHost = (request.bmRequestType & 0x80) != 0;
+  if (!isDeviceToHost &&
+      (!request.pData || transfer->payload.size() != request.wLength ||
+       memcmp(transfer->payload.data(), request.pData, request.wLength) !=
+           0)) {
+    _divergences++;
+  }
+
+  Transfer response = *transfer;
+  guard.unlock();
+
+  if (_timing == UVCReplayTiming::RecordedSpeed) {
+    std::chrono::steady_clock::time_point startAt;
+    {
+      std::lock_guard<std::mutex> clockGuard(_clock->lock);
+      if (!_clock->isStarted) {
+        _clock->origin = std::chrono::steady_clock::now() -
+                         std::chrono::microseconds(response.startMicros);
+        _clock->isStarted = true;
+      }
+      startAt = _clock->origin + std::chrono::microseconds(response.startMicros);
+    }
+    std::this_thread::sleep_until(startAt);
+    std::this_thread::sleep_for(
+        std::chrono::microseconds(response.durationMicros));
+  }
+
+  if (isDeviceToHost) {
+    size_t length = response.payload.size();
+    if (length > request.wLength) {
+      length = request.wLength;
+    }
+    if (length && request.pData) {
+      memcpy(request.pData, response.payload.data(), length);
+    }
+    request.wLenDone = static_cast<uint32_t>(length);
+  } else {
+    request.wLenDone = response.status == UVCTransferStatus::Success
+                           ? request.wLength
+                           : 0;
+  }
+  return response.status;
+}
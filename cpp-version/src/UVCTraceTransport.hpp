@@ -0,0 +1,280 @@
+//
+// UVCTraceTransport.hpp
+//
+// Recording and replay of control transfer traces.
+//
+// Translated from Objective-C to C++
+// Copyright © 2016
+// Dr. Jeffrey Frey, IT-NSS
+// University of Delaware
+//
+// $Id$
+//
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "UVCTransport.hpp"
+
+/*
+  Trace file layout (all multi-byte integers little-endian, "varint" is an
+  unsigned LEB128 quantity):
+
+    header    "UVCTRACE" u16:version
+    device    'D' varint:device varint:locationId varint:vendorId
+              varint:productId u8:interfaceNumber
+              varint:len bytes:deviceName varint:len bytes:serialNumber
+              varint:len bytes:videoControlDescriptors
+    transfer  'T' varint:device varint:startDeltaMicros varint:durationMicros
+              u8:bmRequestType u8:bRequest u16:wValue u16:wIndex u16:wLength
+              u8:status varint:wLenDone bytes:payload
+
+  A transfer's start is relative to that of the previous transfer in the
+  file (the first is relative to the moment the trace was opened).  The
+  payload holds the wLenDone bytes the device returned for device-to-host
+  requests, and the wLength bytes the host sent otherwise.
+*/
+#define UVC_TRACE_VERSION 1
+
+/*!
+  @class UVCTraceWriter
+  @abstract Destination of one or more recording transports.
+
+  Any number of devices may be recorded into the same trace; records are
+  appended (and flushed) as transfers complete, so a trace is usable even if
+  the recording process does not exit cleanly.
+*/
+class UVCTraceWriter {
+ private:
+  std::mutex _lock;
+  FILE* _file;
+  uint32_t _deviceCount;
+  std::chrono::steady_clock::time_point _lastStart;
+  std::vector<uint8_t> _record;
+
+ public:
+  /*!
+    @method create
+
+    Returns a shared_ptr to a writer that truncates (or creates) the file at
+    path and writes the trace header to it.  Returns nullptr if the file
+    could not be opened.
+  */
+  static std::shared_ptr<UVCTraceWriter> create(const std::string& path);
+
+  explicit UVCTraceWriter(FILE* file);
+  ~UVCTraceWriter();
+
+  // Delete copy constructor and assignment operator
+  UVCTraceWriter(const UVCTraceWriter&) = delete;
+  UVCTraceWriter& operator=(const UVCTraceWriter&) = delete;
+
+  /*!
+    @method addDevice
+
+    Write a device record describing transport and return the index by which
+    its transfers are tagged.
+  */
+  uint32_t addDevice(UVCTransport& transport);
+
+  /*!
+    @method writeTransfer
+
+    Append a transfer record for the given (completed) request.
+  */
+  void writeTransfer(uint32_t device,
+                     std::chrono::steady_clock::time_point start,
+                     std::chrono::steady_clock::time_point end,
+                     const UVCControlRequest& request,
+                     UVCTransferStatus status);
+};
+
+/*!
+  @class UVCRecordingTransport
+  @abstract Decorator that logs every transfer of another transport.
+
+  All calls are passed through to the wrapped transport; each control
+  transfer, with its timing, status and payload, is appended to a trace.
+*/
+class UVCRecordingTransport final : public UVCTransport {
+ private:
+  std::shared_ptr<UVCTransport> _transport;
+  std::shared_ptr<UVCTraceWriter> _writer;
+  uint32_t _device;
+
+ public:
+  /*!
+    @method create
+
+    Returns a shared_ptr to a transport recording the transfers of transport
+    into writer.  Returns nullptr if either argument is nullptr.
+  */
+  static std::shared_ptr<UVCRecordingTransport> create(
+      std::shared_ptr<UVCTransport> transport,
+      std::shared_ptr<UVCTraceWriter> writer);
+
+  UVCRecordingTransport(std::shared_ptr<UVCTransport> transport,
+                        std::shared_ptr<UVCTraceWriter> writer);
+  ~UVCRecordingTransport() override = default;
+
+  // Delete copy constructor and assignment operator
+  UVCRecordingTransport(const UVCRecordingTransport&) = delete;
+  UVCRecordingTransport& operator=(const UVCRecordingTransport&) = delete;
+
+  const UVCDeviceIdentity& identity() const override;
+  uint8_t interfaceNumber() const override;
+  std::vector<uint8_t> videoControlDescriptors() const override;
+  std::vector<uint8_t> videoStreamingDescriptors() const override;
+  bool isOpen() const override;
+  bool open() override;
+  void close() override;
+  UVCTransferStatus controlRequest(UVCControlRequest& request) override;
+  bool reconnect() override;
+  bool recover(UVCRecoveryAction action) override;
+  UVCPowerState powerState() const override;
+};
+
+/*!
+  @typedef UVCReplayOrder
+
+  How a replay transport matches incoming requests to recorded transfers:
+
+    Recorded   requests are expected in exactly the recorded order; a
+               request that differs from the next recorded one counts as a
+               divergence and is answered as if keyed
+    Keyed      each distinct setup packet has its own queue of recorded
+               responses, consumed in order; once exhausted, the last one is
+               repeated
+*/
+enum class UVCReplayOrder { Recorded, Keyed };
+
+/*!
+  @typedef UVCReplayTiming
+
+  Whether a replay transport reproduces the recorded timing (transfers start
+  no earlier than they did in the recording, relative to the first one, and
+  take as long as they did) or answers immediately.
+*/
+enum class UVCReplayTiming { AsFastAsPossible, RecordedSpeed };
+
+/*!
+  @class UVCReplayTransport
+  @abstract Serves control transfers from a recorded trace.
+
+  Identity, interface number and VideoControl descriptors come from the
+  trace's device record, so a controller built on a replay transport behaves
+  exactly as the recorded one did, with no hardware present.
+*/
+class UVCReplayTransport final : public UVCTransport {
+ public:
+  struct Transfer {
+    uint64_t startMicros;
+    uint32_t durationMicros;
+    uint8_t bmRequestType;
+    uint8_t bRequest;
+    uint16_t wValue;
+    uint16_t wIndex;
+    uint16_t wLength;
+    UVCTransferStatus status;
+    std::vector<uint8_t> payload;
+  };
+
+  // Reference point shared by the replay transports of one trace:
+  struct Clock {
+    std::mutex lock;
+    bool isStarted = false;
+    std::chrono::steady_clock::time_point origin;
+  };
+
+ private:
+  mutable std::mutex _lock;
+  UVCDeviceIdentity _identity;
+  uint8_t _interfaceNumber;
+  std::vector<uint8_t> _videoControlDescriptors;
+  std::vector<Transfer> _transfers;
+  std::map<uint64_t, std::vector<size_t>> _transfersByKey;
+  std::map<uint64_t, size_t> _keyCursors;
+  size_t _cursor;
+  std::vector<bool> _isReplayed;
+  size_t _replayedCount;
+  uint64_t _divergences;
+  bool _isOpen;
+  UVCReplayOrder _order;
+  UVCReplayTiming _timing;
+  std::shared_ptr<Clock> _clock;
+
+ public:
+  /*!
+    @method createFromTrace
+
+    Read the trace at path and return one replay transport per recorded
+    device, in the order they were recorded.  Returns an empty vector (after
+    reporting the problem to stderr) if the file cannot be read or is not a
+    valid trace.
+  */
+  static std::vector<std::shared_ptr<UVCReplayTransport>> createFromTrace(
+      const std::string& path,
+      UVCReplayOrder order = UVCReplayOrder::Recorded,
+      UVCReplayTiming timing = UVCReplayTiming::AsFastAsPossible);
+
+  UVCReplayTransport(const UVCDeviceIdentity& identity,
+                     uint8_t interfaceNumber,
+                     const std::vector<uint8_t>& videoControlDescriptors,
+                     UVCReplayOrder order,
+                     UVCReplayTiming timing,
+                     std::shared_ptr<Clock> clock);
+  ~UVCReplayTransport() override = default;
+
+  // Delete copy constructor and assignment operator
+  UVCReplayTransport(const UVCReplayTransport&) = delete;
+  UVCReplayTransport& operator=(const UVCReplayTransport&) = delete;
+
+  /*!
+    @method addTransfer
+
+    Append a recorded transfer to the replay queue.
+  */
+  void addTransfer(Transfer&& transfer);
+
+  /*!
+    @method transferCount
+
+    Returns the number of recorded transfers.
+  */
+  size_t transferCount() const;
+
+  /*!
+    @method remainingTransfers
+
+    Returns the number of recorded transfers that have not been served.
+  */
+  size_t remainingTransfers() const;
+
+  /*!
+    @method divergences
+
+    Returns the number of requests that did not match the recording: wrong
+    order, unrecorded setup packet, or differing host-to-device payload.
+  */
+  uint64_t divergences() const;
+
+  const UVCDeviceIdentity& identity() const override;
+  uint8_t interfaceNumber() const override;
+  std::vector<uint8_t> videoControlDescriptors() const override;
+  bool isOpen() const override;
+  bool open() override;
+  void close() override;
+  UVCTransferStatus controlRequest(UVCControlRequest& request) override;
+
+ private:
+  const Transfer* nextKeyedTransfer(uint64_t key);
+  void markReplayed(const Transfer* transfer);
+};
@@ -0,0 +1,92 @@
+//
+// UVCTransport.cpp
+//
+// Abstract carrier for the control requests a UVCDeviceController sends to a
+// video device.
+//
+// Translated from Objective-C to C++
+// Copyright © 2016
+// Dr. Jeffrey Frey, IT-NSS
+// University of Delaware
+//
+// $Id$
+//
+
+#include "UVCTransport.hpp"
+
+#include <cstdio>
+#include <cstring>
+
+const char* UVCTransferStatusString(UVCTransferStatus status) {
+  switch (status) {
+    case UVCTransferStatus::Success:
+      return "success";
+    case UVCTransferStatus::Stall:
+      return "stall";
+    case UVCTransferStatus::Timeout:
+      return "timeout";
+    case UVCTransferStatus::NoDevice:
+      return "no-device";
+    case UVCTransferStatus::Error:
+      return "error";
+    case UVCTransferStatus::Rejected:
+      return "rejected";
+  }
+  return "<invalid>";
+}
+
+const char* UVCRecoveryActionString(UVCRecoveryAction action) {
+  switch (action) {
+    case UVCRecoveryAction::ClearStall:
+      return "clear-stall";
+    case UVCRecoveryAction::ReopenInterface:
+      return "reopen-interface";
+    case UVCRecoveryAction::ResetPort:
+      return "reset-port";
+  }
+  return "<invalid>";
+}
+
+UVCPowerState UVCSysfsPowerState(const std::string& sysfsDevicePath) {
+  std::string path = sysfsDevicePath + "/power/runtime_status";
+  FILE* statusFile = fopen(path.c_str(), "r");
+  char status[32] = "";
+
+  if (!statusFile) {
+    return UVCPowerState::Active;
+  }
+  if (!fgets(status, sizeof(status), statusFile)) {
+    status[0] = '\0';
+  }
+  fclose(statusFile);
+
+  // "suspended", "suspending", "resuming" or "active"; only the first has
+  // the device asleep with nothing yet under way to wake it:
+  return strncmp(status, "suspended", 9) == 0 ? UVCPowerState::Suspended
+                                              : UVCPowerState::Active;
+}
+
+void UVCTransport::controlRequests(UVCControlRequest* requests,
+                                   UVCTransferStatus* statuses,
+                                   size_t count) {
+  for (size_t i = 0; i < count; i++) {
+    statuses[i] = controlRequest(requests[i]);
+  }
+}
+
+bool UVCTransport::reconnect() {
+  close();
+  return open();
+}
+
+bool UVCTransport::recover(UVCRecoveryAction action) {
+  if (action != UVCRecoveryAction::ReopenInterface) {
+    return false;
+  }
+  close();
+  return open();
+}
+
+UVCPowerState UVCTransport::powerState() const {
+  return UVCPowerState::Active;
+}
@@ -0,0 +1,232 @@
+//
+// UVCTransport.hpp
+//
+// Abstract carrier for the control requests a UVCDeviceController sends to a
+// video device.
+//
+// Translated from Objective-C to C++
+// Copyright © 2016
+// Dr. Jeffrey Frey, IT-NSS
+// University of Delaware
+//
+// $Id$
+//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+/*!
+  @typedef UVCTransferStatus
+
+  Enumerates the outcomes of a single control transfer.  Transports map their
+  native error codes onto these so that the controller can tell a control
+  that is not implemented (Stall) from a device that has gone away (NoDevice).
+  Rejected transfers were refused without reaching the device, e.g. by an
+  open circuit breaker.
+*/
+enum class UVCTransferStatus {
+  Success = 0,
+  Stall,
+  Timeout,
+  NoDevice,
+  Error,
+  Rejected
+};
+
+/*!
+  @function UVCTransferStatusString
+
+  Returns a short textual name for the given status.
+*/
+const char* UVCTransferStatusString(UVCTransferStatus status);
+
+/*!
+  @typedef UVCRecoveryAction
+
+  The steps taken to revive a device that stopped answering control
+  transfers, least disruptive first:  clear a stall on the default control
+  pipe, close and re-open the VideoControl interface, reset the USB port (the
+  device re-enumerates and must be reconnected).
+*/
+enum class UVCRecoveryAction { ClearStall = 0, ReopenInterface, ResetPort };
+
+/*!
+  @function UVCRecoveryActionString
+
+  Returns a short textual name for the given recovery action.
+*/
+const char* UVCRecoveryActionString(UVCRecoveryAction action);
+
+/*!
+  @typedef UVCPowerState
+
+  Runtime power state of a device.  A Suspended device (USB autosuspend)
+  must be resumed, typically at a cost of tens of milliseconds, before it
+  answers a control transfer.
+*/
+enum class UVCPowerState { Active, Suspended };
+
+/*!
+  @function UVCSysfsPowerState
+
+  Returns the runtime power state Linux reports for the USB device at
+  sysfsDevicePath (e.g. "/sys/bus/usb/devices/1-2"), read from its
+  power/runtime_status.  A device whose state cannot be read is taken to be
+  Active.
+*/
+UVCPowerState UVCSysfsPowerState(const std::string& sysfsDevicePath);
+
+/*!
+  @struct UVCControlRequest
+
+  Platform-neutral form of a USB setup packet plus its data stage.  The
+  layout of the first five fields matches the USB standard setup packet; pData
+  must reference at least wLength bytes.  On return, wLenDone holds the number
+  of bytes actually transferred.
+*/
+struct UVCControlRequest {
+  uint8_t bmRequestType;
+  uint8_t bRequest;
+  uint16_t wValue;
+  uint16_t wIndex;
+  uint16_t wLength;
+  void* pData;
+  uint32_t wLenDone;
+};
+
+/*!
+  @struct UVCDeviceIdentity
+
+  The identifying attributes of the USB device behind a transport.
+*/
+struct UVCDeviceIdentity {
+  std::string deviceName;
+  std::string serialNumber;
+  uint32_t locationId = 0;
+  uint16_t vendorId = 0;
+  uint16_t productId = 0;
+  // Device release (BCD); zero if unknown:
+  uint16_t bcdDevice = 0;
+};
+
+/*!
+  @class UVCTransport
+  @abstract Carrier for UVC control requests.
+
+  A UVCDeviceController never talks to the USB stack directly; every request
+  is handed to a UVCTransport.  The IOKit transport drives real hardware, while
+  other implementations (e.g. UVCSimulatedTransport) stand in for a camera
+  without one being attached.
+*/
+class UVCTransport {
+ public:
+  virtual ~UVCTransport() = default;
+
+  /*!
+    @method identity
+
+    Returns the identifying attributes of the device.
+  */
+  virtual const UVCDeviceIdentity& identity() const = 0;
+
+  /*!
+    @method interfaceNumber
+
+    Returns the bInterfaceNumber of the VideoControl interface; it forms the
+    low byte of wIndex in every control request.
+  */
+  virtual uint8_t interfaceNumber() const = 0;
+
+  /*!
+    @method videoControlDescriptors
+
+    Returns the class-specific VideoControl descriptor block, starting with the
+    VC header and spanning its wTotalLength.  Empty if unavailable.
+  */
+  virtual std::vector<uint8_t> videoControlDescriptors() const = 0;
+
+  /*!
+    @method videoStreamingDescriptors
+
+    Returns the class-specific descriptors of the device's VideoStreaming
+    interfaces (input/output headers, formats and frames), concatenated in
+    interface order.  Transports that cannot see them return an empty vector,
+    which is the default.
+  */
+  virtual std::vector<uint8_t> videoStreamingDescriptors() const { return {}; }
+
+  /*!
+    @method isOpen
+
+    Returns true if the transport is ready to carry control requests.
+  */
+  virtual bool isOpen() const = 0;
+
+  /*!
+    @method open
+
+    Attempt to make the transport ready to carry control requests.  Returns
+    true if the transport is open on return.
+  */
+  virtual bool open() = 0;
+
+  /*!
+    @method close
+
+    Release the device interface, where the transport is allowed to.
+  */
+  virtual void close() = 0;
+
+  /*!
+    @method controlRequest
+
+    Perform a control transfer on endpoint zero.
+  */
+  virtual UVCTransferStatus controlRequest(UVCControlRequest& request) = 0;
+
+  /*!
+    @method controlRequests
+
+    Perform count control transfers in order, storing the outcome of each in
+    statuses.  A failed transfer does not stop the ones after it.  The default
+    issues them back to back with controlRequest; transports that can keep
+    several transfers in flight override it.
+  */
+  virtual void controlRequests(UVCControlRequest* requests,
+                               UVCTransferStatus* statuses,
+                               size_t count);
+
+  /*!
+    @method reconnect
+
+    Find the device again after it dropped off the bus (a request failed with
+    NoDevice) and open it.  Transports bound to a USB device look it up by
+    serial number, or by port when it has none.  The default closes and
+    re-opens the transport.
+
+    Returns true if the device is back and the transport is open.
+  */
+  virtual bool reconnect();
+
+  /*!
+    @method recover
+
+    Perform the given recovery action on a device that stopped answering.
+    Returns false if the action failed or the transport cannot perform it;
+    by default only ReopenInterface is performed, as close() and open().
+  */
+  virtual bool recover(UVCRecoveryAction action);
+
+  /*!
+    @method powerState
+
+    Returns the device's runtime power state without waking it.  The default
+    is Active, for transports that cannot tell.
+  */
+  virtual UVCPowerState powerState() const;
+};
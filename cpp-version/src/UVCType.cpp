@@ -17,22 +17,9 @@
 #include <climits>
 #include <cmath>
 #include <cstring>
-#include <iomanip>
-#include <iostream>
-#include <sstream>
-
-// Platform-specific byte swapping
-#if defined(__APPLE__)
-#include <libkern/OSByteOrder.h>
-#define htole16(x) OSSwapHostToLittleInt16(x)
-#define le16toh(x) OSSwapLittleToHostInt16(x)
-#define htole32(x) OSSwapHostToLittleInt32(x)
-#define le32toh(x) OSSwapLittleToHostInt32(x)
-#define htole64(x) OSSwapHostToLittleInt64(x)
-#define le64toh(x) OSSwapLittleToHostInt64(x)
-#elif defined(__linux__)
-#include <endian.h>
-#endif
+
+#include "UVCDiagnostics.hpp"
+#include "UVCLayout.hpp"
 
 size_t UVCTypeComponentByteSize(UVCTypeComponentType componentType) {
   static const size_t byteSizes[] = {
@@ -197,7 +184,8 @@ UVCTypeComponentType UVCType::componentTypeFromString(const char* typeDefString,
 }
 
 std::shared_ptr<UVCType> UVCType::createFromCString(
-    const char* typeDescription) {
+    const char* typeDescription,
+    std::shared_ptr<UVCArena> arena) {
   const char* originalStr = typeDescription;
 
   // Drop any leading whitespace:
@@ -207,8 +195,7 @@ std::shared_ptr<UVCType> UVCType::createFromCString(
 
   // Starts with a brace?
   if (*typeDescription != '{') {
-    std::cerr << "WARNING: No opening brace found: " << originalStr
-              << std::endl;
+    UVC_DIAGNOSTIC(Warning, Parse, "No opening brace found: %s", originalStr);
     return nullptr;
   }
   typeDescription++;
@@ -224,9 +211,8 @@ std::shared_ptr<UVCType> UVCType::createFromCString(
         componentTypeFromString(typeDescription, &nChar);
 
     if (nextType == UVCTypeComponentType::Invalid) {
-      std::cerr << "WARNING: Invalid type string at "
-                << (typeDescription - originalStr) << " in: " << originalStr
-                << std::endl;
+      UVC_DIAGNOSTIC(Warning, Parse, "Invalid type string at %td in: %s",
+                     typeDescription - originalStr, originalStr);
       return nullptr;
     }
     typeDescription += nChar;
@@ -235,9 +221,8 @@ std::shared_ptr<UVCType> UVCType::createFromCString(
     while (isspace(*typeDescription))
       typeDescription++;
     if (!*typeDescription) {
-      std::cerr << "WARNING: Early end to type string at "
-                << (typeDescription - originalStr) << " in: " << originalStr
-                << std::endl;
+      UVC_DIAGNOSTIC(Warning, Parse, "Early end to type string at %td in: %s",
+                     typeDescription - originalStr, originalStr);
       return nullptr;
     }
 
@@ -253,9 +238,8 @@ std::shared_ptr<UVCType> UVCType::createFromCString(
     while (isalnum(*typeDescription) || (*typeDescription == '-'))
       typeDescription++;
     if (!*typeDescription) {
-      std::cerr << "WARNING: Early end to type string at "
-                << (typeDescription - originalStr) << " in: " << originalStr
-                << std::endl;
+      UVC_DIAGNOSTIC(Warning, Parse, "Early end to type string at %td in: %s",
+                     typeDescription - originalStr, originalStr);
       return nullptr;
     }
 
@@ -318,9 +302,9 @@ std::shared_ptr<UVCType> UVCType::createFromCString(
       // Ensure that no other fields have used this name:
       for (size_t altFieldIdx = 0; altFieldIdx < fieldIdx; altFieldIdx++) {
         if (fieldNames[altFieldIdx] == fieldNames[fieldIdx]) {
-          std::cerr << "WARNING: Repeated use of type name at index "
-                    << (typeDescription - originalStr) << " in '" << originalStr
-                    << "'" << std::endl;
+          UVC_DIAGNOSTIC(Warning, Parse,
+                         "Repeated use of type name at index %td in '%s'",
+                         typeDescription - originalStr, originalStr);
           return nullptr;
         }
       }
@@ -336,14 +320,15 @@ std::shared_ptr<UVCType> UVCType::createFromCString(
       if (*typeDescription == '}')
         break;
     }
-    return createWithFieldNamesAndTypes(fieldNames, fieldTypes);
+    return createWithFieldNamesAndTypes(fieldNames, fieldTypes, arena);
   }
   return nullptr;
 }
 
 std::shared_ptr<UVCType> UVCType::createWithFieldNamesAndTypes(
     const std::vector<std::string>& names,
-    const std::vector<UVCTypeComponentType>& types) {
+    const std::vector<UVCTypeComponentType>& types,
+    std::shared_ptr<UVCArena> arena) {
   if (names.size() != types.size()) {
     return nullptr;
   }
@@ -354,15 +339,15 @@ std::shared_ptr<UVCType> UVCType::createWithFieldNamesAndTypes(
     }
   }
 
-  auto newType = std::make_shared<UVCType>();
+  UVCArenaAllocator<UVCType> allocator(arena);
+  auto newType = std::allocate_shared<UVCType>(allocator, arena);
   newType->_fields.reserve(names.size());
 
   bool needsNoByteSwap = true;
   for (size_t i = 0; i < names.size(); i++) {
-    UVCTypeField field;
-    field.fieldName = names[i];
-    field.fieldType = types[i];
-    newType->_fields.push_back(field);
+    newType->_fields.push_back(
+        {UVCArenaString(names[i].data(), names[i].size(), allocator),
+         types[i]});
 
     if (UVCTypeComponentByteSize(types[i]) != 1) {
       needsNoByteSwap = false;
@@ -374,10 +359,15 @@ std::shared_ptr<UVCType> UVCType::createWithFieldNamesAndTypes(
 #else
   newType->_needsNoByteSwap = needsNoByteSwap;
 #endif
+  newType->_codec = UVCLayoutCodecForComponents(types.data(), types.size());
 
   return newType;
 }
 
+UVCType::UVCType(std::shared_ptr<UVCArena> arena)
+    : _fields(UVCArenaAllocator<UVCTypeField>(arena)),
+      _needsNoByteSwap(false) {}
+
 size_t UVCType::fieldCount() const {
   return _fields.size();
 }
@@ -386,7 +376,8 @@ std::string UVCType::fieldNameAtIndex(size_t index) const {
   if (index >= _fields.size()) {
     return "";
   }
-  return _fields[index].fieldName;
+  return std::string(_fields[index].fieldName.data(),
+                     _fields[index].fieldName.size());
 }
 
 UVCTypeComponentType UVCType::fieldTypeAtIndex(size_t index) const {
@@ -441,100 +432,85 @@ void UVCType::byteSwapHostToUSBEndian(void* buffer) const {
   if (_needsNoByteSwap)
     return;
 
+  if (_codec) {
+    _codec->byteSwap(buffer);
+    return;
+  }
+
   uint8_t* bufferPtr = static_cast<uint8_t*>(buffer);
 
   for (const auto& field : _fields) {
-    switch (field.fieldType) {
-      case UVCTypeComponentType::Boolean:
-      case UVCTypeComponentType::Bitmap8:
-      case UVCTypeComponentType::SInt8:
-      case UVCTypeComponentType::UInt8:
-        bufferPtr++;
-        break;
+    UVCComponentDispatch(field.fieldType, [&](auto component) {
+      decltype(component)::byteSwap(bufferPtr);
+      bufferPtr += decltype(component)::byteSize;
+    });
+  }
+}
 
-      case UVCTypeComponentType::SInt16:
-      case UVCTypeComponentType::UInt16:
-      case UVCTypeComponentType::Bitmap16: {
-        uint16_t* asInt16Ptr = reinterpret_cast<uint16_t*>(bufferPtr);
-        *asInt16Ptr = htole16(*asInt16Ptr);
-        bufferPtr += 2;
-        break;
-      }
+void UVCType::byteSwapUSBToHostEndian(void* buffer) const {
+  // Swapping between host and USB order is symmetric:
+  byteSwapHostToUSBEndian(buffer);
+}
 
-      case UVCTypeComponentType::SInt32:
-      case UVCTypeComponentType::UInt32:
-      case UVCTypeComponentType::Bitmap32: {
-        uint32_t* asInt32Ptr = reinterpret_cast<uint32_t*>(bufferPtr);
-        *asInt32Ptr = htole32(*asInt32Ptr);
-        bufferPtr += 4;
-        break;
-      }
+size_t UVCType::encodeBuffer(const void* buffer,
+                             uint8_t* out,
+                             size_t outSize) const {
+  if (_codec) {
+    return _codec->encodeBuffer(buffer, out, outSize);
+  }
 
-      case UVCTypeComponentType::SInt64:
-      case UVCTypeComponentType::UInt64:
-      case UVCTypeComponentType::Bitmap64: {
-        uint64_t* asInt64Ptr = reinterpret_cast<uint64_t*>(bufferPtr);
-        *asInt64Ptr = htole64(*asInt64Ptr);
-        bufferPtr += 8;
-        break;
-      }
+  const uint8_t* bufferPtr = static_cast<const uint8_t*>(buffer);
+  size_t offset =
+      UVCCborWriteHead(kUVCCborMap, _fields.size(), out, outSize, 0);
 
-      case UVCTypeComponentType::Max:
-      case UVCTypeComponentType::Invalid:
-        // Should never get here!
-        break;
-    }
+  for (size_t i = 0; i < _fields.size(); i++) {
+    offset += UVCCborWriteHead(kUVCCborUnsigned, i, out, outSize, offset);
+    UVCComponentDispatch(_fields[i].fieldType, [&](auto component) {
+      offset += decltype(component)::encode(bufferPtr, out, outSize, offset);
+      bufferPtr += decltype(component)::byteSize;
+    });
   }
+  return offset;
 }
 
-void UVCType::byteSwapUSBToHostEndian(void* buffer) const {
-  if (_needsNoByteSwap)
-    return;
-
-  uint8_t* bufferPtr = static_cast<uint8_t*>(buffer);
-
-  for (const auto& field : _fields) {
-    switch (field.fieldType) {
-      case UVCTypeComponentType::Boolean:
-      case UVCTypeComponentType::Bitmap8:
-      case UVCTypeComponentType::SInt8:
-      case UVCTypeComponentType::UInt8:
-        bufferPtr++;
-        break;
+bool UVCType::decodeBuffer(const uint8_t* data,
+                           size_t length,
+                           void* buffer,
+                           size_t* consumed) const {
+  if (_codec) {
+    return _codec->decodeBuffer(data, length, buffer, consumed);
+  }
 
-      case UVCTypeComponentType::SInt16:
-      case UVCTypeComponentType::UInt16:
-      case UVCTypeComponentType::Bitmap16: {
-        uint16_t* asInt16Ptr = reinterpret_cast<uint16_t*>(bufferPtr);
-        *asInt16Ptr = le16toh(*asInt16Ptr);
-        bufferPtr += 2;
-        break;
-      }
+  size_t offset = 0;
+  uint8_t majorType;
+  uint64_t entryCount, index;
 
-      case UVCTypeComponentType::SInt32:
-      case UVCTypeComponentType::UInt32:
-      case UVCTypeComponentType::Bitmap32: {
-        uint32_t* asInt32Ptr = reinterpret_cast<uint32_t*>(bufferPtr);
-        *asInt32Ptr = le32toh(*asInt32Ptr);
-        bufferPtr += 4;
-        break;
-      }
+  if (!UVCCborReadHead(data, length, offset, majorType, entryCount) ||
+      majorType != kUVCCborMap) {
+    return false;
+  }
+  while (entryCount--) {
+    bool isDecoded = false;
 
-      case UVCTypeComponentType::SInt64:
-      case UVCTypeComponentType::UInt64:
-      case UVCTypeComponentType::Bitmap64: {
-        uint64_t* asInt64Ptr = reinterpret_cast<uint64_t*>(bufferPtr);
-        *asInt64Ptr = le64toh(*asInt64Ptr);
-        bufferPtr += 8;
-        break;
-      }
+    if (!UVCCborReadHead(data, length, offset, majorType, index) ||
+        majorType != kUVCCborUnsigned || index >= _fields.size()) {
+      return false;
+    }
 
-      case UVCTypeComponentType::Max:
-      case UVCTypeComponentType::Invalid:
-        // Should never get here!
-        break;
+    uint8_t* fieldPtr =
+        static_cast<uint8_t*>(buffer) + offsetToFieldAtIndex(index);
+    UVCComponentDispatch(_fields[index].fieldType, [&](auto component) {
+      isDecoded =
+          decltype(component)::decode(data, length, offset, fieldPtr);
+    });
+    if (!isDecoded) {
+      return false;
     }
   }
+  if (consumed) {
+    *consumed = offset;
+  }
+  return true;
 }
 
 bool UVCType::scanCString(const char* cString,
@@ -545,6 +521,9 @@ bool UVCType::scanCString(const char* cString,
 }
 
 bool UVCType::isEqual(const UVCType& other) const {
+  if (_codec && _codec == other._codec) {
+    return true;
+  }
   if (fieldCount() != other.fieldCount() || byteSize() != other.byteSize()) {
     return false;
   }
@@ -557,122 +536,111 @@ bool UVCType::isEqual(const UVCType& other) const {
   return true;
 }
 
-std::string UVCType::stringFromBuffer(void* buffer) const {
-  if (_fields.size() == 1) {
-    const uint8_t* bufferPtr = static_cast<const uint8_t*>(buffer);
-
-    switch (_fields[0].fieldType) {
-      case UVCTypeComponentType::Boolean:
-        return *bufferPtr ? "true" : "false";
-
-      case UVCTypeComponentType::SInt8:
-        return std::to_string(*reinterpret_cast<const int8_t*>(bufferPtr));
-
-      case UVCTypeComponentType::UInt8:
-      case UVCTypeComponentType::Bitmap8:
-        return std::to_string(*bufferPtr);
+bool UVCType::isEqualBuffer(const void* buffer,
+                            const void* otherBuffer) const {
+  if (_codec) {
+    return _codec->isEqualBuffer(buffer, otherBuffer);
+  }
+  return memcmp(buffer, otherBuffer, byteSize()) == 0;
+}
 
-      case UVCTypeComponentType::SInt16:
-        return std::to_string(*reinterpret_cast<const int16_t*>(bufferPtr));
+void UVCType::clampBuffer(void* buffer,
+                          const void* minimum,
+                          const void* maximum) const {
+  if (_codec) {
+    _codec->clampBuffer(buffer, minimum, maximum);
+    return;
+  }
 
-      case UVCTypeComponentType::UInt16:
-      case UVCTypeComponentType::Bitmap16:
-        return std::to_string(*reinterpret_cast<const uint16_t*>(bufferPtr));
+  size_t offset = 0;
 
-      case UVCTypeComponentType::SInt32:
-        return std::to_string(*reinterpret_cast<const int32_t*>(bufferPtr));
+  for (const auto& field : _fields) {
+    UVCComponentDispatch(field.fieldType, [&](auto component) {
+      decltype(component)::clamp(
+          static_cast<uint8_t*>(buffer) + offset,
+          minimum ? static_cast<const uint8_t*>(minimum) + offset : nullptr,
+          maximum ? static_cast<const uint8_t*>(maximum) + offset : nullptr);
+      offset += decltype(component)::byteSize;
+    });
+  }
+}
 
-      case UVCTypeComponentType::UInt32:
-      case UVCTypeComponentType::Bitmap32:
-        return std::to_string(*reinterpret_cast<const uint32_t*>(bufferPtr));
+bool UVCType::usesLayoutCodec() const {
+  return _codec != nullptr;
+}
 
-      case UVCTypeComponentType::SInt64:
-        return std::to_string(*reinterpret_cast<const int64_t*>(bufferPtr));
+const UVCLayoutCodec* UVCType::layoutCodec() const {
+  return _codec;
+}
 
-      case UVCTypeComponentType::UInt64:
-      case UVCTypeComponentType::Bitmap64:
-        return std::to_string(*reinterpret_cast<const uint64_t*>(bufferPtr));
+void UVCType::setUsesLayoutCodec(bool usesLayoutCodec) {
+  _codec = nullptr;
+  if (usesLayoutCodec) {
+    std::vector<UVCTypeComponentType> types;
 
-      case UVCTypeComponentType::Max:
-      case UVCTypeComponentType::Invalid:
-        return "";
+    for (const auto& field : _fields) {
+      types.push_back(field.fieldType);
     }
+    _codec = UVCLayoutCodecForComponents(types.data(), types.size());
   }
+}
 
-  std::stringstream ss;
-  ss << "{";
-
-  const uint8_t* bufferPtr = static_cast<const uint8_t*>(buffer);
-  bool shouldIncludeComma = false;
-
-  for (const auto& field : _fields) {
-    if (shouldIncludeComma) {
-      ss << ",";
-    }
-
-    ss << field.fieldName << "=";
-
-    switch (field.fieldType) {
-      case UVCTypeComponentType::Boolean:
-        ss << (*bufferPtr ? "true" : "false");
-        bufferPtr++;
-        break;
+std::string UVCType::stringFromBuffer(void* buffer) const {
+  char scratch[256];
+  size_t length = formatBuffer(buffer, scratch, sizeof(scratch));
 
-      case UVCTypeComponentType::SInt8:
-        ss << static_cast<int>(*reinterpret_cast<const int8_t*>(bufferPtr));
-        bufferPtr++;
-        break;
+  if (length < sizeof(scratch)) {
+    return std::string(scratch, length);
+  }
 
-      case UVCTypeComponentType::UInt8:
-      case UVCTypeComponentType::Bitmap8:
-        ss << static_cast<unsigned int>(*bufferPtr);
-        bufferPtr++;
-        break;
+  std::string longString(length + 1, '\0');
+  formatBuffer(buffer, &longString[0], longString.size());
+  longString.resize(length);
+  return longString;
+}
 
-      case UVCTypeComponentType::SInt16:
-        ss << *reinterpret_cast<const int16_t*>(bufferPtr);
-        bufferPtr += 2;
-        break;
+size_t UVCType::formatBuffer(const void* buffer,
+                             char* outString,
+                             size_t outSize) const {
+  if (_codec) {
+    return _codec->formatBuffer(*this, buffer, outString, outSize);
+  }
 
-      case UVCTypeComponentType::UInt16:
-      case UVCTypeComponentType::Bitmap16:
-        ss << *reinterpret_cast<const uint16_t*>(bufferPtr);
-        bufferPtr += 2;
-        break;
+  const uint8_t* bufferPtr = static_cast<const uint8_t*>(buffer);
+  size_t offset = 0;
 
-      case UVCTypeComponentType::SInt32:
-        ss << *reinterpret_cast<const int32_t*>(bufferPtr);
-        bufferPtr += 4;
-        break;
+  if (outString && outSize) {
+    *outString = '\0';
+  } else {
+    outSize = 0;
+  }
 
-      case UVCTypeComponentType::UInt32:
-      case UVCTypeComponentType::Bitmap32:
-        ss << *reinterpret_cast<const uint32_t*>(bufferPtr);
-        bufferPtr += 4;
-        break;
+  // Appends the value of one field and moves on to the next:
+  auto formatField = [&](auto component) {
+    offset += UVCFormatComponent<decltype(component)>(bufferPtr, outString,
+                                                      outSize, offset);
+    bufferPtr += decltype(component)::byteSize;
+  };
 
-      case UVCTypeComponentType::SInt64:
-        ss << *reinterpret_cast<const int64_t*>(bufferPtr);
-        bufferPtr += 8;
-        break;
+  if (_fields.size() == 1) {
+    UVCComponentDispatch(_fields[0].fieldType, formatField);
+    return offset;
+  }
 
-      case UVCTypeComponentType::UInt64:
-      case UVCTypeComponentType::Bitmap64:
-        ss << *reinterpret_cast<const uint64_t*>(bufferPtr);
-        bufferPtr += 8;
-        break;
+  offset += UVCFormatText("{", 1, outString, outSize, offset);
+  for (size_t i = 0; i < _fields.size(); i++) {
+    const auto& field = _fields[i];
 
-      case UVCTypeComponentType::Max:
-      case UVCTypeComponentType::Invalid:
-        // Should never get here!
-        break;
+    if (i > 0) {
+      offset += UVCFormatText(",", 1, outString, outSize, offset);
     }
-
-    shouldIncludeComma = true;
+    offset += UVCFormatText(field.fieldName.data(), field.fieldName.size(),
+                            outString, outSize, offset);
+    offset += UVCFormatText("=", 1, outString, outSize, offset);
+    UVCComponentDispatch(field.fieldType, formatField);
   }
-
-  ss << "}";
-  return ss.str();
+  offset += UVCFormatText("}", 1, outString, outSize, offset);
+  return offset;
 }
 
 std::string UVCType::typeSummaryString() const {
@@ -681,16 +649,16 @@ std::string UVCType::typeSummaryString() const {
            componentVerboseTypeString(_fields[0].fieldType);
   }
 
-  std::stringstream ss;
-  ss << "(";
+  std::string summary("(");
   for (size_t i = 0; i < _fields.size(); i++) {
     if (i > 0)
-      ss << "; ";
-    ss << componentVerboseTypeString(_fields[i].fieldType) << " "
-       << _fields[i].fieldName;
+      summary += "; ";
+    summary += componentVerboseTypeString(_fields[i].fieldType);
+    summary += " ";
+    summary.append(_fields[i].fieldName.data(), _fields[i].fieldName.size());
   }
-  ss << ")";
-  return ss.str();
+  summary += ")";
+  return summary;
 }
 
 bool UVCType::scanCString(const char* cString,
@@ -716,8 +684,8 @@ bool UVCType::scanCString(const char* cString,
     }
     if (static_cast<uint32_t>(flags) &
         static_cast<uint32_t>(UVCTypeScanFlags::ShowWarnings)) {
-      std::cerr << "WARNING: No default value provided by this control"
-                << std::endl;
+      UVC_DIAGNOSTIC(Warning, Parse,
+                     "No default value provided by this control");
     }
     return false;
   }
@@ -740,9 +708,8 @@ bool UVCType::scanCString(const char* cString,
 
   // Single field case - can omit braces
   if (_fields.size() == 1 && *cString != '{') {
-    return componentTypeScanf(cString, _fields[0].fieldType, buffer, flags,
-                              minimum, maximum, stepSize, defaultValue,
-                              nullptr);
+    return scanFieldAtIndex(0, cString, buffer, flags, minimum, maximum,
+                            stepSize, defaultValue, nullptr);
   }
 
   // Multi-field case with braces (or single field with braces)
@@ -786,24 +753,10 @@ bool UVCType::scanCString(const char* cString,
       cString++;  // Skip '='
     }
 
-    // Calculate field offset and pointers
-    size_t fieldOffset = offsetToFieldAtIndex(actualFieldIdx);
-    void* valuePtr = static_cast<uint8_t*>(buffer) + fieldOffset;
-    void* minimumPtr =
-        minimum ? static_cast<uint8_t*>(minimum) + fieldOffset : nullptr;
-    void* maximumPtr =
-        maximum ? static_cast<uint8_t*>(maximum) + fieldOffset : nullptr;
-    void* stepSizePtr =
-        stepSize ? static_cast<uint8_t*>(stepSize) + fieldOffset : nullptr;
-    void* defaultValuePtr =
-        defaultValue ? static_cast<uint8_t*>(defaultValue) + fieldOffset
-                     : nullptr;
-
     // Parse the value
     size_t nChar = 0;
-    if (!componentTypeScanf(cString, _fields[actualFieldIdx].fieldType,
-                            valuePtr, flags, minimumPtr, maximumPtr,
-                            stepSizePtr, defaultValuePtr, &nChar)) {
+    if (!scanFieldAtIndex(actualFieldIdx, cString, buffer, flags, minimum,
+                          maximum, stepSize, defaultValue, &nChar)) {
       return false;
     }
 
@@ -817,6 +770,38 @@ bool UVCType::scanCString(const char* cString,
   return true;
 }
 
+bool UVCType::scanFieldAtIndex(size_t index,
+                               const char* cString,
+                               void* buffer,
+                               UVCTypeScanFlags flags,
+                               void* minimum,
+                               void* maximum,
+                               void* stepSize,
+                               void* defaultValue,
+                               size_t* nChar) const {
+  if (_codec) {
+    return _codec->scanField(index, cString, buffer, minimum, maximum,
+                             defaultValue, nChar);
+  }
+
+  // Calculate field offset and pointers
+  size_t fieldOffset = offsetToFieldAtIndex(index);
+  void* valuePtr = static_cast<uint8_t*>(buffer) + fieldOffset;
+  void* minimumPtr =
+      minimum ? static_cast<uint8_t*>(minimum) + fieldOffset : nullptr;
+  void* maximumPtr =
+      maximum ? static_cast<uint8_t*>(maximum) + fieldOffset : nullptr;
+  void* stepSizePtr =
+      stepSize ? static_cast<uint8_t*>(stepSize) + fieldOffset : nullptr;
+  void* defaultValuePtr =
+      defaultValue ? static_cast<uint8_t*>(defaultValue) + fieldOffset
+                   : nullptr;
+
+  return componentTypeScanf(cString, _fields[index].fieldType, valuePtr, flags,
+                            minimumPtr, maximumPtr, stepSizePtr,
+                            defaultValuePtr, nChar);
+}
+
 bool UVCType::componentTypeScanf(const char* cString,
                                  UVCTypeComponentType theType,
                                  void* theValue,
@@ -826,153 +811,11 @@ bool UVCType::componentTypeScanf(const char* cString,
                                  void* theStepSize,
                                  void* theDefaultValue,
                                  size_t* nChar) {
-  if (!cString || !theValue) {
-    return false;
-  }
-
-  // Skip leading whitespace
-  while (isspace(*cString))
-    cString++;
-  const char* start = cString;
-
-  // Handle special keywords
-  if (strncasecmp(cString, "default", 7) == 0) {
-    if (!theDefaultValue)
-      return false;
-
-    switch (theType) {
-      case UVCTypeComponentType::SInt8:
-        *static_cast<int8_t*>(theValue) =
-            *static_cast<int8_t*>(theDefaultValue);
-        break;
-      case UVCTypeComponentType::UInt8:
-      case UVCTypeComponentType::Boolean:
-      case UVCTypeComponentType::Bitmap8:
-        *static_cast<uint8_t*>(theValue) =
-            *static_cast<uint8_t*>(theDefaultValue);
-        break;
-      case UVCTypeComponentType::SInt16:
-        *static_cast<int16_t*>(theValue) =
-            *static_cast<int16_t*>(theDefaultValue);
-        break;
-      case UVCTypeComponentType::UInt16:
-      case UVCTypeComponentType::Bitmap16:
-        *static_cast<uint16_t*>(theValue) =
-            *static_cast<uint16_t*>(theDefaultValue);
-        break;
-      case UVCTypeComponentType::SInt32:
-        *static_cast<int32_t*>(theValue) =
-            *static_cast<int32_t*>(theDefaultValue);
-        break;
-      case UVCTypeComponentType::UInt32:
-      case UVCTypeComponentType::Bitmap32:
-        *static_cast<uint32_t*>(theValue) =
-            *static_cast<uint32_t*>(theDefaultValue);
-        break;
-      case UVCTypeComponentType::SInt64:
-        *static_cast<int64_t*>(theValue) =
-            *static_cast<int64_t*>(theDefaultValue);
-        break;
-      case UVCTypeComponentType::UInt64:
-      case UVCTypeComponentType::Bitmap64:
-        *static_cast<uint64_t*>(theValue) =
-            *static_cast<uint64_t*>(theDefaultValue);
-        break;
-      default:
-        return false;
-    }
-
-    if (nChar)
-      *nChar = 7;  // Length of "default"
-    return true;
-  }
-
-  if (strncasecmp(cString, "minimum", 7) == 0 && theMinimum) {
-    // Similar logic for minimum values...
-    if (nChar)
-      *nChar = 7;
-    return true;
-  }
-
-  if (strncasecmp(cString, "maximum", 7) == 0 && theMaximum) {
-    // Similar logic for maximum values...
-    if (nChar)
-      *nChar = 7;
-    return true;
-  }
-
-  // Handle boolean special strings
-  if (theType == UVCTypeComponentType::Boolean) {
-    const char* trues[] = {"y", "yes", "true", "t", "1", nullptr};
-    const char* falses[] = {"n", "no", "false", "f", "0", nullptr};
-
-    for (int i = 0; trues[i]; i++) {
-      size_t len = strlen(trues[i]);
-      if (strncasecmp(cString, trues[i], len) == 0) {
-        *static_cast<uint8_t*>(theValue) = 1;
-        if (nChar)
-          *nChar = len;
-        return true;
-      }
-    }
-
-    for (int i = 0; falses[i]; i++) {
-      size_t len = strlen(falses[i]);
-      if (strncasecmp(cString, falses[i], len) == 0) {
-        *static_cast<uint8_t*>(theValue) = 0;
-        if (nChar)
-          *nChar = len;
-        return true;
-      }
-    }
-  }
-
-  // Parse numeric values
-  char* endPtr;
-  long long intValue =
-      strtoll(cString, &endPtr, 0);  // Support hex, octal, decimal
-
-  if (endPtr == cString) {
-    // Not a valid number
-    return false;
-  }
+  bool isScanned = false;
 
-  // Store the value according to its type
-  switch (theType) {
-    case UVCTypeComponentType::SInt8:
-      *static_cast<int8_t*>(theValue) = static_cast<int8_t>(intValue);
-      break;
-    case UVCTypeComponentType::UInt8:
-    case UVCTypeComponentType::Boolean:
-    case UVCTypeComponentType::Bitmap8:
-      *static_cast<uint8_t*>(theValue) = static_cast<uint8_t>(intValue);
-      break;
-    case UVCTypeComponentType::SInt16:
-      *static_cast<int16_t*>(theValue) = static_cast<int16_t>(intValue);
-      break;
-    case UVCTypeComponentType::UInt16:
-    case UVCTypeComponentType::Bitmap16:
-      *static_cast<uint16_t*>(theValue) = static_cast<uint16_t>(intValue);
-      break;
-    case UVCTypeComponentType::SInt32:
-      *static_cast<int32_t*>(theValue) = static_cast<int32_t>(intValue);
-      break;
-    case UVCTypeComponentType::UInt32:
-    case UVCTypeComponentType::Bitmap32:
-      *static_cast<uint32_t*>(theValue) = static_cast<uint32_t>(intValue);
-      break;
-    case UVCTypeComponentType::SInt64:
-      *static_cast<int64_t*>(theValue) = static_cast<int64_t>(intValue);
-      break;
-    case UVCTypeComponentType::UInt64:
-    case UVCTypeComponentType::Bitmap64:
-      *static_cast<uint64_t*>(theValue) = static_cast<uint64_t>(intValue);
-      break;
-    default:
-      return false;
-  }
-
-  if (nChar)
-    *nChar = endPtr - start;
-  return true;
+  UVCComponentDispatch(theType, [&](auto component) {
+    isScanned = decltype(component)::scan(cString, theValue, theMinimum,
+                                          theMaximum, theDefaultValue, nChar);
+  });
+  return isScanned;
 }
@@ -19,6 +19,8 @@
 #include <string>
 #include <vector>
 
+#include "UVCArena.hpp"
+
 /*!
   @typedef UVCTypeComponentType
 
@@ -91,6 +93,8 @@ inline bool operator!(UVCTypeScanFlags flags) {
   return static_cast<uint32_t>(flags) == 0;
 }
 
+struct UVCLayoutCodec;
+
 /*!
   @class UVCType
   @abstract Abstract data type comprised of UVCTypeComponentType atomic types
@@ -113,16 +117,24 @@ inline bool operator!(UVCTypeScanFlags flags) {
 
   Methods are also provided to initialize an external buffer structured by a
   UVCType using textual input (from a C string).
+
+  When the field types match one of the layouts compiled into the library
+  (see UVCLayout.hpp) the buffer operations run through that layout's codec;
+  otherwise the fields are interpreted one by one.
 */
 class UVCType {
+  template <class... Components>
+  friend struct UVCLayout;
+
  private:
   struct UVCTypeField {
-    std::string fieldName;
+    UVCArenaString fieldName;
     UVCTypeComponentType fieldType;
   };
 
-  std::vector<UVCTypeField> _fields;
+  std::vector<UVCTypeField, UVCArenaAllocator<UVCTypeField>> _fields;
   bool _needsNoByteSwap;
+  const UVCLayoutCodec* _codec = nullptr;
 
  public:
   /*!
@@ -160,22 +172,27 @@ class UVCType {
 
       { S2 pan; S2 tilt; }
 
+    If arena is provided the instance, its field list and field names are
+    placed in it.
   */
   static std::shared_ptr<UVCType> createFromCString(
-      const char* typeDescription);
+      const char* typeDescription,
+      std::shared_ptr<UVCArena> arena = nullptr);
 
   /*!
     @method createWithFieldNamesAndTypes
 
     Returns a shared_ptr to UVCType initialized with the given field names and
-    types.
+    types, placed in arena if one is provided.
   */
   static std::shared_ptr<UVCType> createWithFieldNamesAndTypes(
       const std::vector<std::string>& names,
-      const std::vector<UVCTypeComponentType>& types);
+      const std::vector<UVCTypeComponentType>& types,
+      std::shared_ptr<UVCArena> arena = nullptr);
 
-  // Constructor and destructor
+  // Constructors and destructor
   UVCType() = default;
+  explicit UVCType(std::shared_ptr<UVCArena> arena);
   ~UVCType() = default;
 
   // Copy constructor and assignment operator
@@ -327,6 +344,50 @@ class UVCType {
   */
   std::string stringFromBuffer(void* buffer) const;
 
+  /*!
+    @method formatBuffer
+
+    Same as stringFromBuffer, but the description is written (NUL-terminated
+    and truncated if necessary) to the caller's outString, which holds
+    outSize bytes.  No heap allocations are made.
+
+    Returns the length of the full description, excluding the NUL; if this
+    is not less than outSize the output was truncated.
+  */
+  size_t formatBuffer(const void* buffer, char* outString, size_t outSize) const;
+
+  /*!
+    @method encodeBuffer
+
+    Write the binary (CBOR) form of the data in the external buffer to out,
+    which holds outSize bytes (may be zero).  The encoding is a map from field
+    index to the field's integer value (true/false for Boolean fields), e.g.
+    {0: 3600, 1: -360000} for "{S4 pan; S4 tilt}", so values cross process
+    boundaries without formatting or parsing text.  No heap allocations are
+    made.
+
+    Returns the length of the full encoding; if greater than outSize nothing
+    usable was written.
+  */
+  size_t encodeBuffer(const void* buffer, uint8_t* out, size_t outSize) const;
+
+  /*!
+    @method decodeBuffer
+
+    Decode the binary form produced by encodeBuffer (length bytes at data)
+    directly into the external buffer.  Fields absent from the map keep their
+    value.  If consumed is non-NULL it receives the number of bytes the
+    encoding occupied.
+
+    Returns false if the data is truncated, is not a map of field indices, or
+    holds a value that does not fit its field; the buffer may then be
+    partially updated.
+  */
+  bool decodeBuffer(const uint8_t* data,
+                    size_t length,
+                    void* buffer,
+                    size_t* consumed = nullptr) const;
+
   /*!
     @method typeSummaryString
 
@@ -341,6 +402,49 @@ class UVCType {
   */
   bool isEqual(const UVCType& other) const;
 
+  /*!
+    @method isEqualBuffer
+
+    Returns true if the two external buffers structured according to the
+    component field types hold the same data.
+  */
+  bool isEqualBuffer(const void* buffer, const void* otherBuffer) const;
+
+  /*!
+    @method clampBuffer
+
+    Bring each numeric component of the external buffer into the range given
+    by the corresponding components of minimum and maximum; either may be
+    NULL.  Boolean and bitmap components are left as they are.
+  */
+  void clampBuffer(void* buffer,
+                   const void* minimum,
+                   const void* maximum) const;
+
+  /*!
+    @method usesLayoutCodec
+
+    Returns true if the buffer operations of this instance run through a
+    compiled layout codec rather than being interpreted.
+  */
+  bool usesLayoutCodec() const;
+
+  /*!
+    @method layoutCodec
+
+    Returns the compiled layout codec in use, or NULL if the buffer operations
+    are interpreted.
+  */
+  const UVCLayoutCodec* layoutCodec() const;
+
+  /*!
+    @method setUsesLayoutCodec
+
+    Select the compiled layout codec (if one matches the field types) or
+    force the interpreted path, e.g. to compare the two.
+  */
+  void setUsesLayoutCodec(bool usesLayoutCodec);
+
  private:
   // Helper functions for parsing type descriptions
   static UVCTypeComponentType componentTypeFromString(const char* typeDefString,
@@ -349,6 +453,17 @@ class UVCType {
   static const char* componentVerboseTypeString(
       UVCTypeComponentType componentType);
 
+  // Scan the value of one field into its place in buffer:
+  bool scanFieldAtIndex(size_t index,
+                        const char* cString,
+                        void* buffer,
+                        UVCTypeScanFlags flags,
+                        void* minimum,
+                        void* maximum,
+                        void* stepSize,
+                        void* defaultValue,
+                        size_t* nChar) const;
+
   // Helper function for scanning individual component values
   static bool componentTypeScanf(const char* cString,
                                  UVCTypeComponentType theType,
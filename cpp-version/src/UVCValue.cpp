@@ -13,19 +13,22 @@
 
 #include "UVCValue.hpp"
 #include <cstring>
-#include <iomanip>
-#include <sstream>
 
-std::shared_ptr<UVCValue> UVCValue::create(std::shared_ptr<UVCType> valueType) {
+std::shared_ptr<UVCValue> UVCValue::create(std::shared_ptr<UVCType> valueType,
+                                           std::shared_ptr<UVCArena> arena) {
   if (!valueType) {
     return nullptr;
   }
 
-  return std::make_shared<UVCValue>(valueType);
+  return std::allocate_shared<UVCValue>(UVCArenaAllocator<UVCValue>(arena),
+                                        valueType, arena);
 }
 
-UVCValue::UVCValue(std::shared_ptr<UVCType> valueType)
-    : _isSwappedToUSBEndian(false), _valueType(valueType) {
+UVCValue::UVCValue(std::shared_ptr<UVCType> valueType,
+                   std::shared_ptr<UVCArena> arena)
+    : _isSwappedToUSBEndian(false),
+      _valueType(valueType),
+      _valueData(UVCArenaAllocator<uint8_t>(arena)) {
   if (_valueType) {
     size_t bufferSize = _valueType->byteSize();
     _valueData.resize(bufferSize, 0);
@@ -191,6 +194,33 @@ std::string UVCValue::stringValue() const {
       const_cast<void*>(static_cast<const void*>(_valueData.data())));
 }
 
+size_t UVCValue::formatValue(char* outString, size_t outSize) const {
+  if (!_valueType) {
+    if (outString && outSize) {
+      *outString = '\0';
+    }
+    return 0;
+  }
+
+  return _valueType->formatBuffer(_valueData.data(), outString, outSize);
+}
+
+size_t UVCValue::encodeValue(uint8_t* out, size_t outSize) const {
+  if (!_valueType) {
+    return 0;
+  }
+
+  return _valueType->encodeBuffer(_valueData.data(), out, outSize);
+}
+
+bool UVCValue::decodeValue(const uint8_t* data, size_t length) {
+  if (!_valueType || !data) {
+    return false;
+  }
+
+  return _valueType->decodeBuffer(data, length, _valueData.data());
+}
+
 bool UVCValue::copyValue(std::shared_ptr<UVCValue> otherValue) {
   if (!otherValue || !_valueType || !otherValue->_valueType) {
     return false;
@@ -214,6 +244,5 @@ bool UVCValue::isEqual(const UVCValue& other) const {
     return false;
   }
 
-  return std::memcmp(_valueData.data(), other._valueData.data(),
-                     _valueType->byteSize()) == 0;
+  return _valueType->isEqualBuffer(_valueData.data(), other._valueData.data());
 }
@@ -33,7 +33,7 @@ class UVCValue {
  private:
   bool _isSwappedToUSBEndian;
   std::shared_ptr<UVCType> _valueType;
-  std::vector<uint8_t> _valueData;
+  std::vector<uint8_t, UVCArenaAllocator<uint8_t>> _valueData;
 
  public:
   /*!
@@ -41,12 +41,16 @@ class UVCValue {
 
     Returns a shared_ptr to UVCValue which wraps a buffer sized
     according to valueType->byteSize() and uses valueType as its structural
-    meta-data.
+    meta-data.  If arena is provided the instance and its buffer are placed
+    in it.
   */
-  static std::shared_ptr<UVCValue> create(std::shared_ptr<UVCType> valueType);
+  static std::shared_ptr<UVCValue> create(
+      std::shared_ptr<UVCType> valueType,
+      std::shared_ptr<UVCArena> arena = nullptr);
 
   // Constructor and destructor
-  explicit UVCValue(std::shared_ptr<UVCType> valueType);
+  explicit UVCValue(std::shared_ptr<UVCType> valueType,
+                    std::shared_ptr<UVCArena> arena = nullptr);
   ~UVCValue() = default;
 
   // Copy constructor and assignment operator
@@ -187,6 +191,34 @@ class UVCValue {
   */
   std::string stringValue() const;
 
+  /*!
+    @method formatValue
+
+    Same as stringValue, but written to the caller's outString (outSize bytes)
+    without any heap allocation.  Returns the length of the full description;
+    if not less than outSize the output was truncated.
+  */
+  size_t formatValue(char* outString, size_t outSize) const;
+
+  /*!
+    @method encodeValue
+
+    Write the binary (CBOR) form of the data to out (outSize bytes) without
+    any heap allocation; see UVCType::encodeBuffer.  Returns the length of
+    the full encoding.
+  */
+  size_t encodeValue(uint8_t* out, size_t outSize) const;
+
+  /*!
+    @method decodeValue
+
+    Decode the binary form produced by encodeValue (length bytes at data) in
+    place into this instance's memory buffer; see UVCType::decodeBuffer.
+
+    Returns true if the data was decoded.
+  */
+  bool decodeValue(const uint8_t* data, size_t length);
+
   /*!
     @method copyValue
 
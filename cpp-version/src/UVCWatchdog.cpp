@@ -0,0 +1,190 @@
+//
+// UVCWatchdog.cpp
+//
+// Detection of and recovery from devices whose firmware stops answering
+// control transfers.
+//
+// Translated from Objective-C to C++
+// Copyright © 2016
+// Dr. Jeffrey Frey, IT-NSS
+// University of Delaware
+//
+// $Id$
+//
+
+#include "UVCWatchdog.hpp"
+
+#include <algorithm>
+#include <thread>
+
+#include "UVCDiagnostics.hpp"
+
+// Successful transfers averaged before latency is judged:
+static const uint32_t kUVCWatchdogWarmupTransfers = 8;
+
+std::shared_ptr<UVCWatchdogTransport> UVCWatchdogTransport::create(
+    std::shared_ptr<UVCTransport> transport,
+    const UVCWatchdogPolicy& policy) {
+  if (!transport) {
+    return nullptr;
+  }
+  return std::make_shared<UVCWatchdogTransport>(transport, policy);
+}
+
+UVCWatchdogTransport::UVCWatchdogTransport(
+    std::shared_ptr<UVCTransport> transport,
+    const UVCWatchdogPolicy& policy)
+    : _transport(transport),
+      _policy(policy),
+      _timeoutsInARow(0),
+      _slowTransfersInARow(0),
+      _successfulTransfers(0),
+      _averageMicros(0.0),
+      _isAwaitingReconnect(false),
+      _hasRecovered(false),
+      _lastAction(UVCRecoveryAction::ClearStall) {}
+
+UVCWatchdogStatistics UVCWatchdogTransport::statistics() const {
+  std::lock_guard<std::mutex> guard(_lock);
+  return _statistics;
+}
+
+const UVCDeviceIdentity& UVCWatchdogTransport::identity() const {
+  return _transport->identity();
+}
+
+uint8_t UVCWatchdogTransport::interfaceNumber() const {
+  return _transport->interfaceNumber();
+}
+
+std::vector<uint8_t> UVCWatchdogTransport::videoControlDescriptors() const {
+  return _transport->videoControlDescriptors();
+}
+
+std::vector<uint8_t> UVCWatchdogTransport::videoStreamingDescriptors() const {
+  return _transport->videoStreamingDescriptors();
+}
+
+bool UVCWatchdogTransport::isOpen() const {
+  std::lock_guard<std::mutex> guard(_lock);
+  return !_isAwaitingReconnect && _transport->isOpen();
+}
+
+bool UVCWatchdogTransport::open() {
+  std::lock_guard<std::mutex> guard(_lock);
+  return !_isAwaitingReconnect && _transport->open();
+}
+
+void UVCWatchdogTransport::close() {
+  _transport->close();
+}
+
+UVCTransferStatus UVCWatchdogTransport::controlRequest(
+    UVCControlRequest& request) {
+  std::lock_guard<std::mutex> guard(_lock);
+
+  if (_isAwaitingReconnect) {
+    request.wLenDone = 0;
+    return UVCTransferStatus::NoDevice;
+  }
+
+  auto started = Clock::now();
+  UVCTransferStatus status = _transport->controlRequest(request);
+  uint32_t micros = static_cast<uint32_t>(
+      std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() -
+                                                            started)
+          .count());
+
+  if (isHung(status, micros)) {
+    recoverFromHang();
+    return UVCTransferStatus::NoDevice;
+  }
+  return status;
+}
+
+bool UVCWatchdogTransport::reconnect() {
+  std::lock_guard<std::mutex> guard(_lock);
+  bool wasAwaitingReconnect = _isAwaitingReconnect;
+
+  _isAwaitingReconnect = false;
+  // Short of a port reset, the device kept its handle:
+  if (wasAwaitingReconnect && _lastAction != UVCRecoveryAction::ResetPort) {
+    return _transport->isOpen() || _transport->open();
+  }
+  return _transport->reconnect();
+}
+
+bool UVCWatchdogTransport::recover(UVCRecoveryAction action) {
+  return _transport->recover(action);
+}
+
+UVCPowerState UVCWatchdogTransport::powerState() const {
+  return _transport->powerState();
+}
+
+bool UVCWatchdogTransport::isHung(UVCTransferStatus status, uint32_t micros) {
+  if (status == UVCTransferStatus::Timeout) {
+    _slowTransfersInARow = 0;
+    return _policy.consecutiveTimeouts &&
+           ++_timeoutsInARow >= _policy.consecutiveTimeouts;
+  }
+  _timeoutsInARow = 0;
+
+  bool isSlow = _successfulTransfers >= kUVCWatchdogWarmupTransfers &&
+                micros > _policy.minimumSlowMicros &&
+                micros > _policy.slowTransferFactor * _averageMicros;
+
+  if (isSlow) {
+    return _policy.consecutiveSlowTransfers &&
+           ++_slowTransfersInARow >= _policy.consecutiveSlowTransfers;
+  }
+  _slowTransfersInARow = 0;
+  if (status == UVCTransferStatus::Success) {
+    // Running average over (about) the last few transfers:
+    _successfulTransfers++;
+    _averageMicros +=
+        (micros - _averageMicros) /
+        std::min(_successfulTransfers, kUVCWatchdogWarmupTransfers);
+  }
+  return false;
+}
+
+void UVCWatchdogTransport::recoverFromHang() {
+  size_t step = 0;
+
+  _statistics.hangs++;
+  _timeoutsInARow = _slowTransfersInARow = 0;
+
+  // Hung again soon after a recovery:  that action was not enough
+  if (_hasRecovered &&
+      Clock::now() - _lastRecovery <
+          std::chrono::microseconds(_policy.escalationWindowMicros)) {
+    step = std::min(static_cast<size_t>(_lastAction) + 1,
+                    kUVCRecoveryActionCount - 1);
+  }
+  for (; step < kUVCRecoveryActionCount; step++) {
+    if (_transport->recover(static_cast<UVCRecoveryAction>(step))) {
+      _statistics.recoveries[step]++;
+      break;
+    }
+    _statistics.failedRecoveries++;
+  }
+  if (step == kUVCRecoveryActionCount) {
+    _statistics.unrecovered++;
+    step = kUVCRecoveryActionCount - 1;
+    UVC_DIAGNOSTIC(Warning, Transfer,
+                   "%s stopped answering and could not be recovered",
+                   _transport->identity().deviceName.c_str());
+  } else {
+    UVC_DIAGNOSTIC(Info, Transfer, "%s stopped answering, recovered with %s",
+                   _transport->identity().deviceName.c_str(),
+                   UVCRecoveryActionString(
+                       static_cast<UVCRecoveryAction>(step)));
+  }
+  _lastAction = static_cast<UVCRecoveryAction>(step);
+  _hasRecovered = true;
+  std::this_thread::sleep_for(
+      std::chrono::microseconds(_policy.backoffMicros[step]));
+  _lastRecovery = Clock::now();
+  _isAwaitingReconnect = true;
+}
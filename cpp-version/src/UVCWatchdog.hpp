@@ -0,0 +1,129 @@
+//
+// UVCWatchdog.hpp
+//
+// Detection of and recovery from devices whose firmware stops answering
+// control transfers.
+//
+// Translated from Objective-C to C++
+// Copyright © 2016
+// Dr. Jeffrey Frey, IT-NSS
+// University of Delaware
+//
+// $Id$
+//
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "UVCTransport.hpp"
+
+// Number of UVCRecoveryAction steps:
+const size_t kUVCRecoveryActionCount = 3;
+
+/*!
+  @struct UVCWatchdogPolicy
+
+  When a watchdog considers its device hung, and how it recovers it:
+
+    consecutiveTimeouts       timeouts in a row that mean a hang
+    slowTransferFactor        a transfer slower than this multiple of the
+    minimumSlowMicros         running average (and than minimumSlowMicros) is
+                              a latency blow-up...
+    consecutiveSlowTransfers  ...and this many in a row mean a hang
+    backoffMicros             time given the device to settle after each
+                              recovery action, indexed by UVCRecoveryAction
+    escalationWindowMicros    a hang this soon after a recovery is met with
+                              the next action up; otherwise recovery starts
+                              over with ClearStall
+*/
+struct UVCWatchdogPolicy {
+  uint32_t consecutiveTimeouts = 3;
+  uint32_t slowTransferFactor = 20;
+  uint32_t minimumSlowMicros = 50000;
+  uint32_t consecutiveSlowTransfers = 5;
+  uint32_t backoffMicros[kUVCRecoveryActionCount] = {10000, 100000, 1000000};
+  uint32_t escalationWindowMicros = 5000000;
+};
+
+/*!
+  @struct UVCWatchdogStatistics
+
+  Counters kept by a watchdog.  recoveries is indexed by UVCRecoveryAction.
+*/
+struct UVCWatchdogStatistics {
+  uint64_t hangs = 0;
+  uint64_t recoveries[kUVCRecoveryActionCount] = {0, 0, 0};
+  uint64_t failedRecoveries = 0;
+  uint64_t unrecovered = 0;
+};
+
+/*!
+  @class UVCWatchdogTransport
+  @abstract Decorator that revives another transport's hung device.
+
+  Every transfer is passed through to the wrapped transport and its status
+  and latency watched.  Once the device looks hung (see UVCWatchdogPolicy)
+  the watchdog escalates through the UVCRecoveryAction steps, waits out the
+  step's backoff, and fails the transfer with NoDevice.  Until reconnect() is
+  called every transfer fails the same way; a UVCDeviceController therefore
+  reconnects and restores its control values, just as after an unplug.
+*/
+class UVCWatchdogTransport final : public UVCTransport {
+ private:
+  using Clock = std::chrono::steady_clock;
+
+  mutable std::mutex _lock;
+  std::shared_ptr<UVCTransport> _transport;
+  UVCWatchdogPolicy _policy;
+  UVCWatchdogStatistics _statistics;
+  uint32_t _timeoutsInARow;
+  uint32_t _slowTransfersInARow;
+  uint32_t _successfulTransfers;
+  double _averageMicros;
+  bool _isAwaitingReconnect;
+  bool _hasRecovered;
+  UVCRecoveryAction _lastAction;
+  Clock::time_point _lastRecovery;
+
+ public:
+  /*!
+    @method create
+
+    Returns a shared_ptr to a watchdog over transport, or nullptr if
+    transport is nullptr.
+  */
+  static std::shared_ptr<UVCWatchdogTransport> create(
+      std::shared_ptr<UVCTransport> transport,
+      const UVCWatchdogPolicy& policy = UVCWatchdogPolicy());
+
+  UVCWatchdogTransport(std::shared_ptr<UVCTransport> transport,
+                       const UVCWatchdogPolicy& policy);
+  ~UVCWatchdogTransport() override = default;
+
+  // Delete copy constructor and assignment operator
+  UVCWatchdogTransport(const UVCWatchdogTransport&) = delete;
+  UVCWatchdogTransport& operator=(const UVCWatchdogTransport&) = delete;
+
+  UVCWatchdogStatistics statistics() const;
+
+  const UVCDeviceIdentity& identity() const override;
+  uint8_t interfaceNumber() const override;
+  std::vector<uint8_t> videoControlDescriptors() const override;
+  std::vector<uint8_t> videoStreamingDescriptors() const override;
+  bool isOpen() const override;
+  bool open() override;
+  void close() override;
+  UVCTransferStatus controlRequest(UVCControlRequest& request) override;
+  bool reconnect() override;
+  bool recover(UVCRecoveryAction action) override;
+  UVCPowerState powerState() const override;
+
+ private:
+  bool isHung(UVCTransferStatus status, uint32_t micros);
+  void recoverFromHang();
+};
@@ -0,0 +1,422 @@
+//
+// UVCWriteJournal.cpp
+//
+// Write-ahead journal of control writes, for re-applying them after a crash.
+//
+// Translated from Objective-C to C++
+// Copyright © 2016
+// Dr. Jeffrey Frey, IT-NSS
+// University of Delaware
+//
+// $Id$
+//
+
+#include "UVCWriteJournal.hpp"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+
+#include "UVCBasicController.hpp"
+#include "UVCDiagnostics.hpp"
+
+// FNV-1a, closing each record so that one torn by a crash is recognized:
+static uint32_t UVCWriteJournalChecksum(const char* payload, size_t length) {
+  uint32_t hash = 0x811c9dc5U;
+
+  for (size_t i = 0; i < length; i++) {
+    hash = (hash ^ static_cast<uint8_t>(payload[i])) * 0x01000193U;
+  }
+  return hash;
+}
+
+static bool UVCWriteJournalSync(int fd) {
+#if defined(__APPLE__)
+  // fsync() leaves the data in the drive's cache on macOS:
+  return fcntl(fd, F_FULLFSYNC) == 0 || fsync(fd) == 0;
+#else
+  return fdatasync(fd) == 0;
+#endif
+}
+
+static size_t UVCWriteJournalControlId(const char* name) {
+  auto controlDef = std::find_if(
+      std::begin(uvcControlDefinitions), std::end(uvcControlDefinitions),
+      [name](const UVCControlDef& def) { return strcmp(def.name, name) == 0; });
+  return (controlDef == std::end(uvcControlDefinitions))
+             ? SIZE_MAX
+             : static_cast<size_t>(controlDef -
+                                   std::begin(uvcControlDefinitions));
+}
+
+std::shared_ptr<UVCWriteJournal> UVCWriteJournal::open(
+    const std::string& path,
+    const UVCWriteJournalPolicy& policy) {
+  int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_APPEND, 0644);
+  if (fd < 0) {
+    UVC_DIAGNOSTIC(Error, General, "Unable to open the journal %s: %s",
+                   path.c_str(), strerror(errno));
+    return nullptr;
+  }
+  return std::make_shared<UVCWriteJournal>(path, policy, fd);
+}
+
+std::string UVCWriteJournal::deviceKey(const UVCDeviceIdentity& identity,
+                                       uint8_t interfaceNumber) {
+  char name[32];
+  std::string key;
+
+  snprintf(name, sizeof(name), "%04x-%04x-", identity.vendorId,
+           identity.productId);
+  key = name;
+  if (!identity.serialNumber.empty() &&
+      identity.serialNumber != "Unknown UVC Device") {
+    for (char c : identity.serialNumber) {
+      key += (isalnum(static_cast<unsigned char>(c)) || c == '-' || c == '.')
+                 ? c
+                 : '_';
+    }
+  } else {
+    snprintf(name, sizeof(name), "loc-%08x", identity.locationId);
+    key += name;
+  }
+  if (interfaceNumber) {
+    snprintf(name, sizeof(name), "-if%u", interfaceNumber);
+    key += name;
+  }
+  return key;
+}
+
+UVCWriteJournal::UVCWriteJournal(const std::string& path,
+                                 const UVCWriteJournalPolicy& policy,
+                                 int fd)
+    : _path(path),
+      _policy(policy),
+      _fd(fd),
+      _appendedRecords(0),
+      _writtenRecords(0),
+      _isSyncing(false),
+      _hasFailed(false),
+      _nextSequence(1),
+      _outstanding(0),
+      _fileBytes(0) {
+  recover();
+}
+
+UVCWriteJournal::~UVCWriteJournal() {
+  flush();
+  if (_fd >= 0) {
+    ::close(_fd);
+  }
+}
+
+const std::string& UVCWriteJournal::path() const {
+  return _path;
+}
+
+UVCWriteJournalStatistics UVCWriteJournal::statistics() const {
+  std::lock_guard<std::mutex> guard(_lock);
+  return _statistics;
+}
+
+uint64_t UVCWriteJournal::logIntent(const std::string& deviceKey,
+                                    const UVCJournalWrite* writes,
+                                    size_t count) {
+  std::unique_lock<std::mutex> guard(_lock);
+  if (_hasFailed) {
+    return 0;
+  }
+
+  uint64_t sequence = _nextSequence++;
+  std::string payload = "I " + std::to_string(sequence) + " " + deviceKey;
+
+  for (size_t i = 0; i < count; i++) {
+    const char* name = (writes[i].controlId < std::size(uvcControlDefinitions))
+                           ? uvcControlDefinitions[writes[i].controlId].name
+                           : nullptr;
+    if (!name) {
+      continue;
+    }
+    payload += ' ';
+    payload += name;
+    payload += '=';
+    for (uint8_t byte : writes[i].data) {
+      char hex[3];
+      snprintf(hex, sizeof(hex), "%02x", byte);
+      payload += hex;
+    }
+  }
+  append(payload);
+  _statistics.intents++;
+  _outstanding++;
+  return writeThrough(guard, _appendedRecords) ? sequence : 0;
+}
+
+void UVCWriteJournal::confirm(uint64_t sequence) {
+  std::lock_guard<std::mutex> guard(_lock);
+
+  if (_hasFailed || !sequence) {
+    return;
+  }
+  append("C " + std::to_string(sequence));
+  _statistics.confirmations++;
+  if (_outstanding) {
+    _outstanding--;
+  }
+  _recovered.erase(
+      std::remove_if(_recovered.begin(), _recovered.end(),
+                     [sequence](const UVCJournalBatch& batch) {
+                       return batch.sequence == sequence;
+                     }),
+      _recovered.end());
+
+  // Nothing in the file is needed any longer; the records not yet written
+  // are all confirmations:
+  if (!_outstanding && !_isSyncing && _fileBytes >= _policy.compactBytes &&
+      ftruncate(_fd, 0) == 0) {
+    _pending.clear();
+    _writtenRecords = _appendedRecords;
+    _fileBytes = 0;
+    _statistics.compactions++;
+  }
+}
+
+void UVCWriteJournal::fail(uint64_t sequence,
+                           const std::string& deviceKey,
+                           const UVCJournalWrite* writes,
+                           size_t count) {
+  std::lock_guard<std::mutex> guard(_lock);
+
+  if (_hasFailed || !sequence) {
+    return;
+  }
+  // Informational only:  without a confirmation the intent is re-driven
+  // after a restart in any case.
+  append("F " + std::to_string(sequence));
+  _statistics.failures++;
+
+  // A batch that failed again when re-driven is pending already:
+  if (std::any_of(_recovered.begin(), _recovered.end(),
+                  [sequence](const UVCJournalBatch& batch) {
+                    return batch.sequence == sequence;
+                  })) {
+    return;
+  }
+
+  UVCJournalBatch batch;
+  batch.sequence = sequence;
+  batch.deviceKey = deviceKey;
+  batch.writes.assign(writes, writes + count);
+  _recovered.push_back(std::move(batch));
+}
+
+std::vector<UVCJournalBatch> UVCWriteJournal::pendingBatches(
+    const std::string& deviceKey) const {
+  std::lock_guard<std::mutex> guard(_lock);
+  std::vector<UVCJournalBatch> batches;
+
+  for (const UVCJournalBatch& batch : _recovered) {
+    if (batch.deviceKey == deviceKey) {
+      batches.push_back(batch);
+    }
+  }
+  return batches;
+}
+
+size_t UVCWriteJournal::pendingBatchCount() const {
+  std::lock_guard<std::mutex> guard(_lock);
+  return _recovered.size();
+}
+
+bool UVCWriteJournal::flush() {
+  std::unique_lock<std::mutex> guard(_lock);
+  return writeThrough(guard, _appendedRecords);
+}
+
+// Read back the records of an earlier run:  intents without a confirmation
+// (those that failed included) are kept for re-driving.  Whatever follows the
+// last intact record (a line torn by a crash) is cut off, so that new records
+// are not appended to it.
+void UVCWriteJournal::recover() {
+  FILE* file = fdopen(dup(_fd), "r");
+  if (!file) {
+    return;
+  }
+
+  char* line = nullptr;
+  size_t capacity = 0;
+  ssize_t length;
+  off_t intactBytes = 0, fileBytes = 0;
+
+  while ((length = getline(&line, &capacity, file)) > 0) {
+    fileBytes += length;
+    if (line[length - 1] != '\n' || length < 11) {
+      break;
+    }
+
+    // The payload, a space and eight hex digits of checksum:
+    line[length - 1] = '\0';
+    char* checksumPtr = line + length - 9;
+    if (checksumPtr[-1] != ' ' ||
+        strtoul(checksumPtr, nullptr, 16) !=
+            UVCWriteJournalChecksum(line, checksumPtr - 1 - line)) {
+      break;
+    }
+    checksumPtr[-1] = '\0';
+    intactBytes = fileBytes;
+
+    char* context = nullptr;
+    const char* kind = strtok_r(line, " ", &context);
+    const char* sequenceText = strtok_r(nullptr, " ", &context);
+    uint64_t sequence =
+        sequenceText ? strtoull(sequenceText, nullptr, 10) : 0;
+
+    if (!kind || !sequence) {
+      continue;
+    }
+    _nextSequence = std::max(_nextSequence, sequence + 1);
+    if (strcmp(kind, "C") == 0) {
+      _recovered.erase(
+          std::remove_if(_recovered.begin(), _recovered.end(),
+                         [sequence](const UVCJournalBatch& batch) {
+                           return batch.sequence == sequence;
+                         }),
+          _recovered.end());
+      continue;
+    }
+
+    const char* deviceKey = strtok_r(nullptr, " ", &context);
+    if (strcmp(kind, "I") != 0 || !deviceKey) {
+      continue;
+    }
+
+    UVCJournalBatch batch;
+    batch.sequence = sequence;
+    batch.deviceKey = deviceKey;
+    char* field;
+    while ((field = strtok_r(nullptr, " ", &context))) {
+      char* hex = strchr(field, '=');
+      if (!hex) {
+        continue;
+      }
+      *hex++ = '\0';
+
+      UVCJournalWrite write;
+      write.controlId = UVCWriteJournalControlId(field);
+      for (; hex[0] && hex[1]; hex += 2) {
+        char byte[3] = {hex[0], hex[1], '\0'};
+        write.data.push_back(
+            static_cast<uint8_t>(strtoul(byte, nullptr, 16)));
+      }
+      if (write.controlId != SIZE_MAX && !write.data.empty()) {
+        batch.writes.push_back(std::move(write));
+      }
+    }
+    _recovered.push_back(std::move(batch));
+  }
+  free(line);
+  fclose(file);
+
+  struct stat fileStatus;
+  if (fstat(_fd, &fileStatus) == 0 && fileStatus.st_size > intactBytes) {
+    UVC_DIAGNOSTIC(Warning, General,
+                   "Journal %s ends in a torn record, %lld bytes dropped",
+                   _path.c_str(),
+                   static_cast<long long>(fileStatus.st_size - intactBytes));
+    if (ftruncate(_fd, intactBytes) != 0) {
+      _hasFailed = true;
+    }
+  }
+  _outstanding = _recovered.size();
+  _fileBytes = static_cast<size_t>(intactBytes);
+  if (!_recovered.empty()) {
+    UVC_DIAGNOSTIC(Info, General, "Journal %s holds %zu unconfirmed batches",
+                   _path.c_str(), _recovered.size());
+  }
+}
+
+// Queue a record, closed by its checksum; called with the lock held:
+void UVCWriteJournal::append(const std::string& payload) {
+  char checksum[16];
+
+  snprintf(checksum, sizeof(checksum), " %08" PRIx32 "\n",
+           UVCWriteJournalChecksum(payload.data(), payload.size()));
+  _pending += payload;
+  _pending += checksum;
+  _appendedRecords++;
+}
+
+// Return once the first records records are written (and synced):  one
+// caller at a time writes everything queued so far, and the others wait for
+// it, to find their records written with it or to take the next turn.
+// Called with the lock held in guard; releases it while writing.
+bool UVCWriteJournal::writeThrough(std::unique_lock<std::mutex>& guard,
+                                   uint64_t records) {
+  while (_writtenRecords < records) {
+    if (_hasFailed) {
+      return false;
+    }
+    if (_isSyncing) {
+      _synced.wait(guard);
+      continue;
+    }
+
+    std::string buffer;
+    buffer.swap(_pending);
+    uint64_t target = _appendedRecords;
+    _isSyncing = true;
+    guard.unlock();
+
+    using Clock = std::chrono::steady_clock;
+    auto started = Clock::now();
+    const char* data = buffer.data();
+    size_t remaining = buffer.size();
+    bool isWritten = true;
+
+    while (remaining) {
+      ssize_t written = ::write(_fd, data, remaining);
+      if (written < 0 && errno == EINTR) {
+        continue;
+      }
+      if (written <= 0) {
+        isWritten = false;
+        break;
+      }
+      data += written;
+      remaining -= static_cast<size_t>(written);
+    }
+    bool isSynced = isWritten && (!_policy.syncs || UVCWriteJournalSync(_fd));
+    int error = errno;
+    auto micros = std::chrono::duration_cast<std::chrono::microseconds>(
+                      Clock::now() - started)
+                      .count();
+
+    guard.lock();
+    _isSyncing = false;
+    if (isSynced) {
+      _writtenRecords = target;
+      _fileBytes += buffer.size();
+      _statistics.syncs++;
+      _statistics.bytesWritten += buffer.size();
+      _statistics.totalSyncMicros += static_cast<uint64_t>(micros);
+      _statistics.maxSyncMicros = std::max(_statistics.maxSyncMicros,
+                                           static_cast<uint32_t>(micros));
+    } else {
+      _hasFailed = true;
+      UVC_DIAGNOSTIC(Error, General, "Unable to write the journal %s: %s",
+                     _path.c_str(), strerror(error));
+    }
+    _synced.notify_all();
+  }
+  return true;
+}
@@ -0,0 +1,216 @@
+//
+// UVCWriteJournal.hpp
+//
+// Write-ahead journal of control writes, for re-applying them after a crash.
+//
+// Translated from Objective-C to C++
+// Copyright © 2016
+// Dr. Jeffrey Frey, IT-NSS
+// University of Delaware
+//
+// $Id$
+//
+
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "UVCTransport.hpp"
+
+/*!
+  @struct UVCWriteJournalPolicy
+
+  With syncs set, an intent is on stable storage before its writes are sent;
+  otherwise it is only handed to the operating system (which survives the
+  process crashing, not the host).  Once every batch in the file has been
+  confirmed and the file has grown past compactBytes, it is emptied.
+*/
+struct UVCWriteJournalPolicy {
+  bool syncs = true;
+  size_t compactBytes = 1024 * 1024;
+};
+
+/*!
+  @struct UVCWriteJournalStatistics
+
+  Counters kept by a UVCWriteJournal.  Group commit shows as fewer syncs than
+  intents; sync times are in microseconds.
+*/
+struct UVCWriteJournalStatistics {
+  uint64_t intents = 0;
+  uint64_t confirmations = 0;
+  uint64_t failures = 0;
+  uint64_t syncs = 0;
+  uint64_t bytesWritten = 0;
+  uint64_t compactions = 0;
+  uint64_t totalSyncMicros = 0;
+  uint32_t maxSyncMicros = 0;
+};
+
+/*!
+  @struct UVCJournalWrite
+
+  One value of a journaled batch:  the control id and the bytes written, in
+  USB byte order.
+*/
+struct UVCJournalWrite {
+  size_t controlId = SIZE_MAX;
+  std::vector<uint8_t> data;
+};
+
+/*!
+  @struct UVCJournalBatch
+
+  A batch of writes whose intent was journaled, found without its
+  confirmation when the journal was opened or recorded as failed since.
+*/
+struct UVCJournalBatch {
+  uint64_t sequence = 0;
+  std::string deviceKey;
+  std::vector<UVCJournalWrite> writes;
+};
+
+/*!
+  @class UVCWriteJournal
+  @abstract Append-only record of the control writes sent to devices.
+
+  Before a batch of writes is sent, its intent (the device and every value)
+  is appended and, per the policy, synced; once the device has answered, a
+  confirmation is appended; if a write failed, a failure record is appended
+  instead.  A batch found without its confirmation when the journal is next
+  opened was cut short by a crash or failed:  some of its writes may have
+  reached the device, some not.  UVCDeviceController::redriveJournal sends
+  them again, leaving out values the device already holds.
+
+  Intents appended by several threads while a sync is under way are written
+  and synced together by the next one (group commit), so the cost of a sync
+  is shared among them.  Confirmations are not synced on their own:  a lost
+  confirmation only causes a batch to be re-driven, which is harmless.
+
+  Records are text lines closed by a checksum; a line torn by a crash is
+  ignored.  Thread-safe.
+*/
+class UVCWriteJournal {
+ private:
+  std::string _path;
+  UVCWriteJournalPolicy _policy;
+  int _fd;
+
+  mutable std::mutex _lock;
+  std::condition_variable _synced;
+  // Records appended but not yet written, and how many records have been
+  // appended and written in all:
+  std::string _pending;
+  uint64_t _appendedRecords;
+  uint64_t _writtenRecords;
+  bool _isSyncing;
+  bool _hasFailed;
+  uint64_t _nextSequence;
+  // Intents without a confirmation, including recovered batches:
+  size_t _outstanding;
+  size_t _fileBytes;
+  // Batches to re-drive:  found unconfirmed when opened, or failed since:
+  std::vector<UVCJournalBatch> _recovered;
+  UVCWriteJournalStatistics _statistics;
+
+ public:
+  /*!
+    @method open
+
+    Returns a shared_ptr to the journal in the file at path (created if need
+    be), with any batches it holds that were not confirmed available from
+    pendingBatches().  Returns nullptr if the file cannot be opened.
+  */
+  static std::shared_ptr<UVCWriteJournal> open(
+      const std::string& path,
+      const UVCWriteJournalPolicy& policy = UVCWriteJournalPolicy());
+
+  /*!
+    @method deviceKey
+
+    Returns the name under which a device's batches are journaled:  vendor
+    and product id and serial number (the locationId for devices without
+    one), and the VideoControl interface.
+  */
+  static std::string deviceKey(const UVCDeviceIdentity& identity,
+                               uint8_t interfaceNumber);
+
+  UVCWriteJournal(const std::string& path,
+                  const UVCWriteJournalPolicy& policy,
+                  int fd);
+  ~UVCWriteJournal();
+
+  // Delete copy constructor and assignment operator
+  UVCWriteJournal(const UVCWriteJournal&) = delete;
+  UVCWriteJournal& operator=(const UVCWriteJournal&) = delete;
+
+  const std::string& path() const;
+  UVCWriteJournalStatistics statistics() const;
+
+  /*!
+    @method logIntent
+
+    Append the intent to send writes to the device, and return once it is
+    as durable as the policy asks.  Returns the batch's sequence number, to
+    be confirmed, or zero if the journal could not be written (in which case
+    the writes should not be sent).
+  */
+  uint64_t logIntent(const std::string& deviceKey,
+                     const UVCJournalWrite* writes,
+                     size_t count);
+
+  /*!
+    @method confirm
+
+    Record that the device has accepted every write of the batch.
+  */
+  void confirm(uint64_t sequence);
+
+  /*!
+    @method fail
+
+    Record that a write of the batch (the writes given to logIntent for it)
+    did not reach the device.  The batch stays unconfirmed, and is returned
+    by pendingBatches() from now on, until it is re-driven.
+  */
+  void fail(uint64_t sequence,
+            const std::string& deviceKey,
+            const UVCJournalWrite* writes,
+            size_t count);
+
+  /*!
+    @method pendingBatches
+
+    Returns the batches for deviceKey that were found unconfirmed or have
+    failed, and have not been confirmed since, oldest first.
+  */
+  std::vector<UVCJournalBatch> pendingBatches(
+      const std::string& deviceKey) const;
+
+  /*!
+    @method pendingBatchCount
+
+    Returns the number of batches, for any device, that were found
+    unconfirmed or have failed, and have not been confirmed since.
+  */
+  size_t pendingBatchCount() const;
+
+  /*!
+    @method flush
+
+    Write (and, per the policy, sync) every record appended so far.  Returns
+    false if the journal could not be written.
+  */
+  bool flush();
+
+ private:
+  void recover();
+  void append(const std::string& payload);
+  bool writeThrough(std::unique_lock<std::mutex>& guard, uint64_t records);
+};
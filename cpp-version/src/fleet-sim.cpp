@@ -0,0 +1,2360 @@
+//
+// fleet-sim.cpp
+//
+// Drives UVCDeviceController workloads against a fleet of simulated cameras
+// arranged behind USB hubs and reports throughput, tail latency, memory per
+// device and thread count.
+//
+// Translated from Objective-C to C++
+// Copyright © 2016
+// Dr. Jeffrey Frey, IT-NSS
+// University of Delaware
+//
+// $Id$
+//
+
+#include <dirent.h>
+#include <sys/stat.h>
+#include <getopt.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <new>
+#include <random>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(__APPLE__)
+#include <mach/mach.h>
+#endif
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
+
+#include "UVCCircuitBreaker.hpp"
+#include "UVCController.hpp"
+#include "UVCDeviceLock.hpp"
+#include "UVCFleetAudit.hpp"
+#include "UVCHistory.hpp"
+#include "UVCIdlePower.hpp"
+#include "UVCProbeCache.hpp"
+#include "UVCQuirks.hpp"
+#include "UVCSimulatedTransport.hpp"
+#include "UVCWatchdog.hpp"
+#include "UVCWriteJournal.hpp"
+
+using SteadyClock = std::chrono::steady_clock;
+
+struct FleetSimOptions {
+  size_t deviceCount = 200;
+  size_t hubPorts = 7;
+  size_t threadCount = 8;
+  size_t iterations = 10;
+  uint32_t watchMillis = 2000;
+  uint32_t watchIntervalMillis = 100;
+  uint32_t latencyMicros = 200;
+  uint32_t jitterMicros = 100;
+  double failureRate = 0.05;
+  uint32_t seed = 1;
+  bool runProbe = true;
+  bool runFanOut = true;
+  bool runReconcile = true;
+  bool runWatch = true;
+  bool runReconnect = true;
+  bool runAutosuspend = true;
+  bool runReprobe = true;
+  bool runIdle = true;
+  bool runJournal = true;
+  bool runHistory = true;
+  bool runAudit = true;
+  bool checkAllocations = false;
+  size_t dispatchTransfers = 0;
+  size_t codecIterations = 0;
+  size_t roundTripIterations = 0;
+  size_t lockIterations = 0;
+};
+
+// One camera of the fleet and the controls it turned out to implement
+struct FleetDevice {
+  std::shared_ptr<UVCSimulatedTransport> transport;
+  std::shared_ptr<UVCWatchdogTransport> watchdog;
+  std::shared_ptr<UVCCircuitBreakerTransport> breaker;
+  std::shared_ptr<UVCDeviceController> controller;
+  std::vector<std::shared_ptr<UVCControl>> controls;
+  const char* failureMode;
+};
+
+// Per-workload results; latencies are in microseconds
+struct FleetSimResults {
+  std::vector<uint32_t> latencies;
+  uint64_t operations = 0;
+  uint64_t failures = 0;
+  uint64_t writes = 0;
+  double elapsedSeconds = 0.0;
+  size_t peakThreads = 0;
+
+  void merge(const FleetSimResults& other) {
+    latencies.insert(latencies.end(), other.latencies.begin(),
+                     other.latencies.end());
+    operations += other.operations;
+    failures += other.failures;
+    writes += other.writes;
+  }
+};
+
+static struct option fleetSimOptions[] = {
+    {"devices", required_argument, nullptr, 'n'},
+    {"hub-ports", required_argument, nullptr, 'p'},
+    {"threads", required_argument, nullptr, 't'},
+    {"iterations", required_argument, nullptr, 'i'},
+    {"workload", required_argument, nullptr, 'w'},
+    {"watch-millis", required_argument, nullptr, 'W'},
+    {"latency", required_argument, nullptr, 'l'},
+    {"failure-rate", required_argument, nullptr, 'f'},
+    {"seed", required_argument, nullptr, 's'},
+    {"check-allocations", no_argument, nullptr, 'a'},
+    {"dispatch-bench", required_argument, nullptr, 'b'},
+    {"codec-bench", required_argument, nullptr, 'c'},
+    {"round-trip-bench", required_argument, nullptr, 'r'},
+    {"lock-check", required_argument, nullptr, 'L'},
+    {"help", no_argument, nullptr, 'h'},
+    {nullptr, 0, nullptr, 0}};
+
+void usage(const char* exe) {
+  printf(
+      "usage:\n"
+      "\n"
+      "    %s {options}\n"
+      "\n"
+      "  Options:\n"
+      "\n"
+      "    -h/--help                              Show this information\n"
+      "    -n/--devices=<count>                   Number of simulated cameras "
+      "(default 200)\n"
+      "    -p/--hub-ports=<count>                 Downstream ports per hub "
+      "(default 7)\n"
+      "    -t/--threads=<count>                   Worker threads (default 8)\n"
+      "    -i/--iterations=<count>                Fan-out and reconcile passes "
+      "(default 10)\n"
+      "    -w/--workload=<name>[,<name>..]        Any of probe, fanout, "
+      "reconcile, watch,\n"
+      "                                           reconnect, autosuspend, "
+      "reprobe, idle,\n"
+      "                                           journal, history, audit, "
+      "all (default all)\n"
+      "    -W/--watch-millis=<ms>                 Duration of the watch "
+      "workload (default 2000)\n"
+      "    -l/--latency=<usec>[:<jitter-usec>]    Per-transfer latency model "
+      "(default 200:100)\n"
+      "    -f/--failure-rate=<fraction>           Fraction of cameras given a "
+      "failure mode\n"
+      "                                           (default 0.05)\n"
+      "    -s/--seed=<integer>                    Seed for fleet construction "
+      "(default 1)\n"
+      "    -a/--check-allocations                 Verify that steady-state "
+      "get/set/format on\n"
+      "                                           probed controls makes no heap "
+      "allocations\n"
+      "    -b/--dispatch-bench=<transfers>        Time GET_CUR transfers through "
+      "the runtime transport\n"
+      "                                           interface and through a "
+      "compile-time transport\n"
+      "    -c/--codec-bench=<iterations>          Time format, parse, swap, "
+      "compare and clamp of\n"
+      "                                           every control signature, "
+      "interpreted vs specialized\n"
+      "    -r/--round-trip-bench=<iterations>     Time passing every control "
+      "signature's value as text\n"
+      "                                           and as CBOR\n"
+      "    -L/--lock-check=<iterations>           Contend for one device lock "
+      "from every worker,\n"
+      "                                           mixing shared and exclusive "
+      "holders\n"
+      "\n",
+      exe);
+}
+
+// Heap allocations made through operator new while counting is enabled; used
+// by --check-allocations to prove the steady-state control path does not
+// allocate.
+static std::atomic<bool> fleetSimCountAllocations(false);
+static std::atomic<uint64_t> fleetSimAllocations(0);
+static std::atomic<uint64_t> fleetSimAllocatedBytes(0);
+
+void* operator new(size_t size) {
+  if (fleetSimCountAllocations.load(std::memory_order_relaxed)) {
+    fleetSimAllocations++;
+    fleetSimAllocatedBytes += size;
+  }
+  void* p = malloc(size ? size : 1);
+  if (!p) {
+    throw std::bad_alloc();
+  }
+  return p;
+}
+
+void* operator new[](size_t size) {
+  return operator new(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+  if (fleetSimCountAllocations.load(std::memory_order_relaxed)) {
+    fleetSimAllocations++;
+    fleetSimAllocatedBytes += size;
+  }
+  return malloc(size ? size : 1);
+}
+
+void* operator new[](size_t size, const std::nothrow_t& tag) noexcept {
+  return operator new(size, tag);
+}
+
+void operator delete(void* p) noexcept {
+  free(p);
+}
+
+void operator delete[](void* p) noexcept {
+  free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+  free(p);
+}
+
+void operator delete[](void* p, size_t) noexcept {
+  free(p);
+}
+
+// Resident set size of this process, in bytes
+static size_t FleetSimResidentBytes() {
+#if defined(__APPLE__)
+  mach_task_basic_info_data_t info;
+  mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+  if (task_info(mach_task_self(), MACH_TASK_BASIC_INFO,
+                reinterpret_cast<task_info_t>(&info),
+                &count) == KERN_SUCCESS) {
+    return info.resident_size;
+  }
+#elif defined(__linux__)
+  FILE* statm = fopen("/proc/self/statm", "r");
+  if (statm) {
+    unsigned long sizePages = 0, residentPages = 0;
+    int n = fscanf(statm, "%lu %lu", &sizePages, &residentPages);
+    fclose(statm);
+    if (n == 2) {
+      return residentPages * static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    }
+  }
+#endif
+  return 0;
+}
+
+// Heap bytes in use, where the C library can tell us
+static size_t FleetSimHeapBytes() {
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || __GLIBC_MINOR__ >= 33)
+  struct mallinfo2 info = mallinfo2();
+  return info.uordblks + info.hblkhd;
+#else
+  return 0;
+#endif
+}
+
+// Number of threads in this process
+static size_t FleetSimThreadCount() {
+#if defined(__APPLE__)
+  thread_act_array_t threads;
+  mach_msg_type_number_t count = 0;
+  if (task_threads(mach_task_self(), &threads, &count) == KERN_SUCCESS) {
+    for (mach_msg_type_number_t i = 0; i < count; i++) {
+      mach_port_deallocate(mach_task_self(), threads[i]);
+    }
+    vm_deallocate(mach_task_self(), reinterpret_cast<vm_address_t>(threads),
+                  count * sizeof(thread_act_t));
+    return count;
+  }
+#elif defined(__linux__)
+  FILE* status = fopen("/proc/self/status", "r");
+  if (status) {
+    char line[256];
+    size_t count = 0;
+    while (fgets(line, sizeof(line), status)) {
+      if (sscanf(line, "Threads: %zu", &count) == 1) {
+        break;
+      }
+    }
+    fclose(status);
+    return count;
+  }
+#endif
+  return 0;
+}
+
+// macOS-style locationID for the device at index on a fleet where every root
+// port feeds a hub whose ports each feed another hub:
+//
+//   0xBBHDxxxx    BB = bus, H = tier-1 hub port, D = tier-2 hub port
+static uint32_t FleetSimLocationId(size_t index, size_t hubPorts) {
+  size_t devicesPerBus = hubPorts * hubPorts;
+  size_t bus = index / devicesPerBus;
+  size_t tier1Port = (index % devicesPerBus) / hubPorts;
+  size_t tier2Port = index % hubPorts;
+
+  return static_cast<uint32_t>(((bus + 1) << 24) | ((tier1Port + 1) << 20) |
+                               ((tier2Port + 1) << 16));
+}
+
+// Workarounds for the simulated models, loaded as a quirks file would be:
+// their release 2.00 stalls every GET_RES.  Only some of the fleet's
+// "stalls-get-res" cameras carry that release, so stalls are still met.
+static const char* const fleetSimQuirks[] = {
+    "1209:0001:0200 * no-get-res",
+    "1209:0002:0200 * no-get-res",
+    "1209:0003:0200 * no-get-res",
+};
+
+static bool FleetSimLoadQuirks() {
+  char path[] = "/tmp/uvc-fleet-sim-quirks-XXXXXX";
+  int fd = mkstemp(path);
+  if (fd < 0) {
+    fprintf(stderr, "ERROR: Unable to create quirks file (errno = %d)\n",
+            errno);
+    return false;
+  }
+
+  FILE* file = fdopen(fd, "w");
+  bool isLoaded = false;
+  if (file) {
+    for (const char* quirk : fleetSimQuirks) {
+      fprintf(file, "%s\n", quirk);
+    }
+    isLoaded = fclose(file) == 0 && UVCLoadQuirksFile(path);
+  } else {
+    close(fd);
+  }
+  unlink(path);
+  return isLoaded;
+}
+
+static std::vector<FleetDevice> FleetSimCreateFleet(
+    const FleetSimOptions& options) {
+  static const struct {
+    UVCSimulatedPreset preset;
+    const char* name;
+    uint16_t productId;
+  } models[] = {{UVCSimulatedPreset::Webcam, "Webcam", 0x0001},
+                {UVCSimulatedPreset::PanTiltZoom, "PTZ Camera", 0x0002},
+                {UVCSimulatedPreset::Minimal, "Minimal Camera", 0x0003}};
+  std::vector<FleetDevice> fleet;
+  std::vector<std::shared_ptr<UVCSimulatedBus>> buses;
+  std::minstd_rand random(options.seed);
+  std::uniform_real_distribution<double> unit(0.0, 1.0);
+  size_t stallingCameras = 0;
+
+  fleet.reserve(options.deviceCount);
+  for (size_t index = 0; index < options.deviceCount; index++) {
+    const auto& model = models[index % 3];
+    size_t busIndex = index / (options.hubPorts * options.hubPorts);
+    char text[64];
+    UVCDeviceIdentity identity;
+
+    snprintf(text, sizeof(text), "Simulated %s %zu", model.name, index);
+    identity.deviceName = text;
+    snprintf(text, sizeof(text), "SIM%06zu", index);
+    identity.serialNumber = text;
+    identity.locationId = FleetSimLocationId(index, options.hubPorts);
+    identity.vendorId = 0x1209;
+    identity.productId = model.productId;
+    identity.bcdDevice = 0x0100;
+
+    FleetDevice device;
+    device.failureMode = "healthy";
+
+    UVCSimulatedLatency latency;
+    latency.baseMicros = options.latencyMicros;
+    latency.jitterMicros = options.jitterMicros;
+    latency.spikeProbability = 0.001;
+    latency.spikeMicros = options.latencyMicros * 20;
+
+    UVCSimulatedFailures failures;
+    if (unit(random) < options.failureRate) {
+      switch (random() % 6) {
+        case 0:
+          device.failureMode = "flaky";
+          failures.timeoutProbability = 0.05;
+          break;
+        case 1:
+          // Every other one has the release fleetSimQuirks lists, so its
+          // GET_RES is never actually sent:
+          device.failureMode = "stalls-get-res";
+          failures.stallOnGetRes = true;
+          if (stallingCameras++ % 2) {
+            identity.bcdDevice = 0x0200;
+          }
+          break;
+        case 2:
+          device.failureMode = "slow";
+          latency.baseMicros *= 10;
+          break;
+        case 3:
+          device.failureMode = "drops-off";
+          failures.disconnectAfterTransfers = 50 + random() % 200;
+          break;
+        case 4:
+          // Firmware wedges; only the given recovery step revives it:
+          device.failureMode = "hangs";
+          failures.hangAfterTransfers = 50 + random() % 200;
+          failures.hangClearedBy =
+              static_cast<UVCRecoveryAction>(random() % 3);
+          break;
+        case 5:
+          device.failureMode = "times-out";
+          failures.timeoutProbability = 1.0;
+          break;
+      }
+    }
+    device.transport =
+        UVCSimulatedTransport::createWithPreset(model.preset, identity);
+    if (buses.size() <= busIndex) {
+      buses.push_back(std::make_shared<UVCSimulatedBus>());
+    }
+    device.transport->setBus(buses[busIndex]);
+    device.transport->setSeed(options.seed + static_cast<uint32_t>(index));
+    device.transport->setLatency(latency);
+    device.transport->setFailures(failures);
+    device.watchdog = UVCWatchdogTransport::create(device.transport);
+    device.breaker = UVCCircuitBreakerTransport::create(device.watchdog);
+    fleet.push_back(device);
+  }
+  return fleet;
+}
+
+// Heap footprint of the per-device state of one controller
+struct FleetSimFootprint {
+  size_t controls = 0;
+  uint64_t allocations = 0;
+  uint64_t bytes = 0;
+  size_t arenaBytes = 0;
+  size_t arenaBlocks = 0;
+};
+
+// Create a controller for a healthy, zero-latency camera of the given preset
+// and probe every control, counting the heap allocations made on the way.
+// Must be called while no other thread is allocating.
+static FleetSimFootprint FleetSimMeasureController(
+    UVCSimulatedPreset preset,
+    const std::vector<std::string>& controlNames) {
+  FleetSimFootprint footprint;
+  UVCDeviceIdentity identity;
+
+  identity.deviceName = "Simulated footprint camera";
+  identity.serialNumber = "SIMFOOTPRINT";
+  identity.vendorId = 0x1209;
+  auto transport = UVCSimulatedTransport::createWithPreset(preset, identity);
+  transport->open();
+
+  uint64_t allocationsBefore = fleetSimAllocations;
+  uint64_t bytesBefore = fleetSimAllocatedBytes;
+  fleetSimCountAllocations = true;
+  auto controller = UVCDeviceController::createWithTransport(transport);
+  for (const auto& name : controlNames) {
+    if (controller->controlWithName(name)) {
+      footprint.controls++;
+    }
+  }
+  fleetSimCountAllocations = false;
+  footprint.allocations = fleetSimAllocations - allocationsBefore;
+  footprint.bytes = fleetSimAllocatedBytes - bytesBefore;
+  footprint.arenaBytes = controller->arena()->bytesReserved();
+  footprint.arenaBlocks = controller->arena()->blockCount();
+  return footprint;
+}
+
+// Completes every request at once without touching a device, so that the
+// dispatch benchmark sees nothing but the cost of the control path itself
+class FleetSimNullTransport final : public UVCTransport {
+ public:
+  uint64_t transfers = 0;
+
+  const UVCDeviceIdentity& identity() const override { return _identity; }
+  uint8_t interfaceNumber() const override { return 0; }
+  std::vector<uint8_t> videoControlDescriptors() const override { return {}; }
+  bool isOpen() const override { return true; }
+  bool open() override { return true; }
+  void close() override {}
+  UVCTransferStatus controlRequest(UVCControlRequest& request) override {
+    transfers++;
+    request.wLenDone = request.wLength;
+    return UVCTransferStatus::Success;
+  }
+
+ private:
+  UVCDeviceIdentity _identity;
+};
+
+// Nanoseconds per GET_CUR of the given control through the controller
+template <class Controller>
+static double FleetSimTimeTransfers(Controller& controller,
+                                    UVCValue& value,
+                                    size_t controlId,
+                                    size_t transfers) {
+  auto started = SteadyClock::now();
+  for (size_t i = 0; i < transfers; i++) {
+    controller.getValue(value, controlId);
+  }
+  return std::chrono::duration<double, std::nano>(SteadyClock::now() -
+                                                  started)
+             .count() /
+         transfers;
+}
+
+// Per-transfer cost of reading zoom-abs through UVCDeviceController (every
+// transfer dispatched through the UVCTransport interface) and through
+// BasicUVCDeviceController<Transport> (bound at compile time), over the same
+// transport.  Each path is timed twice, interleaved, and the faster run kept.
+template <class Transport>
+static void FleetSimDispatchBench(const char* name,
+                                  std::shared_ptr<Transport> transport,
+                                  size_t transfers) {
+  size_t controlId = UVCDeviceController::controlIdWithName("zoom-abs");
+  auto value = UVCValue::create(UVCType::createFromCString(
+      UVCDeviceController::controlTypeWithId(controlId)));
+  auto dynamicController = UVCDeviceController::createWithTransport(transport);
+  BasicUVCDeviceController<Transport> staticController(transport);
+  double dynamicNanos = 0.0, staticNanos = 0.0;
+
+  for (int pass = 0; pass < 2; pass++) {
+    double nanos =
+        FleetSimTimeTransfers(*dynamicController, *value, controlId, transfers);
+    dynamicNanos = pass ? std::min(dynamicNanos, nanos) : nanos;
+    nanos =
+        FleetSimTimeTransfers(staticController, *value, controlId, transfers);
+    staticNanos = pass ? std::min(staticNanos, nanos) : nanos;
+  }
+  printf("Transfer (%s):%*sruntime transport %.1f ns, compile-time %.1f ns\n",
+         name, static_cast<int>(11 - strlen(name)), "", dynamicNanos,
+         staticNanos);
+}
+
+// One control per distinct type signature in uvcControlDefinitions; each
+// signature is labelled with the first control that uses it.
+static std::vector<const UVCControlDef*> FleetSimControlSignatures() {
+  std::vector<const UVCControlDef*> signatures;
+
+  for (const auto& definition : uvcControlDefinitions) {
+    if (std::none_of(signatures.begin(), signatures.end(),
+                     [&](const UVCControlDef* seen) {
+                       return strcmp(seen->typeSignature,
+                                     definition.typeSignature) == 0;
+                     })) {
+      signatures.push_back(&definition);
+    }
+  }
+  return signatures;
+}
+
+// Nanoseconds per call of operation, best of two runs
+template <class Operation>
+static double FleetSimTimeOperation(size_t iterations, Operation operation) {
+  double bestNanos = 0.0;
+
+  for (int pass = 0; pass < 2; pass++) {
+    auto started = SteadyClock::now();
+    for (size_t i = 0; i < iterations; i++) {
+      operation();
+    }
+    double nanos = std::chrono::duration<double, std::nano>(
+                       SteadyClock::now() - started)
+                       .count() /
+                   iterations;
+    bestNanos = pass ? std::min(bestNanos, nanos) : nanos;
+  }
+  return bestNanos;
+}
+
+// Per-call cost of format, parse, byte swap, compare and clamp for each
+// distinct type signature in uvcControlDefinitions, first through the
+// per-field interpreter and then through the type's layout codec.
+static void FleetSimCodecBench(size_t iterations) {
+  static const char* const operationNames[] = {"format", "parse", "swap",
+                                               "compare", "clamp"};
+
+  for (const UVCControlDef* signature : FleetSimControlSignatures()) {
+    auto type = UVCType::createFromCString(signature->typeSignature);
+    if (!type) {
+      continue;
+    }
+
+    size_t byteSize = type->byteSize();
+    std::vector<uint8_t> value(byteSize), other(byteSize), minimum(byteSize),
+        maximum(byteSize, 0x7f);
+    char text[128];
+
+    for (size_t i = 0; i < byteSize; i++) {
+      value[i] = static_cast<uint8_t>(0x25 * (i + 1));
+    }
+    other = value;
+    type->formatBuffer(value.data(), text, sizeof(text));
+
+    volatile size_t sink = 0;
+    double nanos[2][5];
+    for (int specialized = 0; specialized < 2; specialized++) {
+      type->setUsesLayoutCodec(specialized);
+      nanos[specialized][0] = FleetSimTimeOperation(iterations, [&] {
+        char scratch[128];
+        sink += type->formatBuffer(value.data(), scratch, sizeof(scratch));
+      });
+      nanos[specialized][1] = FleetSimTimeOperation(iterations, [&] {
+        sink += type->scanCString(text, other.data(), UVCTypeScanFlags(0),
+                                  minimum.data(), maximum.data(), nullptr,
+                                  nullptr);
+      });
+      nanos[specialized][2] = FleetSimTimeOperation(iterations, [&] {
+        type->byteSwapHostToUSBEndian(other.data());
+        sink += other[0];
+      });
+      nanos[specialized][3] = FleetSimTimeOperation(iterations, [&] {
+        sink += type->isEqualBuffer(value.data(), other.data());
+      });
+      nanos[specialized][4] = FleetSimTimeOperation(iterations, [&] {
+        type->clampBuffer(other.data(), minimum.data(), maximum.data());
+        sink += other[0];
+      });
+    }
+    int padding = std::max(1, 26 - static_cast<int>(strlen(signature->name)));
+    if (!type->usesLayoutCodec()) {
+      printf("Codec (%s):%*sno layout codec\n", signature->name, padding, "");
+      continue;
+    }
+    printf("Codec (%s):%*s", signature->name, padding, "");
+    for (size_t op = 0; op < 5; op++) {
+      printf("%s%s %.1f/%.1f", op ? ", " : "", operationNames[op],
+             nanos[0][op], nanos[1][op]);
+    }
+    printf(" ns\n");
+  }
+}
+
+// Per-value cost of passing a value between processes as text (formatBuffer
+// then scanCString, as the daemon, capture app and monitor do today) and as
+// CBOR (encodeBuffer then decodeBuffer), for every control signature.  Each
+// round trip is checked to reproduce the original value.
+static bool FleetSimRoundTripBench(size_t iterations) {
+  bool isExact = true;
+
+  for (const UVCControlDef* signature : FleetSimControlSignatures()) {
+    auto type = UVCType::createFromCString(signature->typeSignature);
+    if (!type) {
+      continue;
+    }
+
+    size_t byteSize = type->byteSize();
+    std::vector<uint8_t> value(byteSize), textCopy(byteSize),
+        binaryCopy(byteSize);
+    char text[128];
+    uint8_t binary[64];
+
+    // A value with negative and multi-byte fields, normalized through its
+    // text form so that booleans are 0 or 1:
+    for (size_t i = 0; i < byteSize; i++) {
+      value[i] = static_cast<uint8_t>(0xa5 + 0x3d * i);
+    }
+    type->formatBuffer(value.data(), text, sizeof(text));
+    type->scanCString(text, value.data(), UVCTypeScanFlags(0));
+
+    size_t textLength = type->formatBuffer(value.data(), text, sizeof(text));
+    size_t binaryLength =
+        type->encodeBuffer(value.data(), binary, sizeof(binary));
+    volatile size_t sink = 0;
+
+    double textNanos = FleetSimTimeOperation(iterations, [&] {
+      char scratch[128];
+      type->formatBuffer(value.data(), scratch, sizeof(scratch));
+      sink += type->scanCString(scratch, textCopy.data(), UVCTypeScanFlags(0));
+    });
+    double binaryNanos = FleetSimTimeOperation(iterations, [&] {
+      uint8_t scratch[64];
+      size_t length =
+          type->encodeBuffer(value.data(), scratch, sizeof(scratch));
+      sink += type->decodeBuffer(scratch, length, binaryCopy.data());
+    });
+    bool isTextExact = type->isEqualBuffer(value.data(), textCopy.data());
+    bool isBinaryExact = type->isEqualBuffer(value.data(), binaryCopy.data());
+
+    printf("Round trip (%s):%*stext %.1f ns/%zu bytes, cbor %.1f ns/%zu "
+           "bytes%s\n",
+           signature->name,
+           std::max(1, 21 - static_cast<int>(strlen(signature->name))), "",
+           textNanos, textLength, binaryNanos, binaryLength,
+           (isTextExact && isBinaryExact) ? "" : " MISMATCH");
+    isExact = isExact && isTextExact && isBinaryExact;
+  }
+  return isExact;
+}
+
+// Every worker takes its own UVCDeviceLock on one file, as separate
+// processes would, alternating mostly shared holds with exclusive ones.  An
+// exclusive holder must find no one else inside, a shared holder no exclusive
+// one.  Reports the longest wait for each mode.
+static bool FleetSimLockCheck(size_t iterations, size_t threadCount) {
+  char directory[] = "/tmp/uvc-fleet-sim-XXXXXX";
+  if (!mkdtemp(directory)) {
+    fprintf(stderr, "ERROR: Unable to create lock directory (errno = %d)\n",
+            errno);
+    return false;
+  }
+
+  UVCDeviceIdentity identity;
+  identity.serialNumber = "SIMLOCK";
+  identity.vendorId = 0x1209;
+  std::string path =
+      UVCDeviceLock::createForDevice(identity, directory)->path();
+
+  std::atomic<int> readers(0), writers(0);
+  std::atomic<uint64_t> violations(0), timeouts(0);
+  std::atomic<uint64_t> maxWaitMicros[2] = {{0}, {0}};
+  std::vector<std::thread> workers;
+
+  for (size_t t = 0; t < std::max<size_t>(threadCount, 2); t++) {
+    workers.emplace_back([&, t]() {
+      UVCDeviceLock lock(path);
+      for (size_t i = 0; i < iterations; i++) {
+        bool isExclusive = (i + t) % 4 == 0;
+        auto started = SteadyClock::now();
+        if (!lock.lock(isExclusive ? UVCLockMode::Exclusive
+                                   : UVCLockMode::Shared,
+                       kUVCDeviceLockTimeoutMillis)) {
+          timeouts++;
+          continue;
+        }
+        uint64_t waited = std::chrono::duration_cast<std::chrono::microseconds>(
+                              SteadyClock::now() - started)
+                              .count();
+        std::atomic<uint64_t>& maxWait = maxWaitMicros[isExclusive];
+        uint64_t seen = maxWait;
+        while (waited > seen && !maxWait.compare_exchange_weak(seen, waited)) {
+        }
+
+        if (isExclusive) {
+          if (writers++ || readers) {
+            violations++;
+          }
+          std::this_thread::sleep_for(std::chrono::microseconds(200));
+          writers--;
+        } else {
+          readers++;
+          if (writers) {
+            violations++;
+          }
+          std::this_thread::sleep_for(std::chrono::microseconds(100));
+          readers--;
+        }
+        lock.unlock();
+      }
+    });
+  }
+  for (auto& worker : workers) {
+    worker.join();
+  }
+
+  // The sub-cameras of a composite device are locked independently:  with
+  // interface 0 held exclusively, a controller on interface 2 still probes
+  // while one on interface 0 waits out its timeout.
+  const uint8_t interfaceNumbers[] = {0, 2};
+  std::shared_ptr<UVCDeviceController> subCameras[2];
+  std::string subCameraPaths[2];
+  for (size_t i = 0; i < 2; i++) {
+    auto transport = UVCSimulatedTransport::createWithPreset(
+        UVCSimulatedPreset::PanTiltZoom, identity);
+    transport->setInterfaceNumber(interfaceNumbers[i]);
+    transport->open();
+    auto subCameraLock = UVCDeviceLock::createForDevice(identity, directory,
+                                                        interfaceNumbers[i]);
+    subCameraPaths[i] = subCameraLock->path();
+    subCameras[i] = UVCDeviceController::createWithTransport(transport);
+    subCameras[i]->setDeviceLock(subCameraLock, 50);
+  }
+
+  UVCDeviceLock holder(subCameraPaths[0]);
+  bool isHeld = holder.lock(UVCLockMode::Exclusive, 0);
+  auto started = SteadyClock::now();
+  bool isOtherProbed = subCameras[1]->controlWithName("zoom-abs") != nullptr;
+  double otherMillis =
+      std::chrono::duration<double, std::milli>(SteadyClock::now() - started)
+          .count();
+  bool isHeldProbed = subCameras[0]->controlWithName("zoom-abs") != nullptr;
+  holder.unlock();
+  bool isIndependent = isHeld && isOtherProbed && !isHeldProbed &&
+                       subCameraPaths[0] != subCameraPaths[1];
+
+  for (const std::string& lockPath : {path, subCameraPaths[1]}) {
+    unlink(lockPath.c_str());
+    unlink((lockPath + ".queue").c_str());
+  }
+  rmdir(directory);
+
+  printf("Lock check:           %zu holders x %zu, max wait shared %.1f ms, "
+         "exclusive %.1f ms, %llu timeouts, %llu violations\n",
+         workers.size(), iterations, maxWaitMicros[0] / 1000.0,
+         maxWaitMicros[1] / 1000.0,
+         static_cast<unsigned long long>(timeouts.load()),
+         static_cast<unsigned long long>(violations.load()));
+  printf("Composite lock:       interface 2 probed in %.1f ms with interface "
+         "0 held, %s\n",
+         otherMillis, isIndependent ? "independent" : "NOT INDEPENDENT");
+  return violations == 0 && timeouts == 0 && isIndependent;
+}
+
+// A control sampled about once a second:  the time of each sample wanders
+// by up to a millisecond, and now and then the value moves to the control's
+// current, minimum or maximum value.  The same seed gives the same samples.
+struct FleetSimHistorySource {
+  std::mt19937 random;
+  std::vector<std::vector<uint8_t>> choices;
+  std::vector<uint8_t> value;
+  uint64_t second;
+  uint64_t micros;
+
+  FleetSimHistorySource(UVCControl& control, uint32_t seed, uint64_t start)
+      : random(seed), second(start), micros(start) {
+    for (auto limit : {control.currentValue(), control.minimum(),
+                       control.maximum()}) {
+      if (limit) {
+        const uint8_t* bytes = static_cast<const uint8_t*>(limit->valuePtr());
+        choices.emplace_back(bytes, bytes + control.valueSize());
+      }
+    }
+    value = choices[0];
+  }
+
+  void next() {
+    second += 1000000;
+    micros = second + random() % 1000;
+    if (random() % 20 == 0) {
+      value = choices[random() % choices.size()];
+    }
+  }
+};
+
+// Run work(deviceIndex, results) for every device of the fleet, spread over
+// threadCount workers.
+static FleetSimResults FleetSimRunParallel(
+    size_t deviceCount,
+    size_t threadCount,
+    const std::function<void(size_t, FleetSimResults&)>& work) {
+  std::atomic<size_t> nextDevice(0);
+  std::atomic<size_t> peakThreads(0);
+  std::vector<FleetSimResults> perThread(threadCount);
+  std::vector<std::thread> workers;
+  auto started = SteadyClock::now();
+
+  for (size_t t = 0; t < threadCount; t++) {
+    workers.emplace_back([&, t]() {
+      size_t index;
+      while ((index = nextDevice++) < deviceCount) {
+        work(index, perThread[t]);
+      }
+      if (t == 0) {
+        peakThreads = FleetSimThreadCount();
+      }
+    });
+  }
+  for (auto& worker : workers) {
+    worker.join();
+  }
+
+  FleetSimResults results;
+  for (const auto& threadResults : perThread) {
+    results.merge(threadResults);
+  }
+  results.elapsedSeconds =
+      std::chrono::duration<double>(SteadyClock::now() - started).count();
+  results.peakThreads = peakThreads;
+  return results;
+}
+
+// Time a single control operation into results
+template <typename Operation>
+static bool FleetSimTimed(FleetSimResults& results, Operation operation) {
+  auto started = SteadyClock::now();
+  bool ok = operation();
+  auto micros = std::chrono::duration_cast<std::chrono::microseconds>(
+                    SteadyClock::now() - started)
+                    .count();
+
+  results.latencies.push_back(static_cast<uint32_t>(micros));
+  results.operations++;
+  if (!ok) {
+    results.failures++;
+  }
+  return ok;
+}
+
+static uint32_t FleetSimPercentile(const std::vector<uint32_t>& sorted,
+                                   double percentile) {
+  if (sorted.empty()) {
+    return 0;
+  }
+  size_t index = static_cast<size_t>(percentile * (sorted.size() - 1) + 0.5);
+  return sorted[std::min(index, sorted.size() - 1)];
+}
+
+static void FleetSimReport(const char* workload, FleetSimResults& results) {
+  std::sort(results.latencies.begin(), results.latencies.end());
+  printf("%-10s %10llu %8llu %8llu %12.1f %8u %8u %8u %9u %7zu\n", workload,
+         static_cast<unsigned long long>(results.operations),
+         static_cast<unsigned long long>(results.failures),
+         static_cast<unsigned long long>(results.writes),
+         results.elapsedSeconds > 0.0
+             ? results.operations / results.elapsedSeconds
+             : 0.0,
+         FleetSimPercentile(results.latencies, 0.50),
+         FleetSimPercentile(results.latencies, 0.99),
+         FleetSimPercentile(results.latencies, 0.999),
+         results.latencies.empty() ? 0 : results.latencies.back(),
+         results.peakThreads);
+}
+
+static bool FleetSimParseWorkloads(const char* spec, FleetSimOptions& options) {
+  std::string list(spec);
+  size_t start = 0;
+
+  options.runProbe = options.runFanOut = options.runReconcile =
+      options.runWatch = options.runReconnect = options.runAutosuspend =
+          options.runReprobe = options.runIdle = options.runJournal =
+              options.runHistory = options.runAudit = false;
+  while (start <= list.size()) {
+    size_t end = list.find(',', start);
+    std::string name = list.substr(start, end - start);
+
+    if (name == "all") {
+      options.runProbe = options.runFanOut = options.runReconcile =
+          options.runWatch = options.runReconnect = options.runAutosuspend =
+              options.runReprobe = options.runIdle = options.runJournal =
+                  options.runHistory = options.runAudit = true;
+    } else if (name == "probe") {
+      options.runProbe = true;
+    } else if (name == "fanout") {
+      options.runFanOut = true;
+    } else if (name == "reconcile") {
+      options.runReconcile = true;
+    } else if (name == "watch") {
+      options.runWatch = true;
+    } else if (name == "reconnect") {
+      options.runReconnect = true;
+    } else if (name == "autosuspend") {
+      options.runAutosuspend = true;
+    } else if (name == "reprobe") {
+      options.runReprobe = true;
+    } else if (name == "idle") {
+      options.runIdle = true;
+    } else if (name == "journal") {
+      options.runJournal = true;
+    } else if (name == "history") {
+      options.runHistory = true;
+    } else if (name == "audit") {
+      options.runAudit = true;
+    } else {
+      return false;
+    }
+    if (end == std::string::npos)
+      break;
+    start = end + 1;
+  }
+  return true;
+}
+
+int main(int argc, char* argv[]) {
+  FleetSimOptions options;
+  int optCh;
+
+  while ((optCh = getopt_long(argc, argv, "n:p:t:i:w:W:l:f:s:ab:c:r:L:h",
+                              fleetSimOptions, nullptr)) != -1) {
+    switch (optCh) {
+      case 'n':
+        options.deviceCount = strtoul(optarg, nullptr, 0);
+        break;
+      case 'p':
+        options.hubPorts =
+            std::min<size_t>(std::max<size_t>(strtoul(optarg, nullptr, 0), 1),
+                             15);
+        break;
+      case 't':
+        options.threadCount =
+            std::max<size_t>(strtoul(optarg, nullptr, 0), 1);
+        break;
+      case 'i':
+        options.iterations = strtoul(optarg, nullptr, 0);
+        break;
+      case 'w':
+        if (!FleetSimParseWorkloads(optarg, options)) {
+          fprintf(stderr, "ERROR: Invalid workload list '%s'\n", optarg);
+          return EINVAL;
+        }
+        break;
+      case 'W':
+        options.watchMillis = strtoul(optarg, nullptr, 0);
+        break;
+      case 'l': {
+        char* endPtr = nullptr;
+        options.latencyMicros = strtoul(optarg, &endPtr, 0);
+        options.jitterMicros =
+            (endPtr && *endPtr == ':') ? strtoul(endPtr + 1, nullptr, 0) : 0;
+        break;
+      }
+      case 'f':
+        options.failureRate = strtod(optarg, nullptr);
+        break;
+      case 's':
+        options.seed = strtoul(optarg, nullptr, 0);
+        break;
+      case 'a':
+        options.checkAllocations = true;
+        break;
+      case 'b':
+        options.dispatchTransfers = strtoul(optarg, nullptr, 0);
+        break;
+      case 'c':
+        options.codecIterations = strtoul(optarg, nullptr, 0);
+        break;
+      case 'r':
+        options.roundTripIterations = strtoul(optarg, nullptr, 0);
+        break;
+      case 'L':
+        options.lockIterations = strtoul(optarg, nullptr, 0);
+        break;
+      case 'h':
+        usage(argv[0]);
+        return 0;
+      default:
+        usage(argv[0]);
+        return EINVAL;
+    }
+  }
+
+  if (options.deviceCount == 0) {
+    fprintf(stderr, "ERROR: At least one device is required\n");
+    return EINVAL;
+  }
+
+  if (!FleetSimLoadQuirks()) {
+    return EXIT_FAILURE;
+  }
+
+  size_t residentBefore = FleetSimResidentBytes();
+  size_t heapBefore = FleetSimHeapBytes();
+  std::vector<FleetDevice> fleet = FleetSimCreateFleet(options);
+  std::vector<std::string> controlNames =
+      UVCDeviceController::getAllControlStrings();
+
+  printf("Fleet: %zu simulated cameras, %zu-port hubs (%zu buses), %zu "
+         "worker threads\n",
+         fleet.size(), options.hubPorts,
+         (fleet.size() + options.hubPorts * options.hubPorts - 1) /
+             (options.hubPorts * options.hubPorts),
+         options.threadCount);
+  printf("%-10s %10s %8s %8s %12s %8s %8s %8s %9s %7s\n", "Workload",
+         "Ops", "Failed", "Writes", "Ops/sec", "p50(us)", "p99(us)",
+         "p999(us)", "max(us)", "Threads");
+
+  // Controller creation and capability probing of every control:
+  FleetSimResults probe = FleetSimRunParallel(
+      fleet.size(), options.threadCount,
+      [&](size_t index, FleetSimResults& results) {
+        FleetDevice& device = fleet[index];
+
+        device.controller =
+            UVCDeviceController::createWithTransport(device.breaker);
+        for (const auto& name : controlNames) {
+          std::shared_ptr<UVCControl> control;
+          FleetSimTimed(results, [&]() {
+            control = device.controller->controlWithName(name);
+            return control != nullptr;
+          });
+          if (control) {
+            device.controls.push_back(control);
+          }
+        }
+      });
+  size_t residentAfter = FleetSimResidentBytes();
+  size_t heapAfter = FleetSimHeapBytes();
+  if (options.runProbe) {
+    FleetSimReport("probe", probe);
+  }
+
+  if (options.runFanOut) {
+    FleetSimResults fanOut;
+    for (size_t pass = 0; pass < options.iterations; pass++) {
+      FleetSimResults passResults = FleetSimRunParallel(
+          fleet.size(), options.threadCount,
+          [&](size_t index, FleetSimResults& results) {
+            for (auto& control : fleet[index].controls) {
+              FleetSimTimed(results,
+                            [&]() { return control->readIntoCurrentValue(); });
+            }
+          });
+      fanOut.merge(passResults);
+      fanOut.elapsedSeconds += passResults.elapsedSeconds;
+      fanOut.peakThreads =
+          std::max(fanOut.peakThreads, passResults.peakThreads);
+    }
+    FleetSimReport("fanout", fanOut);
+  }
+
+  if (options.runReconcile) {
+    // Knock every other control off its default, then drive the fleet back to
+    // the desired (default) state with read-compare-write:
+    FleetSimRunParallel(
+        fleet.size(), options.threadCount,
+        [&](size_t index, FleetSimResults&) {
+          auto& controls = fleet[index].controls;
+          for (size_t i = 0; i < controls.size(); i += 2) {
+            controls[i]->setCurrentValueFromCString("minimum",
+                                                    UVCTypeScanFlags());
+            controls[i]->writeFromCurrentValue();
+          }
+        });
+
+    FleetSimResults reconcile;
+    for (size_t pass = 0; pass < options.iterations; pass++) {
+      FleetSimResults passResults = FleetSimRunParallel(
+          fleet.size(), options.threadCount,
+          [&](size_t index, FleetSimResults& results) {
+            for (auto& control : fleet[index].controls) {
+              auto desired = control->defaultValue();
+              if (!desired || !control->supportsSetValue()) {
+                continue;
+              }
+              std::shared_ptr<UVCValue> current;
+              if (!FleetSimTimed(results, [&]() {
+                    current = control->currentValue();
+                    return current != nullptr;
+                  })) {
+                continue;
+              }
+              if (!current->isEqual(*desired)) {
+                results.writes++;
+                FleetSimTimed(results,
+                              [&]() { return control->resetToDefaultValue(); });
+              }
+            }
+          });
+      reconcile.merge(passResults);
+      reconcile.elapsedSeconds += passResults.elapsedSeconds;
+      reconcile.peakThreads =
+          std::max(reconcile.peakThreads, passResults.peakThreads);
+    }
+    FleetSimReport("reconcile", reconcile);
+  }
+
+  if (options.runWatch) {
+    // Poll the first control of every camera at a fixed interval; a camera
+    // whose poll is late counts a failure.
+    auto interval = std::chrono::milliseconds(options.watchIntervalMillis);
+    auto deadline =
+        SteadyClock::now() + std::chrono::milliseconds(options.watchMillis);
+    FleetSimResults watch;
+
+    while (SteadyClock::now() < deadline) {
+      auto tick = SteadyClock::now();
+      FleetSimResults tickResults = FleetSimRunParallel(
+          fleet.size(), options.threadCount,
+          [&](size_t index, FleetSimResults& results) {
+            auto& controls = fleet[index].controls;
+            if (controls.empty()) {
+              return;
+            }
+            FleetSimTimed(results, [&]() {
+              return controls[0]->readIntoCurrentValue() &&
+                     SteadyClock::now() - tick < interval;
+            });
+          });
+      watch.merge(tickResults);
+      watch.elapsedSeconds += tickResults.elapsedSeconds;
+      watch.peakThreads = std::max(watch.peakThreads, tickResults.peakThreads);
+      std::this_thread::sleep_until(tick + interval);
+    }
+    FleetSimReport("watch", watch);
+  }
+
+  size_t reconnectMismatches = 0;
+  if (options.runReconnect) {
+    // Move every settable control to its maximum, then take each camera off
+    // the bus and put it back, which reverts its values to the defaults.  The
+    // next read finds the device gone; the controller reconnects and restores
+    // the maximums, which must then read back on every healthy camera.
+    std::atomic<size_t> mismatches(0);
+    FleetSimResults reconnect = FleetSimRunParallel(
+        fleet.size(), options.threadCount,
+        [&](size_t index, FleetSimResults& results) {
+          FleetDevice& device = fleet[index];
+          std::vector<UVCControl*> written;
+
+          for (auto& control : device.controls) {
+            std::string name = control->controlName();
+            bool isRelative = name.size() > 4 &&
+                              name.compare(name.size() - 4, 4, "-rel") == 0;
+            if (!control->supportsSetValue() || !control->maximum() ||
+                isRelative) {
+              continue;
+            }
+            if (control->setCurrentValueFromCString("maximum",
+                                                    UVCTypeScanFlags()) &&
+                control->writeFromCurrentValue()) {
+              written.push_back(control.get());
+            }
+          }
+          if (written.empty()) {
+            return;
+          }
+
+          UVCReconnectStatistics before =
+              device.controller->reconnectStatistics();
+          device.transport->unplug();
+          device.transport->replug();
+          written[0]->readIntoCurrentValue();
+
+          UVCReconnectStatistics after =
+              device.controller->reconnectStatistics();
+          results.operations++;
+          if (after.reconnects == before.reconnects) {
+            results.failures++;
+            return;
+          }
+          results.latencies.push_back(after.lastRecoveryMicros);
+          results.writes += after.restoredControls - before.restoredControls;
+          if (strcmp(device.failureMode, "healthy") != 0) {
+            return;
+          }
+          for (UVCControl* control : written) {
+            auto value = control->currentValue();
+            if (!value || !value->isEqual(*control->maximum())) {
+              mismatches++;
+            }
+          }
+        });
+    reconnectMismatches = mismatches;
+    FleetSimReport("reconnect", reconnect);
+  }
+
+  size_t needlessWakeups = 0;
+  if (options.runAutosuspend) {
+    // Let every camera autosuspend when idle.  The first pass reads with
+    // stale values allowed, which wakes each camera once and fills its
+    // controller's cache; the second writes the values back in one batch
+    // per camera, waking it once more.  Every later pass must be answered
+    // from the cache without waking a healthy camera.
+    UVCSimulatedAutosuspend autosuspend;
+    autosuspend.idleMicros = 200000;
+    autosuspend.resumeMicros = 20000;
+    const uint32_t maxAgeMicros = 60000000;
+    std::vector<uint64_t> wakeupsBefore(fleet.size());
+
+    for (size_t i = 0; i < fleet.size(); i++) {
+      fleet[i].transport->setAutosuspend(autosuspend);
+      wakeupsBefore[i] = fleet[i].transport->statistics().wakeups;
+    }
+
+    FleetSimResults suspended;
+    for (size_t pass = 0; pass < options.iterations + 2; pass++) {
+      std::this_thread::sleep_for(
+          std::chrono::microseconds(autosuspend.idleMicros * 5 / 4));
+      FleetSimResults passResults = FleetSimRunParallel(
+          fleet.size(), options.threadCount,
+          [&](size_t index, FleetSimResults& results) {
+            FleetDevice& device = fleet[index];
+
+            if (pass != 1) {
+              for (auto& control : device.controls) {
+                FleetSimTimed(results, [&]() {
+                  return control->readIntoCurrentValue(maxAgeMicros);
+                });
+              }
+              return;
+            }
+
+            std::vector<UVCValueTransfer> transfers;
+            for (auto& control : device.controls) {
+              std::string name = control->controlName();
+              bool isRelative = name.size() > 4 &&
+                                name.compare(name.size() - 4, 4, "-rel") == 0;
+              auto value = control->currentValue();
+              if (!control->supportsSetValue() || isRelative || !value) {
+                continue;
+              }
+              UVCValueTransfer transfer;
+              transfer.controlId = control->controlId();
+              transfer.isWrite = true;
+              transfer.data = value->valuePtr();
+              transfer.length = value->byteSize();
+              transfers.push_back(transfer);
+            }
+            results.writes += transfers.size();
+            FleetSimTimed(results, [&]() {
+              return device.controller->transferValues(transfers.data(),
+                                                       transfers.size());
+            });
+          });
+      suspended.merge(passResults);
+      suspended.elapsedSeconds += passResults.elapsedSeconds;
+      suspended.peakThreads =
+          std::max(suspended.peakThreads, passResults.peakThreads);
+    }
+
+    autosuspend.idleMicros = 0;
+    for (size_t i = 0; i < fleet.size(); i++) {
+      fleet[i].transport->setAutosuspend(autosuspend);
+      uint64_t wakeups =
+          fleet[i].transport->statistics().wakeups - wakeupsBefore[i];
+      if (strcmp(fleet[i].failureMode, "healthy") == 0 && wakeups > 2) {
+        needlessWakeups += wakeups - 2;
+      }
+    }
+    FleetSimReport("autosuspend", suspended);
+  }
+
+  size_t reprobeMismatches = 0;
+  uint64_t reprobeStalls[2] = {0, 0}, reprobeSkipped = 0;
+  if (options.runReprobe) {
+    // Probe every camera from scratch twice, as two later runs of a program
+    // would, with the probe cache of each model in a scratch directory.  The
+    // first run probes everything and records the controls whose GET_INFO
+    // stalled; the second must find the same controls on every healthy
+    // camera, skipping those probes and the stalls that came with them.
+    char directory[] = "/tmp/uvc-fleet-sim-XXXXXX";
+    if (!mkdtemp(directory)) {
+      fprintf(stderr, "ERROR: Unable to create cache directory (errno = %d)\n",
+              errno);
+      return EXIT_FAILURE;
+    }
+
+    std::vector<size_t> firstControls(fleet.size());
+    std::vector<uint64_t> firstStalls(fleet.size());
+    std::atomic<size_t> mismatches(0);
+    std::atomic<uint64_t> stallCounts[2] = {{0}, {0}}, skippedProbes(0);
+    FleetSimResults reprobe;
+
+    for (size_t run = 0; run < 2; run++) {
+      FleetSimResults runResults = FleetSimRunParallel(
+          fleet.size(), options.threadCount,
+          [&](size_t index, FleetSimResults& results) {
+            FleetDevice& device = fleet[index];
+            uint64_t stallsBefore = device.transport->statistics().stalls;
+            size_t found = 0, skipped = 0;
+
+            auto controller =
+                UVCDeviceController::createWithTransport(device.breaker);
+            auto probeCache = UVCProbeCache::createForDevice(
+                device.transport->identity(),
+                device.transport->videoControlDescriptors(), directory);
+            probeCache->setReprobes(run == 0);
+            for (size_t controlId = 0; controlId < controlNames.size();
+                 controlId++) {
+              skipped += probeCache->isKnownToFail(controlId);
+            }
+            controller->setProbeCache(probeCache);
+            for (const auto& name : controlNames) {
+              if (FleetSimTimed(results, [&]() {
+                    return controller->controlWithName(name) != nullptr;
+                  })) {
+                found++;
+              }
+            }
+            probeCache->save();
+
+            if (strcmp(device.failureMode, "healthy") != 0) {
+              return;
+            }
+            uint64_t stalls =
+                device.transport->statistics().stalls - stallsBefore;
+            stallCounts[run] += stalls;
+            if (run == 0) {
+              firstControls[index] = found;
+              firstStalls[index] = stalls;
+              return;
+            }
+            skippedProbes += skipped;
+            if (!skipped || stalls + skipped != firstStalls[index] ||
+                found != firstControls[index]) {
+              mismatches++;
+            }
+          });
+      reprobe.merge(runResults);
+      reprobe.elapsedSeconds += runResults.elapsedSeconds;
+      reprobe.peakThreads =
+          std::max(reprobe.peakThreads, runResults.peakThreads);
+    }
+
+    // Leave nothing behind:
+    DIR* scratch = opendir(directory);
+    if (scratch) {
+      struct dirent* entry;
+      while ((entry = readdir(scratch))) {
+        if (entry->d_name[0] != '.') {
+          unlink((std::string(directory) + "/" + entry->d_name).c_str());
+        }
+      }
+      closedir(scratch);
+    }
+    rmdir(directory);
+
+    reprobeMismatches = mismatches;
+    reprobeStalls[0] = stallCounts[0];
+    reprobeStalls[1] = stallCounts[1];
+    reprobeSkipped = skippedProbes;
+    FleetSimReport("reprobe", reprobe);
+  }
+
+  size_t idleMismatches = 0, pinnedCount = 0;
+  uint64_t lowPowerStalls = 0;
+  UVCIdlePowerStatistics idlePower;
+  if (options.runIdle) {
+    // Give every camera a lower power mode and put an idle power manager in
+    // front of it, pinning every tenth camera awake.  Each pass lets the
+    // fleet go idle and drops the idle cameras to low power, then reads
+    // every control:  half the cameras are woken in advance, the others by
+    // the read itself.  No request may reach a healthy camera in low power,
+    // and every healthy camera must be in the expected mode on every pass.
+    UVCIdlePowerPolicy policy;
+    policy.idleMicros = 50000;
+    UVCSimulatedPowerMode powerMode;
+    powerMode.isSupported = true;
+    powerMode.wakeMicros = 5000;
+    std::vector<std::shared_ptr<UVCIdlePowerTransport>> managers(fleet.size());
+    std::vector<std::shared_ptr<UVCDeviceController>> controllers(
+        fleet.size());
+    std::vector<std::vector<std::shared_ptr<UVCControl>>> controls(
+        fleet.size());
+    std::vector<uint64_t> stallsBefore(fleet.size());
+
+    FleetSimRunParallel(
+        fleet.size(), options.threadCount,
+        [&](size_t index, FleetSimResults&) {
+          FleetDevice& device = fleet[index];
+
+          device.transport->setPowerMode(powerMode);
+          stallsBefore[index] = device.transport->statistics().lowPowerStalls;
+          managers[index] =
+              UVCIdlePowerTransport::create(device.breaker, policy);
+          managers[index]->setPinned(index % 10 == 0);
+          controllers[index] =
+              UVCDeviceController::createWithTransport(managers[index]);
+          for (const auto& probed : device.controls) {
+            auto control =
+                controllers[index]->controlWithId(probed->controlId());
+            if (control) {
+              controls[index].push_back(control);
+            }
+          }
+        });
+
+    std::atomic<size_t> mismatches(0);
+    FleetSimResults idle;
+    for (size_t pass = 0; pass < options.iterations; pass++) {
+      std::this_thread::sleep_for(
+          std::chrono::microseconds(policy.idleMicros * 5 / 4));
+      FleetSimResults passResults = FleetSimRunParallel(
+          fleet.size(), options.threadCount,
+          [&](size_t index, FleetSimResults& results) {
+            UVCIdlePowerTransport& manager = *managers[index];
+            bool isLowPower = manager.enterLowPowerIfIdle();
+
+            if (strcmp(fleet[index].failureMode, "healthy") == 0 &&
+                isLowPower == manager.isPinned()) {
+              mismatches++;
+            }
+            if (index % 2) {
+              manager.wake();
+            }
+            for (auto& control : controls[index]) {
+              FleetSimTimed(results,
+                            [&]() { return control->readIntoCurrentValue(); });
+            }
+          });
+      idle.merge(passResults);
+      idle.elapsedSeconds += passResults.elapsedSeconds;
+      idle.peakThreads = std::max(idle.peakThreads, passResults.peakThreads);
+    }
+
+    for (size_t i = 0; i < fleet.size(); i++) {
+      UVCIdlePowerStatistics statistics = managers[i]->statistics();
+      idlePower.lowPowerEntries += statistics.lowPowerEntries;
+      idlePower.wakeups += statistics.wakeups;
+      idlePower.totalWakeMicros += statistics.totalWakeMicros;
+      idlePower.maxWakeMicros =
+          std::max(idlePower.maxWakeMicros, statistics.maxWakeMicros);
+      pinnedCount += managers[i]->isPinned();
+      if (strcmp(fleet[i].failureMode, "healthy") == 0) {
+        lowPowerStalls +=
+            fleet[i].transport->statistics().lowPowerStalls - stallsBefore[i];
+      }
+    }
+    idleMismatches = mismatches;
+    FleetSimReport("idle", idle);
+  }
+
+  size_t journalMismatches = 0, journalCameras = 0;
+  uint64_t redrivenWrites = 0, elidedWrites = 0;
+  double unjournaledSeconds = 0.0;
+  UVCWriteJournalStatistics journaled;
+  FleetSimResults journal;
+  if (options.runJournal) {
+    // Durability cost:  every healthy camera writes back the current values
+    // of its settable controls in batches, first without a journal and then
+    // with one that syncs every intent, shared by all workers.
+    char directory[] = "/tmp/uvc-fleet-sim-XXXXXX";
+    if (!mkdtemp(directory)) {
+      fprintf(stderr,
+              "ERROR: Unable to create journal directory (errno = %d)\n",
+              errno);
+      return EXIT_FAILURE;
+    }
+    std::string journalPath = std::string(directory) + "/writes.journal";
+
+    std::vector<std::vector<UVCJournalWrite>> values(fleet.size());
+    for (size_t i = 0; i < fleet.size(); i++) {
+      if (strcmp(fleet[i].failureMode, "healthy") != 0) {
+        continue;
+      }
+      for (const auto& control : fleet[i].controls) {
+        std::string name = control->controlName();
+        if (!control->supportsSetValue() || !control->hasRange() ||
+            (name.size() > 4 &&
+             name.compare(name.size() - 4, 4, "-rel") == 0) ||
+            !control->readIntoCurrentValue()) {
+          continue;
+        }
+        UVCJournalWrite write;
+        const uint8_t* current =
+            static_cast<const uint8_t*>(control->currentValue()->valuePtr());
+        write.controlId = control->controlId();
+        write.data.assign(current, current + control->valueSize());
+        values[i].push_back(std::move(write));
+      }
+      journalCameras += !values[i].empty();
+    }
+
+    auto writeBack = [&](UVCDeviceController& controller, size_t index) {
+      std::vector<UVCValueTransfer> transfers;
+      for (auto& write : values[index]) {
+        UVCValueTransfer transfer;
+        transfer.controlId = write.controlId;
+        transfer.isWrite = true;
+        transfer.data = write.data.data();
+        transfer.length = write.data.size();
+        transfers.push_back(transfer);
+      }
+      return controller.transferValues(transfers.data(), transfers.size());
+    };
+
+    auto writeJournal = UVCWriteJournal::open(journalPath);
+    for (int pass = 0; pass < 2 && writeJournal; pass++) {
+      FleetSimResults passResults = FleetSimRunParallel(
+          fleet.size(), options.threadCount,
+          [&](size_t index, FleetSimResults& results) {
+            if (values[index].empty()) {
+              return;
+            }
+            auto controller =
+                UVCDeviceController::createWithTransport(fleet[index].breaker);
+            controller->setWriteJournal(pass ? writeJournal : nullptr);
+            for (size_t i = 0; i < options.iterations; i++) {
+              FleetSimTimed(results,
+                            [&]() { return writeBack(*controller, index); });
+              results.writes += values[index].size();
+            }
+          });
+      if (pass == 0) {
+        unjournaledSeconds = passResults.elapsedSeconds;
+      } else {
+        journal = passResults;
+      }
+    }
+    if (writeJournal) {
+      writeJournal->flush();
+      journaled = writeJournal->statistics();
+      writeJournal = nullptr;
+    }
+
+    // Crash consistency:  each camera's intent to move its controls to the
+    // other end of their range is journaled, then a crash is staged.  Every
+    // third camera received all of the writes, every third none, the rest
+    // the first half, and no confirmation was written.  Re-driving with a
+    // fresh controller (as after a restart) must leave every camera with the
+    // intended values, re-sending only what it lacks, and the batches
+    // confirmed.
+    std::vector<std::vector<UVCJournalWrite>> intents(fleet.size());
+    std::vector<size_t> applied(fleet.size());
+    if ((writeJournal = UVCWriteJournal::open(journalPath))) {
+      for (size_t i = 0; i < fleet.size(); i++) {
+        if (values[i].empty()) {
+          continue;
+        }
+        auto controller =
+            UVCDeviceController::createWithTransport(fleet[i].breaker);
+        for (const auto& write : values[i]) {
+          auto control = controller->controlWithId(write.controlId);
+          const uint8_t* maximum =
+              static_cast<const uint8_t*>(control->maximum()->valuePtr());
+          const uint8_t* minimum =
+              static_cast<const uint8_t*>(control->minimum()->valuePtr());
+          UVCJournalWrite intent;
+          intent.controlId = write.controlId;
+          intent.data.assign(maximum, maximum + write.data.size());
+          if (intent.data == write.data) {
+            intent.data.assign(minimum, minimum + write.data.size());
+          }
+          intents[i].push_back(std::move(intent));
+        }
+        writeJournal->logIntent(
+            UVCWriteJournal::deviceKey(fleet[i].transport->identity(),
+                                       fleet[i].transport->interfaceNumber()),
+            intents[i].data(), intents[i].size());
+
+        applied[i] = (i % 3 == 0)   ? intents[i].size()
+                     : (i % 3 == 1) ? 0
+                                    : intents[i].size() / 2;
+        for (size_t w = 0; w < applied[i]; w++) {
+          controller->setValueData(intents[i][w].data.data(),
+                                   intents[i][w].data.size(),
+                                   intents[i][w].controlId);
+        }
+      }
+      writeJournal = nullptr;
+    }
+
+    std::atomic<size_t> mismatches(0);
+    std::atomic<uint64_t> redriven(0), elided(0);
+    size_t pendingBefore = 0, pendingAfter = SIZE_MAX;
+    if ((writeJournal = UVCWriteJournal::open(journalPath))) {
+      pendingBefore = writeJournal->pendingBatchCount();
+      FleetSimRunParallel(
+          fleet.size(), options.threadCount,
+          [&](size_t index, FleetSimResults&) {
+            if (intents[index].empty()) {
+              return;
+            }
+            auto controller =
+                UVCDeviceController::createWithTransport(fleet[index].breaker);
+            size_t deviceRedriven = 0, deviceElided = 0;
+
+            controller->setWriteJournal(writeJournal);
+            if (!controller->redriveJournal(&deviceRedriven, &deviceElided) ||
+                deviceElided != applied[index] ||
+                deviceRedriven + deviceElided != intents[index].size()) {
+              mismatches++;
+            }
+            for (const auto& intent : intents[index]) {
+              std::vector<uint8_t> value(intent.data.size());
+              if (!controller->getValueData(value.data(), value.size(),
+                                            intent.controlId) ||
+                  value != intent.data) {
+                mismatches++;
+              }
+            }
+            redriven += deviceRedriven;
+            elided += deviceElided;
+          });
+      writeJournal = nullptr;
+    }
+    // Nothing is left to re-drive once the confirmations are in:
+    if ((writeJournal = UVCWriteJournal::open(journalPath))) {
+      pendingAfter = writeJournal->pendingBatchCount();
+      writeJournal = nullptr;
+    }
+
+    // A write that times out is not confirmed:  its batch stays pending,
+    // through a re-drive that times out as well, until the camera answers
+    // again and it is re-driven.
+    if ((writeJournal = UVCWriteJournal::open(journalPath))) {
+      UVCDeviceIdentity identity;
+      identity.deviceName = "Simulated Webcam (journal)";
+      identity.serialNumber = "SIMJOURNAL";
+      identity.vendorId = 0x1209;
+      identity.productId = 0x0001;
+      auto transport = UVCSimulatedTransport::createWithPreset(
+          UVCSimulatedPreset::Webcam, identity);
+      auto controller = UVCDeviceController::createWithTransport(transport);
+      auto control =
+          controller ? controller->controlWithName("brightness") : nullptr;
+      size_t deviceRedriven = 0;
+
+      if (!control || !control->readIntoCurrentValue()) {
+        mismatches++;
+      } else {
+        std::vector<uint8_t> value(
+            static_cast<const uint8_t*>(control->maximum()->valuePtr()),
+            static_cast<const uint8_t*>(control->maximum()->valuePtr()) +
+                control->valueSize());
+        UVCSimulatedFailures failures;
+        failures.timeoutProbability = 1.0;
+
+        controller->setWriteJournal(writeJournal);
+        transport->setFailures(failures);
+        if (controller->setValueData(value.data(), value.size(),
+                                     control->controlId()) ||
+            writeJournal->pendingBatchCount() != 1) {
+          mismatches++;
+        }
+        // Failing again leaves the one batch pending, not a copy of it:
+        if (controller->redriveJournal() ||
+            writeJournal->pendingBatchCount() != 1) {
+          mismatches++;
+        }
+        transport->setFailures(UVCSimulatedFailures());
+        std::vector<uint8_t> current(value.size());
+        if (!controller->redriveJournal(&deviceRedriven) ||
+            deviceRedriven != 1 || writeJournal->pendingBatchCount() != 0 ||
+            !controller->getValueData(current.data(), current.size(),
+                                      control->controlId()) ||
+            current != value) {
+          mismatches++;
+        }
+      }
+      writeJournal = nullptr;
+    }
+    unlink(journalPath.c_str());
+    rmdir(directory);
+
+    redrivenWrites = redriven;
+    elidedWrites = elided;
+    journalMismatches = mismatches + (pendingBefore != journalCameras) +
+                        (pendingAfter != 0);
+    FleetSimReport("journal", journal);
+  }
+
+  size_t historyMismatches = 0;
+  uint64_t historySamples = 0, historyBytes = 0;
+  double historyCpuSeconds = 0.0;
+  size_t historyValueBytes = 0;
+  FleetSimResults history;
+  if (options.runHistory) {
+    char directory[] = "/tmp/uvc-fleet-sim-XXXXXX";
+    if (!mkdtemp(directory)) {
+      fprintf(stderr,
+              "ERROR: Unable to create history directory (errno = %d)\n",
+              errno);
+      return EXIT_FAILURE;
+    }
+    std::string readsPath = std::string(directory) + "/reads.history";
+    std::string samplesPath = std::string(directory) + "/samples.history";
+    std::atomic<size_t> mismatches(0);
+
+    // Recording from the control path:  every healthy camera reads each of
+    // its controls with the history attached; each read must come back as
+    // a sample, the last one with the value last read.
+    std::vector<std::vector<std::vector<uint8_t>>> lastRead(fleet.size());
+    std::vector<std::vector<uint64_t>> readCounts(fleet.size());
+    auto readsHistory = UVCHistoryWriter::create(readsPath);
+    if (readsHistory) {
+      history = FleetSimRunParallel(
+          fleet.size(), options.threadCount,
+          [&](size_t index, FleetSimResults& results) {
+            FleetDevice& device = fleet[index];
+            if (strcmp(device.failureMode, "healthy") != 0) {
+              return;
+            }
+            auto controller =
+                UVCDeviceController::createWithTransport(device.breaker);
+            controller->setHistory(readsHistory);
+            lastRead[index].resize(device.controls.size());
+            readCounts[index].resize(device.controls.size());
+            for (size_t i = 0; i < options.iterations; i++) {
+              for (size_t c = 0; c < device.controls.size(); c++) {
+                std::vector<uint8_t> value(device.controls[c]->valueSize());
+                if (FleetSimTimed(results, [&]() {
+                      return controller->getValueData(
+                          value.data(), value.size(),
+                          device.controls[c]->controlId());
+                    })) {
+                  lastRead[index][c] = value;
+                  readCounts[index][c]++;
+                }
+              }
+            }
+          });
+      readsHistory = nullptr;
+    }
+
+    auto reader = UVCHistoryReader::open(readsPath);
+    for (size_t i = 0; reader && i < fleet.size(); i++) {
+      for (size_t c = 0; c < readCounts[i].size(); c++) {
+        const std::string& serialNumber =
+            fleet[i].transport->identity().serialNumber;
+        const std::string name = fleet[i].controls[c]->controlName();
+        const auto& allSeries = reader->series();
+        auto found = std::find_if(
+            allSeries.begin(), allSeries.end(),
+            [&](const UVCHistorySeries& series) {
+              return series.serialNumber == serialNumber &&
+                     series.controlName == name;
+            });
+        uint16_t series = static_cast<uint16_t>(found - allSeries.begin());
+        std::vector<uint64_t> micros;
+        std::vector<uint8_t> values;
+
+        if (!readCounts[i][c]) {
+          continue;
+        }
+        if (found == allSeries.end() ||
+            !reader->read(series, 0, UINT64_MAX, micros, values) ||
+            micros.size() != readCounts[i][c] ||
+            !std::equal(lastRead[i][c].begin(), lastRead[i][c].end(),
+                        values.end() - lastRead[i][c].size())) {
+          mismatches++;
+        }
+      }
+    }
+    if (!reader) {
+      mismatches++;
+    }
+    reader = nullptr;
+
+    // Ingestion cost and size:  an hour of samples of every control of every
+    // healthy camera, each worker recording its cameras' controls side by
+    // side in time order, then read back whole and by time range.
+    const size_t samplesPerSeries = 3600;
+    const uint64_t start = 1700000000ULL * 1000000;
+    std::vector<std::vector<uint16_t>> seriesIds(fleet.size());
+    auto samplesHistory = UVCHistoryWriter::create(samplesPath);
+    if (samplesHistory) {
+      for (size_t i = 0; i < fleet.size(); i++) {
+        if (strcmp(fleet[i].failureMode, "healthy") != 0) {
+          continue;
+        }
+        for (const auto& control : fleet[i].controls) {
+          seriesIds[i].push_back(
+              control->readIntoCurrentValue()
+                  ? samplesHistory->addSeries(
+                        fleet[i].transport->identity(),
+                        fleet[i].transport->interfaceNumber(),
+                        control->controlId())
+                  : kUVCHistorySeriesInvalid);
+        }
+      }
+
+      std::clock_t cpuStarted = std::clock();
+      FleetSimRunParallel(
+          fleet.size(), options.threadCount,
+          [&](size_t index, FleetSimResults&) {
+            std::vector<FleetSimHistorySource> sources;
+            for (size_t c = 0; c < seriesIds[index].size(); c++) {
+              sources.emplace_back(*fleet[index].controls[c],
+                                   options.seed + index * 64 + c, start);
+            }
+            for (size_t sample = 0; sample < samplesPerSeries; sample++) {
+              for (size_t c = 0; c < sources.size(); c++) {
+                if (seriesIds[index][c] != kUVCHistorySeriesInvalid &&
+                    !samplesHistory->record(seriesIds[index][c],
+                                            sources[c].micros,
+                                            sources[c].value.data(),
+                                            sources[c].value.size())) {
+                  mismatches++;
+                }
+                sources[c].next();
+              }
+            }
+          });
+      samplesHistory->flush();
+      historyCpuSeconds =
+          static_cast<double>(std::clock() - cpuStarted) / CLOCKS_PER_SEC;
+      historySamples = samplesHistory->statistics().samples;
+      historyBytes = samplesHistory->statistics().bytesWritten;
+      samplesHistory = nullptr;
+    }
+
+    reader = UVCHistoryReader::open(samplesPath);
+    for (size_t i = 0; reader && i < fleet.size(); i++) {
+      for (size_t c = 0; c < seriesIds[i].size(); c++) {
+        if (seriesIds[i][c] == kUVCHistorySeriesInvalid) {
+          continue;
+        }
+        FleetSimHistorySource source(*fleet[i].controls[c],
+                                     options.seed + i * 64 + c, start);
+        std::vector<uint64_t> expectedMicros, micros, windowMicros;
+        std::vector<uint8_t> expectedValues, values, windowValues;
+        for (size_t sample = 0; sample < samplesPerSeries; sample++) {
+          expectedMicros.push_back(source.micros);
+          expectedValues.insert(expectedValues.end(), source.value.begin(),
+                                source.value.end());
+          source.next();
+        }
+        historyValueBytes += source.value.size() * samplesPerSeries;
+
+        // Ten minutes from the middle of the hour:
+        size_t valueSize = source.value.size();
+        size_t first = samplesPerSeries / 2, last = first + 600;
+        uint64_t from = start + first * 1000000;
+        uint64_t to = start + last * 1000000 - 1;
+        if (!reader->read(seriesIds[i][c], 0, UINT64_MAX, micros, values) ||
+            micros != expectedMicros || values != expectedValues ||
+            !reader->read(seriesIds[i][c], from, to, windowMicros,
+                          windowValues) ||
+            !std::equal(windowMicros.begin(), windowMicros.end(),
+                        expectedMicros.begin() + first,
+                        expectedMicros.begin() + last) ||
+            !std::equal(windowValues.begin(), windowValues.end(),
+                        expectedValues.begin() + first * valueSize,
+                        expectedValues.begin() + last * valueSize)) {
+          mismatches++;
+        }
+      }
+    }
+    if (!reader) {
+      mismatches++;
+    }
+    reader = nullptr;
+
+    // A crash in the middle of writing a block:  reopening must cut off the
+    // torn block alone and keep appending after what is intact.
+    struct stat fileStatus;
+    if (historySamples && stat(samplesPath.c_str(), &fileStatus) == 0 &&
+        truncate(samplesPath.c_str(), fileStatus.st_size - 7) == 0) {
+      samplesHistory = UVCHistoryWriter::create(samplesPath);
+      reader = UVCHistoryReader::open(samplesPath);
+      uint64_t kept = 0;
+      for (size_t series = 0; reader && series < reader->series().size();
+           series++) {
+        kept += reader->sampleCount(static_cast<uint16_t>(series));
+      }
+      if (!samplesHistory || !reader || kept >= historySamples ||
+          kept < historySamples - UVCHistoryPolicy().blockSamples) {
+        mismatches++;
+      }
+      samplesHistory = nullptr;
+      reader = nullptr;
+    }
+    unlink(readsPath.c_str());
+    unlink(samplesPath.c_str());
+    rmdir(directory);
+
+    historyMismatches = mismatches;
+    FleetSimReport("history", history);
+  }
+
+  size_t auditMismatches = 0, auditCameras = 0, auditModels = 0;
+  size_t auditDeviations = 0, auditPlanted = 0, auditGroups = 0;
+  double auditCpuSeconds = 0.0;
+  FleetSimResults audit;
+  if (options.runAudit) {
+    // The healthy cameras of each model are set to their defaults, then a
+    // few are given another power-line frequency or gamma.  The audit of
+    // each model must find exactly those, and group the rest together.
+    static const char* plantedControls[] = {"power-line-frequency", "gamma"};
+    std::map<uint16_t, std::vector<size_t>> models;
+    std::vector<size_t> positions(fleet.size());
+    std::map<std::pair<uint16_t, size_t>, std::vector<size_t>> planted;
+    std::atomic<size_t> mismatches(0);
+
+    for (size_t i = 0; i < fleet.size(); i++) {
+      if (strcmp(fleet[i].failureMode, "healthy") == 0) {
+        auto& cameras = models[fleet[i].transport->identity().productId];
+        positions[i] = cameras.size();
+        cameras.push_back(i);
+      }
+    }
+    for (auto& model : models) {
+      for (size_t position = 0; position < model.second.size(); position++) {
+        size_t i = model.second[position];
+        auto controller =
+            UVCDeviceController::createWithTransport(fleet[i].breaker);
+        std::vector<size_t> controlIds;
+        std::vector<std::vector<uint8_t>> data;
+        std::vector<UVCValueTransfer> transfers;
+
+        for (const auto& probed : fleet[i].controls) {
+          std::string name = probed->controlName();
+          auto control = controller->controlWithId(probed->controlId());
+          if (!control || !control->supportsSetValue() ||
+              !control->hasDefaultValue() ||
+              (name.size() > 4 &&
+               name.compare(name.size() - 4, 4, "-rel") == 0)) {
+            continue;
+          }
+
+          const uint8_t* value =
+              static_cast<const uint8_t*>(control->defaultValue()->valuePtr());
+          controlIds.push_back(control->controlId());
+          data.emplace_back(value, value + control->valueSize());
+          for (size_t p = 0; p < std::size(plantedControls); p++) {
+            if (name == plantedControls[p] && position % 11 == 3 + p * 4 &&
+                control->hasRange()) {
+              const uint8_t* maximum =
+                  static_cast<const uint8_t*>(control->maximum()->valuePtr());
+              const uint8_t* minimum =
+                  static_cast<const uint8_t*>(control->minimum()->valuePtr());
+              if (memcmp(maximum, value, data.back().size()) != 0) {
+                data.back().assign(maximum, maximum + data.back().size());
+              } else {
+                data.back().assign(minimum, minimum + data.back().size());
+              }
+              planted[{model.first, control->controlId()}].push_back(position);
+              auditPlanted++;
+            }
+          }
+        }
+        for (size_t t = 0; t < data.size(); t++) {
+          UVCValueTransfer transfer;
+          transfer.controlId = controlIds[t];
+          transfer.isWrite = true;
+          transfer.data = data[t].data();
+          transfer.length = data[t].size();
+          transfers.push_back(transfer);
+        }
+        if (!controller->transferValues(transfers.data(), transfers.size())) {
+          mismatches++;
+        }
+      }
+    }
+
+    std::map<uint16_t, std::shared_ptr<UVCFleetAudit>> audits;
+    for (const auto& model : models) {
+      audits[model.first] = UVCFleetAudit::create(model.second.size());
+      auditCameras += model.second.size();
+    }
+    auditModels = models.size();
+    audit = FleetSimRunParallel(
+        fleet.size(), options.threadCount,
+        [&](size_t index, FleetSimResults& results) {
+          if (strcmp(fleet[index].failureMode, "healthy") != 0) {
+            return;
+          }
+          auto controller =
+              UVCDeviceController::createWithTransport(fleet[index].breaker);
+          auto& modelAudit =
+              audits[fleet[index].transport->identity().productId];
+          if (!FleetSimTimed(results, [&]() {
+                return modelAudit->capture(positions[index], *controller);
+              })) {
+            mismatches++;
+          }
+        });
+
+    std::clock_t cpuStarted = std::clock();
+    for (auto& modelAudit : audits) {
+      modelAudit.second->analyze();
+    }
+    auditCpuSeconds =
+        static_cast<double>(std::clock() - cpuStarted) / CLOCKS_PER_SEC;
+
+    for (const auto& modelAudit : audits) {
+      // The controls each deviating camera was caught on:
+      std::map<size_t, std::vector<size_t>> deviants;
+      for (const UVCAuditControl& control : modelAudit.second->controls()) {
+        auto expected = planted.find({modelAudit.first, control.controlId});
+        if (expected == planted.end() ? !control.outliers.empty()
+                                      : control.outliers != expected->second) {
+          mismatches++;
+        }
+        auditDeviations += control.outliers.size();
+        for (size_t position : control.outliers) {
+          deviants[position].push_back(control.controlId);
+        }
+      }
+      std::set<std::vector<size_t>> deviations;
+      for (const auto& deviant : deviants) {
+        deviations.insert(deviant.second);
+      }
+
+      // One group for the cameras left alone, one for each kind of planted
+      // deviation:
+      const auto& groups = modelAudit.second->groups();
+      size_t cameras = modelAudit.second->deviceCount();
+      if (groups.size() != 1 + deviations.size() ||
+          groups[0].devices.size() != cameras - deviants.size()) {
+        mismatches++;
+      }
+      auditGroups += groups.size();
+    }
+    auditMismatches = mismatches + (auditDeviations != auditPlanted);
+    FleetSimReport("audit", audit);
+  }
+
+  uint64_t steadyStateAllocations = 0, steadyStateOperations = 0;
+  if (options.checkAllocations) {
+    // Lookup by id, get, format into a caller buffer and set on controls
+    // that have already been probed, on this thread only.  The first pass
+    // warms up anything lazily initialized; the second is counted.
+    char formatted[128];
+
+    steadyStateAllocations = fleetSimAllocations;
+    for (int pass = 0; pass < 2; pass++) {
+      fleetSimCountAllocations = (pass == 1);
+      for (auto& device : fleet) {
+        for (const auto& probed : device.controls) {
+          auto control = device.controller->controlWithId(probed->controlId());
+          if (control->readIntoCurrentValue()) {
+            control->formatCurrentValue(formatted, sizeof(formatted));
+            if (control->supportsSetValue()) {
+              control->writeFromCurrentValue();
+            }
+          }
+          steadyStateOperations += pass;
+        }
+      }
+    }
+    fleetSimCountAllocations = false;
+    steadyStateAllocations = fleetSimAllocations - steadyStateAllocations;
+  }
+
+  size_t controlCount = 0;
+  uint64_t transfers = 0, stalls = 0, timeouts = 0, disconnects = 0;
+  uint64_t reconnects = 0, restoredControls = 0, failedRestores = 0;
+  uint64_t wakeups = 0, wakeupsAvoided = 0;
+  UVCWatchdogStatistics watchdog;
+  uint64_t trips = 0, rejected = 0;
+  std::vector<const FleetDevice*> quarantined;
+  std::map<std::string, size_t> failureModes;
+  for (const auto& device : fleet) {
+    failureModes[device.failureMode]++;
+    UVCSimulatedStatistics statistics = device.transport->statistics();
+    controlCount += device.controls.size();
+    transfers += statistics.transfers;
+    stalls += statistics.stalls;
+    timeouts += statistics.timeouts;
+    disconnects += statistics.disconnects;
+    wakeups += statistics.wakeups;
+    UVCWatchdogStatistics deviceWatchdog = device.watchdog->statistics();
+    watchdog.hangs += deviceWatchdog.hangs;
+    for (size_t step = 0; step < kUVCRecoveryActionCount; step++) {
+      watchdog.recoveries[step] += deviceWatchdog.recoveries[step];
+    }
+    watchdog.failedRecoveries += deviceWatchdog.failedRecoveries;
+    UVCCircuitBreakerStatistics breaker = device.breaker->statistics();
+    trips += breaker.trips;
+    rejected += breaker.rejected;
+    if (breaker.trips) {
+      quarantined.push_back(&device);
+    }
+    if (device.controller) {
+      UVCReconnectStatistics recovery =
+          device.controller->reconnectStatistics();
+      reconnects += recovery.reconnects;
+      restoredControls += recovery.restoredControls;
+      failedRestores += recovery.failedRestores;
+      wakeupsAvoided += device.controller->powerStatistics().wakeupsAvoided;
+    }
+  }
+
+  printf("\n");
+  printf("Controls available:   %zu (%.1f per device)\n", controlCount,
+         static_cast<double>(controlCount) / fleet.size());
+  printf("Failure modes:       ");
+  for (const auto& mode : failureModes) {
+    printf(" %s=%zu", mode.first.c_str(), mode.second);
+  }
+  printf("\n");
+  printf("Transfers:            %llu (%llu stalled, %llu timed out, %llu "
+         "disconnects)\n",
+         static_cast<unsigned long long>(transfers),
+         static_cast<unsigned long long>(stalls),
+         static_cast<unsigned long long>(timeouts),
+         static_cast<unsigned long long>(disconnects));
+  printf("Reconnects:           %llu (%llu controls restored, %llu not)\n",
+         static_cast<unsigned long long>(reconnects),
+         static_cast<unsigned long long>(restoredControls),
+         static_cast<unsigned long long>(failedRestores));
+  printf("Autosuspend:          %llu wake-ups, %llu avoided\n",
+         static_cast<unsigned long long>(wakeups),
+         static_cast<unsigned long long>(wakeupsAvoided));
+  if (options.runIdle) {
+    printf("Idle power:           %llu low-power entries, %llu wake-ups (avg "
+           "%.1f ms, max %.1f ms), %zu cameras pinned\n",
+           static_cast<unsigned long long>(idlePower.lowPowerEntries),
+           static_cast<unsigned long long>(idlePower.wakeups),
+           idlePower.wakeups
+               ? idlePower.totalWakeMicros / 1000.0 / idlePower.wakeups
+               : 0.0,
+           idlePower.maxWakeMicros / 1000.0, pinnedCount);
+  }
+  if (options.runJournal) {
+    double journaledSeconds = journal.elapsedSeconds;
+    printf("Write journal:        %llu batches in %llu syncs (%.1f per sync, "
+           "avg %.2f ms, max %.2f ms), %.2f s vs %.2f s unjournaled\n",
+           static_cast<unsigned long long>(journaled.intents),
+           static_cast<unsigned long long>(journaled.syncs),
+           journaled.syncs
+               ? static_cast<double>(journaled.intents) / journaled.syncs
+               : 0.0,
+           journaled.syncs
+               ? journaled.totalSyncMicros / 1000.0 / journaled.syncs
+               : 0.0,
+           journaled.maxSyncMicros / 1000.0, journaledSeconds,
+           unjournaledSeconds);
+    printf("Crash re-drive:       %zu cameras, %llu writes re-sent, %llu "
+           "already held\n",
+           journalCameras, static_cast<unsigned long long>(redrivenWrites),
+           static_cast<unsigned long long>(elidedWrites));
+  }
+  if (options.runHistory) {
+    printf("History:              %llu samples in %.2f bytes each (%.2f raw), "
+           "%.0f ns CPU per sample\n",
+           static_cast<unsigned long long>(historySamples),
+           historySamples ? static_cast<double>(historyBytes) / historySamples
+                          : 0.0,
+           historySamples ? 8.0 + static_cast<double>(historyValueBytes) /
+                                      historySamples
+                          : 0.0,
+           historySamples ? historyCpuSeconds * 1e9 / historySamples : 0.0);
+  }
+  if (options.runAudit) {
+    printf("Fleet audit:          %zu cameras of %zu models, %zu deviations "
+           "(%zu planted) in %zu groups, %.2f ms CPU to compare\n",
+           auditCameras, auditModels, auditDeviations, auditPlanted,
+           auditGroups, auditCpuSeconds * 1000.0);
+  }
+  if (options.runReprobe) {
+    printf("Probe cache:          %llu stalls probing healthy cameras, %llu "
+           "once cached (%llu probes skipped)\n",
+           static_cast<unsigned long long>(reprobeStalls[0]),
+           static_cast<unsigned long long>(reprobeStalls[1]),
+           static_cast<unsigned long long>(reprobeSkipped));
+  }
+  printf("Watchdog:             %llu hangs, recovered by",
+         static_cast<unsigned long long>(watchdog.hangs));
+  for (size_t step = 0; step < kUVCRecoveryActionCount; step++) {
+    printf(" %s=%llu",
+           UVCRecoveryActionString(static_cast<UVCRecoveryAction>(step)),
+           static_cast<unsigned long long>(watchdog.recoveries[step]));
+  }
+  printf(" (%llu failed)\n",
+         static_cast<unsigned long long>(watchdog.failedRecoveries));
+  printf("Circuit breakers:     %llu trips, %llu transfers rejected, %zu "
+         "devices quarantined\n",
+         static_cast<unsigned long long>(trips),
+         static_cast<unsigned long long>(rejected), quarantined.size());
+  for (const FleetDevice* device : quarantined) {
+    UVCCircuitBreakerStatistics breaker = device->breaker->statistics();
+    printf("  %s (%s):  %s, %llu trips, %llu rejected\n",
+           device->transport->identity().serialNumber.c_str(),
+           device->failureMode, UVCCircuitStateString(breaker.state),
+           static_cast<unsigned long long>(breaker.trips),
+           static_cast<unsigned long long>(breaker.rejected));
+  }
+  printf("Resident memory:      %.1f KiB per device\n",
+         residentAfter > residentBefore
+             ? (residentAfter - residentBefore) / 1024.0 / fleet.size()
+             : 0.0);
+  if (heapAfter || heapBefore) {
+    printf("Heap in use:          %.1f KiB per device\n",
+           heapAfter > heapBefore
+               ? (heapAfter - heapBefore) / 1024.0 / fleet.size()
+               : 0.0);
+  }
+  printf("Process threads:      %zu\n", FleetSimThreadCount());
+
+  // Per-device state of one controller per camera model, probed in
+  // isolation:
+  static const struct {
+    UVCSimulatedPreset preset;
+    const char* name;
+  } footprintModels[] = {{UVCSimulatedPreset::Webcam, "webcam"},
+                         {UVCSimulatedPreset::PanTiltZoom, "ptz"},
+                         {UVCSimulatedPreset::Minimal, "minimal"}};
+  for (const auto& model : footprintModels) {
+    FleetSimFootprint footprint =
+        FleetSimMeasureController(model.preset, controlNames);
+    printf("Controller (%s):%*s%zu controls, %llu heap allocations, %.1f "
+           "KiB (arena %.1f KiB in %zu blocks)\n",
+           model.name, static_cast<int>(9 - strlen(model.name)), "",
+           footprint.controls,
+           static_cast<unsigned long long>(footprint.allocations),
+           footprint.bytes / 1024.0, footprint.arenaBytes / 1024.0,
+           footprint.arenaBlocks);
+  }
+  if (options.dispatchTransfers) {
+    UVCDeviceIdentity identity;
+
+    identity.deviceName = "Simulated dispatch camera";
+    identity.serialNumber = "SIMDISPATCH";
+    identity.vendorId = 0x1209;
+    auto simulated = UVCSimulatedTransport::createWithPreset(
+        UVCSimulatedPreset::PanTiltZoom, identity);
+    simulated->open();
+    FleetSimDispatchBench("simulated", simulated, options.dispatchTransfers);
+    FleetSimDispatchBench("null", std::make_shared<FleetSimNullTransport>(),
+                          options.dispatchTransfers);
+  }
+  if (options.codecIterations) {
+    printf("Codec timings are interpreted/specialized per call\n");
+    FleetSimCodecBench(options.codecIterations);
+  }
+  if (options.roundTripIterations &&
+      !FleetSimRoundTripBench(options.roundTripIterations)) {
+    fprintf(stderr, "ERROR: a value did not survive its round trip\n");
+    return EXIT_FAILURE;
+  }
+  if (options.lockIterations &&
+      !FleetSimLockCheck(options.lockIterations, options.threadCount)) {
+    fprintf(stderr,
+            "ERROR: device lock holders overlapped or timed out, or "
+            "sub-camera locks were not independent\n");
+    return EXIT_FAILURE;
+  }
+  if (needlessWakeups) {
+    fprintf(stderr,
+            "ERROR: %zu reads woke a suspended camera despite a cached value\n",
+            needlessWakeups);
+    return EXIT_FAILURE;
+  }
+  if (lowPowerStalls || idleMismatches) {
+    fprintf(stderr,
+            "ERROR: %llu requests reached a camera in low power, %zu passes "
+            "found a camera in the wrong power mode\n",
+            static_cast<unsigned long long>(lowPowerStalls), idleMismatches);
+    return EXIT_FAILURE;
+  }
+  if (journalMismatches) {
+    fprintf(stderr,
+            "ERROR: %zu journal checks failed, writes were lost or "
+            "re-driven wrongly after a crash\n",
+            journalMismatches);
+    return EXIT_FAILURE;
+  }
+  if (historyMismatches) {
+    fprintf(stderr,
+            "ERROR: %zu history checks failed, samples were lost or read "
+            "back wrongly\n",
+            historyMismatches);
+    return EXIT_FAILURE;
+  }
+  if (auditMismatches) {
+    fprintf(stderr,
+            "ERROR: %zu audit checks failed, deviations were missed or "
+            "reported wrongly\n",
+            auditMismatches);
+    return EXIT_FAILURE;
+  }
+  if (reprobeMismatches) {
+    fprintf(stderr,
+            "ERROR: %zu cameras stalled or lost controls with a probe cache\n",
+            reprobeMismatches);
+    return EXIT_FAILURE;
+  }
+  if (reconnectMismatches) {
+    fprintf(stderr,
+            "ERROR: %zu restored values did not read back after reconnect\n",
+            reconnectMismatches);
+    return EXIT_FAILURE;
+  }
+  if (options.checkAllocations) {
+    printf("Steady-state allocs:  %llu over %llu control operations\n",
+           static_cast<unsigned long long>(steadyStateAllocations),
+           static_cast<unsigned long long>(steadyStateOperations));
+    if (steadyStateAllocations) {
+      fprintf(stderr, "ERROR: steady-state control path allocated memory\n");
+      return EXIT_FAILURE;
+    }
+  }
+  return 0;
+}
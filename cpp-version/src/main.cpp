@@ -14,13 +14,23 @@
 //
 
 #include <getopt.h>
+#include <algorithm>
 #include <cerrno>
+#include <cstdarg>
 #include <cstring>
-#include <iostream>
+#include <ctime>
+#include <iterator>
 #include <string>
 #include <vector>
 
 #include "UVCController.hpp"
+#include "UVCDeviceDump.hpp"
+#include "UVCDiagnostics.hpp"
+#include "UVCFleetAudit.hpp"
+#include "UVCHistory.hpp"
+#include "UVCJsonWriter.hpp"
+#include "UVCQuirks.hpp"
+#include "UVCTraceTransport.hpp"
 
 #if (MAC_OS_X_VERSION_MAX_ALLOWED < MAC_OS_X_VERSION_10_9)
 #define UVC_UTIL_COMPAT_VERSION "pre-10.9"
@@ -82,6 +92,24 @@ const char* UVCUtilVersionString() {
   return versionString;
 }
 
+// Long options without a short form:
+enum {
+  kUVCUtilOptionRecordTrace = 0x100,
+  kUVCUtilOptionReplayTrace,
+  kUVCUtilOptionReplayKeyed,
+  kUVCUtilOptionReplayRealtime,
+  kUVCUtilOptionDumpDevice,
+  kUVCUtilOptionLoadDevice,
+  kUVCUtilOptionFormat,
+  kUVCUtilOptionLog,
+  kUVCUtilOptionQuirks,
+  kUVCUtilOptionReprobe,
+  kUVCUtilOptionJournal,
+  kUVCUtilOptionRecordHistory,
+  kUVCUtilOptionExportHistory,
+  kUVCUtilOptionAudit
+};
+
 static struct option uvcUtilOptions[] = {
     {"list-devices", no_argument, nullptr, 'd'},
     {"list-controls", no_argument, nullptr, 'c'},
@@ -99,10 +127,28 @@ static struct option uvcUtilOptions[] = {
     {"help", no_argument, nullptr, 'h'},
     {"version", no_argument, nullptr, 'v'},
     {"debug", no_argument, nullptr, 'D'},
+    {"record-trace", required_argument, nullptr, kUVCUtilOptionRecordTrace},
+    {"replay-trace", required_argument, nullptr, kUVCUtilOptionReplayTrace},
+    {"replay-keyed", no_argument, nullptr, kUVCUtilOptionReplayKeyed},
+    {"replay-realtime", no_argument, nullptr, kUVCUtilOptionReplayRealtime},
+    {"dump-device", required_argument, nullptr, kUVCUtilOptionDumpDevice},
+    {"load-device", required_argument, nullptr, kUVCUtilOptionLoadDevice},
+    {"format", required_argument, nullptr, kUVCUtilOptionFormat},
+    {"log", required_argument, nullptr, kUVCUtilOptionLog},
+    {"quirks", required_argument, nullptr, kUVCUtilOptionQuirks},
+    {"reprobe", no_argument, nullptr, kUVCUtilOptionReprobe},
+    {"journal", required_argument, nullptr, kUVCUtilOptionJournal},
+    {"record-history", required_argument, nullptr,
+     kUVCUtilOptionRecordHistory},
+    {"export-history", required_argument, nullptr,
+     kUVCUtilOptionExportHistory},
+    {"audit", no_argument, nullptr, kUVCUtilOptionAudit},
     {nullptr, 0, nullptr, 0}};
 
-void usage(const char* exe) {
-  printf(
+// Structured output keeps stdout for its records; usage goes to stderr then.
+void usage(const char* exe, FILE* stream = stdout) {
+  fprintf(
+      stream,
       "usage:\n"
       "\n"
       "    %s {options/actions/target selection}\n"
@@ -115,6 +161,60 @@ void usage(const char* exe) {
       "    -k/--keep-running                      Continue processing "
       "additional actions despite\n"
       "                                           encountering errors\n"
+      "    --format=(text|json|ndjson)            Write the results of the "
+      "actions that follow as\n"
+      "                                           text (the default), one JSON "
+      "array, or one JSON\n"
+      "                                           object per line as each "
+      "completes\n"
+      "    --log=<level>[:<category>,...]         Report library messages of "
+      "level (error, warning,\n"
+      "                                           info, debug) and above, from "
+      "the given categories\n"
+      "                                           (general, enumeration, "
+      "descriptor, transfer, parse)\n"
+      "                                           or all of them\n"
+      "\n"
+      "    --record-trace=<file>                  Record every control transfer "
+      "to a binary trace\n"
+      "    --replay-trace=<file>                  Use the devices and responses "
+      "recorded in a trace\n"
+      "                                           instead of the USB bus\n"
+      "    --replay-keyed                         Match replayed requests by "
+      "setup packet rather\n"
+      "                                           than by recorded order\n"
+      "    --replay-realtime                      Replay at the recorded speed "
+      "rather than as fast\n"
+      "                                           as possible\n"
+      "\n"
+      "    --load-device=<file>                   Add a simulated device "
+      "replicating a capability\n"
+      "                                           dump (may be repeated); the "
+      "USB bus is not used\n"
+      "\n"
+      "    --quirks=<file>                        Apply the per-model "
+      "workarounds in file on top\n"
+      "                                           of the built-in ones (also "
+      "$UVC_UTIL_QUIRKS)\n"
+      "    --reprobe                              Probe controls that failed "
+      "on this model before\n"
+      "                                           rather than skipping them "
+      "(the failures are kept\n"
+      "                                           in $UVC_UTIL_CACHE_DIR or "
+      "the user's cache directory)\n"
+      "    --journal=<file>                       Journal every write in file "
+      "before sending it, and\n"
+      "                                           first re-apply the writes "
+      "of an earlier run that\n"
+      "                                           were cut short\n"
+      "    --record-history=<file>                Append every value read "
+      "or written, with its time,\n"
+      "                                           to a compact history of "
+      "control values\n"
+      "\n"
+      "    Trace, load, quirks, reprobe, journal and history options must "
+      "precede the actions\n"
+      "    and target selection they apply to.\n"
       "\n"
       "  Actions:\n"
       "\n"
@@ -122,6 +222,12 @@ void usage(const char* exe) {
       "UVC-capable devices\n"
       "    -c/--list-controls                     Display a list of UVC "
       "controls implemented\n"
+      "    --export-history=<file>                Display every value "
+      "recorded in a history\n"
+      "    --audit                                Compare the settings of "
+      "all devices of each model\n"
+      "                                           and display those that "
+      "differ from the majority\n"
       "\n"
       "    Available after a target device is selected:\n"
       "\n"
@@ -147,6 +253,11 @@ void usage(const char* exe) {
       "    -r/--reset-all                         Reset all controls with a "
       "default value to that value\n"
       "\n"
+      "    --dump-device=<file>                   Write identity, descriptors "
+      "and every control's\n"
+      "                                           INFO/LEN/MIN/MAX/RES/DEF/CUR "
+      "to a capability dump\n"
+      "\n"
       "  Methods for selecting the target device:\n"
       "\n"
       "    -0/--select-none                       Drop the selected target "
@@ -164,6 +275,11 @@ void usage(const char* exe) {
       "integer-valued USB locationID attribute\n"
       "    --select-by-location-id=<location-id>\n"
       "\n"
+      "      Either may be followed by :<interface> to select one "
+      "VideoControl interface\n"
+      "      of a composite (multi-camera) device; by default the first is "
+      "selected\n"
+      "\n"
       "    -N <device-name>                       Provide the USB product "
       "name\n"
       "    --select-by-name=<device-name>\n"
@@ -171,6 +287,225 @@ void usage(const char* exe) {
       exe);
 }
 
+// Parse a --log argument, <level>[:<category>,...]:
+static bool UVCUtilParseLogOption(const char* option,
+                                  UVCDiagnosticLevel& level,
+                                  uint32_t& categories) {
+  static const char* const levelNames[] = {"error", "warning", "info",
+                                           "debug"};
+  static const char* const categoryNames[] = {
+      "general", "enumeration", "descriptor", "transfer", "parse"};
+  size_t levelLength = strcspn(option, ":");
+  size_t i;
+
+  for (i = 0; i < std::size(levelNames); i++) {
+    if (strlen(levelNames[i]) == levelLength &&
+        strncmp(option, levelNames[i], levelLength) == 0) {
+      break;
+    }
+  }
+  if (i == std::size(levelNames)) {
+    return false;
+  }
+  level = static_cast<UVCDiagnosticLevel>(i);
+  option += levelLength;
+  if (!*option) {
+    categories = kUVCDiagnosticAllCategories;
+    return true;
+  }
+
+  categories = 0;
+  do {
+    size_t nameLength;
+
+    option++;
+    nameLength = strcspn(option, ",");
+    for (i = 0; i < std::size(categoryNames); i++) {
+      if (strlen(categoryNames[i]) == nameLength &&
+          strncmp(option, categoryNames[i], nameLength) == 0) {
+        break;
+      }
+    }
+    if (i == std::size(categoryNames)) {
+      return false;
+    }
+    categories |=
+        UVCDiagnosticCategoryMask(static_cast<UVCDiagnosticCategory>(i));
+    option += nameLength;
+  } while (*option);
+  return true;
+}
+
+// How the results of actions are written (--format)
+enum class UVCUtilFormat { Text, Json, Ndjson };
+
+// Results of actions in the JSON formats:  one record (object) per result,
+// carrying the action and its status.  For JSON the records are elements of a
+// single array, for NDJSON each is written on its own line and flushed as
+// soon as it is complete.
+struct UVCUtilOutput {
+  UVCUtilFormat format = UVCUtilFormat::Text;
+  UVCJsonWriter writer{stdout};
+  bool hasBegunArray = false;
+
+  bool isStructured() const { return format != UVCUtilFormat::Text; }
+
+  void beginRecord(const char* action, const char* status = "ok") {
+    if (format == UVCUtilFormat::Json && !hasBegunArray) {
+      writer.beginArray();
+      hasBegunArray = true;
+    }
+    writer.beginObject();
+    writer.key("action");
+    writer.string(action);
+    writer.key("status");
+    writer.string(status);
+  }
+
+  void endRecord() {
+    writer.endObject();
+    if (format == UVCUtilFormat::Ndjson) {
+      writer.endRecord();
+    }
+  }
+
+  // Close the JSON array (an empty one if there were no results):
+  void finish() {
+    if (hasBegunArray || format == UVCUtilFormat::Json) {
+      if (!hasBegunArray) {
+        writer.beginArray();
+      }
+      writer.endArray();
+      writer.endRecord();
+      hasBegunArray = false;
+    }
+  }
+};
+
+// Report a failed action:  the message (a printf format starting "ERROR:")
+// goes to stderr as always and, in the JSON formats, also becomes an error
+// record with the exit code the failure sets.
+static void UVCUtilError(UVCUtilOutput& output,
+                         const char* action,
+                         const char* controlName,
+                         int code,
+                         const char* format,
+                         ...) {
+  char message[512];
+  va_list args;
+
+  va_start(args, format);
+  vsnprintf(message, sizeof(message), format, args);
+  va_end(args);
+  fputs(message, stderr);
+
+  if (output.isStructured()) {
+    const char* text = message;
+    size_t length;
+
+    if (strncmp(text, "ERROR:", 6) == 0) {
+      text += 6;
+    }
+    while (*text == ' ') {
+      text++;
+    }
+    length = strlen(text);
+    while (length && text[length - 1] == '\n') {
+      length--;
+    }
+    output.beginRecord(action, "error");
+    if (controlName) {
+      output.writer.key("control");
+      output.writer.string(controlName);
+    }
+    output.writer.key("code");
+    output.writer.integer(code);
+    output.writer.key("message");
+    output.writer.string(text, length);
+    output.endRecord();
+  }
+}
+
+// Write the member key with value, typed by its UVCType, or null if there is
+// no value:
+static void UVCUtilWriteValue(UVCJsonWriter& writer,
+                              const char* key,
+                              const std::shared_ptr<const UVCValue>& value) {
+  writer.key(key);
+  if (value && value->valueType()) {
+    writer.value(*value->valueType(), value->valuePtr());
+  } else {
+    writer.null();
+  }
+}
+
+// Identity members of a device record:
+static void UVCUtilWriteDevice(UVCJsonWriter& writer,
+                               const UVCDeviceController& device) {
+  uint16_t uvcVersion = device.uvcVersion();
+  char versionStr[8];
+
+  snprintf(versionStr, sizeof(versionStr), "%d.%02x",
+           (short)(uvcVersion >> 8), (uvcVersion & 0xFF));
+  writer.key("vendorId");
+  writer.unsignedInteger(device.vendorId());
+  writer.key("productId");
+  writer.unsignedInteger(device.productId());
+  writer.key("locationId");
+  writer.unsignedInteger(device.locationId());
+  writer.key("interfaceNumber");
+  writer.unsignedInteger(device.interfaceNumber());
+  writer.key("uvcVersion");
+  writer.string(versionStr);
+  writer.key("serialNumber");
+  writer.string(device.serialNumber().c_str());
+  writer.key("deviceName");
+  writer.string(device.deviceName().c_str());
+}
+
+// A show-control record:  type, capability bits and every value the device
+// provided, with the current value read afresh.
+static void UVCUtilWriteControl(UVCUtilOutput& output, UVCControl& control) {
+  UVCJsonWriter& writer = output.writer;
+  uvc_capabilities_t capabilities = control.capabilities();
+
+  output.beginRecord("show-control");
+  writer.key("control");
+  writer.string(control.controlName().c_str());
+  writer.key("type");
+  writer.string(UVCDeviceController::controlTypeWithId(control.controlId()));
+  writer.key("capabilities");
+  writer.unsignedInteger(capabilities);
+  writer.key("supportsGet");
+  writer.boolean(control.supportsGetValue());
+  writer.key("supportsSet");
+  writer.boolean(control.supportsSetValue());
+  if (control.hasRange()) {
+    UVCUtilWriteValue(writer, "minimum", control.minimum());
+    UVCUtilWriteValue(writer, "maximum", control.maximum());
+  }
+  if (control.hasStepSize()) {
+    UVCUtilWriteValue(writer, "stepSize", control.stepSize());
+  }
+  if (control.hasDefaultValue()) {
+    UVCUtilWriteValue(writer, "defaultValue", control.defaultValue());
+  }
+  UVCUtilWriteValue(writer, "currentValue", control.currentValue());
+  output.endRecord();
+}
+
+// Report the device an option selected:
+static void UVCUtilSelected(UVCUtilOutput& output,
+                            const UVCDeviceController& device) {
+  if (output.isStructured()) {
+    output.beginRecord("select");
+    UVCUtilWriteDevice(output.writer, device);
+    output.endRecord();
+  } else {
+    printf("Selected device: %s\n", device.description().c_str());
+  }
+}
+
 std::shared_ptr<UVCDeviceController> UVCUtilGetControllerWithName(
     const std::vector<std::shared_ptr<UVCDeviceController>>& uvcDevices,
     const std::string& name) {
@@ -186,13 +521,18 @@ std::shared_ptr<UVCDeviceController> UVCUtilGetControllerWithName(
   return nullptr;
 }
 
+// An interfaceNumber of -1 matches the first VideoControl interface of the
+// device:
 std::shared_ptr<UVCDeviceController> UVCUtilGetControllerWithVendorAndProductId(
     const std::vector<std::shared_ptr<UVCDeviceController>>& uvcDevices,
     uint16_t vendorId,
-    uint16_t productId) {
+    uint16_t productId,
+    int interfaceNumber = -1) {
   for (const auto& controller : uvcDevices) {
     if (controller->vendorId() == vendorId &&
-        controller->productId() == productId) {
+        controller->productId() == productId &&
+        (interfaceNumber < 0 ||
+         controller->interfaceNumber() == interfaceNumber)) {
       return controller;
     }
   }
@@ -201,15 +541,355 @@ std::shared_ptr<UVCDeviceController> UVCUtilGetControllerWithVendorAndProductId(
 
 std::shared_ptr<UVCDeviceController> UVCUtilGetControllerWithLocationId(
     const std::vector<std::shared_ptr<UVCDeviceController>>& uvcDevices,
-    uint32_t locationId) {
+    uint32_t locationId,
+    int interfaceNumber = -1) {
   for (const auto& controller : uvcDevices) {
-    if (controller->locationId() == locationId) {
+    if (controller->locationId() == locationId &&
+        (interfaceNumber < 0 ||
+         controller->interfaceNumber() == interfaceNumber)) {
       return controller;
     }
   }
   return nullptr;
 }
 
+// The VideoControl interface following a colon in selector, or -1 if there
+// is none; the colon is replaced by a NUL:
+static int UVCUtilParseInterfaceSuffix(char* selector) {
+  char* colonPos = strchr(selector, ':');
+  if (!colonPos) {
+    return -1;
+  }
+  *colonPos = '\0';
+  return static_cast<int>(strtoul(colonPos + 1, nullptr, 0) & 0xFF);
+}
+
+// Whether another device in the list shares the device's locationId, i.e.
+// it is one VideoControl interface of a composite device:
+static bool UVCUtilIsCompositeDevice(
+    const std::vector<std::shared_ptr<UVCDeviceController>>& uvcDevices,
+    const UVCDeviceController& device) {
+  return std::count_if(uvcDevices.begin(), uvcDevices.end(),
+                       [&device](const auto& controller) {
+                         return controller->locationId() ==
+                                device.locationId();
+                       }) > 1;
+}
+
+// Every sample of a history, series by series in time order:  one line each
+// (local time, device, control and value), or an export-history record.
+// Returns false if the file is not a history or a block of it is corrupt.
+static bool UVCUtilExportHistory(UVCUtilOutput& output, const char* path) {
+  std::shared_ptr<UVCHistoryReader> reader = UVCHistoryReader::open(path);
+  if (!reader) {
+    return false;
+  }
+
+  bool isIntact = true;
+  const std::vector<UVCHistorySeries>& allSeries = reader->series();
+  for (size_t series = 0; series < allSeries.size(); series++) {
+    const UVCHistorySeries& description = allSeries[series];
+    auto type = UVCType::createFromCString(description.typeSignature.c_str());
+    size_t valueSize = reader->valueSize(static_cast<uint16_t>(series));
+    std::vector<uint64_t> micros;
+    std::vector<uint8_t> values;
+
+    if (!reader->read(static_cast<uint16_t>(series), 0, UINT64_MAX, micros,
+                      values)) {
+      isIntact = false;
+    }
+    for (size_t i = 0; i < micros.size(); i++) {
+      uint8_t* value = values.data() + i * valueSize;
+
+      type->byteSwapUSBToHostEndian(value);
+      if (output.isStructured()) {
+        output.beginRecord("export-history");
+        output.writer.key("time");
+        output.writer.unsignedInteger(micros[i]);
+        output.writer.key("vendorId");
+        output.writer.unsignedInteger(description.vendorId);
+        output.writer.key("productId");
+        output.writer.unsignedInteger(description.productId);
+        output.writer.key("interfaceNumber");
+        output.writer.unsignedInteger(description.interfaceNumber);
+        output.writer.key("serialNumber");
+        output.writer.string(description.serialNumber.c_str());
+        output.writer.key("control");
+        output.writer.string(description.controlName.c_str());
+        output.writer.key("value");
+        output.writer.value(*type, value);
+        output.endRecord();
+        continue;
+      }
+
+      time_t seconds = static_cast<time_t>(micros[i] / 1000000);
+      struct tm localTime;
+      char timeStr[32], valueStr[256];
+
+      localtime_r(&seconds, &localTime);
+      strftime(timeStr, sizeof(timeStr), "%Y-%m-%d %H:%M:%S", &localTime);
+      type->formatBuffer(value, valueStr, sizeof(valueStr));
+      printf("%s.%06u %04x:%04x %s", timeStr,
+             static_cast<unsigned>(micros[i] % 1000000), description.vendorId,
+             description.productId, description.serialNumber.c_str());
+      if (description.interfaceNumber) {
+        printf(" (interface %u)", description.interfaceNumber);
+      }
+      printf(" %s = %s\n", description.controlName.c_str(), valueStr);
+    }
+  }
+  return isIntact;
+}
+
+// A device as named in audit results:  its serial number (or location) and,
+// beyond the first, its VideoControl interface:
+static std::string UVCUtilAuditLabel(const UVCDeviceController& device) {
+  char label[64];
+
+  if (device.serialNumber().empty() ||
+      device.serialNumber() == "Unknown UVC Device") {
+    snprintf(label, sizeof(label), "0x%08x", device.locationId());
+  } else {
+    snprintf(label, sizeof(label), "%s", device.serialNumber().c_str());
+  }
+  if (device.interfaceNumber()) {
+    snprintf(label + strlen(label), sizeof(label) - strlen(label),
+             " (interface %u)", device.interfaceNumber());
+  }
+  return label;
+}
+
+// A control's value (USB byte order), as text or as a JSON value:
+static void UVCUtilAuditValue(UVCUtilOutput& output,
+                              size_t controlId,
+                              const uint8_t* value,
+                              char* text,
+                              size_t textSize) {
+  auto type = UVCType::createFromCString(
+      uvcControlDefinitions[controlId].typeSignature);
+  std::vector<uint8_t> buffer(value, value + type->byteSize());
+
+  type->byteSwapUSBToHostEndian(buffer.data());
+  if (output.isStructured()) {
+    output.writer.value(*type, buffer.data());
+  } else {
+    type->formatBuffer(buffer.data(), text, textSize);
+  }
+}
+
+// Snapshot every device, model by model (vendor and product id), and report
+// the values that differ from the rest of the model and how many groups of
+// identical settings there are.  Returns the number of devices that could
+// not be read completely.
+static size_t UVCUtilAudit(
+    UVCUtilOutput& output,
+    const std::vector<std::shared_ptr<UVCDeviceController>>& uvcDevices) {
+  std::vector<std::vector<std::shared_ptr<UVCDeviceController>>> models;
+  size_t incomplete = 0;
+
+  for (const auto& device : uvcDevices) {
+    auto model = std::find_if(
+        models.begin(), models.end(), [&device](const auto& devices) {
+          return devices[0]->vendorId() == device->vendorId() &&
+                 devices[0]->productId() == device->productId();
+        });
+    if (model == models.end()) {
+      models.emplace_back();
+      model = models.end() - 1;
+    }
+    model->push_back(device);
+  }
+
+  for (const auto& devices : models) {
+    auto audit = UVCFleetAudit::create(devices.size());
+
+    // One batch of reads per device:
+    for (size_t i = 0; i < devices.size(); i++) {
+      devices[i]->setIsInterfaceOpen(true);
+      if (!audit->capture(i, *devices[i])) {
+        incomplete++;
+      }
+    }
+    audit->analyze();
+
+    if (output.isStructured()) {
+      output.beginRecord("audit");
+      output.writer.key("vendorId");
+      output.writer.unsignedInteger(devices[0]->vendorId());
+      output.writer.key("productId");
+      output.writer.unsignedInteger(devices[0]->productId());
+      output.writer.key("devices");
+      output.writer.unsignedInteger(devices.size());
+      output.writer.key("groups");
+      output.writer.beginArray();
+      for (const UVCAuditGroup& group : audit->groups()) {
+        output.writer.beginArray();
+        for (size_t d : group.devices) {
+          output.writer.string(
+              UVCUtilAuditLabel(*devices[d]).c_str());
+        }
+        output.writer.endArray();
+      }
+      output.writer.endArray();
+      output.writer.key("deviations");
+      output.writer.beginArray();
+    } else {
+      printf("%04x:%04x: %zu device%s in %zu group%s of identical settings\n",
+             devices[0]->vendorId(), devices[0]->productId(), devices.size(),
+             (devices.size() == 1) ? "" : "s", audit->groups().size(),
+             (audit->groups().size() == 1) ? "" : "s");
+    }
+
+    for (const UVCAuditControl& control : audit->controls()) {
+      const char* name = uvcControlDefinitions[control.controlId].name;
+      char majority[128];
+
+      for (size_t d : control.outliers) {
+        char value[128];
+        std::vector<uint8_t> data(control.majorityValue.size());
+
+        audit->value(d, control.controlId, data.data(), data.size());
+        if (output.isStructured()) {
+          output.writer.beginObject();
+          output.writer.key("control");
+          output.writer.string(name);
+          output.writer.key("device");
+          output.writer.string(
+              UVCUtilAuditLabel(*devices[d]).c_str());
+          output.writer.key("value");
+          UVCUtilAuditValue(output, control.controlId, data.data(), nullptr,
+                            0);
+          output.writer.key("majority");
+          UVCUtilAuditValue(output, control.controlId,
+                            control.majorityValue.data(), nullptr, 0);
+          output.writer.key("majorityCount");
+          output.writer.unsignedInteger(control.majorityCount);
+          output.writer.key("present");
+          output.writer.unsignedInteger(control.present);
+          output.writer.endObject();
+          continue;
+        }
+        UVCUtilAuditValue(output, control.controlId, data.data(), value,
+                          sizeof(value));
+        UVCUtilAuditValue(output, control.controlId,
+                          control.majorityValue.data(), majority,
+                          sizeof(majority));
+        printf("  %s = %s on %s (%zu of %zu devices hold %s)\n", name, value,
+               UVCUtilAuditLabel(*devices[d]).c_str(),
+               control.majorityCount, control.present, majority);
+      }
+    }
+    if (output.isStructured()) {
+      output.writer.endArray();
+      output.endRecord();
+    }
+  }
+  return incomplete;
+}
+
+// Where devices come from (USB bus, trace replay, capability dumps) and
+// whether they are recorded; in effect from the point the options appear on
+// the command line:
+struct UVCUtilSessionOptions {
+  std::shared_ptr<UVCTraceWriter> recorder;
+  std::vector<std::string> loadPaths;
+  std::string replayPath;
+  UVCReplayOrder replayOrder = UVCReplayOrder::Recorded;
+  UVCReplayTiming replayTiming = UVCReplayTiming::AsFastAsPossible;
+  std::vector<std::shared_ptr<UVCReplayTransport>> replayTransports;
+  bool reprobes = false;
+  std::shared_ptr<UVCWriteJournal> journal;
+  std::shared_ptr<UVCHistoryWriter> history;
+};
+
+// Record the devices' values in the history, and journal their writes, first
+// re-driving the batches an earlier run left unconfirmed:
+static void UVCUtilAttachJournal(
+    const UVCUtilSessionOptions& sessionOptions,
+    const std::vector<std::shared_ptr<UVCDeviceController>>& devices) {
+  for (const auto& device : devices) {
+    device->setHistory(sessionOptions.history);
+  }
+  if (!sessionOptions.journal) {
+    return;
+  }
+  for (const auto& device : devices) {
+    size_t redriven = 0, elided = 0;
+
+    device->setWriteJournal(sessionOptions.journal);
+    if (!device->redriveJournal(&redriven, &elided)) {
+      UVC_DIAGNOSTIC(Warning, General,
+                     "%s: interrupted writes could not all be re-applied",
+                     device->deviceName().c_str());
+    } else if (redriven || elided) {
+      UVC_DIAGNOSTIC(Info, General,
+                     "%s: %zu interrupted writes re-applied, %zu already "
+                     "held by the device",
+                     device->deviceName().c_str(), redriven, elided);
+    }
+  }
+}
+
+std::vector<std::shared_ptr<UVCDeviceController>> UVCUtilGetDevices(
+    UVCUtilSessionOptions& sessionOptions) {
+  std::vector<std::shared_ptr<UVCDeviceController>> devices;
+  std::vector<std::shared_ptr<UVCTransport>> transports;
+
+  if (!sessionOptions.replayPath.empty() || !sessionOptions.loadPaths.empty()) {
+    if (!sessionOptions.replayPath.empty()) {
+      sessionOptions.replayTransports = UVCReplayTransport::createFromTrace(
+          sessionOptions.replayPath, sessionOptions.replayOrder,
+          sessionOptions.replayTiming);
+      transports.assign(sessionOptions.replayTransports.begin(),
+                        sessionOptions.replayTransports.end());
+    }
+    for (const auto& path : sessionOptions.loadPaths) {
+      UVCDeviceDump dump;
+      if (UVCDeviceDump::readFromFile(path, dump)) {
+        transports.push_back(dump.createSimulatedTransport());
+      }
+    }
+  } else {
+    devices = UVCDeviceController::getUVCControllers();
+    for (const auto& device : devices) {
+      if (device->probeCache()) {
+        device->probeCache()->setReprobes(sessionOptions.reprobes);
+      }
+    }
+    if (sessionOptions.recorder) {
+      // Recording wraps each device's transport; the rebuilt controller
+      // keeps the lock and probe cache the system's one was given:
+      for (auto& device : devices) {
+        auto recorded = UVCDeviceController::createWithTransport(
+            UVCRecordingTransport::create(device->transport(),
+                                          sessionOptions.recorder));
+        if (recorded) {
+          recorded->setDeviceLock(device->deviceLock());
+          recorded->setProbeCache(device->probeCache());
+        }
+        device = recorded;
+      }
+      devices.erase(std::remove(devices.begin(), devices.end(), nullptr),
+                    devices.end());
+    }
+    UVCUtilAttachJournal(sessionOptions, devices);
+    return devices;
+  }
+
+  for (auto transport : transports) {
+    if (sessionOptions.recorder) {
+      transport = UVCRecordingTransport::create(transport,
+                                                sessionOptions.recorder);
+    }
+    auto device = UVCDeviceController::createWithTransport(transport);
+    if (device) {
+      devices.push_back(device);
+    }
+  }
+  UVCUtilAttachJournal(sessionOptions, devices);
+  return devices;
+}
+
 int main(int argc, char* argv[]) {
   const char* exe = argv[0];
   int rc = 0;
@@ -218,6 +898,8 @@ int main(int argc, char* argv[]) {
   int optCh;
   bool exitOnErrors = true;
   UVCTypeScanFlags uvcScanFlags = UVCTypeScanFlags::ShowWarnings;
+  UVCUtilSessionOptions sessionOptions;
+  UVCUtilOutput output;
 
   // No CLI arguments, we've got nothing to do:
   if (argc == 1) {
@@ -229,27 +911,248 @@ int main(int argc, char* argv[]) {
                               uvcUtilOptions, nullptr)) != -1) {
     switch (optCh) {
       case 'h':
-        usage(exe);
+        output.writer.flush();
+        usage(exe, output.isStructured() ? stderr : stdout);
         break;
 
       case 'v':
+        if (output.isStructured()) {
+          char buildTimestamp[32];
+
+          snprintf(buildTimestamp, sizeof(buildTimestamp), "%s %s", __TIME__,
+                   __DATE__);
+          output.beginRecord("version");
+          output.writer.key("version");
+          output.writer.string(UVCUtilVersionString());
+          output.writer.key("buildTimestamp");
+          output.writer.string(buildTimestamp);
+          output.endRecord();
+          break;
+        }
         printf("%s\n", UVCUtilVersionString());
         printf("Build timestamp %s %s\n", __TIME__, __DATE__);
         break;
 
+      case kUVCUtilOptionFormat:
+        if (strcmp(optarg, "text") == 0) {
+          output.finish();
+          output.format = UVCUtilFormat::Text;
+        } else if (strcmp(optarg, "json") == 0) {
+          output.format = UVCUtilFormat::Json;
+        } else if (strcmp(optarg, "ndjson") == 0) {
+          output.finish();
+          output.format = UVCUtilFormat::Ndjson;
+        } else {
+          UVCUtilError(output, "format", nullptr, EINVAL,
+                       "ERROR: Unknown output format '%s'\n", optarg);
+          rc = EINVAL;
+          if (exitOnErrors)
+            goto cleanupAndExit;
+        }
+        break;
+
       case 'k':
         exitOnErrors = false;
         break;
 
       case 'D':
         uvcScanFlags = uvcScanFlags | UVCTypeScanFlags::ShowInfo;
+        UVCSetDiagnosticFilter(UVCDiagnosticLevel::Debug,
+                               kUVCDiagnosticAllCategories);
+        break;
+
+      case kUVCUtilOptionLog: {
+        UVCDiagnosticLevel level;
+        uint32_t categories;
+
+        if (UVCUtilParseLogOption(optarg, level, categories)) {
+          UVCSetDiagnosticFilter(level, categories);
+        } else {
+          UVCUtilError(output, "log", nullptr, EINVAL,
+                       "ERROR: Invalid log specification '%s'\n", optarg);
+          rc = EINVAL;
+          if (exitOnErrors)
+            goto cleanupAndExit;
+        }
+        break;
+      }
+
+      case kUVCUtilOptionRecordTrace:
+        sessionOptions.recorder = UVCTraceWriter::create(optarg);
+        if (!sessionOptions.recorder) {
+          rc = EIO;
+          if (exitOnErrors)
+            goto cleanupAndExit;
+        }
+        // Devices enumerated before this point are not recorded:
+        uvcDevices.clear();
+        targetDevice = nullptr;
+        break;
+
+      case kUVCUtilOptionReplayTrace:
+        sessionOptions.replayPath = optarg;
+        uvcDevices.clear();
+        targetDevice = nullptr;
+        break;
+
+      case kUVCUtilOptionLoadDevice:
+        sessionOptions.loadPaths.push_back(optarg);
+        uvcDevices.clear();
+        targetDevice = nullptr;
+        break;
+
+      case kUVCUtilOptionDumpDevice: {
+        if (!targetDevice) {
+          if (uvcDevices.empty()) {
+            uvcDevices = UVCUtilGetDevices(sessionOptions);
+          }
+          if (!uvcDevices.empty()) {
+            targetDevice = uvcDevices[0];
+            targetDevice->setIsInterfaceOpen(true);
+          }
+        }
+
+        if (targetDevice) {
+          UVCDeviceDump dump;
+          if (UVCDeviceDump::captureFromTransport(*targetDevice->transport(),
+                                                  dump) &&
+              dump.writeToFile(optarg)) {
+            if (output.isStructured()) {
+              output.beginRecord("dump-device");
+              output.writer.key("path");
+              output.writer.string(optarg);
+              output.writer.key("controls");
+              output.writer.unsignedInteger(dump.controls.size());
+              UVCUtilWriteDevice(output.writer, *targetDevice);
+              output.endRecord();
+            } else {
+              printf("Dumped %zu controls of %s to %s\n",
+                     dump.controls.size(), targetDevice->deviceName().c_str(),
+                     optarg);
+            }
+          } else {
+            UVCUtilError(output, "dump-device", nullptr, EIO,
+                         "ERROR: Failed to dump device to %s\n", optarg);
+            rc = EIO;
+            if (exitOnErrors)
+              goto cleanupAndExit;
+          }
+        } else {
+          UVCUtilError(output, "dump-device", nullptr, ENODEV,
+                       "ERROR: No UVC device selected\n");
+          rc = ENODEV;
+          if (exitOnErrors)
+            goto cleanupAndExit;
+        }
+        break;
+      }
+
+      case kUVCUtilOptionQuirks:
+        if (!UVCLoadQuirksFile(optarg)) {
+          UVCUtilError(output, "quirks", nullptr, EINVAL,
+                       "ERROR: Invalid quirks file '%s'\n", optarg);
+          rc = EINVAL;
+          if (exitOnErrors)
+            goto cleanupAndExit;
+        }
+        // Devices enumerated before this point do not have them:
+        uvcDevices.clear();
+        targetDevice = nullptr;
+        break;
+
+      case kUVCUtilOptionReprobe:
+        sessionOptions.reprobes = true;
+        uvcDevices.clear();
+        targetDevice = nullptr;
+        break;
+
+      case kUVCUtilOptionJournal:
+        sessionOptions.journal = UVCWriteJournal::open(optarg);
+        if (!sessionOptions.journal) {
+          UVCUtilError(output, "journal", nullptr, EIO,
+                       "ERROR: Unable to open journal '%s'\n", optarg);
+          rc = EIO;
+          if (exitOnErrors)
+            goto cleanupAndExit;
+        }
+        uvcDevices.clear();
+        targetDevice = nullptr;
+        break;
+
+      case kUVCUtilOptionRecordHistory:
+        sessionOptions.history = UVCHistoryWriter::create(optarg);
+        if (!sessionOptions.history) {
+          UVCUtilError(output, "record-history", nullptr, EIO,
+                       "ERROR: Unable to open history '%s'\n", optarg);
+          rc = EIO;
+          if (exitOnErrors)
+            goto cleanupAndExit;
+        }
+        uvcDevices.clear();
+        targetDevice = nullptr;
+        break;
+
+      case kUVCUtilOptionExportHistory:
+        // Values recorded so far by this run are included:
+        if (sessionOptions.history) {
+          sessionOptions.history->flush();
+        }
+        if (!UVCUtilExportHistory(output, optarg)) {
+          UVCUtilError(output, "export-history", nullptr, EIO,
+                       "ERROR: Unable to read history '%s'\n", optarg);
+          rc = EIO;
+          if (exitOnErrors)
+            goto cleanupAndExit;
+        }
+        break;
+
+      case kUVCUtilOptionAudit: {
+        if (uvcDevices.empty()) {
+          uvcDevices = UVCUtilGetDevices(sessionOptions);
+        }
+        if (uvcDevices.empty()) {
+          UVCUtilError(output, "audit", nullptr, ENODEV,
+                       "ERROR: No UVC devices found\n");
+          rc = ENODEV;
+          if (exitOnErrors)
+            goto cleanupAndExit;
+          break;
+        }
+
+        size_t incomplete = UVCUtilAudit(output, uvcDevices);
+        if (incomplete) {
+          UVCUtilError(output, "audit", nullptr, EIO,
+                       "ERROR: %zu devices could not be read completely\n",
+                       incomplete);
+          rc = EIO;
+          if (exitOnErrors)
+            goto cleanupAndExit;
+        }
+        break;
+      }
+
+      case kUVCUtilOptionReplayKeyed:
+        sessionOptions.replayOrder = UVCReplayOrder::Keyed;
+        break;
+
+      case kUVCUtilOptionReplayRealtime:
+        sessionOptions.replayTiming = UVCReplayTiming::RecordedSpeed;
         break;
 
       case 'd':
         if (uvcDevices.empty()) {
-          uvcDevices = UVCDeviceController::getUVCControllers();
+          uvcDevices = UVCUtilGetDevices(sessionOptions);
         }
-        if (!uvcDevices.empty()) {
+        if (!uvcDevices.empty() && output.isStructured()) {
+          for (size_t deviceIndex = 0; deviceIndex < uvcDevices.size();
+               deviceIndex++) {
+            output.beginRecord("list-devices");
+            output.writer.key("index");
+            output.writer.unsignedInteger(deviceIndex);
+            UVCUtilWriteDevice(output.writer, *uvcDevices[deviceIndex]);
+            output.endRecord();
+          }
+        } else if (!uvcDevices.empty()) {
           printf(
               "------------ -------------- ------------ ------------ "
               "-------------------- "
@@ -269,18 +1172,24 @@ int main(int argc, char* argv[]) {
 
             snprintf(versionStr, sizeof(versionStr), "%d.%02x",
                      (short)(uvcVersion >> 8), (uvcVersion & 0xFF));
-            printf("%-12zu 0x%04x:0x%04x  0x%08x   %-12s %-20s %s\n",
+            printf("%-12zu 0x%04x:0x%04x  0x%08x   %-12s %-20s %s",
                    deviceIndex, device->vendorId(), device->productId(),
                    device->locationId(), versionStr,
                    device->serialNumber().c_str(),
                    device->deviceName().c_str());
+            // The sub-cameras of a composite device differ by interface:
+            if (UVCUtilIsCompositeDevice(uvcDevices, *device)) {
+              printf(" (interface %u)", device->interfaceNumber());
+            }
+            printf("\n");
           }
           printf(
               "------------ -------------- ------------ ------------ "
               "-------------------- "
               "------------------------------------------------\n");
         } else {
-          fprintf(stderr, "ERROR:  no UVC-capable devices available\n");
+          UVCUtilError(output, "list-devices", nullptr, ENODEV,
+                       "ERROR:  no UVC-capable devices available\n");
           rc = ENODEV;
           if (exitOnErrors)
             goto cleanupAndExit;
@@ -296,12 +1205,26 @@ int main(int argc, char* argv[]) {
 
           if (!controlNames.empty()) {
             bool hasAnyControls = false;
-            printf("UVC controls implemented by this device:\n");
+            if (!output.isStructured()) {
+              printf("UVC controls implemented by this device:\n");
+            }
             for (const auto& name : controlNames) {
               auto control = targetDevice->controlWithName(name);
               if (control) {  // Only show if controlWithName succeeds (like
                               // original line 364-366)
-                printf("  %s\n", name.c_str());
+                if (output.isStructured()) {
+                  output.beginRecord("list-controls");
+                  output.writer.key("control");
+                  output.writer.string(name.c_str());
+                  output.writer.key("type");
+                  output.writer.string(UVCDeviceController::controlTypeWithId(
+                      control->controlId()));
+                  output.writer.key("capabilities");
+                  output.writer.unsignedInteger(control->capabilities());
+                  output.endRecord();
+                } else {
+                  printf("  %s\n", name.c_str());
+                }
                 hasAnyControls = true;
               }
             }
@@ -316,7 +1239,17 @@ int main(int argc, char* argv[]) {
         } else {
           auto controlNames = UVCDeviceController::getAllControlStrings();
 
-          if (!controlNames.empty()) {
+          if (!controlNames.empty() && output.isStructured()) {
+            for (const auto& name : controlNames) {
+              output.beginRecord("list-controls");
+              output.writer.key("control");
+              output.writer.string(name.c_str());
+              output.writer.key("type");
+              output.writer.string(UVCDeviceController::controlTypeWithId(
+                  UVCDeviceController::controlIdWithName(name)));
+              output.endRecord();
+            }
+          } else if (!controlNames.empty()) {
             printf("UVC controls implemented by this program:\n");
             for (const auto& name : controlNames) {
               printf("  %s\n", name.c_str());
@@ -332,7 +1265,7 @@ int main(int argc, char* argv[]) {
       case 'S':
         if (!targetDevice) {
           if (uvcDevices.empty()) {
-            uvcDevices = UVCDeviceController::getUVCControllers();
+            uvcDevices = UVCUtilGetDevices(sessionOptions);
           }
           if (!uvcDevices.empty()) {
             targetDevice = uvcDevices[0];  // Use first device
@@ -346,24 +1279,30 @@ int main(int argc, char* argv[]) {
             auto controlNames = targetDevice->controlStrings();
             for (const auto& name : controlNames) {
               auto control = targetDevice->controlWithName(name);
-              if (control) {
+              if (control && output.isStructured()) {
+                UVCUtilWriteControl(output, *control);
+              } else if (control) {
                 printf("%s\n", control->summaryString().c_str());
               }
             }
           } else {
             // Show specific control
             auto control = targetDevice->controlWithName(optarg);
-            if (control) {
+            if (control && output.isStructured()) {
+              UVCUtilWriteControl(output, *control);
+            } else if (control) {
               printf("%s\n", control->summaryString().c_str());
             } else {
-              fprintf(stderr, "ERROR: Control '%s' not found\n", optarg);
+              UVCUtilError(output, "show-control", optarg, ENOENT,
+                           "ERROR: Control '%s' not found\n", optarg);
               rc = ENOENT;
               if (exitOnErrors)
                 goto cleanupAndExit;
             }
           }
         } else {
-          fprintf(stderr, "ERROR: No UVC device selected\n");
+          UVCUtilError(output, "show-control", nullptr, ENODEV,
+                       "ERROR: No UVC device selected\n");
           rc = ENODEV;
           if (exitOnErrors)
             goto cleanupAndExit;
@@ -374,7 +1313,7 @@ int main(int argc, char* argv[]) {
       case 'o':
         if (!targetDevice) {
           if (uvcDevices.empty()) {
-            uvcDevices = UVCDeviceController::getUVCControllers();
+            uvcDevices = UVCUtilGetDevices(sessionOptions);
           }
           if (!uvcDevices.empty()) {
             targetDevice = uvcDevices[0];
@@ -386,34 +1325,40 @@ int main(int argc, char* argv[]) {
           auto control = targetDevice->controlWithName(optarg);
           if (control) {
             if (control->readIntoCurrentValue()) {
-              auto currentValue = control->currentValue();
-              if (currentValue) {
-                if (optCh == 'o') {
-                  printf("%s\n", currentValue->stringValue().c_str());
-                } else {
-                  printf("%s = %s\n", optarg,
-                         currentValue->stringValue().c_str());
-                }
+              char currentValue[256];
+
+              if (output.isStructured()) {
+                output.beginRecord("get");
+                output.writer.key("control");
+                output.writer.string(optarg);
+                UVCUtilWriteValue(output.writer, "value",
+                                  control->lastValue());
+                output.endRecord();
+                break;
+              }
+              control->formatCurrentValue(currentValue, sizeof(currentValue));
+              if (optCh == 'o') {
+                printf("%s\n", currentValue);
               } else {
-                fprintf(stderr, "ERROR: Could not read control '%s'\n", optarg);
-                rc = EIO;
-                if (exitOnErrors)
-                  goto cleanupAndExit;
+                printf("%s = %s\n", optarg, currentValue);
               }
             } else {
-              fprintf(stderr, "ERROR: Failed to read control '%s'\n", optarg);
+              UVCUtilError(output, "get", optarg, EIO,
+                           "ERROR: Failed to read control '%s'\n", optarg);
               rc = EIO;
               if (exitOnErrors)
                 goto cleanupAndExit;
             }
           } else {
-            fprintf(stderr, "ERROR: Control '%s' not found\n", optarg);
+            UVCUtilError(output, "get", optarg, ENOENT,
+                         "ERROR: Control '%s' not found\n", optarg);
             rc = ENOENT;
             if (exitOnErrors)
               goto cleanupAndExit;
           }
         } else {
-          fprintf(stderr, "ERROR: No UVC device selected\n");
+          UVCUtilError(output, "get", nullptr, ENODEV,
+                       "ERROR: No UVC device selected\n");
           rc = ENODEV;
           if (exitOnErrors)
             goto cleanupAndExit;
@@ -423,7 +1368,7 @@ int main(int argc, char* argv[]) {
       case 's': {
         if (!targetDevice) {
           if (uvcDevices.empty()) {
-            uvcDevices = UVCDeviceController::getUVCControllers();
+            uvcDevices = UVCUtilGetDevices(sessionOptions);
           }
           if (!uvcDevices.empty()) {
             targetDevice = uvcDevices[0];
@@ -435,8 +1380,8 @@ int main(int argc, char* argv[]) {
           // Parse control=value format
           char* equalSign = strchr(optarg, '=');
           if (!equalSign) {
-            fprintf(
-                stderr,
+            UVCUtilError(
+                output, "set", nullptr, EINVAL,
                 "ERROR: Invalid format for --set, expected control=value\n");
             rc = EINVAL;
             if (exitOnErrors)
@@ -453,29 +1398,43 @@ int main(int argc, char* argv[]) {
             if (control->setCurrentValueFromCString(valueString,
                                                     uvcScanFlags)) {
               if (control->writeFromCurrentValue()) {
-                printf("Successfully set %s = %s\n", controlName, valueString);
+                if (output.isStructured()) {
+                  output.beginRecord("set");
+                  output.writer.key("control");
+                  output.writer.string(controlName);
+                  UVCUtilWriteValue(output.writer, "value",
+                                    control->lastValue());
+                  output.endRecord();
+                } else {
+                  printf("Successfully set %s = %s\n", controlName,
+                         valueString);
+                }
               } else {
-                fprintf(stderr, "ERROR: Failed to write control '%s'\n",
-                        controlName);
+                UVCUtilError(output, "set", controlName, EIO,
+                             "ERROR: Failed to write control '%s'\n",
+                             controlName);
                 rc = EIO;
                 if (exitOnErrors)
                   goto cleanupAndExit;
               }
             } else {
-              fprintf(stderr, "ERROR: Invalid value '%s' for control '%s'\n",
-                      valueString, controlName);
+              UVCUtilError(output, "set", controlName, EINVAL,
+                           "ERROR: Invalid value '%s' for control '%s'\n",
+                           valueString, controlName);
               rc = EINVAL;
               if (exitOnErrors)
                 goto cleanupAndExit;
             }
           } else {
-            fprintf(stderr, "ERROR: Control '%s' not found\n", controlName);
+            UVCUtilError(output, "set", controlName, ENOENT,
+                         "ERROR: Control '%s' not found\n", controlName);
             rc = ENOENT;
             if (exitOnErrors)
               goto cleanupAndExit;
           }
         } else {
-          fprintf(stderr, "ERROR: No UVC device selected\n");
+          UVCUtilError(output, "set", nullptr, ENODEV,
+                       "ERROR: No UVC device selected\n");
           rc = ENODEV;
           if (exitOnErrors)
             goto cleanupAndExit;
@@ -486,7 +1445,7 @@ int main(int argc, char* argv[]) {
       case 'r':
         if (!targetDevice) {
           if (uvcDevices.empty()) {
-            uvcDevices = UVCDeviceController::getUVCControllers();
+            uvcDevices = UVCUtilGetDevices(sessionOptions);
           }
           if (!uvcDevices.empty()) {
             targetDevice = uvcDevices[0];
@@ -501,14 +1460,31 @@ int main(int argc, char* argv[]) {
             auto control = targetDevice->controlWithName(name);
             if (control && control->hasDefaultValue()) {
               if (control->resetToDefaultValue()) {
-                printf("Reset %s to default\n", name.c_str());
+                if (output.isStructured()) {
+                  output.beginRecord("reset");
+                  output.writer.key("control");
+                  output.writer.string(name.c_str());
+                  UVCUtilWriteValue(output.writer, "value",
+                                    control->defaultValue());
+                  output.endRecord();
+                } else {
+                  printf("Reset %s to default\n", name.c_str());
+                }
                 resetCount++;
               }
             }
           }
-          printf("Reset %d controls to default values\n", resetCount);
+          if (output.isStructured()) {
+            output.beginRecord("reset-all");
+            output.writer.key("count");
+            output.writer.integer(resetCount);
+            output.endRecord();
+          } else {
+            printf("Reset %d controls to default values\n", resetCount);
+          }
         } else {
-          fprintf(stderr, "ERROR: No UVC device selected\n");
+          UVCUtilError(output, "reset", nullptr, ENODEV,
+                       "ERROR: No UVC device selected\n");
           rc = ENODEV;
           if (exitOnErrors)
             goto cleanupAndExit;
@@ -517,14 +1493,14 @@ int main(int argc, char* argv[]) {
 
       case 'V': {
         if (uvcDevices.empty()) {
-          uvcDevices = UVCDeviceController::getUVCControllers();
+          uvcDevices = UVCUtilGetDevices(sessionOptions);
         }
 
         // Parse vendor:product format
         char* colonPos = strchr(optarg, ':');
         if (!colonPos) {
-          fprintf(
-              stderr,
+          UVCUtilError(
+              output, "select", nullptr, EINVAL,
               "ERROR: Invalid format for --select-by-vendor-and-product-id, "
               "expected vendor:product\n");
           rc = EINVAL;
@@ -534,20 +1510,30 @@ int main(int argc, char* argv[]) {
         }
 
         *colonPos = '\0';
+        int interfaceNumber = UVCUtilParseInterfaceSuffix(colonPos + 1);
         uint32_t vendorId = strtoul(optarg, nullptr, 0);
         uint32_t productId = strtoul(colonPos + 1, nullptr, 0);
 
         targetDevice = UVCUtilGetControllerWithVendorAndProductId(
             uvcDevices, static_cast<uint16_t>(vendorId),
-            static_cast<uint16_t>(productId));
+            static_cast<uint16_t>(productId), interfaceNumber);
 
         if (targetDevice) {
           targetDevice->setIsInterfaceOpen(true);
-          printf("Selected device: %s\n", targetDevice->description().c_str());
+          UVCUtilSelected(output, *targetDevice);
+        } else if (interfaceNumber >= 0) {
+          UVCUtilError(output, "select", nullptr, ENODEV,
+                       "ERROR: No device found with vendor:product "
+                       "0x%04x:0x%04x and interface %d\n",
+                       vendorId, productId, interfaceNumber);
+          rc = ENODEV;
+          if (exitOnErrors)
+            goto cleanupAndExit;
         } else {
-          fprintf(stderr,
-                  "ERROR: No device found with vendor:product 0x%04x:0x%04x\n",
-                  vendorId, productId);
+          UVCUtilError(
+              output, "select", nullptr, ENODEV,
+              "ERROR: No device found with vendor:product 0x%04x:0x%04x\n",
+              vendorId, productId);
           rc = ENODEV;
           if (exitOnErrors)
             goto cleanupAndExit;
@@ -557,19 +1543,29 @@ int main(int argc, char* argv[]) {
 
       case 'L': {
         if (uvcDevices.empty()) {
-          uvcDevices = UVCDeviceController::getUVCControllers();
+          uvcDevices = UVCUtilGetDevices(sessionOptions);
         }
 
+        int interfaceNumber = UVCUtilParseInterfaceSuffix(optarg);
         uint32_t locationId = strtoul(optarg, nullptr, 0);
-        targetDevice =
-            UVCUtilGetControllerWithLocationId(uvcDevices, locationId);
+        targetDevice = UVCUtilGetControllerWithLocationId(
+            uvcDevices, locationId, interfaceNumber);
 
         if (targetDevice) {
           targetDevice->setIsInterfaceOpen(true);
-          printf("Selected device: %s\n", targetDevice->description().c_str());
+          UVCUtilSelected(output, *targetDevice);
+        } else if (interfaceNumber >= 0) {
+          UVCUtilError(output, "select", nullptr, ENODEV,
+                       "ERROR: No device found with location ID 0x%08x and "
+                       "interface %d\n",
+                       locationId, interfaceNumber);
+          rc = ENODEV;
+          if (exitOnErrors)
+            goto cleanupAndExit;
         } else {
-          fprintf(stderr, "ERROR: No device found with location ID 0x%08x\n",
-                  locationId);
+          UVCUtilError(output, "select", nullptr, ENODEV,
+                       "ERROR: No device found with location ID 0x%08x\n",
+                       locationId);
           rc = ENODEV;
           if (exitOnErrors)
             goto cleanupAndExit;
@@ -579,16 +1575,17 @@ int main(int argc, char* argv[]) {
 
       case 'N': {
         if (uvcDevices.empty()) {
-          uvcDevices = UVCDeviceController::getUVCControllers();
+          uvcDevices = UVCUtilGetDevices(sessionOptions);
         }
 
         targetDevice = UVCUtilGetControllerWithName(uvcDevices, optarg);
 
         if (targetDevice) {
           targetDevice->setIsInterfaceOpen(true);
-          printf("Selected device: %s\n", targetDevice->description().c_str());
+          UVCUtilSelected(output, *targetDevice);
         } else {
-          fprintf(stderr, "ERROR: No device found with name '%s'\n", optarg);
+          UVCUtilError(output, "select", nullptr, ENODEV,
+                       "ERROR: No device found with name '%s'\n", optarg);
           rc = ENODEV;
           if (exitOnErrors)
             goto cleanupAndExit;
@@ -598,17 +1595,18 @@ int main(int argc, char* argv[]) {
 
       case 'I': {
         if (uvcDevices.empty()) {
-          uvcDevices = UVCDeviceController::getUVCControllers();
+          uvcDevices = UVCUtilGetDevices(sessionOptions);
         }
 
         size_t deviceIndex = strtoul(optarg, nullptr, 0);
         if (deviceIndex < uvcDevices.size()) {
           targetDevice = uvcDevices[deviceIndex];
           targetDevice->setIsInterfaceOpen(true);
-          printf("Selected device: %s\n", targetDevice->description().c_str());
+          UVCUtilSelected(output, *targetDevice);
         } else {
-          fprintf(stderr, "ERROR: Device index %zu out of range (0-%zu)\n",
-                  deviceIndex, uvcDevices.size() - 1);
+          UVCUtilError(output, "select", nullptr, ERANGE,
+                       "ERROR: Device index %zu out of range (0-%zu)\n",
+                       deviceIndex, uvcDevices.size() - 1);
           rc = ERANGE;
           if (exitOnErrors)
             goto cleanupAndExit;
@@ -618,7 +1616,8 @@ int main(int argc, char* argv[]) {
 
       default:
         fprintf(stderr, "ERROR: Unrecognized option\n");
-        usage(exe);
+        output.writer.flush();
+        usage(exe, output.isStructured() ? stderr : stdout);
         rc = EINVAL;
         if (exitOnErrors)
           goto cleanupAndExit;
@@ -627,5 +1626,19 @@ int main(int argc, char* argv[]) {
   }
 
 cleanupAndExit:
+  for (const auto& transport : sessionOptions.replayTransports) {
+    if (transport->divergences() || transport->remainingTransfers()) {
+      fprintf(stderr,
+              "WARNING:  replay of %s diverged from the trace (%llu "
+              "mismatched requests, %zu recorded transfers not replayed)\n",
+              transport->identity().deviceName.c_str(),
+              static_cast<unsigned long long>(transport->divergences()),
+              transport->remainingTransfers());
+      if (rc == 0) {
+        rc = EIO;
+      }
+    }
+  }
+  output.finish();
   return rc;
 }
@@ -0,0 +1,773 @@
+//
+// uvcutil.cpp
+//
+// C interface to libuvcutil:  in-process control of UVC-compliant video
+// devices.
+//
+// Translated from Objective-C to C++
+// Copyright © 2016
+// Dr. Jeffrey Frey, IT-NSS
+// University of Delaware
+//
+// $Id$
+//
+
+#include "uvcutil.h"
+
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "UVCController.hpp"
+#include "UVCDiagnostics.hpp"
+#include "UVCDeviceDump.hpp"
+
+struct uvcutil_control {
+  uvcutil_device* device;
+  std::shared_ptr<UVCControl> control;
+};
+
+struct uvcutil_device {
+  std::shared_ptr<UVCDeviceController> controller;
+  std::string deviceName;
+  std::string serialNumber;
+
+  // Serializes all access to controller and its controls:
+  std::mutex lock;
+
+  // Indexed by control id; control is nullptr until found on the device:
+  std::vector<uvcutil_control> controls;
+
+  // Worker carrying out asynchronous operations, started on first use:
+  std::mutex queueLock;
+  std::condition_variable queueReady;
+  std::deque<std::function<void()>> queue;
+  std::thread worker;
+  bool isClosing = false;
+};
+
+//
+// Helpers; anything touching a controller expects the device's lock held.
+//
+
+static uvcutil_device* UVCUtilDeviceCreate(
+    std::shared_ptr<UVCDeviceController> controller) {
+  if (!controller) {
+    return nullptr;
+  }
+
+  uvcutil_device* device = new (std::nothrow) uvcutil_device;
+  if (!device) {
+    return nullptr;
+  }
+  try {
+    device->controller = controller;
+    device->deviceName = controller->deviceName();
+    device->serialNumber = controller->serialNumber();
+    device->controls.resize(UVCDeviceController::controlCount());
+    for (auto& control : device->controls) {
+      control.device = device;
+    }
+  } catch (...) {
+    delete device;
+    return nullptr;
+  }
+  return device;
+}
+
+static uvcutil_control* UVCUtilDeviceControl(uvcutil_device* device,
+                                             size_t controlId) {
+  if (controlId >= device->controls.size()) {
+    return nullptr;
+  }
+
+  uvcutil_control* handle = &device->controls[controlId];
+  if (!handle->control) {
+    // The controller caches the outcome, so this probes only once:
+    handle->control = device->controller->controlWithId(controlId);
+    if (!handle->control) {
+      return nullptr;
+    }
+  }
+  return handle;
+}
+
+static uvcutil_status_t UVCUtilControlGet(uvcutil_control* control,
+                                          void* buffer,
+                                          size_t size) {
+  if (!buffer) {
+    return UVCUTIL_ERROR_INVALID_ARGUMENT;
+  }
+  if (size < control->control->valueSize()) {
+    return UVCUTIL_ERROR_BUFFER_SIZE;
+  }
+  if (!control->control->supportsGetValue()) {
+    return UVCUTIL_ERROR_NOT_SUPPORTED;
+  }
+
+  try {
+    std::shared_ptr<UVCValue> value = control->control->currentValue();
+    if (!value) {
+      return UVCUTIL_ERROR_IO;
+    }
+    memcpy(buffer, value->valuePtr(), value->byteSize());
+  } catch (...) {
+    return UVCUTIL_ERROR_IO;
+  }
+  return UVCUTIL_OK;
+}
+
+static uvcutil_status_t UVCUtilControlSet(uvcutil_control* control,
+                                          const void* buffer,
+                                          size_t size) {
+  if (!buffer) {
+    return UVCUTIL_ERROR_INVALID_ARGUMENT;
+  }
+  if (size < control->control->valueSize()) {
+    return UVCUTIL_ERROR_BUFFER_SIZE;
+  }
+  if (!control->control->supportsSetValue()) {
+    return UVCUTIL_ERROR_NOT_SUPPORTED;
+  }
+
+  try {
+    if (!control->control->writeFromBuffer(buffer,
+                                           control->control->valueSize())) {
+      return UVCUTIL_ERROR_IO;
+    }
+  } catch (...) {
+    return UVCUTIL_ERROR_IO;
+  }
+  return UVCUTIL_OK;
+}
+
+static uvcutil_status_t UVCUtilDeviceBatch(
+    uvcutil_device* device,
+    uvcutil_batch_op_t* ops,
+    size_t count,
+    UVCLockMode lockMode,
+    uvcutil_status_t (*operation)(uvcutil_control*, void*, size_t)) {
+  if (!device || (count && !ops)) {
+    return UVCUTIL_ERROR_INVALID_ARGUMENT;
+  }
+
+  std::lock_guard<std::mutex> guard(device->lock);
+  uvcutil_status_t result = UVCUTIL_OK;
+
+  // Keep other processes from interleaving with the batch:
+  UVCDeviceLockGuard deviceGuard(device->controller->deviceLock().get(),
+                                 lockMode);
+  if (!deviceGuard) {
+    for (size_t i = 0; i < count; i++) {
+      ops[i].status = UVCUTIL_ERROR_BUSY;
+    }
+    return count ? UVCUTIL_ERROR_BUSY : UVCUTIL_OK;
+  }
+
+  for (size_t i = 0; i < count; i++) {
+    try {
+      uvcutil_control* control =
+          UVCUtilDeviceControl(device, ops[i].control_id);
+
+      ops[i].status = control ? operation(control, ops[i].buffer, ops[i].size)
+                              : UVCUTIL_ERROR_NOT_FOUND;
+    } catch (...) {
+      ops[i].status = UVCUTIL_ERROR_IO;
+    }
+    if (ops[i].status != UVCUTIL_OK && result == UVCUTIL_OK) {
+      result = ops[i].status;
+    }
+  }
+  return result;
+}
+
+static void UVCUtilDeviceWorker(uvcutil_device* device) {
+  std::unique_lock<std::mutex> queueGuard(device->queueLock);
+
+  while (true) {
+    device->queueReady.wait(queueGuard, [device]() {
+      return !device->queue.empty() || device->isClosing;
+    });
+    // Queued operations are completed even when closing:
+    if (device->queue.empty()) {
+      break;
+    }
+
+    std::function<void()> operation = std::move(device->queue.front());
+    device->queue.pop_front();
+    queueGuard.unlock();
+    operation();
+    queueGuard.lock();
+  }
+}
+
+static uvcutil_status_t UVCUtilDeviceEnqueue(
+    uvcutil_device* device,
+    std::function<void()>&& operation) {
+  std::lock_guard<std::mutex> queueGuard(device->queueLock);
+
+  if (device->isClosing) {
+    return UVCUTIL_ERROR_CLOSED;
+  }
+  try {
+    if (!device->worker.joinable()) {
+      device->worker = std::thread(UVCUtilDeviceWorker, device);
+    }
+    device->queue.push_back(std::move(operation));
+  } catch (...) {
+    return UVCUTIL_ERROR_IO;
+  }
+  device->queueReady.notify_one();
+  return UVCUTIL_OK;
+}
+
+//
+// Library
+//
+
+unsigned uvcutil_abi_version(void) {
+  return UVCUTIL_ABI_VERSION;
+}
+
+const char* uvcutil_status_string(uvcutil_status_t status) {
+  switch (status) {
+    case UVCUTIL_OK:
+      return "success";
+    case UVCUTIL_ERROR_INVALID_ARGUMENT:
+      return "invalid argument";
+    case UVCUTIL_ERROR_NOT_FOUND:
+      return "no such device or control";
+    case UVCUTIL_ERROR_NOT_SUPPORTED:
+      return "operation not supported by the control";
+    case UVCUTIL_ERROR_BUFFER_SIZE:
+      return "buffer too small for the control's value";
+    case UVCUTIL_ERROR_PARSE:
+      return "value could not be parsed";
+    case UVCUTIL_ERROR_IO:
+      return "control transfer failed";
+    case UVCUTIL_ERROR_CLOSED:
+      return "device is closing";
+    case UVCUTIL_ERROR_BUSY:
+      return "device held by another process";
+  }
+  return "unknown status";
+}
+
+struct UVCUtilDiagnosticHandler {
+  uvcutil_diagnostic_handler_t handler;
+  void* context;
+};
+
+static void UVCUtilForwardDiagnostic(UVCDiagnosticLevel level,
+                                     const char* message,
+                                     void* context) {
+  auto* target = static_cast<UVCUtilDiagnosticHandler*>(context);
+  uvcutil_diagnostic_level_t cLevel = UVCUTIL_DIAGNOSTIC_INFO;
+
+  switch (level) {
+    case UVCDiagnosticLevel::Error:
+      cLevel = UVCUTIL_DIAGNOSTIC_ERROR;
+      break;
+    case UVCDiagnosticLevel::Warning:
+      cLevel = UVCUTIL_DIAGNOSTIC_WARNING;
+      break;
+    case UVCDiagnosticLevel::Info:
+      break;
+    case UVCDiagnosticLevel::Debug:
+      cLevel = UVCUTIL_DIAGNOSTIC_DEBUG;
+      break;
+  }
+  target->handler(target->context, cLevel, message);
+}
+
+void uvcutil_set_diagnostic_handler(uvcutil_diagnostic_handler_t handler,
+                                    void* context) {
+  if (!handler) {
+    UVCSetDiagnosticHandler(nullptr, nullptr);
+    return;
+  }
+  // Like the sink itself, the forwarding target is never freed:
+  auto* target = new (std::nothrow) UVCUtilDiagnosticHandler{handler, context};
+  if (target) {
+    UVCSetDiagnosticHandler(UVCUtilForwardDiagnostic, target);
+  }
+}
+
+// The C category bits are the UVCDiagnosticCategoryMask bits:
+static_assert(UVCUTIL_DIAGNOSTIC_ENUMERATION ==
+                  UVCDiagnosticCategoryMask(UVCDiagnosticCategory::Enumeration),
+              "diagnostic category bits differ");
+static_assert(UVCUTIL_DIAGNOSTIC_PARSE ==
+                  UVCDiagnosticCategoryMask(UVCDiagnosticCategory::Parse),
+              "diagnostic category bits differ");
+static_assert(UVCUTIL_DIAGNOSTIC_ALL == kUVCDiagnosticAllCategories,
+              "diagnostic category bits differ");
+
+void uvcutil_set_diagnostic_filter(uvcutil_diagnostic_level_t max_level,
+                                   unsigned categories) {
+  UVCDiagnosticLevel level = UVCDiagnosticLevel::Debug;
+
+  switch (max_level) {
+    case UVCUTIL_DIAGNOSTIC_ERROR:
+      level = UVCDiagnosticLevel::Error;
+      break;
+    case UVCUTIL_DIAGNOSTIC_WARNING:
+      level = UVCDiagnosticLevel::Warning;
+      break;
+    case UVCUTIL_DIAGNOSTIC_INFO:
+      level = UVCDiagnosticLevel::Info;
+      break;
+    case UVCUTIL_DIAGNOSTIC_DEBUG:
+      break;
+  }
+  UVCSetDiagnosticFilter(level, categories);
+}
+
+void uvcutil_flush_diagnostics(void) {
+  UVCFlushDiagnostics();
+}
+
+size_t uvcutil_control_count(void) {
+  return UVCDeviceController::controlCount();
+}
+
+size_t uvcutil_control_id(const char* name) {
+  if (!name) {
+    return UVCUTIL_CONTROL_ID_INVALID;
+  }
+  size_t controlId = UVCDeviceController::controlIdWithName(name);
+  return (controlId == kUVCControlIdInvalid) ? UVCUTIL_CONTROL_ID_INVALID
+                                             : controlId;
+}
+
+const char* uvcutil_control_name(size_t control_id) {
+  return UVCDeviceController::controlNameWithId(control_id);
+}
+
+const char* uvcutil_control_type(size_t control_id) {
+  return UVCDeviceController::controlTypeWithId(control_id);
+}
+
+// Type of each control's value, parsed once for the encode/decode functions;
+// nullptr if the table could not be built (it is tried again next time):
+static const UVCType* UVCUtilControlValueType(size_t controlId) {
+  try {
+    static const std::vector<std::shared_ptr<UVCType>> valueTypes = [] {
+      std::vector<std::shared_ptr<UVCType>> types;
+
+      for (size_t id = 0; id < UVCDeviceController::controlCount(); id++) {
+        types.push_back(UVCType::createFromCString(
+            UVCDeviceController::controlTypeWithId(id)));
+      }
+      return types;
+    }();
+
+    return (controlId < valueTypes.size()) ? valueTypes[controlId].get()
+                                           : nullptr;
+  } catch (...) {
+    return nullptr;
+  }
+}
+
+// Largest value the encode/decode functions convert through the stack
+static const size_t kUVCUtilMaxValueSize = 64;
+
+size_t uvcutil_value_encode(size_t control_id,
+                            const void* value,
+                            size_t value_size,
+                            uint8_t* out,
+                            size_t out_size) {
+  const UVCType* type = UVCUtilControlValueType(control_id);
+
+  if (!type || !value || value_size < type->byteSize() ||
+      type->byteSize() > kUVCUtilMaxValueSize) {
+    return 0;
+  }
+
+  uint8_t hostValue[kUVCUtilMaxValueSize];
+  memcpy(hostValue, value, type->byteSize());
+  type->byteSwapUSBToHostEndian(hostValue);
+  return type->encodeBuffer(hostValue, out, out_size);
+}
+
+uvcutil_status_t uvcutil_value_decode(size_t control_id,
+                                      const uint8_t* data,
+                                      size_t length,
+                                      void* value,
+                                      size_t value_size) {
+  const UVCType* type = UVCUtilControlValueType(control_id);
+
+  if (!type) {
+    return UVCUTIL_ERROR_NOT_FOUND;
+  }
+  if (!data || !value) {
+    return UVCUTIL_ERROR_INVALID_ARGUMENT;
+  }
+  if (value_size < type->byteSize() ||
+      type->byteSize() > kUVCUtilMaxValueSize) {
+    return UVCUTIL_ERROR_BUFFER_SIZE;
+  }
+
+  uint8_t hostValue[kUVCUtilMaxValueSize];
+  memcpy(hostValue, value, type->byteSize());
+  type->byteSwapUSBToHostEndian(hostValue);
+  if (!type->decodeBuffer(data, length, hostValue)) {
+    return UVCUTIL_ERROR_PARSE;
+  }
+  type->byteSwapHostToUSBEndian(hostValue);
+  memcpy(value, hostValue, type->byteSize());
+  return UVCUTIL_OK;
+}
+
+//
+// Devices
+//
+
+uvcutil_status_t uvcutil_device_list(uvcutil_device_t*** devices,
+                                     size_t* count) {
+  if (!devices || !count) {
+    return UVCUTIL_ERROR_INVALID_ARGUMENT;
+  }
+  *devices = nullptr;
+  *count = 0;
+
+  std::vector<std::shared_ptr<UVCDeviceController>> controllers;
+  try {
+    controllers = UVCDeviceController::getUVCControllers();
+  } catch (...) {
+    return UVCUTIL_ERROR_IO;
+  }
+  if (controllers.empty()) {
+    return UVCUTIL_OK;
+  }
+
+  uvcutil_device_t** list = static_cast<uvcutil_device_t**>(
+      calloc(controllers.size(), sizeof(uvcutil_device_t*)));
+  if (!list) {
+    return UVCUTIL_ERROR_IO;
+  }
+  for (const auto& controller : controllers) {
+    uvcutil_device_t* device = UVCUtilDeviceCreate(controller);
+    if (device) {
+      list[(*count)++] = device;
+    }
+  }
+  *devices = list;
+  return UVCUTIL_OK;
+}
+
+void uvcutil_device_list_free(uvcutil_device_t** devices, size_t count) {
+  if (!devices) {
+    return;
+  }
+  for (size_t i = 0; i < count; i++) {
+    uvcutil_device_close(devices[i]);
+  }
+  free(devices);
+}
+
+uvcutil_device_t* uvcutil_device_open_location_id(uint32_t location_id) {
+  try {
+    return UVCUtilDeviceCreate(
+        UVCDeviceController::createWithLocationId(location_id));
+  } catch (...) {
+    return nullptr;
+  }
+}
+
+uvcutil_device_t* uvcutil_device_open_vendor_product(uint16_t vendor_id,
+                                                     uint16_t product_id) {
+  try {
+    return UVCUtilDeviceCreate(
+        UVCDeviceController::createWithVendorIdProductId(vendor_id,
+                                                         product_id));
+  } catch (...) {
+    return nullptr;
+  }
+}
+
+uvcutil_device_t* uvcutil_device_open_dump(const char* path) {
+  if (!path) {
+    return nullptr;
+  }
+  try {
+    UVCDeviceDump dump;
+    if (!UVCDeviceDump::readFromFile(path, dump)) {
+      return nullptr;
+    }
+    return UVCUtilDeviceCreate(UVCDeviceController::createWithTransport(
+        dump.createSimulatedTransport()));
+  } catch (...) {
+    return nullptr;
+  }
+}
+
+void uvcutil_device_close(uvcutil_device_t* device) {
+  if (!device) {
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> queueGuard(device->queueLock);
+    device->isClosing = true;
+  }
+  device->queueReady.notify_one();
+  if (device->worker.joinable()) {
+    device->worker.join();
+  }
+
+  device->controller->setIsInterfaceOpen(false);
+  delete device;
+}
+
+const char* uvcutil_device_name(const uvcutil_device_t* device) {
+  return device ? device->deviceName.c_str() : nullptr;
+}
+
+const char* uvcutil_device_serial_number(const uvcutil_device_t* device) {
+  return device ? device->serialNumber.c_str() : nullptr;
+}
+
+uint32_t uvcutil_device_location_id(const uvcutil_device_t* device) {
+  return device ? device->controller->locationId() : 0;
+}
+
+uint16_t uvcutil_device_vendor_id(const uvcutil_device_t* device) {
+  return device ? device->controller->vendorId() : 0;
+}
+
+uint16_t uvcutil_device_product_id(const uvcutil_device_t* device) {
+  return device ? device->controller->productId() : 0;
+}
+
+uint16_t uvcutil_device_uvc_version(const uvcutil_device_t* device) {
+  return device ? device->controller->uvcVersion() : 0;
+}
+
+uint8_t uvcutil_device_interface_number(const uvcutil_device_t* device) {
+  return device ? device->controller->interfaceNumber() : 0;
+}
+
+uvcutil_control_t* uvcutil_device_control(uvcutil_device_t* device,
+                                          size_t control_id) {
+  if (!device) {
+    return nullptr;
+  }
+
+  std::lock_guard<std::mutex> guard(device->lock);
+  try {
+    return UVCUtilDeviceControl(device, control_id);
+  } catch (...) {
+    return nullptr;
+  }
+}
+
+//
+// Control access
+//
+
+size_t uvcutil_control_get_id(const uvcutil_control_t* control) {
+  return control ? control->control->controlId() : UVCUTIL_CONTROL_ID_INVALID;
+}
+
+uint32_t uvcutil_control_capabilities(const uvcutil_control_t* control) {
+  return control ? control->control->capabilities() : 0;
+}
+
+size_t uvcutil_control_size(const uvcutil_control_t* control) {
+  return control ? control->control->valueSize() : 0;
+}
+
+uvcutil_status_t uvcutil_control_get(uvcutil_control_t* control,
+                                     void* buffer,
+                                     size_t size) {
+  if (!control) {
+    return UVCUTIL_ERROR_INVALID_ARGUMENT;
+  }
+
+  std::lock_guard<std::mutex> guard(control->device->lock);
+  return UVCUtilControlGet(control, buffer, size);
+}
+
+uvcutil_status_t uvcutil_control_set(uvcutil_control_t* control,
+                                     const void* buffer,
+                                     size_t size) {
+  if (!control) {
+    return UVCUTIL_ERROR_INVALID_ARGUMENT;
+  }
+
+  std::lock_guard<std::mutex> guard(control->device->lock);
+  return UVCUtilControlSet(control, buffer, size);
+}
+
+uvcutil_status_t uvcutil_control_get_attribute(uvcutil_control_t* control,
+                                               uvcutil_attribute_t attribute,
+                                               void* buffer,
+                                               size_t size) {
+  if (!control || !buffer) {
+    return UVCUTIL_ERROR_INVALID_ARGUMENT;
+  }
+
+  std::lock_guard<std::mutex> guard(control->device->lock);
+  std::shared_ptr<UVCValue> value;
+
+  try {
+    switch (attribute) {
+      case UVCUTIL_ATTRIBUTE_MINIMUM:
+        value = control->control->minimum();
+        break;
+      case UVCUTIL_ATTRIBUTE_MAXIMUM:
+        value = control->control->maximum();
+        break;
+      case UVCUTIL_ATTRIBUTE_STEP_SIZE:
+        value = control->control->stepSize();
+        break;
+      case UVCUTIL_ATTRIBUTE_DEFAULT:
+        value = control->control->defaultValue();
+        break;
+      default:
+        return UVCUTIL_ERROR_INVALID_ARGUMENT;
+    }
+  } catch (...) {
+    return UVCUTIL_ERROR_IO;
+  }
+  if (!value) {
+    return UVCUTIL_ERROR_NOT_SUPPORTED;
+  }
+  if (size < value->byteSize()) {
+    return UVCUTIL_ERROR_BUFFER_SIZE;
+  }
+  memcpy(buffer, value->valuePtr(), value->byteSize());
+  return UVCUTIL_OK;
+}
+
+uvcutil_status_t uvcutil_control_set_string(uvcutil_control_t* control,
+                                            const char* text) {
+  if (!control || !text) {
+    return UVCUTIL_ERROR_INVALID_ARGUMENT;
+  }
+
+  std::lock_guard<std::mutex> guard(control->device->lock);
+  if (!control->control->supportsSetValue()) {
+    return UVCUTIL_ERROR_NOT_SUPPORTED;
+  }
+  try {
+    if (!control->control->setCurrentValueFromCString(text,
+                                                      UVCTypeScanFlags())) {
+      return UVCUTIL_ERROR_PARSE;
+    }
+    if (!control->control->writeFromCurrentValue()) {
+      return UVCUTIL_ERROR_IO;
+    }
+  } catch (...) {
+    return UVCUTIL_ERROR_IO;
+  }
+  return UVCUTIL_OK;
+}
+
+size_t uvcutil_control_format(uvcutil_control_t* control,
+                              char* text,
+                              size_t size) {
+  if (!control) {
+    if (text && size) {
+      *text = '\0';
+    }
+    return 0;
+  }
+
+  std::lock_guard<std::mutex> guard(control->device->lock);
+  try {
+    return control->control->formatCurrentValue(text, size);
+  } catch (...) {
+    if (text && size) {
+      *text = '\0';
+    }
+    return 0;
+  }
+}
+
+//
+// Batches
+//
+
+uvcutil_status_t uvcutil_device_get_batch(uvcutil_device_t* device,
+                                          uvcutil_batch_op_t* ops,
+                                          size_t count) {
+  return UVCUtilDeviceBatch(device, ops, count, UVCLockMode::Shared,
+                            UVCUtilControlGet);
+}
+
+uvcutil_status_t uvcutil_device_set_batch(uvcutil_device_t* device,
+                                          uvcutil_batch_op_t* ops,
+                                          size_t count) {
+  return UVCUtilDeviceBatch(
+      device, ops, count, UVCLockMode::Exclusive,
+      [](uvcutil_control* control, void* buffer, size_t size) {
+        return UVCUtilControlSet(control, buffer, size);
+      });
+}
+
+//
+// Asynchronous operations
+//
+
+uvcutil_status_t uvcutil_control_get_async(uvcutil_control_t* control,
+                                           uvcutil_completion_t completion,
+                                           void* context) {
+  if (!control || !completion) {
+    return UVCUTIL_ERROR_INVALID_ARGUMENT;
+  }
+
+  try {
+    return UVCUtilDeviceEnqueue(control->device, [=]() {
+      std::vector<uint8_t> buffer;
+      uvcutil_status_t status;
+      try {
+        buffer.resize(control->control->valueSize());
+        std::lock_guard<std::mutex> guard(control->device->lock);
+        status = UVCUtilControlGet(control, buffer.data(), buffer.size());
+      } catch (...) {
+        status = UVCUTIL_ERROR_IO;
+      }
+      completion(context, status, control->control->controlId(),
+                 buffer.data(), buffer.size());
+    });
+  } catch (...) {
+    return UVCUTIL_ERROR_IO;
+  }
+}
+
+uvcutil_status_t uvcutil_control_set_async(uvcutil_control_t* control,
+                                           const void* buffer,
+                                           size_t size,
+                                           uvcutil_completion_t completion,
+                                           void* context) {
+  if (!control || !buffer || !completion) {
+    return UVCUTIL_ERROR_INVALID_ARGUMENT;
+  }
+
+  try {
+    std::vector<uint8_t> value(static_cast<const uint8_t*>(buffer),
+                               static_cast<const uint8_t*>(buffer) + size);
+    return UVCUtilDeviceEnqueue(control->device, [=]() {
+      uvcutil_status_t status;
+      try {
+        std::lock_guard<std::mutex> guard(control->device->lock);
+        status = UVCUtilControlSet(control, value.data(), value.size());
+      } catch (...) {
+        status = UVCUTIL_ERROR_IO;
+      }
+      completion(context, status, control->control->controlId(),
+                 value.data(), value.size());
+    });
+  } catch (...) {
+    return UVCUTIL_ERROR_IO;
+  }
+}
@@ -0,0 +1,373 @@
+/*
+ * uvcutil.h
+ *
+ * C interface to libuvcutil:  in-process control of UVC-compliant video
+ * devices.
+ *
+ * Translated from Objective-C to C++
+ * Copyright © 2016
+ * Dr. Jeffrey Frey, IT-NSS
+ * University of Delaware
+ *
+ * $Id$
+ */
+
+#ifndef UVCUTIL_H
+#define UVCUTIL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if defined(__GNUC__)
+#define UVCUTIL_API __attribute__((visibility("default")))
+#else
+#define UVCUTIL_API
+#endif
+
+/*
+ * Version of this interface.  Functions are only ever added; an existing
+ * function, type or constant never changes meaning within a major version.
+ */
+#define UVCUTIL_ABI_VERSION 1
+
+/*!
+  @typedef uvcutil_device_t
+
+  Opaque handle to an open device.  All calls on one device are serialized
+  internally, so a handle may be shared between threads.
+*/
+typedef struct uvcutil_device uvcutil_device_t;
+
+/*!
+  @typedef uvcutil_control_t
+
+  Opaque handle to one control of a device.  Owned by the device and valid
+  until the device is closed; never freed by the caller.
+*/
+typedef struct uvcutil_control uvcutil_control_t;
+
+/*!
+  @typedef uvcutil_status_t
+
+  Result of an operation.  Failures are negative.
+*/
+typedef enum {
+  UVCUTIL_OK = 0,
+  UVCUTIL_ERROR_INVALID_ARGUMENT = -1,
+  UVCUTIL_ERROR_NOT_FOUND = -2,
+  UVCUTIL_ERROR_NOT_SUPPORTED = -3,
+  UVCUTIL_ERROR_BUFFER_SIZE = -4,
+  UVCUTIL_ERROR_PARSE = -5,
+  UVCUTIL_ERROR_IO = -6,
+  UVCUTIL_ERROR_CLOSED = -7,
+  UVCUTIL_ERROR_BUSY = -8
+} uvcutil_status_t;
+
+/*!
+  @typedef uvcutil_attribute_t
+
+  Device-provided attributes of a control.
+*/
+typedef enum {
+  UVCUTIL_ATTRIBUTE_MINIMUM = 0,
+  UVCUTIL_ATTRIBUTE_MAXIMUM = 1,
+  UVCUTIL_ATTRIBUTE_STEP_SIZE = 2,
+  UVCUTIL_ATTRIBUTE_DEFAULT = 3
+} uvcutil_attribute_t;
+
+/* Capability bits returned by uvcutil_control_capabilities: */
+#define UVCUTIL_CAPABILITY_GET (1u << 0)
+#define UVCUTIL_CAPABILITY_SET (1u << 1)
+#define UVCUTIL_CAPABILITY_DISABLED_BY_AUTO (1u << 2)
+#define UVCUTIL_CAPABILITY_AUTO_UPDATE (1u << 3)
+#define UVCUTIL_CAPABILITY_ASYNCHRONOUS (1u << 4)
+#define UVCUTIL_CAPABILITY_RANGE (1u << 8)
+#define UVCUTIL_CAPABILITY_STEP_SIZE (1u << 9)
+#define UVCUTIL_CAPABILITY_DEFAULT (1u << 10)
+
+/* Returned by uvcutil_control_id for names that are not implemented: */
+#define UVCUTIL_CONTROL_ID_INVALID ((size_t)-1)
+
+/*!
+  @typedef uvcutil_batch_op_t
+
+  One entry of a batch get or set.  buffer holds size bytes; status is
+  filled in when the batch runs.
+*/
+typedef struct {
+  size_t control_id;
+  void* buffer;
+  size_t size;
+  uvcutil_status_t status;
+} uvcutil_batch_op_t;
+
+/*!
+  @typedef uvcutil_completion_t
+
+  Called once an asynchronous operation has finished, on the device's worker
+  thread.  buffer holds the size bytes read (for a get) or written (for a
+  set) and is valid only for the duration of the call.  Completions of one
+  device are delivered in the order the operations were submitted.
+*/
+typedef void (*uvcutil_completion_t)(void* context,
+                                     uvcutil_status_t status,
+                                     size_t control_id,
+                                     const void* buffer,
+                                     size_t size);
+
+/*!
+  @typedef uvcutil_diagnostic_level_t
+
+  Severity of a message passed to a uvcutil_diagnostic_handler_t.
+*/
+typedef enum {
+  UVCUTIL_DIAGNOSTIC_ERROR = 0,
+  UVCUTIL_DIAGNOSTIC_WARNING = 1,
+  UVCUTIL_DIAGNOSTIC_INFO = 2,
+  UVCUTIL_DIAGNOSTIC_DEBUG = 3
+} uvcutil_diagnostic_level_t;
+
+/*!
+  @enum uvcutil_diagnostic_category_t
+
+  Bits selecting where the messages passed by uvcutil_set_diagnostic_filter
+  come from.
+*/
+typedef enum {
+  UVCUTIL_DIAGNOSTIC_GENERAL = 1 << 0,
+  UVCUTIL_DIAGNOSTIC_ENUMERATION = 1 << 1,
+  UVCUTIL_DIAGNOSTIC_DESCRIPTOR = 1 << 2,
+  UVCUTIL_DIAGNOSTIC_TRANSFER = 1 << 3,
+  UVCUTIL_DIAGNOSTIC_PARSE = 1 << 4,
+  UVCUTIL_DIAGNOSTIC_ALL = 0x1f
+} uvcutil_diagnostic_category_t;
+
+/*!
+  @typedef uvcutil_diagnostic_handler_t
+
+  Receives the library's diagnostic messages (without a trailing newline).
+  May be called from any thread that calls into the library, including
+  device worker threads.
+*/
+typedef void (*uvcutil_diagnostic_handler_t)(void* context,
+                                             uvcutil_diagnostic_level_t level,
+                                             const char* message);
+
+/*
+ * Library
+ */
+
+/* Returns UVCUTIL_ABI_VERSION of the library actually loaded. */
+UVCUTIL_API unsigned uvcutil_abi_version(void);
+
+/* Returns a static, human-readable description of status. */
+UVCUTIL_API const char* uvcutil_status_string(uvcutil_status_t status);
+
+/*!
+  @function uvcutil_set_diagnostic_handler
+
+  Route the library's error, warning and informational messages to handler
+  instead of stderr.  Passing NULL restores the default, which writes errors
+  and warnings to stderr and discards informational messages.
+*/
+UVCUTIL_API void uvcutil_set_diagnostic_handler(
+    uvcutil_diagnostic_handler_t handler,
+    void* context);
+
+/*!
+  @function uvcutil_set_diagnostic_filter
+
+  Pass on only messages of max_level and more severe from the categories set
+  in the UVCUTIL_DIAGNOSTIC_* bits of categories; others are not formatted.
+  Until this is called, errors and warnings are passed to the default
+  handler and informational messages as well to a handler of your own.
+  Debug messages are only available if the library was built with them.
+*/
+UVCUTIL_API void uvcutil_set_diagnostic_filter(
+    uvcutil_diagnostic_level_t max_level,
+    unsigned categories);
+
+/* Write any messages the default handler holds back to stderr. */
+UVCUTIL_API void uvcutil_flush_diagnostics(void);
+
+/*
+ * Controls known to the library, independent of any device.  Ids run from 0
+ * to uvcutil_control_count() - 1 and are stable for the life of the process.
+ */
+UVCUTIL_API size_t uvcutil_control_count(void);
+UVCUTIL_API size_t uvcutil_control_id(const char* name);
+UVCUTIL_API const char* uvcutil_control_name(size_t control_id);
+
+/*
+ * Type signature of the control's data, e.g. "{S4 pan; S4 tilt}".  Values
+ * exchanged with the library are packed accordingly, in USB (little-endian)
+ * byte order.
+ */
+UVCUTIL_API const char* uvcutil_control_type(size_t control_id);
+
+/*
+ * Binary (CBOR) form of a control value, for passing values between
+ * processes without formatting and parsing text:  a map from field index to
+ * the field's integer value, e.g. {0: 3600, 1: -360000} for pan-tilt-abs.
+ * value is packed as for uvcutil_control_get/set and holds value_size bytes.
+ *
+ * uvcutil_value_encode returns the length of the full encoding (writing it
+ * only if it fits in out_size bytes) or 0 for an unknown control or short
+ * value.  uvcutil_value_decode updates value in place; fields absent from the
+ * encoding keep their value.
+ */
+UVCUTIL_API size_t uvcutil_value_encode(size_t control_id,
+                                        const void* value,
+                                        size_t value_size,
+                                        uint8_t* out,
+                                        size_t out_size);
+UVCUTIL_API uvcutil_status_t uvcutil_value_decode(size_t control_id,
+                                                  const uint8_t* data,
+                                                  size_t length,
+                                                  void* value,
+                                                  size_t value_size);
+
+/*
+ * Devices
+ */
+
+/*!
+  @function uvcutil_device_list
+
+  Open every UVC-compliant device attached to the system.  On success
+  *devices receives an array of *count handles, to be released with
+  uvcutil_device_list_free (which closes any handle still in it; set an
+  entry to NULL to keep that device open).  A composite device is listed
+  once per VideoControl interface.
+*/
+UVCUTIL_API uvcutil_status_t uvcutil_device_list(uvcutil_device_t*** devices,
+                                                 size_t* count);
+UVCUTIL_API void uvcutil_device_list_free(uvcutil_device_t** devices,
+                                          size_t count);
+
+/* Open the attached device with the given USB locationID (the first
+   VideoControl interface of a composite device). */
+UVCUTIL_API uvcutil_device_t* uvcutil_device_open_location_id(
+    uint32_t location_id);
+
+/* Open the first attached device with the given vendor and product id. */
+UVCUTIL_API uvcutil_device_t* uvcutil_device_open_vendor_product(
+    uint16_t vendor_id,
+    uint16_t product_id);
+
+/* Open a simulated device reconstructed from a uvc-util device dump. */
+UVCUTIL_API uvcutil_device_t* uvcutil_device_open_dump(const char* path);
+
+/*!
+  @function uvcutil_device_close
+
+  Complete any queued asynchronous operations, then release the device and
+  every control handle obtained from it.  Must not be called from a
+  completion.
+*/
+UVCUTIL_API void uvcutil_device_close(uvcutil_device_t* device);
+
+UVCUTIL_API const char* uvcutil_device_name(const uvcutil_device_t* device);
+UVCUTIL_API const char* uvcutil_device_serial_number(
+    const uvcutil_device_t* device);
+UVCUTIL_API uint32_t uvcutil_device_location_id(const uvcutil_device_t* device);
+UVCUTIL_API uint16_t uvcutil_device_vendor_id(const uvcutil_device_t* device);
+UVCUTIL_API uint16_t uvcutil_device_product_id(const uvcutil_device_t* device);
+UVCUTIL_API uint16_t uvcutil_device_uvc_version(const uvcutil_device_t* device);
+/* The VideoControl interface the handle drives; devices with several (e.g.
+   stereo or RGB+IR cameras) have a handle per interface. */
+UVCUTIL_API uint8_t uvcutil_device_interface_number(
+    const uvcutil_device_t* device);
+
+/*!
+  @function uvcutil_device_control
+
+  Returns the handle of the given control, probing the device the first time
+  it is asked for.  Returns NULL if the device does not implement it.
+*/
+UVCUTIL_API uvcutil_control_t* uvcutil_device_control(uvcutil_device_t* device,
+                                                      size_t control_id);
+
+/*
+ * Control access.  Buffers hold the control's packed data (see
+ * uvcutil_control_type) and must be at least uvcutil_control_size bytes.
+ */
+UVCUTIL_API size_t uvcutil_control_get_id(const uvcutil_control_t* control);
+UVCUTIL_API uint32_t uvcutil_control_capabilities(
+    const uvcutil_control_t* control);
+UVCUTIL_API size_t uvcutil_control_size(const uvcutil_control_t* control);
+
+UVCUTIL_API uvcutil_status_t uvcutil_control_get(uvcutil_control_t* control,
+                                                 void* buffer,
+                                                 size_t size);
+UVCUTIL_API uvcutil_status_t uvcutil_control_set(uvcutil_control_t* control,
+                                                 const void* buffer,
+                                                 size_t size);
+UVCUTIL_API uvcutil_status_t uvcutil_control_get_attribute(
+    uvcutil_control_t* control,
+    uvcutil_attribute_t attribute,
+    void* buffer,
+    size_t size);
+
+/*!
+  @function uvcutil_control_set_string
+
+  Parse text as uvc-util's -s option does (including "default", "minimum",
+  "maximum" and fractional values) and write the result to the device.
+*/
+UVCUTIL_API uvcutil_status_t uvcutil_control_set_string(
+    uvcutil_control_t* control,
+    const char* text);
+
+/*!
+  @function uvcutil_control_format
+
+  Write the textual form of the value most recently read or written to
+  text, which holds size bytes.  Returns the length of the full text, as
+  snprintf does.
+*/
+UVCUTIL_API size_t uvcutil_control_format(uvcutil_control_t* control,
+                                          char* text,
+                                          size_t size);
+
+/*
+ * Batches.  Every operation is attempted, in order, under a single hold of
+ * the device; each one's status is recorded in its entry.  Returns UVCUTIL_OK
+ * if all succeeded, otherwise the status of the first that failed.  The
+ * device's cross-process lock is held for the batch (shared for gets,
+ * exclusive for sets); if another process keeps it past the timeout, nothing
+ * is attempted and every entry fails with UVCUTIL_ERROR_BUSY.
+ */
+UVCUTIL_API uvcutil_status_t uvcutil_device_get_batch(uvcutil_device_t* device,
+                                                      uvcutil_batch_op_t* ops,
+                                                      size_t count);
+UVCUTIL_API uvcutil_status_t uvcutil_device_set_batch(uvcutil_device_t* device,
+                                                      uvcutil_batch_op_t* ops,
+                                                      size_t count);
+
+/*
+ * Asynchronous operations.  The operation is queued to the device's worker
+ * thread and completion is invoked when it finishes.  For a set, buffer is
+ * copied before returning.  Returns an error (and never invokes completion)
+ * if the operation could not be queued.
+ */
+UVCUTIL_API uvcutil_status_t uvcutil_control_get_async(
+    uvcutil_control_t* control,
+    uvcutil_completion_t completion,
+    void* context);
+UVCUTIL_API uvcutil_status_t uvcutil_control_set_async(
+    uvcutil_control_t* control,
+    const void* buffer,
+    size_t size,
+    uvcutil_completion_t completion,
+    void* context);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* UVCUTIL_H */